@@ -0,0 +1,422 @@
+#ifndef	_CPUFRAMEDISPLAY_H_
+#define	_CPUFRAMEDISPLAY_H_
+
+#include	"Rect.h"
+#include	"Vector4.h"
+#include	"FrameBlend.h"
+#include	"AlignedBuffer.h"
+#include	"LatencyStats.h"
+#include	"boost/thread/thread.hpp"
+#include	"boost/thread/mutex.hpp"
+#include	"boost/thread/condition_variable.hpp"
+
+/*
+	CCPUFrameDisplay().
+	Piecewise cubic or linear interpolation for displays without shaders.
+	Does the same weighted sum as CCubicFrameDisplay/CLinearFrameDisplay, blended on a worker thread with CFrameBlend and uploaded as one texture per display frame.
+	The texture shown is the blend submitted on the previous display frame, so the worker runs while the render thread draws.
+*/
+class	CCPUFrameDisplay : public CFrameDisplay
+{
+	static const uint32 kMaxFrames = 4;
+
+	bool	m_bCubic;
+
+	fp4 m_LastAlpha;
+
+	//	The last four decoded frames of both streams.
+	ContentDecoder::spCVideoFrame	m_spFrames[ 2 * kMaxFrames ];
+
+	//	Simple ringbuffer, same order as in CCubicFrameDisplay.
+	uint32	m_Frames[ kMaxFrames ];
+	uint32	m_NumFrames;
+	uint32	m_NumSecondFrames;
+
+	bool m_bWaitNextFrame;
+
+	//	Work for the blend thread. Only raw pointers cross over, the frames stay referenced in m_spPinned until the job is collected.
+	typedef struct
+	{
+		const uint8	*m_pSources[ Base::CFrameBlend::kMaxSources ];
+		uint32		m_Strides[ Base::CFrameBlend::kMaxSources ];
+		fp4			m_Weights[ Base::CFrameBlend::kMaxSources ];
+		uint32		m_NumSources;
+		uint32		m_Width;
+		uint32		m_Height;
+		uint8		*m_pDst;
+	} sBlendJob;
+
+	sBlendJob	m_Job;
+	bool		m_bJobPending;
+	bool		m_bJobOut;
+
+	ContentDecoder::spCVideoFrame	m_spPinned[ Base::CFrameBlend::kMaxSources ];
+
+	boost::mutex				m_JobMutex;
+	boost::condition_variable	m_JobCond;
+	boost::condition_variable	m_DoneCond;
+	boost::thread				*m_pBlendThread;
+
+	Base::CFrameBlend::eKernel	m_Kernel;
+
+	//	Two result buffers, the worker fills one while the texture keeps the other.
+	Base::spCAlignedBuffer	m_spResults[ 2 ];
+	uint32	m_Back;
+	uint32	m_ResultWidth;
+	uint32	m_ResultHeight;
+
+	DisplayOutput::spCTextureFlat	m_spTexture;
+
+	//	Mitchell Netravali Reconstruction Filter.
+	fp4	MitchellNetravali( const fp4 _x, const fp4 _B, const fp4 _C )
+	{
+		float ax = fabsf(_x);
+
+		if( ax < 1.f )
+			return( (12.f - 9.f * _B - 6.f * _C) * ax * ax * ax + (-18.f + 12.f * _B + 6.f * _C) * ax * ax + (6.f - 2.f * _B)) / 6.f;
+		else if( (ax >= 1.f) && (ax < 2.f) )
+			return ((-_B - 6.f * _C) * ax * ax * ax + (6.f * _B + 30.f * _C) * ax * ax + (-12.f * _B - 48.f * _C) * ax + (8.f * _B + 24.f * _C)) / 6.f;
+		else
+			return 0.f;
+	}
+
+	//	Blend thread.
+	void	BlendThread()
+	{
+		try
+		{
+			while( true )
+			{
+				sBlendJob job;
+				{
+					boost::mutex::scoped_lock lock( m_JobMutex );
+					while( !m_bJobPending )
+						m_JobCond.wait( lock );
+					job = m_Job;
+				}
+
+				uint64 start = Base::CLatencyStats::Now();
+
+				const uint32 rowBytes = job.m_Width * 4;
+				bool bContiguous = true;
+				for( uint32 i=0; i<job.m_NumSources; i++ )
+					bContiguous &= ( job.m_Strides[i] == rowBytes );
+
+				if( bContiguous )
+					Base::CFrameBlend::Blend( job.m_pDst, job.m_pSources, job.m_Weights, job.m_NumSources, rowBytes * job.m_Height, m_Kernel );
+				else
+				{
+					const uint8 *rows[ Base::CFrameBlend::kMaxSources ];
+					for( uint32 y=0; y<job.m_Height; y++ )
+					{
+						for( uint32 i=0; i<job.m_NumSources; i++ )
+							rows[i] = job.m_pSources[i] + y * job.m_Strides[i];
+						Base::CFrameBlend::Blend( job.m_pDst + y * rowBytes, rows, job.m_Weights, job.m_NumSources, rowBytes, m_Kernel );
+					}
+				}
+
+				Base::g_LatencyStats().RecordSince( Base::eLatencyBlend, start );
+
+				{
+					boost::mutex::scoped_lock lock( m_JobMutex );
+					m_bJobPending = false;
+				}
+				m_DoneCond.notify_all();
+			}
+		}
+		catch( boost::thread_interrupted const & )
+		{
+		}
+	}
+
+	//	Get a frame from the decoder into slot _idx, keeping the pixels on the cpu.
+	bool	GrabFrameData( ContentDecoder::spCContentDecoder _spDecoder, const uint32 _idx, ContentDecoder::sMetaData &_metadata )
+	{
+		if( !FetchFrame( _spDecoder, _metadata ) )
+			return false;
+
+		m_spFrames[ _idx ] = m_spFrameData;
+		m_spFrames[ _idx + kMaxFrames ] = _metadata.m_SecondFrame;
+		return true;
+	}
+
+	//	Adds _weight of _spFrame to the job, merging repeated frames. Frames of another size than the job are left out.
+	void	AddSource( sBlendJob &_job, ContentDecoder::spCVideoFrame &_spFrame, const fp4 _weight )
+	{
+		if( _spFrame.IsNull() || _weight == 0.f || _spFrame->Width() != _job.m_Width || _spFrame->Height() != _job.m_Height )
+			return;
+
+		const uint8 *pData = _spFrame->StorageBuffer()->GetBufferPtr();
+		for( uint32 i=0; i<_job.m_NumSources; i++ )
+			if( _job.m_pSources[i] == pData )
+			{
+				_job.m_Weights[i] += _weight;
+				return;
+			}
+
+		if( _job.m_NumSources == Base::CFrameBlend::kMaxSources )
+			return;
+
+		m_spPinned[ _job.m_NumSources ] = _spFrame;
+		_job.m_pSources[ _job.m_NumSources ] = pData;
+		_job.m_Strides[ _job.m_NumSources ] = (uint32)_spFrame->Stride();
+		_job.m_Weights[ _job.m_NumSources ] = _weight;
+		_job.m_NumSources++;
+	}
+
+	//	Frame used for ring slot _slot when only _numFrames frames are there, the oldest one stands in for the missing ones.
+	ContentDecoder::spCVideoFrame	&Slot( const uint32 _slot, const uint32 _numFrames, const uint32 _offset )
+	{
+		uint32 framesToUse = ( _numFrames > kMaxFrames ) ? kMaxFrames : _numFrames;
+		uint32 slot = ( _slot < kMaxFrames - framesToUse ) ? kMaxFrames - framesToUse : _slot;
+		return m_spFrames[ m_Frames[ slot ] + _offset ];
+	}
+
+	//	Hand the blend for this display frame to the worker.
+	void	Submit( const fp4 *_pWeights, const fp4 _transition )
+	{
+		ContentDecoder::spCVideoFrame &spNewest = m_spFrames[ m_Frames[ kMaxFrames - 1 ] ];
+
+		sBlendJob job;
+		job.m_NumSources = 0;
+		job.m_Width = spNewest->Width();
+		job.m_Height = spNewest->Height();
+
+		if( m_ResultWidth != job.m_Width || m_ResultHeight != job.m_Height )
+		{
+			m_spResults[0] = new Base::CAlignedBuffer( job.m_Width * job.m_Height * 4 );
+			m_spResults[1] = new Base::CAlignedBuffer( job.m_Width * job.m_Height * 4 );
+			m_ResultWidth = job.m_Width;
+			m_ResultHeight = job.m_Height;
+		}
+		job.m_pDst = m_spResults[ m_Back ]->GetBufferPtr();
+
+		bool bSecond = m_NumSecondFrames > 0 && !m_spFrames[ m_Frames[ kMaxFrames - 1 ] + kMaxFrames ].IsNull() && _transition > 0.f;
+		fp4 first = bSecond ? 1.f - _transition : 1.f;
+
+		for( uint32 i=0; i<kMaxFrames; i++ )
+			AddSource( job, Slot( i, m_NumFrames, 0 ), _pWeights[i] * first );
+
+		if( bSecond )
+			for( uint32 i=0; i<kMaxFrames; i++ )
+				AddSource( job, Slot( i, m_NumSecondFrames, kMaxFrames ), _pWeights[i] * _transition );
+
+		if( job.m_NumSources == 0 )
+			AddSource( job, spNewest, 1.f );
+
+		//	Frames of another size were left out, don't let the picture darken because of it.
+		fp4 sum = 0.f;
+		for( uint32 i=0; i<job.m_NumSources; i++ )
+			sum += job.m_Weights[i];
+		if( sum > 0.f && fabsf( sum - 1.f ) > 0.001f )
+			for( uint32 i=0; i<job.m_NumSources; i++ )
+				job.m_Weights[i] /= sum;
+
+		{
+			boost::mutex::scoped_lock lock( m_JobMutex );
+			m_Job = job;
+			m_bJobPending = true;
+		}
+		m_JobCond.notify_one();
+		m_bJobOut = true;
+	}
+
+	//	Wait for the last submitted blend, and upload it.
+	void	Collect()
+	{
+		if( !m_bJobOut )
+			return;
+
+		{
+			boost::mutex::scoped_lock lock( m_JobMutex );
+			while( m_bJobPending )
+				m_DoneCond.wait( lock );
+		}
+
+		m_bJobOut = false;
+		for( uint32 i=0; i<Base::CFrameBlend::kMaxSources; i++ )
+			m_spPinned[i] = NULL;
+
+		if( m_spTexture.IsNull() )
+			m_spTexture = m_spRenderer->NewTextureFlat();
+
+		if( m_spTexture.IsNull() )
+			return;
+
+		if( m_spImageRef->GetWidth() != m_ResultWidth || m_spImageRef->GetHeight() != m_ResultHeight || m_spImageRef->GetFormat().getFormatEnum() != DisplayOutput::eImage_RGBA8 )
+			m_spImageRef->Create( m_ResultWidth, m_ResultHeight, DisplayOutput::eImage_RGBA8, false, true );
+
+		Base::CLatencyScope uploadScope( Base::eLatencyUpload );
+		m_spImageRef->SetStorageBuffer( m_spResults[ m_Back ] );
+		m_spTexture->Upload( m_spImageRef );
+
+		m_Back ^= 1;
+	}
+
+	public:
+			CCPUFrameDisplay( DisplayOutput::spCRenderer _spRenderer, const bool _bCubic ) : CFrameDisplay( _spRenderer ), m_bCubic( _bCubic )
+			{
+				m_LastAlpha = 1.f;
+
+				m_NumFrames = 0;
+				m_NumSecondFrames = 0;
+
+				m_Frames[0] = 0;
+				m_Frames[1] = 1;
+				m_Frames[2] = 2;
+				m_Frames[3] = 3;
+
+				m_bWaitNextFrame = false;
+
+				m_bJobPending = false;
+				m_bJobOut = false;
+				m_Back = 0;
+				m_ResultWidth = m_ResultHeight = 0;
+
+				m_Kernel = Base::CFrameBlend::Best();
+				g_Log->Info( "Blending frames on the cpu (%s)", Base::CFrameBlend::KernelName( m_Kernel ) );
+
+				m_pBlendThread = new boost::thread( boost::bind( &CCPUFrameDisplay::BlendThread, this ) );
+			}
+
+			virtual ~CCPUFrameDisplay()
+			{
+				m_pBlendThread->interrupt();
+				m_pBlendThread->join();
+				SAFE_DELETE( m_pBlendThread );
+			}
+
+			//	Blending works on RGB frames only.
+			virtual bool	EnableYUV()
+			{
+				return false;
+			}
+
+			virtual bool	EnableDXT()
+			{
+				return false;
+			}
+
+			//	Decode a frame every 1/_fpsCap seconds, store the previous 4 frames, and blend between them.
+			virtual bool	Update( ContentDecoder::spCContentDecoder _spDecoder, const fp8 _decodeFps, const fp8 /*_displayFps*/, ContentDecoder::sMetaData &_metadata )
+			{
+				fp4 currentalpha = m_LastAlpha;
+				bool frameGrabbed = false;
+				bool isSeam = false;
+
+				if( m_bWaitNextFrame )
+				{
+					if( !GrabFrameData( _spDecoder, m_Frames[3], _metadata ) )
+						return false;
+
+					frameGrabbed = true;
+					Reset();
+					m_bWaitNextFrame = false;
+				}
+				else
+				{
+					if( UpdateInterframeDelta( _decodeFps ) )
+					{
+						//	Shift array back one step.
+						uint32 tmp = m_Frames[ 0 ];
+						m_Frames[ 0 ] = m_Frames[ 1 ];
+						m_Frames[ 1 ] = m_Frames[ 2 ];
+						m_Frames[ 2 ] = m_Frames[ 3 ];
+						m_Frames[ 3 ] = tmp;
+
+						//	... and fill the frontmost slot.
+						if( !GrabFrameData( _spDecoder, m_Frames[3], _metadata ) )
+						{
+							m_bWaitNextFrame = true;
+							return false;
+						}
+
+						frameGrabbed = true;
+					}
+					else
+					{
+						currentalpha = (fp4)Base::Math::Clamped(m_LastAlpha +
+							Base::Math::Clamped(m_InterframeDelta/m_FadeCount, 0., 1./m_FadeCount)
+							, 0., 1.);
+					}
+				}
+
+				if( frameGrabbed )
+				{
+					m_MetaData = _metadata;
+					m_LastAlpha = m_MetaData.m_Fade;
+					currentalpha = m_LastAlpha;
+
+					m_NumFrames++;
+
+					if( m_spFrames[ m_Frames[3] + kMaxFrames ].IsNull() )
+						m_NumSecondFrames = 0;
+					else
+						m_NumSecondFrames++;
+
+					isSeam = _metadata.m_IsSeam;
+				}
+
+				if( m_NumFrames == 0 || m_spFrames[ m_Frames[3] ].IsNull() )
+					return true;
+
+				if( isSeam )
+				{
+					for( uint32 i=0; i<kMaxFrames-1; i++ )
+					{
+						m_spFrames[ m_Frames[i] ] = m_spFrames[ m_Frames[i] + kMaxFrames ];
+						m_spFrames[ m_Frames[i] + kMaxFrames ] = NULL;
+					}
+				}
+
+				fp4 weights[ kMaxFrames ];
+				const fp4 delta = fp4(m_InterframeDelta);
+				if( m_bCubic )
+				{
+					//	Same filter as CCubicFrameDisplay, B = 1, C = 0 - cubic B-spline.
+					const fp4 B = 1.0f;
+					const fp4 C = 0.0f;
+					weights[0] = MitchellNetravali( delta + 1.f, B, C );
+					weights[1] = MitchellNetravali( delta, B, C );
+					weights[2] = MitchellNetravali( 1.f - delta, B, C );
+					weights[3] = MitchellNetravali( 2.f - delta, B, C );
+				}
+				else
+				{
+					//	Lerp between the last two frames, like CLinearFrameDisplay.
+					weights[0] = weights[1] = 0.f;
+					weights[2] = 1.f - delta;
+					weights[3] = delta;
+				}
+
+				//	Show the previous blend and start on this one.
+				Collect();
+				Submit( weights, m_MetaData.m_TransitionProgress / 100.f );
+
+				//	Nothing to show yet on the very first frame.
+				if( m_spTexture.IsNull() )
+					Collect();
+
+				if( m_spTexture.IsNull() )
+					return false;
+
+				m_spRenderer->SetBlend( "alphablend" );
+				m_spRenderer->SetTexture( m_spTexture, 0 );
+				m_spRenderer->Apply();
+
+				UpdateTexRect( m_spTexture->GetRect() );
+
+				m_spRenderer->DrawQuad( m_texRect, Base::Math::CVector4( 1, 1, 1, currentalpha ), m_spTexture->GetRect() );
+
+				return true;
+			}
+
+			virtual fp8 GetFps( fp8 /*_decodeFps*/, fp8 _displayFps )
+			{
+				return _displayFps;
+			}
+};
+
+MakeSmartPointers( CCPUFrameDisplay );
+
+#endif
@@ -25,6 +25,13 @@ class	CCubicFrameDisplay : public CFrameDisplay
 	
 	bool m_bWaitNextFrame;
 
+	//	Where the renderer has texture arrays all frames are layers of one texture, bound once, and m_Layers maps the slots of m_spFrames to them (-1 is empty).
+	//	Uploading a frame only replaces a layer, no textures come and go as transitions start and end.
+	DisplayOutput::spCTextureArray	m_spRing;
+	DisplayOutput::spCShader		m_spRingShader;
+	DisplayOutput::spCShader		m_spRingYUVShader;
+	int32	m_Layers[ 2 * kMaxFrames ];
+
 	//	Mitchell Netravali Reconstruction Filter.
 	fp4	MitchellNetravali( const fp4 _x, const fp4 _B, const fp4 _C )
 	{
@@ -38,6 +45,195 @@ class	CCubicFrameDisplay : public CFrameDisplay
 			return 0.f;
 	}
 
+	//	Slot holds a frame.
+	bool	HasFrame( const uint32 _slot )
+	{
+		if( m_spRing.IsNull() )
+			return !m_spFrames[ _slot ].IsNull();
+
+		return m_Layers[ _slot ] >= 0;
+	}
+
+	//	A layer no slot refers to, there are as many layers as slots.
+	int32	FreeLayer( void )
+	{
+		for( int32 layer=0; layer<(int32)(2 * kMaxFrames); layer++ )
+		{
+			bool bUsed = false;
+			for( uint32 i=0; i<2 * kMaxFrames; i++ )
+				if( m_Layers[i] == layer )
+					bUsed = true;
+
+			if( !bUsed )
+				return layer;
+		}
+
+		return -1;
+	}
+
+	//	Back to separate textures, starting over with the frame at hand.
+	void	DropRing( void )
+	{
+		m_spRing = NULL;
+		m_spRingShader = NULL;
+		m_spRingYUVShader = NULL;
+		for( uint32 i=0; i<2 * kMaxFrames; i++ )
+			m_Layers[i] = -1;
+
+		m_NumFrames = 0;
+		m_NumSecondFrames = 0;
+	}
+
+	/*
+		UploadRingFrame().
+		Puts the fetched frame into the layer of _slot, and the transition frame into the layer of the second stream's slot.
+		The storage follows the first stream, so a new frame size only costs the frames before it. False if the second frame doesn't fit.
+	*/
+	bool	UploadRingFrame( const uint32 _slot, ContentDecoder::sMetaData &_metadata )
+	{
+		ContentDecoder::spCVideoFrame spSecondFrameData = _metadata.m_SecondFrame;
+
+		PrepareImageRef( m_spImageRef, m_spFrameData );
+		m_spImageRef->SetStorageBuffer( m_spFrameData->StorageBuffer(), m_spFrameData->Generation() );
+
+		if( !spSecondFrameData.IsNull() )
+		{
+			PrepareImageRef( m_spSecondImageRef, spSecondFrameData );
+			m_spSecondImageRef->SetStorageBuffer( spSecondFrameData->StorageBuffer(), spSecondFrameData->Generation() );
+
+			if( m_spSecondImageRef->GetWidth() != m_spImageRef->GetWidth() || m_spSecondImageRef->GetHeight() != m_spImageRef->GetHeight() ||
+				m_spSecondImageRef->GetFormat().getFormatEnum() != m_spImageRef->GetFormat().getFormatEnum() )
+				return false;
+		}
+
+		Base::CLatencyScope uploadScope( Base::eLatencyUpload );
+
+		if( m_Layers[ _slot ] < 0 )
+			m_Layers[ _slot ] = FreeLayer();
+
+		const uint32 allocations = m_spRing->Allocations();
+		if( !m_spRing->Upload( m_spImageRef, m_Layers[ _slot ], true ) )
+			return false;
+
+		//	Respecified, the older frames are gone.
+		if( m_spRing->Allocations() != allocations )
+		{
+			for( uint32 i=0; i<2 * kMaxFrames; i++ )
+				if( i != _slot )
+					m_Layers[i] = -1;
+
+			m_NumFrames = 0;
+			m_NumSecondFrames = 0;
+		}
+
+		if( spSecondFrameData.IsNull() )
+		{
+			m_Layers[ _slot + kMaxFrames ] = -1;
+			return true;
+		}
+
+		if( m_Layers[ _slot + kMaxFrames ] < 0 )
+			m_Layers[ _slot + kMaxFrames ] = FreeLayer();
+
+		return m_spRing->Upload( m_spSecondImageRef, m_Layers[ _slot + kMaxFrames ], false );
+	}
+
+	//	Fill the frontmost slot, and its second stream slot.
+	bool	Grab( ContentDecoder::spCContentDecoder _spDecoder, ContentDecoder::sMetaData &_metadata )
+	{
+		const uint32 slot = m_Frames[3];
+
+		if( m_spRing.IsNull() )
+			return GrabFrame( _spDecoder, m_spFrames[ slot ], m_spFrames[ slot + kMaxFrames ], _metadata );
+
+		if( !FetchFrame( _spDecoder, _metadata ) )
+			return false;
+
+		if( !UploadRingFrame( slot, _metadata ) )
+		{
+			//	Transitions between frames of different size or format (a lowres stream) don't fit one array.
+			g_Log->Warning( "Frames don't fit a texture array, using separate textures" );
+			DropRing();
+			return UploadFrame( m_spFrames[ slot ], m_spFrames[ slot + kMaxFrames ], _metadata );
+		}
+
+		return true;
+	}
+
+	/*
+		BindFrames().
+		Picks the frames the filter works on, the oldest one stands in for those not decoded yet.
+	*/
+	void	BindFrames( DisplayOutput::spCShader _spShader )
+	{
+		uint32 framesToUse = m_NumFrames;
+		
+		if (framesToUse > kMaxFrames)
+			framesToUse = kMaxFrames;
+
+		bool bSecond = m_NumSecondFrames > 0 && HasFrame( m_Frames[3] + kMaxFrames );
+		uint32 secFrameToUse = m_NumSecondFrames;
+		
+		if (secFrameToUse > kMaxFrames)
+			secFrameToUse = kMaxFrames;
+
+		if( !m_spRing.IsNull() )
+		{
+			//	One bind for all of them, the shader gets layer numbers.
+			fp4 layers[ kMaxFrames ], secondLayers[ kMaxFrames ];
+			for( uint32 i=0; i<kMaxFrames; i++ )
+			{
+				int32 layer = m_Layers[ m_Frames[ ( i < kMaxFrames-framesToUse ) ? kMaxFrames-framesToUse : i ] ];
+				layers[i] = (fp4)( ( layer >= 0 ) ? layer : m_Layers[ m_Frames[3] ] );
+
+				secondLayers[i] = layers[i];
+				if( bSecond )
+				{
+					layer = m_Layers[ m_Frames[ ( i < kMaxFrames-secFrameToUse ) ? kMaxFrames-secFrameToUse : i ] + kMaxFrames ];
+					secondLayers[i] = (fp4)( ( layer >= 0 ) ? layer : m_Layers[ m_Frames[3] + kMaxFrames ] );
+				}
+			}
+
+			_spShader->Set( "layers", layers[0], layers[1], layers[2], layers[3] );
+			_spShader->Set( "secondLayers", secondLayers[0], secondLayers[1], secondLayers[2], secondLayers[3] );
+			m_spRenderer->SetTexture( m_spRing, 1 );
+			return;
+		}
+
+		uint32 i;
+		
+		for (i = 0; i < kMaxFrames-framesToUse; i++)
+		{
+			uint32 realIdx = m_Frames[ kMaxFrames-framesToUse ];
+			
+			m_spRenderer->SetTexture( m_spFrames[ realIdx ], i + 1);						
+		}
+		
+		for (i = kMaxFrames-framesToUse; i < kMaxFrames; i++)
+		{
+			uint32 realIdx = m_Frames[i];
+
+			m_spRenderer->SetTexture( m_spFrames[ realIdx ], i + 1);
+		}
+		
+		if ( bSecond )
+		{
+			for (i = 0; i < kMaxFrames-secFrameToUse; i++)
+			{
+				uint32 realIdx = m_Frames[ kMaxFrames-secFrameToUse ];
+											
+				m_spRenderer->SetTexture( m_spFrames[ realIdx + kMaxFrames ], i + kMaxFrames + 1);
+			}
+			
+			for (i = kMaxFrames-secFrameToUse; i < kMaxFrames; i++)
+			{
+				uint32 realIdx = m_Frames[i];
+				
+				m_spRenderer->SetTexture( m_spFrames[ realIdx + kMaxFrames ], i + kMaxFrames + 1);
+			}
+		}
+	}
+
 	public:
 			CCubicFrameDisplay( DisplayOutput::spCRenderer _spRenderer ) : CFrameDisplay( _spRenderer )
 			{
@@ -115,6 +311,25 @@ class	CCubicFrameDisplay : public CFrameDisplay
 						gl_FragColor.a = newalpha;\
 					}";
 
+				//	glsl fragment shader, frames in a texture array.
+				static const char *cubic_fragmentshaderGLArray = "#extension GL_EXT_texture_array : enable\n\
+					uniform sampler2DArray texUnit1;	\
+					uniform vec4	layers;\
+					uniform vec4	secondLayers;\
+					uniform vec4	weights;\
+					uniform float	newalpha;\
+					uniform float	transPct;\
+					void main(void)\
+					{\
+						vec2 st = gl_TexCoord[0].st;\
+						vec4 fc1 = texture2DArray( texUnit1, vec3( st, layers.x ) ) * weights.x + texture2DArray( texUnit1, vec3( st, layers.y ) ) * weights.y +\
+								   texture2DArray( texUnit1, vec3( st, layers.z ) ) * weights.z + texture2DArray( texUnit1, vec3( st, layers.w ) ) * weights.w;\
+						vec4 fc2 = texture2DArray( texUnit1, vec3( st, secondLayers.x ) ) * weights.x + texture2DArray( texUnit1, vec3( st, secondLayers.y ) ) * weights.y +\
+								   texture2DArray( texUnit1, vec3( st, secondLayers.z ) ) * weights.z + texture2DArray( texUnit1, vec3( st, secondLayers.w ) ) * weights.w;\
+						gl_FragColor = mix(fc1, fc2, transPct / 100.0); \
+						gl_FragColor.a = newalpha;\
+					}";
+
 				//gl_FragColor = ( c0 * weights.x ) + ( c1 * weights.y ) + ( c2 * weights.z ) + ( c3 * weights.w );
 				//	hlsl vertexshader...
 				static const char *cubic_vertexshader = "\
@@ -175,6 +390,25 @@ class	CCubicFrameDisplay : public CFrameDisplay
 				m_NumFrames = 0;
 				m_NumSecondFrames = 0;
 
+				//	NULL unless this is a GL renderer with EXT_texture_array.
+				m_spRing = NULL;
+				m_spRingShader = NULL;
+				m_spRingYUVShader = NULL;
+				for( uint32 i=0; i<2 * kMaxFrames; i++ )
+					m_Layers[i] = -1;
+
+				if( m_spShader && g_Settings()->Get( "settings.player.TextureArray", true ) )
+				{
+					m_spRing = _spRenderer->NewTextureArray( 2 * kMaxFrames );
+					if( !m_spRing.IsNull() )
+						m_spRingShader = _spRenderer->NewShader( NULL, cubic_fragmentshaderGLArray );
+
+					if( m_spRingShader.IsNull() )
+						m_spRing = NULL;
+					else
+						g_Log->Info( "Cubic frames in a texture array" );
+				}
+
 				m_Frames[0] = 0;
 				m_Frames[1] = 1;
 				m_Frames[2] = 2;
@@ -183,6 +417,74 @@ class	CCubicFrameDisplay : public CFrameDisplay
 				m_bWaitNextFrame = false;
 			}
 
+			//	Same filter as cubic_fragmentshaderGL2D, done on YUV.
+			virtual bool	EnableYUV()
+			{
+				static const char *cubic_yuv_fragmentshaderGL = "\
+					uniform sampler2D texUnit1;	\
+					uniform sampler2D texUnit2;	\
+					uniform sampler2D texUnit3;	\
+					uniform sampler2D texUnit4;	\
+					uniform sampler2D texUnit5;	\
+					uniform sampler2D texUnit6;	\
+					uniform sampler2D texUnit7;	\
+					uniform sampler2D texUnit8;	\
+					uniform vec4	weights;\
+					uniform float	newalpha;\
+					uniform float	transPct;\
+					void main(void)\
+					{\
+						vec2 st = gl_TexCoord[0].st;\
+						vec3 fc1 = sampleYUV( texUnit1, st ) * weights.x + sampleYUV( texUnit2, st ) * weights.y +\
+								   sampleYUV( texUnit3, st ) * weights.z + sampleYUV( texUnit4, st ) * weights.w;\
+						vec3 fc2 = sampleYUV2( texUnit5, st ) * weights.x + sampleYUV2( texUnit6, st ) * weights.y +\
+								   sampleYUV2( texUnit7, st ) * weights.z + sampleYUV2( texUnit8, st ) * weights.w;\
+						gl_FragColor = vec4( yuv2rgb( mix( fc1, fc2, transPct / 100.0 ) ), newalpha );\
+					}";
+
+				static const char *cubic_yuv_fragmentshaderGLArray = "\
+					uniform sampler2DArray texUnit1;	\
+					uniform vec4	layers;\
+					uniform vec4	secondLayers;\
+					uniform vec4	weights;\
+					uniform float	newalpha;\
+					uniform float	transPct;\
+					void main(void)\
+					{\
+						vec2 st = gl_TexCoord[0].st;\
+						vec3 fc1 = sampleYUV( texUnit1, st, layers.x ) * weights.x + sampleYUV( texUnit1, st, layers.y ) * weights.y +\
+								   sampleYUV( texUnit1, st, layers.z ) * weights.z + sampleYUV( texUnit1, st, layers.w ) * weights.w;\
+						vec3 fc2 = sampleYUV( texUnit1, st, secondLayers.x ) * weights.x + sampleYUV( texUnit1, st, secondLayers.y ) * weights.y +\
+								   sampleYUV( texUnit1, st, secondLayers.z ) * weights.z + sampleYUV( texUnit1, st, secondLayers.w ) * weights.w;\
+						gl_FragColor = vec4( yuv2rgb( mix( fc1, fc2, transPct / 100.0 ) ), newalpha );\
+					}";
+
+				m_spYUVShader = NewYUVShader( cubic_yuv_fragmentshaderGL );
+				if( m_spYUVShader.IsNull() )
+					return false;
+
+				if( !m_spRing.IsNull() )
+				{
+					m_spRingYUVShader = NewYUVShader( cubic_yuv_fragmentshaderGLArray, true );
+					if( m_spRingYUVShader.IsNull() )
+						DropRing();
+				}
+
+				return true;
+			}
+
+			//	Sheep with and without a BC1 stream can meet in a transition, and one array can't hold both formats.
+			virtual bool	EnableDXT()
+			{
+				if( !m_spRing.IsNull() )
+				{
+					g_Log->Info( "BC1 frames, using separate textures" );
+					DropRing();
+				}
+
+				return true;
+			}
+
 			virtual ~CCubicFrameDisplay()
 			{
 			}
@@ -197,7 +499,7 @@ class	CCubicFrameDisplay : public CFrameDisplay
 				if (m_bWaitNextFrame)
 				{
 #if !defined(WIN32) && !defined(_MSC_VER)
-					if ( !GrabFrame( _spDecoder, m_spFrames[ m_Frames[3] ], m_spFrames[ m_Frames[3] + kMaxFrames ], _metadata) )
+					if ( !Grab( _spDecoder, _metadata ) )
 					{
 						return false;
 					} 
@@ -211,7 +513,7 @@ class	CCubicFrameDisplay : public CFrameDisplay
 					}
 
 #else
-					if ( GrabFrame( _spDecoder, m_spFrames[ m_Frames[3] ], m_spFrames[ m_Frames[3] + kMaxFrames ], _metadata ) )
+					if ( Grab( _spDecoder, _metadata ) )
 					{
 						frameGrabbed = true;
 
@@ -233,7 +535,7 @@ class	CCubicFrameDisplay : public CFrameDisplay
 						m_Frames[ 3 ] = tmp;
 
 						//	... and fill the frontmost slot.
-						if( !GrabFrame( _spDecoder, m_spFrames[ m_Frames[3] ], m_spFrames[ m_Frames[3] + kMaxFrames ], _metadata ) )
+						if( !Grab( _spDecoder, _metadata ) )
 						{
 							m_bWaitNextFrame = true;
 #if !defined(WIN32) && !defined(_MSC_VER)
@@ -261,7 +563,7 @@ class	CCubicFrameDisplay : public CFrameDisplay
 						
 					m_NumFrames++;
 						
-					if (m_spFrames[ m_Frames[3] + kMaxFrames ].IsNull())
+					if (!HasFrame( m_Frames[3] + kMaxFrames ))
 						m_NumSecondFrames = 0;
 					else
 						m_NumSecondFrames++;
@@ -270,65 +572,34 @@ class	CCubicFrameDisplay : public CFrameDisplay
 				}
 
 
-				if (m_NumFrames > 0 && !m_spFrames[ m_Frames[3] ].IsNull())
+				if (m_NumFrames > 0 && HasFrame( m_Frames[3] ))
 				{
 					//	Enable the shader.
-					m_spRenderer->SetShader( m_spShader );
+					DisplayOutput::spCShader spShader;
+					if( !m_spRing.IsNull() )
+						spShader = ( m_bYUVFrame && !m_spRingYUVShader.IsNull() ) ? m_spRingYUVShader : m_spRingShader;
+					else
+						spShader = ( m_bYUVFrame && !m_spYUVShader.IsNull() ) ? m_spYUVShader : m_spShader;
+					m_spRenderer->SetShader( spShader );
 					
 					if (isSeam)
-					{						
-						m_spFrames[ m_Frames[0] ] = m_spFrames[ m_Frames[0] + kMaxFrames ];
-						m_spFrames[ m_Frames[1] ] = m_spFrames[ m_Frames[1] + kMaxFrames ];
-						m_spFrames[ m_Frames[2] ] = m_spFrames[ m_Frames[2] + kMaxFrames ];
-												
-						m_spFrames[ m_Frames[0] + kMaxFrames ] = NULL;
-						m_spFrames[ m_Frames[1] + kMaxFrames ] = NULL;
-						m_spFrames[ m_Frames[2] + kMaxFrames ] = NULL;
-					}
-					
-					uint32 framesToUse = m_NumFrames;
-					
-					if (framesToUse > kMaxFrames)
-						framesToUse = kMaxFrames;
-					
-					uint32 i;
-					
-					for (i = 0; i < kMaxFrames-framesToUse; i++)
-					{
-						uint32 realIdx = m_Frames[ kMaxFrames-framesToUse ];
-						
-						m_spRenderer->SetTexture( m_spFrames[ realIdx ], i + 1);						
-					}
-					
-					for (i = kMaxFrames-framesToUse; i < kMaxFrames; i++)
-					{
-						uint32 realIdx = m_Frames[i];
-
-						m_spRenderer->SetTexture( m_spFrames[ realIdx ], i + 1);
-					}
-					
-					if ( m_NumSecondFrames > 0 && !m_spFrames[ m_Frames[3] + kMaxFrames ].IsNull() )
 					{
-					
-						uint32 secFrameToUse = m_NumSecondFrames;
-					
-						if (secFrameToUse > kMaxFrames)
-							secFrameToUse = kMaxFrames;
-												
-						for (i = 0; i < kMaxFrames-secFrameToUse; i++)
-						{
-							uint32 realIdx = m_Frames[ kMaxFrames-secFrameToUse ];
-														
-							m_spRenderer->SetTexture( m_spFrames[ realIdx + kMaxFrames ], i + kMaxFrames + 1);
-						}
-						
-						for (i = kMaxFrames-secFrameToUse; i < kMaxFrames; i++)
+						for( uint32 i=0; i<kMaxFrames-1; i++ )
 						{
-							uint32 realIdx = m_Frames[i];
-							
-							m_spRenderer->SetTexture( m_spFrames[ realIdx + kMaxFrames ], i + kMaxFrames + 1);
+							if( !m_spRing.IsNull() )
+							{
+								m_Layers[ m_Frames[i] ] = m_Layers[ m_Frames[i] + kMaxFrames ];
+								m_Layers[ m_Frames[i] + kMaxFrames ] = -1;
+							}
+							else
+							{
+								m_spFrames[ m_Frames[i] ] = m_spFrames[ m_Frames[i] + kMaxFrames ];
+								m_spFrames[ m_Frames[i] + kMaxFrames ] = NULL;
+							}
 						}
 					}
+					
+					BindFrames( spShader );
 
 					//	B = 1,   C = 0   - cubic B-spline
 					//	B = 1/3, C = 1/3 - nice
@@ -337,18 +608,24 @@ class	CCubicFrameDisplay : public CFrameDisplay
 					const fp4 C = 0.0f;
 
 					//	Set the filter weights...
-					m_spShader->Set( "weights", MitchellNetravali( fp4(m_InterframeDelta) + 1.f, B, C ), MitchellNetravali( fp4(m_InterframeDelta), B, C ),
+					spShader->Set( "weights", MitchellNetravali( fp4(m_InterframeDelta) + 1.f, B, C ), MitchellNetravali( fp4(m_InterframeDelta), B, C ),
 												MitchellNetravali( 1.f - fp4(m_InterframeDelta), B, C ), MitchellNetravali( 2.f - fp4(m_InterframeDelta), B, C ) );
-					m_spShader->Set( "newalpha", currentalpha);
+					spShader->Set( "newalpha", currentalpha);
 					
-					m_spShader->Set( "transPct", m_MetaData.m_TransitionProgress);
+					spShader->Set( "transPct", m_MetaData.m_TransitionProgress);
+
+					const Base::Math::CRect texRect = m_spRing.IsNull() ? m_spFrames[ m_Frames[3] ]->GetRect() : m_spRing->GetRect();
+					const Base::Math::CRect secondTexRect = ( m_spRing.IsNull() && !m_spFrames[ m_Frames[3] + kMaxFrames ].IsNull() ) ? m_spFrames[ m_Frames[3] + kMaxFrames ]->GetRect() : texRect;
+
+					if( spShader == m_spYUVShader || spShader == m_spRingYUVShader )
+						SetYUVUniforms( spShader, texRect, secondTexRect );
 
 					m_spRenderer->SetBlend( "alphablend" );
 					m_spRenderer->Apply();
                     
-                    UpdateTexRect( m_spFrames[ m_Frames[3] ]->GetRect() );
+                    UpdateTexRect( texRect );
                     
-					m_spRenderer->DrawQuad( m_texRect, Base::Math::CVector4( 1, 1, 1, currentalpha), m_spFrames[ m_Frames[3] ]->GetRect() );
+					m_spRenderer->DrawQuad( m_texRect, Base::Math::CVector4( 1, 1, 1, currentalpha), texRect );
 				}
 
 				return true;
@@ -2,6 +2,8 @@
 #define	_FRAMEDISPLAY_H_
 
 #include	"TextureFlat.h"
+#include	"Shader.h"
+#include	"LatencyStats.h"
 #include	"Player.h"
 #include	"Rect.h"
 #include	"Vector4.h"
@@ -42,6 +44,9 @@ class	CFrameDisplay
 		
 		DisplayOutput::spCRenderer	m_spRenderer;
 
+		//	Which of the decoder's readers this is, displays playing the same decoder need one each.
+		uint32	m_FrameReader;
+
 		//	Dimensions of the display surface.
 		Base::Math::CRect	m_dispSize;
     
@@ -58,8 +63,146 @@ class	CFrameDisplay
     
         bool m_bPreserveAR;
 
-		//	Grab a frame from the decoder and use it as a texture.
-		bool	GrabFrame( ContentDecoder::spCContentDecoder _spDecoder, DisplayOutput::spCTextureFlat &_spTexture, DisplayOutput::spCTextureFlat &_spSecondTexture, ContentDecoder::sMetaData &_metadata )
+		//	Colour conversion for packed YUV frames, NULL until EnableYUV() succeeds.
+		DisplayOutput::spCShader	m_spYUVShader;
+
+		//	Last grabbed frame was packed YUV, and its video size.
+		bool	m_bYUVFrame;
+		uint32	m_YUVWidth;
+		uint32	m_YUVHeight;
+
+		//	Video size of the transition frame that came with it, a lowres stream can be smaller.
+		uint32	m_SecondYUVWidth;
+		uint32	m_SecondYUVHeight;
+
+		/*
+			YUVFunctions().
+			GLSL helpers shared by all YUV shaders: sampleYUV() reads the Y, U and V of a point of a packed frame texture, yuv2rgb() converts (BT.601, video range).
+			sampleYUV2() is the same for transition frames, which have their own plane layout (the yuv*2 uniforms).
+			Being linear, blending can happen on YUV values, with a single conversion at the end.
+		*/
+		static const char *YUVFunctions()
+		{
+			return "\
+				uniform vec4 yuvLuma;\
+				uniform vec4 yuvChroma;\
+				uniform vec4 yuvChromaClamp;\
+				uniform vec4 yuvLuma2;\
+				uniform vec4 yuvChroma2;\
+				uniform vec4 yuvChromaClamp2;\
+				vec3 sampleYUV( sampler2D tex, vec2 st, vec4 luma, vec4 chroma, vec4 chromaClamp )\
+				{\
+					vec2 c = clamp( st * chroma.xy + vec2( 0.0, chroma.z ), chromaClamp.xy, chromaClamp.zw );\
+					return vec3( texture2D( tex, min( st * luma.xy, luma.zw ) ).r,\
+								 texture2D( tex, c ).r,\
+								 texture2D( tex, c + vec2( chroma.w, 0.0 ) ).r );\
+				}\
+				vec3 sampleYUV( sampler2D tex, vec2 st )\
+				{\
+					return sampleYUV( tex, st, yuvLuma, yuvChroma, yuvChromaClamp );\
+				}\
+				vec3 sampleYUV2( sampler2D tex, vec2 st )\
+				{\
+					return sampleYUV( tex, st, yuvLuma2, yuvChroma2, yuvChromaClamp2 );\
+				}\
+				vec3 yuv2rgb( vec3 yuv )\
+				{\
+					yuv -= vec3( 0.0625, 0.5, 0.5 );\
+					return mat3( 1.1644, 1.1644, 1.1644, 0.0, -0.3918, 2.0172, 1.5960, -0.8130, 0.0 ) * yuv;\
+				}";
+		}
+
+		//	sampleYUV() for a layer of a texture array, transition frames only share an array when they are the same size.
+		static const char *YUVArrayFunctions()
+		{
+			return "\
+				vec3 sampleYUV( sampler2DArray tex, vec2 st, float layer )\
+				{\
+					vec2 c = clamp( st * yuvChroma.xy + vec2( 0.0, yuvChroma.z ), yuvChromaClamp.xy, yuvChromaClamp.zw );\
+					return vec3( texture2DArray( tex, vec3( min( st * yuvLuma.xy, yuvLuma.zw ), layer ) ).r,\
+								 texture2DArray( tex, vec3( c, layer ) ).r,\
+								 texture2DArray( tex, vec3( c + vec2( yuvChroma.w, 0.0 ), layer ) ).r );\
+				}";
+		}
+
+		//	Compile a YUV shader, _pMain is appended to YUVFunctions(), and YUVArrayFunctions() if it samples a texture array.
+		DisplayOutput::spCShader	NewYUVShader( const char *_pMain, const bool _bArray = false )
+		{
+#ifdef MAC
+			//	Mac textures use client storage with 4 byte pixels, no 8 bit packed frames there.
+			(void)_pMain;
+			(void)_bArray;
+			return NULL;
+#else
+			if( m_spRenderer->Type() != DisplayOutput::eGL )
+				return NULL;
+
+			std::string source = std::string( YUVFunctions() ) + _pMain;
+			if( _bArray )
+				source = std::string( "#extension GL_EXT_texture_array : enable\n" ) + YUVFunctions() + YUVArrayFunctions() + _pMain;
+
+			return m_spRenderer->NewShader( NULL, source.c_str() );
+#endif
+		}
+
+		/*
+			SetYUVPlanes().
+			Maps the texture coordinates of a quad covering a packed _width x _height frame texture to its Y, U and V planes.
+			_texRect is the rect of that texture, _pSuffix picks the uniform set ("" for sampleYUV(), "2" for sampleYUV2()).
+		*/
+		void	SetYUVPlanes( DisplayOutput::spCShader _spShader, const char *_pSuffix, const uint32 _width, const uint32 _height, const Base::Math::CRect &_texRect )
+		{
+			const fp4 w = (fp4)_width;
+			const fp4 h = (fp4)_height;
+			const fp4 cw = (fp4)( (_width + 1) / 2 );
+			const fp4 ch = (fp4)( (_height + 1) / 2 );
+			const fp4 pw = (fp4)ContentDecoder::PackedYUVWidth( _width );
+			const fp4 ph = (fp4)ContentDecoder::PackedYUVHeight( _height );
+			const fp4 rx = _texRect.m_X1;
+			const fp4 ry = _texRect.m_Y1;
+			const std::string suffix( _pSuffix );
+
+			//	Half a texel in, so filtering never picks up the neighbouring plane.
+			_spShader->Set( "yuvLuma" + suffix, w / pw, h / ph, (w - 0.5f) / pw * rx, (h - 0.5f) / ph * ry );
+			_spShader->Set( "yuvChroma" + suffix, cw / pw, ch / ph, h / ph * ry, 0.5f * rx );
+			_spShader->Set( "yuvChromaClamp" + suffix, 0.5f / pw * rx, (h + 0.5f) / ph * ry, (cw - 0.5f) / pw * rx, (h + ch - 0.5f) / ph * ry );
+		}
+
+		/*
+			SetYUVUniforms().
+			Both uniform sets, the fetched frame's from _texRect and the transition frame's from _secondTexRect (the texture rects passed to DrawQuad()).
+		*/
+		void	SetYUVUniforms( DisplayOutput::spCShader _spShader, const Base::Math::CRect &_texRect, const Base::Math::CRect &_secondTexRect )
+		{
+			SetYUVPlanes( _spShader, "", m_YUVWidth, m_YUVHeight, _texRect );
+			SetYUVPlanes( _spShader, "2", m_SecondYUVWidth, m_SecondYUVHeight, _secondTexRect );
+		}
+
+		//	(Re)create _spImage if it doesn't fit the frame.
+		void	PrepareImageRef( DisplayOutput::spCImage &_spImage, ContentDecoder::spCVideoFrame &_spFrame )
+		{
+			uint32 width = _spFrame->Width();
+			uint32 height = _spFrame->Height();
+			DisplayOutput::eImageFormat format = DisplayOutput::eImage_RGBA8;
+
+			if( _spFrame->IsPackedYUV() )
+			{
+				width = ContentDecoder::PackedYUVWidth( width );
+				height = ContentDecoder::PackedYUVHeight( height );
+				format = DisplayOutput::eImage_I8;
+			}
+			else if( _spFrame->IsDXT1() )
+				format = DisplayOutput::eImage_DXT1;
+
+			if( _spImage->GetWidth() != width || _spImage->GetHeight() != height || _spImage->GetFormat().getFormatEnum() != format )
+			{
+				//	Frame differs in size, recreate ref image.
+				_spImage->Create( width, height, format, false, true );
+			}
+		}
+
+		//	Get the next frame from the decoder into m_spFrameData, and its metadata.
+		bool	FetchFrame( ContentDecoder::spCContentDecoder _spDecoder, ContentDecoder::sMetaData &_metadata )
 		{
 			//_metadata.m_Fade = 1.0f;
 			m_MetaData = _metadata;
@@ -72,72 +215,91 @@ class	CFrameDisplay
 			m_spFrameData = NULL;
 
 			//	Spin until we have a decoded frame from decoder.	(spin really?)
-			m_spFrameData = _spDecoder->Frame();
-			if( m_spFrameData != NULL )
+			m_spFrameData = _spDecoder->Frame( m_FrameReader );
+			if( m_spFrameData == NULL )
 			{
-				m_spFrameData->GetMetaData(_metadata);
-				m_MetaData = _metadata;
-				if( m_spImageRef->GetWidth() != m_spFrameData->Width() || m_spImageRef->GetHeight() != m_spFrameData->Height() )
-				{
-					//	Frame differs in size, recreate ref image.
-					m_spImageRef->Create( m_spFrameData->Width(), m_spFrameData->Height(), DisplayOutput::eImage_RGBA8, false, true );
-				}
+				g_Log->Warning( "failed to get frame..." );
+				return false;
+			}
 
-				if (_spTexture.IsNull())
-					_spTexture = m_spRenderer->NewTextureFlat();
-				
-				if( _spTexture == NULL )
-					return false;
-				
-				//	Set image texturedata and upload to texture.
-				m_spImageRef->SetStorageBuffer( m_spFrameData->StorageBuffer() );
-				_spTexture->Upload( m_spImageRef );
-				
+			m_spFrameData->GetMetaData(_metadata);
+			m_MetaData = _metadata;
+
+			m_bYUVFrame = m_spFrameData->IsPackedYUV();
+			m_YUVWidth = m_spFrameData->Width();
+			m_YUVHeight = m_spFrameData->Height();
+			m_SecondYUVWidth = m_YUVWidth;
+			m_SecondYUVHeight = m_YUVHeight;
+			if( !_metadata.m_SecondFrame.IsNull() )
+			{
+				m_SecondYUVWidth = _metadata.m_SecondFrame->Width();
+				m_SecondYUVHeight = _metadata.m_SecondFrame->Height();
+			}
+			if( m_bYUVFrame && m_spYUVShader.IsNull() )
+				g_Log->Warning( "YUV frame without YUV shader" );
+
+			return true;
+		}
+
+		//	Upload the frame FetchFrame() got, and the transition frame that came with it.
+		bool	UploadFrame( DisplayOutput::spCTextureFlat &_spTexture, DisplayOutput::spCTextureFlat &_spSecondTexture, ContentDecoder::sMetaData &_metadata )
+		{
+			PrepareImageRef( m_spImageRef, m_spFrameData );
+
+			if (_spTexture.IsNull())
+				_spTexture = m_spRenderer->NewTextureFlat();
+			
+			if( _spTexture == NULL )
+				return false;
+			
+			//	Set image texturedata and upload to texture.
+			Base::CLatencyScope uploadScope( Base::eLatencyUpload );
+			m_spImageRef->SetStorageBuffer( m_spFrameData->StorageBuffer(), m_spFrameData->Generation() );
+			_spTexture->Upload( m_spImageRef );
+			
 #ifdef FRAME_DIAG
-				g_Log->Info( "Grabbing frame %ld/%ld from %ld (first)...prog - %f, seam - %d", _metadata.m_FrameIdx, _metadata.m_MaxFrameIdx, _metadata.m_SheepID, _metadata.m_TransitionProgress, _metadata.m_IsSeam );
+			g_Log->Info( "Grabbing frame %ld/%ld from %ld (first)...prog - %f, seam - %d", _metadata.m_FrameIdx, _metadata.m_MaxFrameIdx, _metadata.m_SheepID, _metadata.m_TransitionProgress, _metadata.m_IsSeam );
 #endif				
+			
+			ContentDecoder::spCVideoFrame spSecondFrameData = _metadata.m_SecondFrame;
+			
+			if (!spSecondFrameData.IsNull())
+			{
+				PrepareImageRef( m_spSecondImageRef, spSecondFrameData );
+
+				if (_spSecondTexture.IsNull())
+					_spSecondTexture = m_spRenderer->NewTextureFlat();
 				
-				ContentDecoder::spCVideoFrame spSecondFrameData = _metadata.m_SecondFrame;
-				
-				if (!spSecondFrameData.IsNull())
+				if( _spSecondTexture != NULL )
 				{
-					if( m_spSecondImageRef->GetWidth() != spSecondFrameData->Width() || m_spSecondImageRef->GetHeight() != spSecondFrameData->Height() )
-					{
-						//	Frame differs in size, recreate ref image.
-						m_spSecondImageRef->Create( spSecondFrameData->Width(), spSecondFrameData->Height(), DisplayOutput::eImage_RGBA8, false, true );
-					}
-
-					if (_spSecondTexture.IsNull())
-						_spSecondTexture = m_spRenderer->NewTextureFlat();
+					//	Set image texturedata and upload to texture.
+					m_spSecondImageRef->SetStorageBuffer( spSecondFrameData->StorageBuffer(), spSecondFrameData->Generation() );
+					_spSecondTexture->Upload( m_spSecondImageRef );
 					
-					if( _spSecondTexture != NULL )
-					{
-						//	Set image texturedata and upload to texture.
-						m_spSecondImageRef->SetStorageBuffer( spSecondFrameData->StorageBuffer() );
-						_spSecondTexture->Upload( m_spSecondImageRef );
-						
 #ifdef FRAME_DIAG
-						ContentDecoder::sMetaData tmpMetaData;
-						
-						spSecondFrameData->GetMetaData(tmpMetaData);
-						
-						g_Log->Info( "Grabbing frame %ld/%d from %ld (second)...prog - %f, seam - %d", tmpMetaData.m_FrameIdx, tmpMetaData.m_MaxFrameIdx, tmpMetaData.m_SheepID, tmpMetaData.m_TransitionProgress, tmpMetaData.m_IsSeam );
+					ContentDecoder::sMetaData tmpMetaData;
+					
+					spSecondFrameData->GetMetaData(tmpMetaData);
+					
+					g_Log->Info( "Grabbing frame %ld/%d from %ld (second)...prog - %f, seam - %d", tmpMetaData.m_FrameIdx, tmpMetaData.m_MaxFrameIdx, tmpMetaData.m_SheepID, tmpMetaData.m_TransitionProgress, tmpMetaData.m_IsSeam );
 #endif
-					}
 				}
-				else
-					_spSecondTexture = NULL;
-
 			}
 			else
-			{
-				g_Log->Warning( "failed to get frame..." );
-				return false;
-			}
+				_spSecondTexture = NULL;
 			
 			return true;
 		}
 
+		//	Grab a frame from the decoder and use it as a texture.
+		bool	GrabFrame( ContentDecoder::spCContentDecoder _spDecoder, DisplayOutput::spCTextureFlat &_spTexture, DisplayOutput::spCTextureFlat &_spSecondTexture, ContentDecoder::sMetaData &_metadata )
+		{
+			if( !FetchFrame( _spDecoder, _metadata ) )
+				return false;
+
+			return UploadFrame( _spTexture, _spSecondTexture, _metadata );
+		}
+
 		//	Do some math to figure out the delta between frames...
 		bool	UpdateInterframeDelta( const fp8 _fpsCap )
 		{
@@ -187,6 +349,7 @@ class	CFrameDisplay
 				m_Acc = 0;
 				m_T = 0;
 				m_spRenderer = _spRenderer;
+				m_FrameReader = 0;
 				m_spImageRef = new DisplayOutput::CImage();
 				m_spSecondImageRef = new DisplayOutput::CImage();
 				m_bValid = true;
@@ -197,6 +360,10 @@ class	CFrameDisplay
                 m_LastTexMoveClock = -1;
                 m_CurTexMoveOff = 0;
                 m_CurTexMoveDir = 1.;
+				m_spYUVShader = NULL;
+				m_bYUVFrame = false;
+				m_YUVWidth = m_YUVHeight = 0;
+				m_SecondYUVWidth = m_SecondYUVHeight = 0;
 			}
 
 			virtual ~CFrameDisplay()
@@ -207,6 +374,32 @@ class	CFrameDisplay
 
 			bool Valid()	{	return m_bValid;	};
 
+			/*
+				EnableYUV().
+				Prepare for packed YUV frames, returns false if this display can't show them.
+			*/
+			virtual bool	EnableYUV()
+			{
+				static const char *yuv_fragmentshaderGL = "\
+					uniform sampler2D texUnit0;\
+					void main(void)\
+					{\
+						gl_FragColor = vec4( yuv2rgb( sampleYUV( texUnit0, gl_TexCoord[0].st ) ), gl_Color.a );\
+					}";
+
+				m_spYUVShader = NewYUVShader( yuv_fragmentshaderGL );
+				return !m_spYUVShader.IsNull();
+			}
+
+			/*
+				EnableDXT().
+				False if this display needs the pixels of a frame, BC1 frames only go straight to a texture.
+			*/
+			virtual bool	EnableDXT()
+			{
+				return true;
+			}
+
 			//
 			void	SetDisplaySize( const uint32 _w, const uint32 _h )
 			{
@@ -214,6 +407,23 @@ class	CFrameDisplay
                 m_CurTexMoveOff = 0.f;
 			}
 
+			//	See CContentDecoder::Frame().
+			void	SetFrameReader( const uint32 _reader )
+			{
+				m_FrameReader = _reader;
+			}
+
+			/*
+				SetRenderer().
+				Displays whose contexts share objects share one frame display, see CPlayer::AddDisplay(). It draws through _spRenderer until the next call,
+				with the textures and shaders it made through any of them.
+			*/
+			void	SetRenderer( DisplayOutput::spCRenderer _spRenderer, const uint32 _w, const uint32 _h )
+			{
+				m_spRenderer = _spRenderer;
+				m_dispSize = Base::Math::CRect( _w, _h );
+			}
+
 			//	Decode a frame, and render it.
 			virtual bool	Update( ContentDecoder::spCContentDecoder _spDecoder, const fp8 _decodeFps, const fp8 /*_displayFps*/, ContentDecoder::sMetaData &_metadata )
 			{
@@ -265,6 +475,11 @@ class	CFrameDisplay
 				//	Bind texture and render a quad covering the screen.
 				m_spRenderer->SetBlend( "alphablend" );
 				m_spRenderer->SetTexture( m_spVideoTexture, 0 );
+				if( m_bYUVFrame && !m_spYUVShader.IsNull() )
+				{
+					m_spRenderer->SetShader( m_spYUVShader );
+					SetYUVPlanes( m_spYUVShader, "", m_YUVWidth, m_YUVHeight, m_spVideoTexture->GetRect() );
+				}
 				m_spRenderer->Apply();
 
                 //UpdateInterframeDelta( _decodeFps );
@@ -279,9 +494,11 @@ class	CFrameDisplay
 				{
 					//	Bind the second texture and render a quad covering the screen.
 					m_spRenderer->SetTexture( m_spSecondVideoTexture, 0 );
+					if( m_bYUVFrame && !m_spYUVShader.IsNull() )
+						SetYUVPlanes( m_spYUVShader, "", m_SecondYUVWidth, m_SecondYUVHeight, m_spSecondVideoTexture->GetRect() );
 					m_spRenderer->Apply();
                     
-                    m_spRenderer->DrawQuad( m_texRect, Base::Math::CVector4( 1,1,1, currentalpha * transCoef ), m_spVideoTexture->GetRect() );
+                    m_spRenderer->DrawQuad( m_texRect, Base::Math::CVector4( 1,1,1, currentalpha * transCoef ), m_spSecondVideoTexture->GetRect() );
 				}
 
 				return true;
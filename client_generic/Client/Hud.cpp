@@ -8,7 +8,7 @@ namespace	Hud
 
 /*
 */
-CHudManager::CHudManager()
+CHudManager::CHudManager() : m_UpdateInterval( 0.25 ), m_NextUpdate( 0 ), m_bUpdate( false )
 {
 	m_Timer.Reset();
 }
@@ -27,6 +27,7 @@ bool	CHudManager::Add( const std::string _name, spCHudEntry _entry, fp8 _duratio
 {
 	_entry->SetTime( m_Timer.Time(), _duration );
 	m_EntryMap[ _name ] = _entry;
+	m_NextUpdate = 0;
 	return true;
 }
 
@@ -38,6 +39,19 @@ bool	CHudManager::Remove( const std::string _name )
 	return true;
 }
 
+/*
+*/
+bool	CHudManager::Tick()
+{
+	fp8 time = m_Timer.Time();
+	if( time < m_NextUpdate )
+		return false;
+
+	m_NextUpdate = time + m_UpdateInterval;
+	m_bUpdate = true;
+	return true;
+}
+
 /*
 */
 bool	CHudManager::Render( DisplayOutput::spCRenderer _spRenderer )
@@ -49,6 +63,10 @@ bool	CHudManager::Render( DisplayOutput::spCRenderer _spRenderer )
 	_spRenderer->Orthographic();
 	_spRenderer->Apply();
 
+	const fp8 time = m_Timer.Time();
+	const bool bUpdate = m_bUpdate;
+	m_bUpdate = false;
+
     std::map<std::string, spCHudEntry>::iterator i;
 	for( i=m_EntryMap.begin(); i != m_EntryMap.end(); )
 	{
@@ -57,7 +75,10 @@ bool	CHudManager::Render( DisplayOutput::spCRenderer _spRenderer )
 
 		if( e->Visible() )
 		{
-			if( !e->Render( m_Timer.Time(), _spRenderer ) )
+			if( bUpdate )
+				e->Update( time, _spRenderer );
+
+			if( !e->Render( time, _spRenderer ) )
 				bRemove = true;
 		}
 
@@ -92,6 +113,7 @@ void	CHudManager::Toggle( const std::string _entry )
 	bool bState = m_EntryMap[ _entry ]->Visible();
 	HideAll();
 	m_EntryMap[ _entry ]->Visible( !bState);
+	m_NextUpdate = 0;
 }
 
 void	CHudManager::Hide( const std::string _entry )
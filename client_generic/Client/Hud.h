@@ -9,6 +9,85 @@
 namespace	Hud
 {
 
+/*
+	CTextCache.
+	A string drawn into a texture once, and from then on as a single quad until the string changes.
+	Where the renderer can't draw text into an image it falls back to Text() every time.
+*/
+class	CTextCache
+{
+	std::string						m_Text;
+	bool							m_bValid;
+	uint32							m_DisplayWidth, m_DisplayHeight;
+	Base::Math::CVector2			m_Size;
+	DisplayOutput::spCTextureFlat	m_spTexture;
+
+	public:
+			CTextCache() : m_bValid( false ), m_DisplayWidth( 0 ), m_DisplayHeight( 0 )	{};
+
+			/*
+				Update().
+				Sets the text, measuring and redrawing it only if it changed, or if the display did (extents are relative to it).
+			*/
+			const Base::Math::CVector2	&Update( DisplayOutput::spCRenderer _spRenderer, DisplayOutput::spCBaseFont _spFont, const std::string &_text )
+			{
+				const uint32 w = _spRenderer->Display()->Width();
+				const uint32 h = _spRenderer->Display()->Height();
+
+				if( m_bValid && _text == m_Text && w == m_DisplayWidth && h == m_DisplayHeight )
+					return m_Size;
+
+				m_Text = _text;
+				m_DisplayWidth = w;
+				m_DisplayHeight = h;
+				m_Size = _spRenderer->GetTextExtent( _spFont, m_Text );
+				m_bValid = true;
+
+				DisplayOutput::spCImage spImage = _spRenderer->TextImage( _spFont, m_Text );
+				if( spImage.IsNull() )
+				{
+					m_spTexture = NULL;
+					return m_Size;
+				}
+
+				if( m_spTexture.IsNull() )
+					m_spTexture = _spRenderer->NewTextureFlat();
+
+				if( m_spTexture.IsNull() || !m_spTexture->Upload( spImage ) )
+					m_spTexture = NULL;
+
+				return m_Size;
+			}
+
+			bool	Valid() const	{	return m_bValid;	};
+			bool	Cached() const	{	return !m_spTexture.IsNull();	};
+			const Base::Math::CVector2	&Size() const	{	return m_Size;	};
+
+			/*
+				Render().
+				Top left corner at _x, _y, snapped to whole pixels so the texels land on them exactly.
+			*/
+			void	Render( DisplayOutput::spCRenderer _spRenderer, DisplayOutput::spCBaseFont _spFont, const fp4 _x, const fp4 _y )
+			{
+				if( m_spTexture.IsNull() )
+				{
+					_spRenderer->Text( _spFont, m_Text, Base::Math::CVector4( 1, 1, 1, 1 ), Base::Math::CRect( _x, _y, 1, 1 ), 0 );
+					return;
+				}
+
+				const fp4 w = (fp4)m_DisplayWidth;
+				const fp4 h = (fp4)m_DisplayHeight;
+				const fp4 x = floorf( _x * w + 0.5f ) / w;
+				const fp4 y = floorf( _y * h + 0.5f ) / h;
+
+				_spRenderer->SetTexture( m_spTexture, 0 );
+				_spRenderer->Apply();
+				_spRenderer->DrawQuad( Base::Math::CRect( x, y, x + m_Size.m_X, y + m_Size.m_Y ), Base::Math::CVector4( 1, 1, 1, 1 ), m_spTexture->GetRect() );
+				_spRenderer->SetTexture( NULL, 0 );
+				_spRenderer->Apply();
+			}
+};
+
 /*
 */
 class   CHudEntry
@@ -36,6 +115,9 @@ class   CHudEntry
 				return true;
 			};
 
+			//	Called on the hud tick rather than every frame, to refresh whatever the entry shows.
+			virtual	void	Update( const fp8 /*_time*/, DisplayOutput::spCRenderer /*_spRenderer*/ )	{};
+
 			void Visible( const bool _bState )	{	m_bVisible = _bState;	};
 			virtual bool	Visible() const	{	return m_bVisible;	};
 };
@@ -52,6 +134,11 @@ class   CHudManager
 	//	Entries.
 	std::map<std::string, spCHudEntry> m_EntryMap;
 
+	//	Entries are refreshed at this rate, not every frame.
+	fp8		m_UpdateInterval;
+	fp8		m_NextUpdate;
+	bool	m_bUpdate;
+
 	public:
 			CHudManager();
 			~CHudManager();
@@ -63,6 +150,12 @@ class   CHudManager
 			//	Operators rule.
 			spCHudEntry	Get( const std::string _what )	{	return m_EntryMap[ _what ];	}
 
+			/*
+				Tick().
+				True once every m_UpdateInterval, and right after the visible entries change. Entries are updated on the next Render().
+			*/
+			bool	Tick();
+
 			bool	Render( DisplayOutput::spCRenderer _spRenderer );
 			void	HideAll();
 			void	Toggle( const std::string _name );
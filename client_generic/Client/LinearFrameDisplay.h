@@ -127,6 +127,29 @@ class	CLinearFrameDisplay : public CFrameDisplay
 			{
 			}
 
+			//	Same lerps as linear_pixelshaderGL2D, done on YUV.
+			virtual bool	EnableYUV()
+			{
+				static const char *linear_yuv_pixelshaderGL = "\
+					uniform float delta;\
+					uniform sampler2D texUnit1;	\
+					uniform sampler2D texUnit2;	\
+					uniform sampler2D texUnit3; \
+					uniform sampler2D texUnit4; \
+					uniform float newalpha;\
+					uniform float transPct;\
+					void main(void)\
+					{\
+						vec2 st = gl_TexCoord[0].st;\
+						vec3 fc1 = mix( sampleYUV( texUnit1, st ), sampleYUV( texUnit2, st ), delta );\
+						vec3 fc2 = mix( sampleYUV2( texUnit3, st ), sampleYUV2( texUnit4, st ), delta );\
+						gl_FragColor = vec4( yuv2rgb( mix( fc1, fc2, transPct / 100.0 ) ), newalpha );\
+					}";
+
+				m_spYUVShader = NewYUVShader( linear_yuv_pixelshaderGL );
+				return !m_spYUVShader.IsNull();
+			}
+
 			//	Decode a frame every 1/_fpsCap seconds, store the previous frame, and lerp between them.
 			virtual bool	Update( ContentDecoder::spCContentDecoder _spDecoder, const fp8 _decodeFps, const fp8 /*_displayFps*/, ContentDecoder::sMetaData &_metadata )
 			{
@@ -208,7 +231,9 @@ class	CLinearFrameDisplay : public CFrameDisplay
 						m_spFrames[ !m_State + kMaxFrames ] = NULL;							
 					}
 					
-					m_spRenderer->SetShader( m_spShader );
+					DisplayOutput::spCShader spShader = ( m_bYUVFrame && !m_spYUVShader.IsNull() ) ? m_spYUVShader : m_spShader;
+
+					m_spRenderer->SetShader( spShader );
 					m_spRenderer->SetBlend( "alphablend" );
 
 					//	Only one frame so far, let's display it normally.
@@ -236,9 +261,11 @@ class	CLinearFrameDisplay : public CFrameDisplay
 						}
 					}
 					texRect = m_spFrames[ m_State ]->GetRect();
-					m_spShader->Set( "delta", (fp4)m_InterframeDelta );
-					m_spShader->Set( "newalpha", (fp4)currentalpha );
-					m_spShader->Set( "transPct", m_MetaData.m_TransitionProgress);
+					spShader->Set( "delta", (fp4)m_InterframeDelta );
+					spShader->Set( "newalpha", (fp4)currentalpha );
+					spShader->Set( "transPct", m_MetaData.m_TransitionProgress);
+					if( spShader == m_spYUVShader )
+						SetYUVUniforms( spShader, texRect, m_spFrames[ m_State + kMaxFrames ].IsNull() ? texRect : m_spFrames[ m_State + kMaxFrames ]->GetRect() );
 					m_spRenderer->Apply();
 					
                     UpdateTexRect( texRect );
@@ -8,6 +8,7 @@
 
 #include	<boost/filesystem/path.hpp>
 #include	<boost/scoped_ptr.hpp>
+#include	<boost/thread/mutex.hpp>
 static const uint32 gl_sMaxGeneration = 100000;
 #define max_sheep 100000
 #define max_play_count ((1<<16)-1)
@@ -31,6 +32,15 @@ class	CPlayCounter : public Base::CSingleton<CPlayCounter>
     
     typedef std::map<uint32, sPlayCountData> PlayCountMap;
 
+public:
+	//	Told about every play, _bDecayed when all the counts were scaled down before it.
+	typedef void (*PlayedHook)( void *_pData, uint32 _generation, uint32 _id, bool _bDecayed );
+
+private:
+	PlayedHook	m_pPlayedHook;
+	void		*m_pPlayedHookData;
+	boost::mutex	m_PlayedHookMutex;
+
 	PlayCountMap m_PlayCounts;
 	path m_PlayCountFilePath;
 	bool m_ReadOnly;
@@ -120,7 +130,7 @@ class	CPlayCounter : public Base::CSingleton<CPlayCounter>
 	}
 
 public:
-	CPlayCounter():m_ReadOnly(false), m_DeadEndCutSurvivors(0), m_MedianCutSurvivors(0), m_PlayCountTotal(0)
+	CPlayCounter():m_pPlayedHook(NULL), m_pPlayedHookData(NULL), m_ReadOnly(false), m_DeadEndCutSurvivors(0), m_MedianCutSurvivors(0), m_PlayCountTotal(0)
 	{
 		m_PlayCountDecayY = g_Settings()->Get( "settings.player.PlayCountDecayY", 2000 );
 		m_PlayCountDecayZ = g_Settings()->Get( "settings.player.PlayCountDecayZ", 60 );
@@ -201,10 +211,19 @@ public:
 		m_PlayCountFilePath = dir;
 	}
 
+	//	SetPlayedHook(). One hook at a time, NULL takes it off again.
+	void SetPlayedHook( PlayedHook _pHook, void *_pData )
+	{
+		boost::mutex::scoped_lock lock( m_PlayedHookMutex );
+		m_pPlayedHook = _pHook;
+		m_pPlayedHookData = _pData;
+	}
+
 	void IncPlayCount( uint32 generation, uint32 id )
 	{
 		if (id >= max_sheep || generation > gl_sMaxGeneration || generation == 0)
 			return;
+		bool decayed = false;
 		if (m_PlayCountTotal > static_cast<uint64>(m_PlayCountDecayY) && m_PlayCountDecayZ != 100)
 		{
 			m_PlayCountTotal = 0;
@@ -214,6 +233,7 @@ public:
 				jj->second.PlayCounts[ii] = uint16(m_PlayCountDecayZ/100. * jj->second.PlayCounts[ii]);
 				m_PlayCountTotal += jj->second.PlayCounts[ii];
 			}
+			decayed = true;
 		}
 
 		PlayCountMap::iterator iter = m_PlayCounts.find(generation);
@@ -223,6 +243,10 @@ public:
 		iter = m_PlayCounts.find(generation);
 		++iter->second.PlayCounts[id];
 		++m_PlayCountTotal;
+
+		boost::mutex::scoped_lock lock( m_PlayedHookMutex );
+		if (m_pPlayedHook != NULL)
+			m_pPlayedHook( m_pPlayedHookData, generation, id, decayed );
 	}
 
 	uint16 PlayCount( uint32 generation, uint32 id )
@@ -57,6 +57,7 @@
 #include	"FrameDisplay.h"
 #include	"LinearFrameDisplay.h"
 #include	"CubicFrameDisplay.h"
+#include	"CPUFrameDisplay.h"
 
 #include	"boost/filesystem/path.hpp"
 #include	"boost/filesystem/operations.hpp"
@@ -88,10 +89,14 @@ CPlayer::CPlayer()
 	m_InitPlayCounts = true;
 	
 	m_MultiDisplayMode = kMDSharedMode;
+
+	m_bYUVFrames = true;
+	m_bDXTFrames = true;
 	
 	m_bStarted = false;
-	
-	m_CapClock = 0.0;
+
+	m_pDisplayUnits = new DisplayUnitList;
+	m_NumFrameReaders = 0;
 
 #ifdef	WIN32
 	m_hWnd = NULL;
@@ -239,45 +244,40 @@ bool CPlayer::AddDisplay( uint32 screen )
 		return false;
 	spDisplay->Title( "Electric Sheep" );
 
-	//	Create frame display.
-	int32 displayMode = g_Settings()->Get( "settings.player.DisplayMode", 2 );
-	if( displayMode == 2 )
-	{
-		if( spDisplay->HasShaders() )
-		{
-			g_Log->Info( "Using piecewise cubic video display..." );
-			spFrameDisplay = new CCubicFrameDisplay( spRenderer );
-		}
-	}
-	else
+	//	In shared mode, displays whose contexts share objects share the frame display as well, so a decoded frame is uploaded once for all of them.
+	DisplayUnit *pFrameOwner = NULL;
+	if( m_MultiDisplayMode == kMDSharedMode && spDisplay->ShareGroup() != NULL )
 	{
-		if( displayMode == 1 )
+		DisplayUnitList &units = DisplayUnits();
+
+		for( DisplayUnitIterator it = units.begin(); it != units.end(); it++ )
 		{
-			if( spDisplay->HasShaders() )
+			if( (*it)->pFrameOwner == *it && (*it)->spDisplay->ShareGroup() == spDisplay->ShareGroup() && (*it)->spRenderer->Type() == spRenderer->Type() )
 			{
-				g_Log->Info( "Using piecewise linear video display..." );
-				spFrameDisplay = new CLinearFrameDisplay( spRenderer );
-				g_Settings()->Set( "settings.player.DisplayMode", 1 );
+				pFrameOwner = *it;
+				break;
 			}
 		}
 	}
 
-	if( spFrameDisplay && !spFrameDisplay->Valid() )
+	if( pFrameOwner != NULL )
 	{
-		g_Log->Warning( "FrameDisplay failed, falling back to normal" );
-		g_Settings()->Set( "settings.player.DisplayMode", 0 );
-		spFrameDisplay = NULL;
+		g_Log->Info( "Sharing frame textures with another display..." );
+		spFrameDisplay = pFrameOwner->spFrameDisplay;
+		pFrameOwner->bSharedFrameDisplay = true;
 	}
-
-	//	Fallback to normal.
-	if( spFrameDisplay == NULL )
+	else
 	{
-		g_Log->Info( "Using normal video display..." );
-		spFrameDisplay = new CFrameDisplay( spRenderer );
-		g_Settings()->Set( "settings.player.DisplayMode", 0 );
-	}
+		spFrameDisplay = NewFrameDisplay( spDisplay, spRenderer );
 
-	spFrameDisplay->SetDisplaySize( spDisplay->Width(), spDisplay->Height() );
+		//	Each frame display playing the shared decoder reads it as its own reader, the others have a decoder each.
+		if( m_MultiDisplayMode == kMDSharedMode )
+		{
+			if( m_NumFrameReaders >= ContentDecoder::CFrameHandoff::kMaxReaders )
+				g_Log->Warning( "Too many displays, some will play the same frames at the wrong speed" );
+			spFrameDisplay->SetFrameReader( m_NumFrameReaders++ % ContentDecoder::CFrameHandoff::kMaxReaders );
+		}
+	}
 	
 	{
 		DisplayUnit *du = new DisplayUnit;
@@ -285,6 +285,10 @@ bool CPlayer::AddDisplay( uint32 screen )
 		du->spFrameDisplay = spFrameDisplay;
 		du->spRenderer = spRenderer;
 		du->spDisplay = spDisplay;
+		du->pFrameOwner = ( pFrameOwner != NULL ) ? pFrameOwner : du;
+		du->bSharedFrameDisplay = ( pFrameOwner != NULL );
+		du->m_CapClock = 0.0;
+		du->m_UploadBytes = 0;
 		du->m_MetaData.m_SheepID = 0;
 		du->m_MetaData.m_SheepGeneration = 0;
 		du->m_MetaData.m_Fade = 1.f;
@@ -301,17 +305,112 @@ bool CPlayer::AddDisplay( uint32 screen )
 
 		boost::mutex::scoped_lock lockthis( m_displayListMutex );
 		
+		DisplayUnitList *pUnits = new DisplayUnitList( DisplayUnits() );
 		
 		if (g_Settings()->Get( "settings.player.reversedisplays", false ) == true)
-			m_displayUnits.insert(m_displayUnits.begin(), du);
+			pUnits->insert(pUnits->begin(), du);
 		else
-			m_displayUnits.push_back(du);
+			pUnits->push_back(du);
 		
+		m_RetiredDisplayUnits.push_back( &DisplayUnits() );
+#ifdef WIN32
+		m_pDisplayUnits = pUnits;
+#else
+		__atomic_store_n( &m_pDisplayUnits, pUnits, __ATOMIC_RELEASE );
+#endif
 	}
 	
 	return true;
 }
 
+/*
+	NewFrameDisplay().
+	The best frame display _spDisplay can do, as configured. Also settles whether frames can be decoded to YUV or BC1 for it.
+*/
+spCFrameDisplay	CPlayer::NewFrameDisplay( DisplayOutput::spCDisplayOutput _spDisplay, DisplayOutput::spCRenderer _spRenderer )
+{
+	spCFrameDisplay	spFrameDisplay;
+
+	//	Create frame display.
+	int32 displayMode = g_Settings()->Get( "settings.player.DisplayMode", 2 );
+	//	Without shaders the interpolation can be done on the cpu instead.
+	bool bCPUInterpolation = g_Settings()->Get( "settings.player.CPUInterpolation", true );
+	if( displayMode == 2 )
+	{
+		if( _spDisplay->HasShaders() )
+		{
+			g_Log->Info( "Using piecewise cubic video display..." );
+			spFrameDisplay = new CCubicFrameDisplay( _spRenderer );
+		}
+		else if( bCPUInterpolation )
+		{
+			g_Log->Info( "Using piecewise cubic video display without shaders..." );
+			spFrameDisplay = new CCPUFrameDisplay( _spRenderer, true );
+		}
+	}
+	else
+	{
+		if( displayMode == 1 )
+		{
+			if( _spDisplay->HasShaders() )
+			{
+				g_Log->Info( "Using piecewise linear video display..." );
+				spFrameDisplay = new CLinearFrameDisplay( _spRenderer );
+				g_Settings()->Set( "settings.player.DisplayMode", 1 );
+			}
+			else if( bCPUInterpolation )
+			{
+				g_Log->Info( "Using piecewise linear video display without shaders..." );
+				spFrameDisplay = new CCPUFrameDisplay( _spRenderer, false );
+				g_Settings()->Set( "settings.player.DisplayMode", 1 );
+			}
+		}
+	}
+
+	if( spFrameDisplay && !spFrameDisplay->Valid() )
+	{
+		g_Log->Warning( "FrameDisplay failed, falling back to normal" );
+		g_Settings()->Set( "settings.player.DisplayMode", 0 );
+		spFrameDisplay = NULL;
+	}
+
+	//	Fallback to normal.
+	if( spFrameDisplay == NULL )
+	{
+		g_Log->Info( "Using normal video display..." );
+		spFrameDisplay = new CFrameDisplay( _spRenderer );
+		g_Settings()->Set( "settings.player.DisplayMode", 0 );
+	}
+
+	spFrameDisplay->SetDisplaySize( _spDisplay->Width(), _spDisplay->Height() );
+
+	//	BC1 frames go to the texture compressed, only if every display can take them that way. Rectangle textures (mac) can't be compressed.
+	if( m_bDXTFrames )
+	{
+#ifndef MAC
+		m_bDXTFrames = g_Settings()->Get( "settings.player.DXTFrames", false ) && _spRenderer->Type() == DisplayOutput::eGL && spFrameDisplay->EnableDXT();
+#else
+		m_bDXTFrames = false;
+#endif
+		if( m_bDXTFrames )
+			g_Log->Info( "Playing pre-transcoded BC1 frames where available" );
+	}
+
+	//	Sheep without a BC1 stream have to come out as RGB too then, the frame displays sample both the same way.
+	if( m_bDXTFrames )
+		m_bYUVFrames = false;
+
+	//	YUV frames need the colour conversion shaders, otherwise everybody gets RGB.
+	if( m_bYUVFrames )
+	{
+		m_bYUVFrames = g_Settings()->Get( "settings.player.yuv_frames", true ) && _spDisplay->HasShaders() && spFrameDisplay->EnableYUV();
+		if( !m_bYUVFrames )
+			g_Log->Info( "Decoding to RGB frames" );
+	}
+
+	return spFrameDisplay;
+}
+
 /*
 */
 bool	CPlayer::Startup()
@@ -380,7 +479,12 @@ ContentDecoder::CContentDecoder *CPlayer::CreateContentDecoder( bool _bStartByRa
 
 #endif
 
-	return new ContentDecoder::CContentDecoder( m_spPlaylist, _bStartByRandom, g_Settings()->Get( "settings.player.CalculateTransitions", true ), (uint32)abs(g_Settings()->Get( "settings.player.BufferLength", 25 )), pf );
+	if( m_bYUVFrames )
+		pf = AV_PIX_FMT_YUV420P;
+
+	ContentDecoder::CContentDecoder *pDecoder = new ContentDecoder::CContentDecoder( m_spPlaylist, _bStartByRandom, g_Settings()->Get( "settings.player.CalculateTransitions", true ), (uint32)abs(g_Settings()->Get( "settings.player.BufferLength", 25 )), pf );
+	pDecoder->EnableDXTFrames( m_bDXTFrames );
+	return pDecoder;
 }
 
 /*
@@ -388,12 +492,7 @@ ContentDecoder::CContentDecoder *CPlayer::CreateContentDecoder( bool _bStartByRa
  */
 void CPlayer::ForceWidthAndHeight(uint32 du, uint32 _w, uint32 _h)
 {
-    boost::mutex::scoped_lock lockthis( m_displayListMutex );
-    
-    if (du >= m_displayUnits.size())
-        return;
-    
-	const DisplayUnit* duptr = m_displayUnits[du];
+	const DisplayUnit* duptr = Unit( du );
     
     if (duptr == NULL)
         return;
@@ -420,8 +519,6 @@ void	CPlayer::Start()
 {	
 	if ( !m_bStarted )
 	{
-		m_CapClock = 0.0;
-		
 		if ( m_MultiDisplayMode == kMDSharedMode )
 		{
 			m_spDecoder =  CreateContentDecoder( true );
@@ -431,11 +528,11 @@ void	CPlayer::Start()
 		}
 		else
 		{
-			boost::mutex::scoped_lock lockthis( m_displayListMutex );
+			DisplayUnitList &units = DisplayUnits();
 			
-			DisplayUnitIterator it = m_displayUnits.begin();
+			DisplayUnitIterator it = units.begin();
 			
-			for ( ; it != m_displayUnits.end(); it++ )
+			for ( ; it != units.end(); it++ )
 			{
 				if ((*it)->spDecoder.IsNull())
 					(*it)->spDecoder = CreateContentDecoder( true );
@@ -464,11 +561,11 @@ void	CPlayer::Stop()
 		}
 		else
 		{
-			boost::mutex::scoped_lock lockthis( m_displayListMutex );
+			DisplayUnitList &units = DisplayUnits();
 
-			DisplayUnitIterator it = m_displayUnits.begin();
+			DisplayUnitIterator it = units.begin();
 			
-			for ( ; it != m_displayUnits.end(); it++ )
+			for ( ; it != units.end(); it++ )
 			{
 				if (!(*it)->spDecoder.IsNull())
 					(*it)->spDecoder->Stop();
@@ -494,11 +591,11 @@ bool	CPlayer::Shutdown( void )
 	}
 	else
 	{
-		boost::mutex::scoped_lock lockthis( m_displayListMutex );
+		DisplayUnitList &units = DisplayUnits();
 
-		DisplayUnitIterator it = m_displayUnits.begin();
+		DisplayUnitIterator it = units.begin();
 		
-		for ( ; it != m_displayUnits.end(); it++ )
+		for ( ; it != units.end(); it++ )
 		{
 			if (!(*it)->spDecoder.IsNull())
 				(*it)->spDecoder->Close();
@@ -506,23 +603,29 @@ bool	CPlayer::Shutdown( void )
 		}
 	}
 	
+	//	Nothing draws anymore, the render threads are gone by now.
 	{
 		boost::mutex::scoped_lock lockthis( m_displayListMutex );
 
-		DisplayUnitIterator it = m_displayUnits.begin();
+		DisplayUnitList &units = DisplayUnits();
+		DisplayUnitIterator it = units.begin();
 		
-		for ( ; it != m_displayUnits.end(); it++ )
+		for ( ; it != units.end(); it++ )
 		{
 			delete (*it);
 		}
+
+		units.clear();
+
+		for( std::vector<DisplayUnitList *>::iterator r = m_RetiredDisplayUnits.begin(); r != m_RetiredDisplayUnits.end(); r++ )
+			delete (*r);
+		m_RetiredDisplayUnits.clear();
 	}
 
 	m_spPlaylist = NULL;
 	
 	m_spDecoder = NULL;
 	
-	m_displayUnits.clear();
-	
 	m_bStarted = false;
 	
 	return true;
@@ -534,62 +637,31 @@ CPlayer::~CPlayer()
 {
 	//	Mark singleton as properly shutdown, to track unwanted access after this point.
 	SingletonActive( false );
-}
 
-bool	CPlayer::BeginFrameUpdate()
-{
-	if ( m_MultiDisplayMode == kMDSharedMode )
-	{
-		if (m_spDecoder.IsNull() == false)
-			m_spDecoder->ResetSharedFrame();
-	}
-	else
-	{
-		boost::mutex::scoped_lock lockthis( m_displayListMutex );
-
-		DisplayUnitIterator it = m_displayUnits.begin();
-		
-		for ( ; it != m_displayUnits.end(); it++ )
-		{
-			if (!(*it)->spDecoder.IsNull())
-				(*it)->spDecoder->ResetSharedFrame();
-				
-		}
-	}
-	
-	return true;
+	delete m_pDisplayUnits;
 }
 
-bool	CPlayer::EndFrameUpdate()
+bool	CPlayer::EndFrameUpdate( uint32 displayUnit )
 {
-	spCFrameDisplay spFD;
+	DisplayUnit* du = Unit( displayUnit );
 	
-	{
-		boost::mutex::scoped_lock lockthis( m_displayListMutex );
-		
-		spFD = m_displayUnits[ 0 ]->spFrameDisplay;
-	}
+	if ( du == NULL || du->spFrameDisplay.IsNull() )
+		return false;
 	
-	fp8 capFPS = spFD->GetFps( m_PlayerFps, m_DisplayFps );
+	fp8 capFPS = du->spFrameDisplay->GetFps( m_PlayerFps, m_DisplayFps );
 	
-	if ( !spFD.IsNull() && capFPS > 0.000001)
-		FpsCap( capFPS );
+	if ( capFPS > 0.000001 )
+		FpsCap( capFPS, du->m_CapClock );
 	
 	return true;
 }
 
 bool	CPlayer::BeginDisplayFrame( uint32 displayUnit )
 {
-	DisplayUnit* du;
+	DisplayUnit* du = Unit( displayUnit );
 	
-	{
-		boost::mutex::scoped_lock lockthis( m_displayListMutex );
-		
-		if (displayUnit >= m_displayUnits.size())
-			return false;
-					
-		du = m_displayUnits[ displayUnit ];
-	}
+	if ( du == NULL )
+		return false;
 
 	if (du->spRenderer->BeginFrame() == false)
 		return false;
@@ -599,28 +671,89 @@ bool	CPlayer::BeginDisplayFrame( uint32 displayUnit )
 
 bool	CPlayer::EndDisplayFrame( uint32 displayUnit, bool drawn )
 {
-	DisplayUnit* du;
+	DisplayUnit* du = Unit( displayUnit );
 	
-	{	
-		boost::mutex::scoped_lock lockthis( m_displayListMutex );
-		
-		if (displayUnit >= m_displayUnits.size())
-			return false;
-			
-		du = m_displayUnits[ displayUnit ];
-	}
+	if ( du == NULL )
+		return false;
 
-	return du->spRenderer->EndFrame( drawn );
+	bool bEnded = du->spRenderer->EndFrame( drawn );
+	const uint64 uploadBytes = du->spRenderer->FrameStats().m_UploadBytes;
+#ifdef WIN32
+	InterlockedExchangeAdd64( (volatile LONGLONG *)&du->m_UploadBytes, (LONGLONG)uploadBytes );
+#else
+	__atomic_fetch_add( &du->m_UploadBytes, uploadBytes, __ATOMIC_RELAXED );
+#endif
+	return bEnded;
+}
+
+/*
+*/
+uint32	CPlayer::FrameOwner( uint32 displayUnit )
+{
+	DisplayUnitList &units = DisplayUnits();
+
+	if ( displayUnit >= units.size() )
+		return displayUnit;
+
+	for ( uint32 i = 0; i < units.size(); i++ )
+		if ( units[ i ] == units[ displayUnit ]->pFrameOwner )
+			return i;
+
+	return displayUnit;
+}
+
+/*
+*/
+void	CPlayer::ReleaseDisplay( uint32 displayUnit )
+{
+	DisplayUnit* du = Unit( displayUnit );
+	
+	if ( du != NULL )
+		du->spDisplay->DoneCurrent();
+}
+
+/*
+*/
+uint64	CPlayer::UploadBytes()
+{
+	DisplayUnitList &units = DisplayUnits();
+
+	uint64 bytes = 0;
+	for ( DisplayUnitIterator it = units.begin(); it != units.end(); it++ )
+#ifdef WIN32
+		bytes += (uint64)InterlockedCompareExchange64( (volatile LONGLONG *)&(*it)->m_UploadBytes, 0, 0 );
+#else
+		bytes += __atomic_load_n( &(*it)->m_UploadBytes, __ATOMIC_RELAXED );
+#endif
+
+	return bytes;
+}
+
+/*
+*/
+uint64	CPlayer::FramesDecoded()
+{
+	if ( m_MultiDisplayMode == kMDSharedMode )
+		return m_spDecoder.IsNull() ? 0 : m_spDecoder->FramesServed();
+
+	DisplayUnitList &units = DisplayUnits();
+
+	uint64 frames = 0;
+	for ( DisplayUnitIterator it = units.begin(); it != units.end(); it++ )
+		if ( !(*it)->spDecoder.IsNull() )
+			frames += (*it)->spDecoder->FramesServed();
+
+	return frames;
 }
 
 //	Chill the remaining time to keep the framerate.
-void CPlayer::FpsCap( const fp8 _cap )
+void CPlayer::FpsCap( const fp8 _cap, fp8 &_clock )
 {
-	fp8	diff = 1.0/_cap - (m_Timer.Time() - m_CapClock);
+	fp8	diff = 1.0/_cap - (m_Timer.Time() - _clock);
 	if( diff > 0.0 )
 		Base::CTimer::Wait( diff );
 
-	m_CapClock = m_Timer.Time();
+	_clock = m_Timer.Time();
 }
 
 
@@ -632,37 +765,32 @@ bool	CPlayer::Update(uint32 displayUnit, bool &bPlayNoSheepIntro)
 {	
 	bPlayNoSheepIntro = false;
 
-	DisplayUnit* du;
+	DisplayUnit* du = Unit( displayUnit );
 	
-	{
-		boost::mutex::scoped_lock lockthis( m_displayListMutex );
-		
-		if (displayUnit >= m_displayUnits.size())
-			return false;
-		
-		du = m_displayUnits[ displayUnit ];
-	}
+	if ( du == NULL )
+		return false;
 
+	//	Only selects, the frame display applies what it needs before drawing, so state it keeps from the last frame costs nothing.
 	du->spRenderer->Reset( eEverything );
 	du->spRenderer->Orthographic();
-	du->spRenderer->Apply();
 	
-	{
-		boost::mutex::scoped_lock lockthis( m_updateMutex );
+	//	A shared frame display draws for each of its displays in turn, only the first one after a frame is due uploads it.
+	if( du->pFrameOwner->bSharedFrameDisplay )
+		du->spFrameDisplay->SetRenderer( du->spRenderer, du->spDisplay->Width(), du->spDisplay->Height() );
 
 	//	Update the frame display, it rests before doing any work to keep the framerate.
-	if( !du->spFrameDisplay->Update( du->spDecoder.IsNull() ? m_spDecoder : du->spDecoder, m_PlayerFps, m_DisplayFps, du->m_MetaData ) )
+	//	Nothing here is shared with the other render threads but the decoder, which hands frames over without locking.
+	if( !du->spFrameDisplay->Update( du->spDecoder.IsNull() ? m_spDecoder : du->spDecoder, m_PlayerFps, m_DisplayFps, du->pFrameOwner->m_MetaData ) )
 	{
-			if ( (m_spDecoder.IsNull() == false && m_spDecoder->PlayNoSheepIntro()) || 
-				 (du->spDecoder.IsNull() == false && du->spDecoder->PlayNoSheepIntro()) )
-			{
-				bPlayNoSheepIntro = true;
-				return true;
-			}
-			return false;
-			//	Failed to update screen here, do something noticeable like show a logo or something.. :)
-			//g_Log->Warning( "Failed to render frame..." );
-	}
+		if ( (m_spDecoder.IsNull() == false && m_spDecoder->PlayNoSheepIntro()) || 
+			 (du->spDecoder.IsNull() == false && du->spDecoder->PlayNoSheepIntro()) )
+		{
+			bPlayNoSheepIntro = true;
+			return true;
+		}
+		return false;
+		//	Failed to update screen here, do something noticeable like show a logo or something.. :)
+		//g_Log->Warning( "Failed to render frame..." );
 	}
 	
 	if ( (m_spDecoder.IsNull() == false && m_spDecoder->PlayNoSheepIntro()) || 
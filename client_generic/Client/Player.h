@@ -29,19 +29,55 @@ public:
 	} MultiDisplayMode;
 	
 private:
-	typedef struct
+	typedef struct sDisplayUnit
 	{
 		DisplayOutput::spCDisplayOutput		spDisplay;
 		DisplayOutput::spCRenderer			spRenderer;
 		ContentDecoder::spCContentDecoder	spDecoder;
 		spCFrameDisplay						spFrameDisplay;
 		ContentDecoder::sMetaData			m_MetaData; // current frame meta data
+
+		//	Unit the frame display was made for, this one unless it is shared. Units sharing a frame display are drawn by the same thread.
+		struct sDisplayUnit					*pFrameOwner;
+		bool								bSharedFrameDisplay;
+
+		//	Written by the thread drawing the unit only.
+		fp8									m_CapClock;
+
+		//	Same, but summed on the main thread, so it is only touched atomically.
+		volatile uint64						m_UploadBytes;
 	} DisplayUnit;
 	
 	typedef std::vector<DisplayUnit*>		DisplayUnitList;
 	typedef std::vector<DisplayUnit*>::iterator DisplayUnitIterator;
 	
+	//	Only taken to change the display list, readers go through DisplayUnits().
 	boost::mutex m_displayListMutex;
+
+	//	The current display list. AddDisplay() publishes a changed copy instead of changing it, so render threads read it without a lock.
+	DisplayUnitList	*volatile	m_pDisplayUnits;
+
+	//	Lists replaced by AddDisplay(), a render thread may still be reading one. Displays are added a handful of times, they are freed in Shutdown().
+	std::vector<DisplayUnitList *>	m_RetiredDisplayUnits;
+
+	//	Decoder readers handed to frame displays in shared mode, see CContentDecoder::Frame().
+	uint32	m_NumFrameReaders;
+
+	inline DisplayUnitList	&DisplayUnits()
+	{
+#ifdef WIN32
+		return *m_pDisplayUnits;
+#else
+		return *__atomic_load_n( &m_pDisplayUnits, __ATOMIC_ACQUIRE );
+#endif
+	}
+
+	//	The unit at _displayUnit, or NULL.
+	inline DisplayUnit	*Unit( const uint32 _displayUnit )
+	{
+		DisplayUnitList &units = DisplayUnits();
+		return ( _displayUnit < units.size() ) ? units[ _displayUnit ] : NULL;
+	}
 	
 	friend class Base::CSingleton<CPlayer>;
 
@@ -54,8 +90,6 @@ private:
 	//	Videodecoder & framedisplay object.
 	ContentDecoder::spCContentDecoder		m_spDecoder;
 	
-	DisplayUnitList							m_displayUnits;
-	
 	//	Playlist.
 	ContentDecoder::spCLuaPlaylist			m_spPlaylist;
 
@@ -75,16 +109,17 @@ private:
 	bool			m_InitPlayCounts;
 	
 	MultiDisplayMode m_MultiDisplayMode;
+
+	//	Decode to packed YUV420 and convert in the shaders, only if every display can do that.
+	bool			m_bYUVFrames;
+
+	//	Play the .dxt streams of sheep straight into compressed textures, only if every display can do that.
+	bool			m_bDXTFrames;
 	
 	bool			m_bStarted;
 
-	//	Used to keep track of elapsed time since last frame.
-	fp8	m_CapClock;
-
 	bool m_HasGoldSheep;
 	int m_UsedSheepType;
-	
-	boost::mutex	m_updateMutex;
 
 #ifdef	WIN32
 	HWND	m_hWnd;
@@ -97,8 +132,9 @@ private:
 #endif
 	
 	ContentDecoder::CContentDecoder *CreateContentDecoder( bool _bStartByRandom = false );
+	spCFrameDisplay	NewFrameDisplay( DisplayOutput::spCDisplayOutput _spDisplay, DisplayOutput::spCRenderer _spRenderer );
 	
-	void FpsCap( const fp8 _cap );
+	void FpsCap( const fp8 _cap, fp8 &_clock );
 
 	public:
 			bool	Startup();
@@ -120,8 +156,8 @@ private:
                 return spDisplay->Closed();
 			}
 
-			bool	BeginFrameUpdate();
-			bool	EndFrameUpdate();
+			//	Rests to keep the framerate of the display unit _displayUnit was drawn with, call after drawing all of them.
+			bool	EndFrameUpdate( uint32 displayUnit = 0 );
 			bool	BeginDisplayFrame( uint32 displayUnit );
 			bool	EndDisplayFrame( uint32 displayUnit, bool drawn = true );
 			bool	Update(uint32 displayUnit, bool &bPlayNoSheepIntro);
@@ -145,51 +181,48 @@ private:
 			
 			inline DisplayOutput::spCDisplayOutput	Display(uint32 du = 0)
 			{ 	
-				boost::mutex::scoped_lock lockthis( m_displayListMutex );
-                
-                if (du >= m_displayUnits.size())
-                    return NULL;
+				DisplayUnit *pUnit = Unit( du );
 
-				return m_displayUnits[du]->spDisplay;
+				return ( pUnit == NULL ) ? NULL : pUnit->spDisplay;
 			}
 			
 			inline DisplayOutput::spCRenderer		Renderer()
 			{
-				boost::mutex::scoped_lock lockthis( m_displayListMutex );
+				DisplayUnit *pUnit = Unit( 0 );
 				
-				return m_displayUnits.empty() ? NULL :  m_displayUnits[0]->spRenderer;	
+				return ( pUnit == NULL ) ? NULL : pUnit->spRenderer;
 			}
 			
 			inline ContentDecoder::spCContentDecoder Decoder()
 			{				
-				boost::mutex::scoped_lock lockthis( m_displayListMutex );
-				
 				if ( m_MultiDisplayMode == kMDSharedMode )
 					return m_spDecoder;
-				else
-					return m_displayUnits.empty() ? NULL :  m_displayUnits[0]->spDecoder;
+
+				DisplayUnit *pUnit = Unit( 0 );
+
+				return ( pUnit == NULL ) ? NULL : pUnit->spDecoder;
 			}
 
 			//	Playlist stuff.
 			inline std::string GetCurrentPlayingSheepFile()
 			{
-				return m_displayUnits[0]->m_MetaData.m_FileName;
+				return DisplayUnits()[0]->m_MetaData.m_FileName;
 			}
 			inline uint32	GetCurrentPlayingSheepID()
 			{	
-				return m_displayUnits[0]->m_MetaData.m_SheepID;
+				return DisplayUnits()[0]->m_MetaData.m_SheepID;
 			};
 			inline uint32	GetCurrentPlayingSheepGeneration()
 			{	
-				return m_displayUnits[0]->m_MetaData.m_SheepGeneration;
+				return DisplayUnits()[0]->m_MetaData.m_SheepGeneration;
 			};
 			inline time_t	GetCurrentPlayingatime()
 			{	
-				return m_displayUnits[0]->m_MetaData.m_LastAccessTime;
+				return DisplayUnits()[0]->m_MetaData.m_LastAccessTime;
 			};
 			inline time_t	IsCurrentPlayingEdge()
 			{	
-				return m_displayUnits[0]->m_MetaData.m_IsEdge;
+				return DisplayUnits()[0]->m_MetaData.m_IsEdge;
 			};
 			inline uint32	GetCurrentPlayingID()
 			{	
@@ -246,7 +279,21 @@ private:
 			inline bool		HasGoldSheep() { return m_HasGoldSheep; }
 			inline int		UsedSheepType() { return m_UsedSheepType; }
 			
-			inline uint32		GetDisplayCount() { return static_cast<uint32>(m_displayUnits.size()); }
+			inline uint32		GetDisplayCount() { return static_cast<uint32>(DisplayUnits().size()); }
+
+			/*
+				FrameOwner().
+				Index of the unit whose frame display _displayUnit draws with, _displayUnit itself unless it shares one.
+				Units with the same owner have to be drawn by the same thread, one after the other.
+			*/
+			uint32				FrameOwner( uint32 displayUnit );
+
+			//	Lets go of the display's context on the calling thread, so a render thread can take it.
+			void				ReleaseDisplay( uint32 displayUnit );
+
+			//	Texture data sent to the gpu so far, and frames the decoders handed out, one upload per frame is the least it can be.
+			uint64				UploadBytes();
+			uint64				FramesDecoded();
     
             void ForceWidthAndHeight(uint32 du, uint32 _w, uint32 _h);
 };
@@ -22,6 +22,7 @@ class	CServerMessage : public CConsole
 	std::string	m_Message;
 	DisplayOutput::CFontDescription m_Desc;
 	fp4 m_MoveMessageCounter;
+	CTextCache	m_Text;
 
 	public:
 			CServerMessage( std::string &_msg, Base::Math::CRect _rect, const uint32 _fontHeight ) : CConsole( _rect )
@@ -48,11 +49,19 @@ class	CServerMessage : public CConsole
 			//	Override to make it always visible.
 			virtual bool	Visible() const	{	return true;	};
 
+			void	Update( const fp8 /*_time*/, DisplayOutput::spCRenderer _spRenderer )
+			{
+				m_Text.Update( _spRenderer, m_spFont, m_Message );
+			}
+
 			//
 			bool	Render( const fp8 _time, DisplayOutput::spCRenderer _spRenderer )
 			{
 				if( !CHudEntry::Render( _time, _spRenderer ) )
 					return false;
+
+				if( !m_Text.Valid() )
+					Update( _time, _spRenderer );
 				
 				if (m_bServerMessageStartTimer == false)
 				{
@@ -66,7 +75,7 @@ class	CServerMessage : public CConsole
 
 				//	Figure out text extent for all strings.
 				Base::Math::CRect	extent;
-				Base::Math::CVector2 size = g_Player().Renderer()->GetTextExtent( m_spFont, m_Message );
+				const Base::Math::CVector2 &size = m_Text.Size();
 				extent = extent.Union( Base::Math::CRect( 0, 0, size.m_X+(edge*2), size.m_Y+(edge*2) ) );
 
 				boost::posix_time::time_duration td = boost::posix_time::second_clock::local_time() - m_ServerMessageStartTimer;
@@ -86,11 +95,11 @@ class	CServerMessage : public CConsole
 				_spRenderer->Apply();
 				_spRenderer->DrawSoftQuad( r, Base::Math::CVector4( 0, 0, 0, 0.5 ), 16 );
 				
-				//dasvo - terrible hack - redo!!
-				if (!m_spFont.IsNull())
+				//dasvo - terrible hack - redo!! (only needed when the text isn't cached)
+				if (!m_Text.Cached() && !m_spFont.IsNull())
 					m_spFont->Reupload();
 
-				g_Player().Renderer()->Text( m_spFont, m_Message, Base::Math::CVector4( 1, 1, 1, 1 ), Base::Math::CRect( r.m_X0+edge, r.m_Y0+edge, r.m_X1, r.m_Y1 ), 0 );
+				m_Text.Render( _spRenderer, m_spFont, r.m_X0+edge, r.m_Y0+edge );
 
 				return true;
 			}
@@ -19,6 +19,7 @@ class	CStartupScreen : public CHudEntry
 	
 	Base::Math::CRect m_LogoSize;
 	fp4 m_MoveMessageCounter;
+	CTextCache	m_Text;
 
 	public:
 			CStartupScreen( Base::Math::CRect _rect, const std::string &_FontName, const uint32 _fontHeight ) : CHudEntry( _rect )
@@ -55,6 +56,11 @@ class	CStartupScreen : public CHudEntry
 				m_spVideoTexture = NULL;
 			}
 
+			void	Update( const fp8 /*_time*/, DisplayOutput::spCRenderer _spRenderer )
+			{
+				m_Text.Update( _spRenderer, m_spFont, m_StartupMessage );
+			}
+
 			bool	Render( const fp8 _time, DisplayOutput::spCRenderer _spRenderer )
 			{
 				CHudEntry::Render( _time, _spRenderer );
@@ -67,8 +73,8 @@ class	CStartupScreen : public CHudEntry
 
 				// draw picture
 
-				DisplayOutput::spCImage tmpImage = new DisplayOutput::CImage();
-				if( m_spImageRef.IsNull() == false )
+				//	The logo never changes, one upload is enough.
+				if( m_spVideoTexture.IsNull() && m_spImageRef.IsNull() == false )
 				{
 					m_spVideoTexture = _spRenderer->NewTextureFlat();
 					m_spVideoTexture->Upload( m_spImageRef );
@@ -96,7 +102,10 @@ class	CStartupScreen : public CHudEntry
 				fp4 edge = 24 / (fp4)_spRenderer->Display()->Width();
 
 				Base::Math::CRect	extent;
-				Base::Math::CVector2 size = g_Player().Renderer()->GetTextExtent( m_spFont, m_StartupMessage );
+				if( !m_Text.Valid() )
+					Update( _time, _spRenderer );
+
+				const Base::Math::CVector2 &size = m_Text.Size();
 				extent = extent.Union( Base::Math::CRect( 0, 0, size.m_X+(edge*2), size.m_Y+(edge*2) ) );
 
 				boost::posix_time::time_duration td = boost::posix_time::second_clock::local_time() - m_ServerMessageStartTimer;
@@ -117,11 +126,11 @@ class	CStartupScreen : public CHudEntry
 				_spRenderer->Apply();
 				_spRenderer->DrawSoftQuad( r, Base::Math::CVector4( 0, 0, 0, 0.5f ), 16 );
 				
-				//dasvo - terrible hack - redo!!
-				if (!m_spFont.IsNull())
+				//dasvo - terrible hack - redo!! (only needed when the text isn't cached)
+				if (!m_Text.Cached() && !m_spFont.IsNull())
 					m_spFont->Reupload();
 				
-				_spRenderer->Text( m_spFont, m_StartupMessage, Base::Math::CVector4( 1, 1, 1, 1 ), Base::Math::CRect( r.m_X0+edge, r.m_Y0+edge, r.m_X1, r.m_Y1 ), 0 );
+				m_Text.Render( _spRenderer, m_spFont, r.m_X0+edge, r.m_Y0+edge );
 
 				return true;
 			}
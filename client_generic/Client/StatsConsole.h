@@ -5,6 +5,7 @@
 #include	"Hud.h"
 #include	"Rect.h"
 #include	"Console.h"
+#include	"LatencyStats.h"
 #include	<iomanip>
 
 namespace	Hud
@@ -131,6 +132,31 @@ class CAverageCounter : public CIntCounter
 
 //MakeSmartPointers( CAverageCounter );
 
+/*
+	CLatencyStat.
+	p50/p95/p99 of every frame pipeline stage, straight from the latency histograms.
+*/
+class CLatencyStat : public CStat
+{
+	std::string m_PreString;
+
+	public:
+			CLatencyStat( const std::string _name, const std::string _pre ) : CStat( _name ), m_PreString( _pre )	{};
+			virtual ~CLatencyStat()	{};
+
+			virtual const std::string	Report( const fp8 /*_time*/ )
+			{
+				Base::CLatencyStats &latency = Base::g_LatencyStats();
+
+				std::stringstream s;
+				s << m_PreString;
+				for( uint32 i=0; i<Base::eLatencyNumStages; i++ )
+					s << "\n  " << Base::CLatencyStats::StageName( (Base::eLatencyStage)i ) << ": " << latency.Report( (Base::eLatencyStage)i );
+
+				return s.str();
+			}
+};
+
 /*
 */
 class CTimeCountDownStat : public CStat
@@ -252,6 +278,9 @@ class	CStatsConsole : public CConsole
 	std::map<std::string, CStat *> m_Stats;
 	DisplayOutput::CFontDescription m_Desc;
 
+	//	All visible stats, one per line.
+	CTextCache	m_Text;
+
 	public:
 			CStatsConsole( Base::Math::CRect _rect, const std::string &_FontName, const uint32 _fontHeight ) : CConsole( _rect )
 			{
@@ -282,53 +311,53 @@ class	CStatsConsole : public CConsole
 			void	Add( CStat *_pStat )	{	m_Stats[ _pStat->m_Name ] = _pStat;	}
 			CStat	*Get( const std::string &_name ) {	return m_Stats[ _name ];	}
 
-			bool	Render( const fp8 _time, DisplayOutput::spCRenderer _spRenderer )
+			/*
+				Update().
+				Asks the stats for their reports, the text is only redrawn if one of them changed.
+			*/
+			void	Update( const fp8 _time, DisplayOutput::spCRenderer _spRenderer )
 			{
-				CHudEntry::Render( _time, _spRenderer );
-
-				fp4 step = (fp4)m_Desc.Height() / (fp4)_spRenderer->Display()->Height();
-				fp4	pos = 0;
-				fp4 edge = 24 / (fp4)_spRenderer->Display()->Width();
+				std::string text;
+				bool bFirst = true;
 
 				std::map<std::string, CStat *>::const_iterator i;
-
-				//	Figure out text extent for all strings.
-				Base::Math::CRect	extent;
-				std::queue<Base::Math::CVector2> sizeq;
 				for( i=m_Stats.begin(); i != m_Stats.end(); ++i )
 				{
 					CStat *e = i->second;
 					if( e && e->Visible() )
 					{
-						sizeq.push(_spRenderer->GetTextExtent( m_spFont, e->Report( _time ) ));
-						extent = extent.Union( Base::Math::CRect( 0, pos, sizeq.back().m_X+(edge*2), sizeq.back().m_Y+(pos)+(edge*2) ) );
-						pos += sizeq.back().m_Y;
+						if( !bFirst )
+							text += '\n';
+
+						text += e->Report( _time );
+						bFirst = false;
 					}
 				}
 
+				m_Text.Update( _spRenderer, m_spFont, text );
+			}
+
+			bool	Render( const fp8 _time, DisplayOutput::spCRenderer _spRenderer )
+			{
+				CHudEntry::Render( _time, _spRenderer );
+
+				if( !m_Text.Valid() )
+					Update( _time, _spRenderer );
+
+				fp4 edge = 24 / (fp4)_spRenderer->Display()->Width();
+
 				// align soft quad at bottom
-				extent.m_Y0 = 1.f - extent.m_Y1;
-				extent.m_Y1 = 1.f;
+				const Base::Math::CVector2 &size = m_Text.Size();
+				Base::Math::CRect	extent( 0, 1.f - ( size.m_Y + edge*2 ), size.m_X + edge*2, 1.f );
 
 				//	Draw quad.
 				_spRenderer->Reset( DisplayOutput::eTexture | DisplayOutput::eShader | DisplayOutput::eBlend );
 				_spRenderer->SetBlend( "alphablend" );
 				_spRenderer->Apply();
 				_spRenderer->DrawSoftQuad( extent, Base::Math::CVector4( 0, 0, 0, 0.375f ), 16 );
-				
+
 				// align text at bottom
-				pos = extent.m_Y0 + edge;
-				for( i=m_Stats.begin(); i != m_Stats.end(); ++i )
-				{
-					CStat *e = i->second;
-					if( e && e->Visible() )
-					{
-						Base::Math::CVector2 size = sizeq.front();
-						sizeq.pop();
-						_spRenderer->Text( m_spFont, e->Report( _time ), Base::Math::CVector4( 1, 1, 1, 1 ), Base::Math::CRect( edge, pos, 1, size.m_Y+pos+step ), 0 );
-						pos += size.m_Y;
-					}
-				}
+				m_Text.Render( _spRenderer, m_spFont, edge, extent.m_Y0 + edge );
 
 				return true;
 			}
@@ -0,0 +1,1058 @@
+/*
+	es-bench.
+	Headless benchmark of the decode pipeline: plays a directory of sheep through CContentDecoder without
+	a display or GL context, and reports throughput, frame latency, allocations and memory use.
+	-texbench opens a window, for the GL texture path of the display. It is only in es-texbench, built with ES_BENCH_GL, so es-bench links no GL.
+	-flockbench times the download queue of the downloader on a synthetic sheep list, -netbench the transfers of the network manager.
+*/
+#include	<new>
+#include	<string>
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<string.h>
+#include	<vector>
+#include	<algorithm>
+#include	<limits.h>
+#ifndef WIN32
+#include	<sys/resource.h>
+#endif
+
+#include	"base.h"
+#include	"Log.h"
+#include	"Timer.h"
+#include	"Settings.h"
+#include	"ContentDecoder.h"
+#include	"DirectoryPlaylist.h"
+#include	"FramePool.h"
+#include	"LatencyStats.h"
+#include	"BlockingQueue.h"
+#include	"SPSCQueue.h"
+#include	"FrameBlend.h"
+#include	"AlignedBuffer.h"
+#include	"Sheep.h"
+#include	"SheepIndex.h"
+#include	"boost/thread/thread.hpp"
+#ifdef ES_BENCH_GL
+#ifndef LINUX_GNU
+#include	"GLee.h"
+#else
+#include	<GLee.h>
+#endif
+#ifdef MAC
+#include	<GLUT/glut.h>
+#else
+#include	<GL/glut.h>
+#endif
+#include	"PixelStreamGL.h"
+#endif
+
+//	After the X11 headers, it takes their Status macro out of the way.
+#include	"Networking.h"
+
+//	Count every heap allocation in the process, so per frame allocations show up without a profiler.
+static volatile uint32 g_HeapAllocations = 0;
+
+void	*operator new( size_t _size )
+{
+	__atomic_fetch_add( &g_HeapAllocations, 1, __ATOMIC_RELAXED );
+	void *p = malloc( _size ? _size : 1 );
+	if( p == NULL )
+		throw std::bad_alloc();
+	return p;
+}
+
+void	*operator new[]( size_t _size )	{	return operator new( _size );	}
+void	operator delete( void *_p ) throw()		{	free( _p );	}
+void	operator delete[]( void *_p ) throw()	{	free( _p );	}
+void	operator delete( void *_p, size_t ) throw()		{	free( _p );	}
+void	operator delete[]( void *_p, size_t ) throw()	{	free( _p );	}
+
+/*
+	MemoryUsage().
+	Current and peak resident set size in kB.
+*/
+static void	MemoryUsage( uint64 &_rss, uint64 &_peak )
+{
+	_rss = _peak = 0;
+
+#ifdef LINUX_GNU
+	FILE *pFile = fopen( "/proc/self/status", "r" );
+	if( pFile )
+	{
+		char line[256];
+		unsigned long long value;
+		while( fgets( line, sizeof(line), pFile ) )
+		{
+			if( sscanf( line, "VmRSS: %llu", &value ) == 1 )
+				_rss = value;
+			else if( sscanf( line, "VmHWM: %llu", &value ) == 1 )
+				_peak = value;
+		}
+		fclose( pFile );
+	}
+#endif
+
+#ifndef WIN32
+	if( _peak == 0 )
+	{
+		struct rusage usage;
+		if( getrusage( RUSAGE_SELF, &usage ) == 0 )
+#ifdef MAC
+			_peak = (uint64)usage.ru_maxrss / 1024;
+#else
+			_peak = (uint64)usage.ru_maxrss;
+#endif
+	}
+#endif
+}
+
+/*
+	QueueBench().
+	Hands pointers from one thread to another through the old blocking queue and the SPSC ring used for decoded frames.
+*/
+template <class Q> struct	sQueueProducer
+{
+	Q		&m_Queue;
+	uint32	m_Count;
+
+	sQueueProducer( Q &_queue, const uint32 _count ) : m_Queue( _queue ), m_Count( _count )	{}
+
+	void	operator()()
+	{
+		for( uint32 i=1; i<=m_Count; i++ )
+			m_Queue.push( (void *)(size_t)i );
+	}
+};
+
+template <class Q> static fp8	QueueRun( Q &_queue, const uint32 _count )
+{
+	Base::CTimer timer;
+	timer.Reset();
+
+	boost::thread producer( sQueueProducer<Q>( _queue, _count ) );
+
+	void *p;
+	for( uint32 i=0; i<_count; i++ )
+		while( !_queue.pop( p, true ) )
+			;
+
+	producer.join();
+
+	return timer.Time();
+}
+
+static void	QueueBench( const uint32 _queueLength )
+{
+	const uint32 count = 1000000;
+
+	Base::CBlockingQueue<void *> blocking;
+	blocking.setMaxQueueElements( _queueLength );
+	fp8 blockingTime = QueueRun( blocking, count );
+
+	Base::CSPSCQueue<void *> spsc( _queueLength );
+	fp8 spscTime = QueueRun( spsc, count );
+
+	printf( "queue handoff, %u elements through a %u deep queue:\n", count, _queueLength );
+	printf( "  CBlockingQueue: %8.1f ns/element\n", blockingTime * 1e9 / count );
+	printf( "  CSPSCQueue:     %8.1f ns/element\n", spscTime * 1e9 / count );
+}
+
+/*
+	BlendBench().
+	Times the frame interpolation of CCPUFrameDisplay on one core, for every blend kernel this cpu has.
+*/
+static void	BlendBench( const uint32 _width, const uint32 _height )
+{
+	const uint32 numBytes = _width * _height * 4;
+	const uint32 iterations = 120;
+
+	Base::spCAlignedBuffer spSources[ Base::CFrameBlend::kMaxSources ];
+	const uint8 *sources[ Base::CFrameBlend::kMaxSources ];
+	uint32 seed = 12345;
+	for( uint32 i=0; i<Base::CFrameBlend::kMaxSources; i++ )
+	{
+		spSources[i] = new Base::CAlignedBuffer( numBytes );
+		uint8 *p = spSources[i]->GetBufferPtr();
+		for( uint32 b=0; b<numBytes; b++ )
+		{
+			seed = seed * 1103515245 + 12345;
+			p[b] = (uint8)( seed >> 16 );
+		}
+		sources[i] = p;
+	}
+
+	Base::spCAlignedBuffer spReference = new Base::CAlignedBuffer( numBytes );
+	Base::spCAlignedBuffer spResult = new Base::CAlignedBuffer( numBytes );
+
+	//	Cubic B-spline weights halfway between two frames, on their own and halfway through a transition.
+	const fp4 cubic[4] = { 1.f / 48.f, 23.f / 48.f, 23.f / 48.f, 1.f / 48.f };
+	fp4 weights[ Base::CFrameBlend::kMaxSources ];
+
+	printf( "cpu frame interpolation, %ux%u, one thread, %u frames:\n", _width, _height, iterations );
+
+	for( uint32 numSources=4; numSources<=Base::CFrameBlend::kMaxSources; numSources+=4 )
+	{
+		for( uint32 i=0; i<numSources; i++ )
+			weights[i] = cubic[ i % 4 ] * 4.f / numSources;
+
+		Base::CFrameBlend::Blend( spReference->GetBufferPtr(), sources, weights, numSources, numBytes, Base::CFrameBlend::eScalar );
+
+		for( uint32 k=Base::CFrameBlend::eScalar; k<=(uint32)Base::CFrameBlend::Best(); k++ )
+		{
+			Base::CFrameBlend::eKernel kernel = (Base::CFrameBlend::eKernel)k;
+
+			Base::CTimer timer;
+			timer.Reset();
+			for( uint32 i=0; i<iterations; i++ )
+				Base::CFrameBlend::Blend( spResult->GetBufferPtr(), sources, weights, numSources, numBytes, kernel );
+			fp8 ms = timer.Time() * 1000.0 / iterations;
+
+			bool bMatch = memcmp( spResult->GetBufferPtr(), spReference->GetBufferPtr(), numBytes ) == 0;
+
+			printf( "  %-6s %u frames%s: %6.2f ms/frame, %6.1f fps%s\n", Base::CFrameBlend::KernelName( kernel ), numSources,
+					numSources > 4 ? " (transition)" : "", ms, 1000.0 / ms, bMatch ? "" : ", DIFFERS FROM SCALAR" );
+		}
+	}
+
+	printf( "60 fps leaves %.2f ms per frame\n", 1000.0 / 60.0 );
+}
+
+#ifdef ES_BENCH_GL
+/*
+	TextureBench().
+	Texture binds and uploads per display frame of CCubicFrameDisplay, with its eight separate textures and with the frames as layers of one texture array.
+	Both run the same display loop: frames come in at 23 fps into a 60 fps display, every other 100 frames with a transition running,
+	and the frame size switches every 300 frames like it does between sheep. Each display frame is timed up to a glFinish() after the draw.
+	Needs a display for its GL context.
+*/
+struct	sTexBenchPath
+{
+	const char	*m_pName;
+	bool		m_bArray;
+	GLuint		m_Program;
+	GLuint		m_Textures[ 8 ];
+	uint32		m_Widths[ 8 ];
+	uint32		m_Heights[ 8 ];
+	bool		m_bDirty[ 8 ];
+	int32		m_Layers[ 8 ];
+	GLuint		m_Active[ 9 ];
+	//	Per texture like the display has them, the array path only uses the first.
+	DisplayOutput::CPixelStreamGL	m_Streams[ 8 ];
+
+	//	Per run.
+	uint32		m_Binds;
+	uint32		m_Created;
+	uint32		m_Deleted;
+	uint32		m_Respecified;
+	uint64		m_TotalTime;
+	Base::CLatencyHistogram	m_FrameTime;
+};
+
+static GLuint	TexBenchProgram( const char *_pSource )
+{
+	GLuint shader = glCreateShader( GL_FRAGMENT_SHADER );
+	glShaderSource( shader, 1, &_pSource, NULL );
+	glCompileShader( shader );
+
+	GLint ok = 0;
+	glGetShaderiv( shader, GL_COMPILE_STATUS, &ok );
+	if( !ok )
+		return 0;
+
+	GLuint program = glCreateProgram();
+	glAttachShader( program, shader );
+	glLinkProgram( program );
+	glGetProgramiv( program, GL_LINK_STATUS, &ok );
+	if( !ok )
+		return 0;
+
+	glUseProgram( program );
+	if( strstr( _pSource, "sampler2DArray" ) )
+		glUniform1i( glGetUniformLocation( program, "texUnit1" ), 1 );
+	else
+		for( int32 i=1; i<=8; i++ )
+		{
+			char name[ 16 ];
+			snprintf( name, sizeof(name), "texUnit%d", i );
+			glUniform1i( glGetUniformLocation( program, name ), i );
+		}
+	glUniform4f( glGetUniformLocation( program, "weights" ), 1.f / 48.f, 23.f / 48.f, 23.f / 48.f, 1.f / 48.f );
+
+	return program;
+}
+
+//	Streams _pPixels into the bound texture through _stream, like CTextureFlatGL and CTextureArrayGL do.
+static void	TexBenchUpload( DisplayOutput::CPixelStreamGL &_stream, const int32 _layer, const uint32 _width, const uint32 _height, const uint8 *_pPixels )
+{
+	const bool bStreamed = _stream.Write( _pPixels, _width * _height * 4 );
+	if( bStreamed )
+		_pPixels = NULL;
+
+	if( _layer < 0 )
+		glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, _pPixels );
+	else
+		glTexSubImage3D( GL_TEXTURE_2D_ARRAY_EXT, 0, 0, 0, _layer, _width, _height, 1, GL_RGBA, GL_UNSIGNED_BYTE, _pPixels );
+
+	if( bStreamed )
+		_stream.Done();
+}
+
+//	Texture parameters of CTextureFlatGL::StreamUpload().
+static void	TexBenchParameters( const GLenum _target )
+{
+	glTexParameteri( _target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+	glTexParameteri( _target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+	glTexParameteri( _target, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+	glTexParameteri( _target, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+}
+
+//	Into a slot of the separate textures path, slots without a texture get a new one, like CFrameDisplay::UploadFrame().
+static void	TexBenchUploadFlat( sTexBenchPath &_path, const uint32 _slot, const uint32 _width, const uint32 _height, const uint8 *_pPixels )
+{
+	if( _path.m_Textures[ _slot ] == 0 )
+	{
+		glGenTextures( 1, &_path.m_Textures[ _slot ] );
+		_path.m_Widths[ _slot ] = _path.m_Heights[ _slot ] = 0;
+		_path.m_Created++;
+	}
+
+	glBindTexture( GL_TEXTURE_2D, _path.m_Textures[ _slot ] );
+	if( _path.m_Widths[ _slot ] != _width || _path.m_Heights[ _slot ] != _height )
+	{
+		TexBenchParameters( GL_TEXTURE_2D );
+		glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, _width, _height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+		_path.m_Widths[ _slot ] = _width;
+		_path.m_Heights[ _slot ] = _height;
+		_path.m_Respecified++;
+	}
+
+	TexBenchUpload( _path.m_Streams[ _slot ], -1, _width, _height, _pPixels );
+	glBindTexture( GL_TEXTURE_2D, 0 );
+	_path.m_bDirty[ _slot ] = true;
+}
+
+static void	TexBenchDropFlat( sTexBenchPath &_path, const uint32 _slot )
+{
+	if( _path.m_Textures[ _slot ] == 0 )
+		return;
+
+	//	CRenderer still holds it while it is bound, it goes when the unit gets another one.
+	for( uint32 u=1; u<=8; u++ )
+		if( _path.m_Active[u] == _path.m_Textures[ _slot ] )
+		{
+			glActiveTextureARB( GL_TEXTURE0 + u );
+			glBindTexture( GL_TEXTURE_2D, 0 );
+			glDisable( GL_TEXTURE_2D );
+			_path.m_Active[u] = 0;
+		}
+
+	glDeleteTextures( 1, &_path.m_Textures[ _slot ] );
+	_path.m_Textures[ _slot ] = 0;
+	_path.m_Streams[ _slot ].Release();
+	_path.m_Deleted++;
+}
+
+//	CRenderer::Apply() for texture units 1 to 8 of the separate textures path.
+static void	TexBenchApplyFlat( sTexBenchPath &_path, const uint32 *_pSlots, const uint32 _numUnits )
+{
+	for( uint32 u=1; u<=_numUnits; u++ )
+	{
+		uint32 slot = _pSlots[ u - 1 ];
+		GLuint tex = _path.m_Textures[ slot ];
+		if( tex != _path.m_Active[u] || _path.m_bDirty[ slot ] )
+		{
+			glActiveTextureARB( GL_TEXTURE0 + u );
+			if( _path.m_Active[u] != 0 && tex != _path.m_Active[u] )
+			{
+				glBindTexture( GL_TEXTURE_2D, 0 );
+				glDisable( GL_TEXTURE_2D );
+			}
+			glEnable( GL_TEXTURE_2D );
+			glBindTexture( GL_TEXTURE_2D, tex );
+			_path.m_Active[u] = tex;
+			_path.m_bDirty[ slot ] = false;
+			_path.m_Binds++;
+		}
+	}
+}
+
+static int32	TexBenchFreeLayer( sTexBenchPath &_path )
+{
+	for( int32 layer=0; layer<8; layer++ )
+	{
+		bool bUsed = false;
+		for( uint32 i=0; i<8; i++ )
+			if( _path.m_Layers[i] == layer )
+				bUsed = true;
+		if( !bUsed )
+			return layer;
+	}
+	return -1;
+}
+
+static void	TexBenchRun( sTexBenchPath &_path, const uint32 _width, const uint32 _height, const uint8 *_pPixels, const uint32 _displayFrames )
+{
+	const fp8 decodeFps = 23.0, displayFps = 60.0;
+
+	uint32 frames[4] = { 0, 1, 2, 3 };
+	uint32 numFrames = 0, numSecond = 0, decoded = 0;
+
+	memset( _path.m_Textures, 0, sizeof(_path.m_Textures) );
+	memset( _path.m_Active, 0, sizeof(_path.m_Active) );
+	memset( _path.m_bDirty, 0, sizeof(_path.m_bDirty) );
+	for( uint32 i=0; i<8; i++ )
+		_path.m_Layers[i] = -1;
+	_path.m_Binds = _path.m_Created = _path.m_Deleted = _path.m_Respecified = 0;
+	_path.m_TotalTime = 0;
+
+	uint32 arrayWidth = 0, arrayHeight = 0;
+	if( _path.m_bArray )
+	{
+		glGenTextures( 1, &_path.m_Textures[0] );
+		_path.m_Created++;
+	}
+
+	glUseProgram( _path.m_Program );
+	GLint layersLoc = glGetUniformLocation( _path.m_Program, "layers" );
+	GLint secondLayersLoc = glGetUniformLocation( _path.m_Program, "secondLayers" );
+	GLint transLoc = glGetUniformLocation( _path.m_Program, "transPct" );
+
+	for( uint32 f=0; f<_displayFrames; f++ )
+	{
+		uint64 start = Base::CLatencyStats::Now();
+
+		const bool bNewFrame = (uint32)( ( f + 1 ) * decodeFps / displayFps ) != (uint32)( f * decodeFps / displayFps ) || f == 0;
+		if( bNewFrame )
+		{
+			uint32 tmp = frames[0];
+			frames[0] = frames[1];	frames[1] = frames[2];	frames[2] = frames[3];	frames[3] = tmp;
+
+			const uint32 slot = frames[3];
+			const bool bTransition = ( decoded / 100 ) % 2 == 1;
+			const bool bSmall = ( decoded / 300 ) % 2 == 1;
+			const uint32 w = bSmall ? _width * 2 / 3 : _width;
+			const uint32 h = bSmall ? _height * 2 / 3 : _height;
+			decoded++;
+
+			if( _path.m_bArray )
+			{
+				glBindTexture( GL_TEXTURE_2D_ARRAY_EXT, _path.m_Textures[0] );
+				if( w != arrayWidth || h != arrayHeight )
+				{
+					TexBenchParameters( GL_TEXTURE_2D_ARRAY_EXT );
+					glTexImage3D( GL_TEXTURE_2D_ARRAY_EXT, 0, GL_RGBA8, w, h, 8, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+					arrayWidth = w;
+					arrayHeight = h;
+					_path.m_Respecified++;
+					for( uint32 i=0; i<8; i++ )
+						_path.m_Layers[i] = -1;
+					numFrames = numSecond = 0;
+				}
+
+				if( _path.m_Layers[ slot ] < 0 )
+					_path.m_Layers[ slot ] = TexBenchFreeLayer( _path );
+				TexBenchUpload( _path.m_Streams[0], _path.m_Layers[ slot ], w, h, _pPixels );
+
+				if( bTransition )
+				{
+					if( _path.m_Layers[ slot + 4 ] < 0 )
+						_path.m_Layers[ slot + 4 ] = TexBenchFreeLayer( _path );
+					TexBenchUpload( _path.m_Streams[0], _path.m_Layers[ slot + 4 ], w, h, _pPixels );
+				}
+				else
+					_path.m_Layers[ slot + 4 ] = -1;
+
+				glBindTexture( GL_TEXTURE_2D_ARRAY_EXT, 0 );
+				_path.m_bDirty[0] = true;
+			}
+			else
+			{
+				TexBenchUploadFlat( _path, slot, w, h, _pPixels );
+				if( bTransition )
+					TexBenchUploadFlat( _path, slot + 4, w, h, _pPixels );
+				else
+					TexBenchDropFlat( _path, slot + 4 );
+			}
+
+			numFrames++;
+			numSecond = bTransition ? numSecond + 1 : 0;
+		}
+
+		//	Same frame choice as CCubicFrameDisplay::BindFrames().
+		const uint32 use = ( numFrames > 4 ) ? 4 : numFrames;
+		const uint32 secondUse = ( numSecond > 4 ) ? 4 : numSecond;
+		uint32 slots[8];
+		for( uint32 i=0; i<4; i++ )
+		{
+			slots[i] = frames[ ( i < 4 - use ) ? 4 - use : i ];
+			slots[i + 4] = ( secondUse > 0 ) ? frames[ ( i < 4 - secondUse ) ? 4 - secondUse : i ] + 4 : slots[i];
+		}
+
+		if( _path.m_bArray )
+		{
+			fp4 layers[8];
+			for( uint32 i=0; i<8; i++ )
+				layers[i] = (fp4)_path.m_Layers[ slots[i] ];
+			glUniform4f( layersLoc, layers[0], layers[1], layers[2], layers[3] );
+			glUniform4f( secondLayersLoc, layers[4], layers[5], layers[6], layers[7] );
+
+			if( _path.m_bDirty[0] )
+			{
+				glActiveTextureARB( GL_TEXTURE1 );
+				glBindTexture( GL_TEXTURE_2D_ARRAY_EXT, _path.m_Textures[0] );
+				_path.m_bDirty[0] = false;
+				_path.m_Binds++;
+			}
+		}
+		else
+			TexBenchApplyFlat( _path, slots, secondUse > 0 ? 8 : 4 );
+
+		glUniform1f( transLoc, secondUse > 0 ? 50.f : 0.f );
+
+		glBegin( GL_QUADS );
+		glTexCoord2f( 0, 0 );	glVertex2f( -1, -1 );
+		glTexCoord2f( 1, 0 );	glVertex2f( 1, -1 );
+		glTexCoord2f( 1, 1 );	glVertex2f( 1, 1 );
+		glTexCoord2f( 0, 1 );	glVertex2f( -1, 1 );
+		glEnd();
+		glFinish();
+
+		uint64 time = Base::CLatencyStats::Now() - start;
+		_path.m_FrameTime.Record( (uint32)time );
+		_path.m_TotalTime += time;
+	}
+
+	for( uint32 u=1; u<=8; u++ )
+	{
+		glActiveTextureARB( GL_TEXTURE0 + u );
+		glBindTexture( GL_TEXTURE_2D, 0 );
+		glBindTexture( GL_TEXTURE_2D_ARRAY_EXT, 0 );
+		glDisable( GL_TEXTURE_2D );
+	}
+	glActiveTextureARB( GL_TEXTURE0 );
+
+	for( uint32 i=0; i<8; i++ )
+		if( _path.m_Textures[i] != 0 )
+			glDeleteTextures( 1, &_path.m_Textures[i] );
+	for( uint32 i=0; i<8; i++ )
+		_path.m_Streams[i].Release();
+}
+
+static void	TextureBench( int _argc, char *_argv[], const uint32 _width, const uint32 _height )
+{
+	static const char *flatShader = "\
+		uniform sampler2D texUnit1; uniform sampler2D texUnit2; uniform sampler2D texUnit3; uniform sampler2D texUnit4;\
+		uniform sampler2D texUnit5; uniform sampler2D texUnit6; uniform sampler2D texUnit7; uniform sampler2D texUnit8;\
+		uniform vec4 weights; uniform float transPct;\
+		void main(void)\
+		{\
+			vec2 st = gl_TexCoord[0].st;\
+			vec4 fc1 = texture2D( texUnit1, st ) * weights.x + texture2D( texUnit2, st ) * weights.y + texture2D( texUnit3, st ) * weights.z + texture2D( texUnit4, st ) * weights.w;\
+			vec4 fc2 = texture2D( texUnit5, st ) * weights.x + texture2D( texUnit6, st ) * weights.y + texture2D( texUnit7, st ) * weights.z + texture2D( texUnit8, st ) * weights.w;\
+			gl_FragColor = mix( fc1, fc2, transPct / 100.0 );\
+		}";
+
+	static const char *arrayShader = "#extension GL_EXT_texture_array : enable\n\
+		uniform sampler2DArray texUnit1;\
+		uniform vec4 layers; uniform vec4 secondLayers; uniform vec4 weights; uniform float transPct;\
+		void main(void)\
+		{\
+			vec2 st = gl_TexCoord[0].st;\
+			vec4 fc1 = texture2DArray( texUnit1, vec3( st, layers.x ) ) * weights.x + texture2DArray( texUnit1, vec3( st, layers.y ) ) * weights.y +\
+					   texture2DArray( texUnit1, vec3( st, layers.z ) ) * weights.z + texture2DArray( texUnit1, vec3( st, layers.w ) ) * weights.w;\
+			vec4 fc2 = texture2DArray( texUnit1, vec3( st, secondLayers.x ) ) * weights.x + texture2DArray( texUnit1, vec3( st, secondLayers.y ) ) * weights.y +\
+					   texture2DArray( texUnit1, vec3( st, secondLayers.z ) ) * weights.z + texture2DArray( texUnit1, vec3( st, secondLayers.w ) ) * weights.w;\
+			gl_FragColor = mix( fc1, fc2, transPct / 100.0 );\
+		}";
+
+	glutInit( &_argc, _argv );
+	glutInitDisplayMode( GLUT_RGBA | GLUT_DOUBLE );
+	glutInitWindowSize( 640, 360 );
+	glutCreateWindow( "es-bench" );
+	GLeeInit();
+
+	if( !GLEE_VERSION_2_0 || !GLEE_EXT_texture_array )
+	{
+		printf( "needs OpenGL 2.0 and EXT_texture_array\n" );
+		return;
+	}
+
+	std::vector<uint8> pixels( _width * _height * 4 );
+	for( size_t i=0; i<pixels.size(); i++ )
+		pixels[i] = (uint8)( i * 7 );
+
+	sTexBenchPath paths[2];
+	paths[0].m_pName = "separate textures";
+	paths[0].m_bArray = false;
+	paths[0].m_Program = TexBenchProgram( flatShader );
+	paths[1].m_pName = "texture array";
+	paths[1].m_bArray = true;
+	paths[1].m_Program = TexBenchProgram( arrayShader );
+
+	const uint32 displayFrames = 3000;
+	printf( "cubic frame display, %ux%u frames at 23 fps into 60 fps, %u display frames on %s:\n", _width, _height, displayFrames, (const char *)glGetString( GL_RENDERER ) );
+
+	for( uint32 p=0; p<2; p++ )
+	{
+		sTexBenchPath &path = paths[p];
+		if( path.m_Program == 0 )
+		{
+			printf( "  %-18s shader failed\n", path.m_pName );
+			continue;
+		}
+
+		TexBenchRun( path, _width, _height, &pixels[0], displayFrames );
+
+		printf( "  %-18s %5.2f binds/frame, %4u textures created, %4u deleted, %3u storage respecifications\n", path.m_pName,
+				path.m_Binds / (fp8)displayFrames, path.m_Created, path.m_Deleted, path.m_Respecified );
+		printf( "  %-18s %.3f ms/frame, p50/p95/p99 %.2f/%.2f/%.2f ms\n", "", path.m_TotalTime / 1000.0 / displayFrames,
+				path.m_FrameTime.Percentile( 50 ) / 1000.0, path.m_FrameTime.Percentile( 95 ) / 1000.0, path.m_FrameTime.Percentile( 99 ) / 1000.0 );
+	}
+}
+#endif
+
+/*
+	FlockBench().
+	Picks the next sheep to download from a synthetic list, the way SheepDownloader did before the flocks were indexed against CSheepIndex and CDownloadQueue.
+	Every decision includes the rating refresh of updateCachedSheep(). The cache size limit is left out, it costs the same both ways.
+*/
+using ContentDownloader::Sheep;
+using ContentDownloader::SheepArray;
+
+//	Old selection, O(server x client) twice per decision. _ratingOld/_ctimeOld are the bounds it kept between decisions.
+static int	FlockScanPick( const SheepArray &_server, const SheepArray &_client, int &_ratingOld, time_t &_ctimeOld, size_t &_downloaded )
+{
+	for( size_t j=0; j<_client.size(); j++ )
+		for( size_t i=0; i<_server.size(); i++ )
+			if( _server[i]->id() == _client[j]->id() && _server[i]->generation() == _client[j]->generation() &&
+				_server[i]->firstId() == _client[j]->firstId() && _server[i]->lastId() == _client[j]->lastId() )
+			{
+				_client[j]->setRating( _server[i]->rating() );
+				break;
+			}
+
+	_downloaded = 0;
+	for( size_t i=0; i<_server.size(); i++ )
+		for( size_t j=0; j<_client.size(); j++ )
+			if( _server[i]->id() == _client[j]->id() && _server[i]->generation() == _client[j]->generation() )
+			{
+				_downloaded++;
+				break;
+			}
+
+	int bestRating = INT_MIN;
+	time_t bestCtime = 0;
+	int best = -1;
+	for( size_t i=0; i<_server.size(); i++ )
+	{
+		size_t j;
+		for( j=0; j<_client.size(); j++ )
+			if( _server[i]->id() == _client[j]->id() && _server[i]->generation() == _client[j]->generation() )
+				break;
+
+		if( j != _client.size() )
+			continue;
+
+		if( (bestCtime == 0 && _ctimeOld == 0) ||
+			(_server[i]->rating() > bestRating && _server[i]->rating() <= _ratingOld) ||
+			(_server[i]->rating() == bestRating && _server[i]->fileWriteTime() < bestCtime) )
+			if( _server[i]->rating() != _ratingOld || _server[i]->fileWriteTime() > _ctimeOld )
+			{
+				bestRating = _server[i]->rating();
+				bestCtime = _server[i]->fileWriteTime();
+				best = (int)i;
+			}
+	}
+
+	if( best != -1 )
+	{
+		_ratingOld = bestRating;
+		_ctimeOld = bestCtime;
+	}
+
+	return best;
+}
+
+//	New selection, the client index is rebuilt every time like updateCachedSheep() does after rescanning the cache.
+static int	FlockIndexPick( const SheepArray &_server, const SheepArray &_client, const ContentDownloader::CSheepIndex &_serverIndex,
+							ContentDownloader::CSheepIndex &_clientIndex, ContentDownloader::CDownloadQueue &_queue )
+{
+	_clientIndex.Build( _client );
+
+	for( size_t j=0; j<_client.size(); j++ )
+	{
+		Sheep *pServer = _serverIndex.Find( _client[j]->generation(), _client[j]->id() );
+		if( pServer != NULL && pServer->firstId() == _client[j]->firstId() && pServer->lastId() == _client[j]->lastId() )
+			_client[j]->setRating( pServer->rating() );
+	}
+
+	uint32 next;
+	while( _queue.Pop( next ) )
+		if( !_clientIndex.Contains( _server[ next ] ) )
+			return (int)next;
+
+	return -1;
+}
+
+static void	FlockBench( const uint32 _numServer, const uint32 _numClient, const uint32 _numScanDecisions, const uint32 _numIndexDecisions )
+{
+	SheepArray server, clientScan, clientIndex;
+	uint32 seed = 12345;
+
+	//	Mostly one generation plus some gold, ratings clumped like the real list, distinct write times so both ways agree on the order.
+	std::vector<uint32> order( _numServer );
+	for( uint32 i=0; i<_numServer; i++ )
+		order[i] = i;
+
+	for( uint32 i=0; i<_numServer; i++ )
+	{
+		seed = seed * 1103515245 + 12345;
+		std::swap( order[i], order[ i + ( seed >> 8 ) % ( _numServer - i ) ] );
+	}
+
+	for( uint32 i=0; i<_numServer; i++ )
+	{
+		seed = seed * 1103515245 + 12345;
+		Sheep *pSheep = new Sheep();
+		pSheep->setGeneration( ( i % 10 ) ? 248 : 10244 );
+		pSheep->setId( i );
+		pSheep->setFirstId( ( seed >> 8 ) % _numServer );
+		pSheep->setLastId( ( seed >> 12 ) % _numServer );
+		pSheep->setRating( (int)( ( seed >> 16 ) % 12 ) - 2 );
+		pSheep->setFileWriteTime( (time_t)1300000000 + order[i] * 60 );
+		pSheep->setFileSize( 4 * 1024 * 1024 );
+		server.push_back( pSheep );
+	}
+
+	for( uint32 i=0; i<_numClient && i<_numServer; i++ )
+	{
+		clientScan.push_back( new Sheep( *server[ order[i] ] ) );
+		clientIndex.push_back( new Sheep( *server[ order[i] ] ) );
+	}
+
+	printf( "next sheep to download, %u sheep on the server, %u in the cache:\n", _numServer, (uint32)clientScan.size() );
+
+	//	Old way.
+	int ratingOld = INT_MAX;
+	time_t ctimeOld = 0;
+	size_t downloaded = 0;
+	std::vector<int> scanPicks;
+
+	Base::CTimer timer;
+	timer.Reset();
+	for( uint32 d=0; d<_numScanDecisions; d++ )
+	{
+		int pick = FlockScanPick( server, clientScan, ratingOld, ctimeOld, downloaded );
+		scanPicks.push_back( pick );
+		if( pick == -1 )
+			break;
+
+		clientScan.push_back( new Sheep( *server[ (size_t)pick ] ) );
+	}
+	fp8 scanTime = timer.Time();
+
+	//	New way.
+	ContentDownloader::CSheepIndex serverIndex, clientIdx;
+	ContentDownloader::CDownloadQueue queue;
+
+	timer.Reset();
+	serverIndex.Build( server );
+	queue.Build( server );
+	fp8 buildTime = timer.Time();
+
+	std::vector<int> indexPicks;
+	timer.Reset();
+	for( uint32 d=0; d<_numIndexDecisions; d++ )
+	{
+		int pick = FlockIndexPick( server, clientIndex, serverIndex, clientIdx, queue );
+		indexPicks.push_back( pick );
+		if( pick == -1 )
+			break;
+
+		clientIndex.push_back( new Sheep( *server[ (size_t)pick ] ) );
+	}
+	fp8 indexTime = timer.Time();
+
+	bool bMatch = true;
+	for( size_t d=0; d<scanPicks.size() && d<indexPicks.size(); d++ )
+		bMatch &= ( scanPicks[d] == indexPicks[d] );
+
+	printf( "  scans:        %10.3f ms/decision over %u decisions\n", scanTime * 1000.0 / scanPicks.size(), (uint32)scanPicks.size() );
+	printf( "  index + heap: %10.3f ms/decision over %u decisions, %.3f ms to index and queue the list\n", indexTime * 1000.0 / indexPicks.size(), (uint32)indexPicks.size(), buildTime * 1000.0 );
+	printf( "  first %u picks %s\n", (uint32)std::min( scanPicks.size(), indexPicks.size() ), bMatch ? "match" : "DIFFER" );
+
+	for( size_t i=0; i<server.size(); i++ )		delete server[i];
+	for( size_t i=0; i<clientScan.size(); i++ )	delete clientScan[i];
+	for( size_t i=0; i<clientIndex.size(); i++ )	delete clientIndex[i];
+}
+
+/*
+	NetBench().
+	Fetches _url a number of times through the network manager, one after the other and then several at once,
+	and counts the connections that took. Point it at a local http server to try the transfers without the sheep server.
+*/
+static void	NetBench( const std::string &_url, const uint32 _count, const uint32 _parallel )
+{
+	g_NetworkManager->Startup();
+
+	printf( "%u downloads of %s:\n", _count, _url.c_str() );
+
+	for( uint32 pass=0; pass<2; pass++ )
+	{
+		const uint32 parallel = ( pass == 0 ) ? 1 : _parallel;
+		uint32 numFailed = 0;
+		long numConnects = 0;
+		uint64 numBytes = 0;
+
+		Base::CTimer timer;
+		timer.Reset();
+		for( uint32 i=0; i<_count; i+=parallel )
+		{
+			std::vector<Network::spCFileDownloader> downloads;
+			for( uint32 j=i; j<_count && j<i+parallel; j++ )
+			{
+				char name[32];
+				snprintf( name, 32, "Bench #%u", j );
+				downloads.push_back( new Network::CFileDownloader( name ) );
+				downloads.back()->Start( _url );
+			}
+
+			for( size_t j=0; j<downloads.size(); j++ )
+			{
+				if( downloads[j]->Finish() )
+				{
+					numConnects += downloads[j]->NumConnects();
+					numBytes += downloads[j]->Data().size();
+				}
+				else
+					numFailed++;
+			}
+		}
+		fp8 time = timer.Time();
+
+		printf( "  %u at a time: %8.1f ms, %7.2f MB/s, %ld new connections, %u failed\n", parallel, time * 1000.0,
+				numBytes / ( 1024.0 * 1024.0 ) / time, numConnects, numFailed );
+	}
+
+	g_NetworkManager->Shutdown();
+}
+
+static void	Usage()
+{
+	printf( "usage: es-bench [options] <sheep directory>\n" );
+	printf( "  -frames <n>      frames to consume (default 1000)\n" );
+	printf( "  -fps <n>         consume at a fixed rate, 0 is as fast as possible (default 0)\n" );
+	printf( "  -transitions     crossfade at every sheep change, exercising the two stream path\n" );
+	printf( "  -yuv             decode to packed YUV420 instead of BGRA\n" );
+	printf( "  -queue <n>       decoder queue length (default 10)\n" );
+	printf( "  -settings <dir>  use the decoder settings of this settings root (read only)\n" );
+	printf( "  -queuebench      only compare the frame queue implementations\n" );
+	printf( "  -blendbench      only time the cpu frame interpolation on 1080p frames\n" );
+	printf( "  -texbench        only compare texture binds and uploads of the cubic display, separate textures against a texture array\n" );
+	printf( "  -flockbench      only compare picking the next sheep to download from a 50000 sheep list, scans against index and heap\n" );
+	printf( "  -netbench <url>  only download url 32 times, one at a time and 4 at a time, e.g. from a local http server\n" );
+}
+
+//
+int	main( int argc, char *argv[] )
+{
+	uint32 numFrames = 1000;
+	fp8 fps = 0.0;
+	bool bTransitions = false;
+	bool bYUV = false;
+	bool bQueueBench = false;
+	bool bBlendBench = false;
+	bool bTexBench = false;
+	bool bFlockBench = false;
+	std::string netBenchUrl;
+	uint32 queueLength = 10;
+	std::string settingsRoot;
+	std::string directory;
+
+	for( int i=1; i<argc; i++ )
+	{
+		std::string arg( argv[i] );
+		if( arg == "-frames" && i+1 < argc )
+			numFrames = (uint32)atoi( argv[++i] );
+		else if( arg == "-fps" && i+1 < argc )
+			fps = atof( argv[++i] );
+		else if( arg == "-transitions" )
+			bTransitions = true;
+		else if( arg == "-yuv" )
+			bYUV = true;
+		else if( arg == "-queue" && i+1 < argc )
+			queueLength = (uint32)atoi( argv[++i] );
+		else if( arg == "-settings" && i+1 < argc )
+			settingsRoot = argv[++i];
+		else if( arg == "-queuebench" )
+			bQueueBench = true;
+		else if( arg == "-blendbench" )
+			bBlendBench = true;
+		else if( arg == "-texbench" )
+			bTexBench = true;
+		else if( arg == "-flockbench" )
+			bFlockBench = true;
+		else if( arg == "-netbench" && i+1 < argc )
+			netBenchUrl = argv[++i];
+		else if( arg[0] != '-' )
+			directory = arg;
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+
+	if( queueLength < 1 )
+		queueLength = 1;
+
+	if( bQueueBench )
+	{
+		QueueBench( queueLength );
+		return 0;
+	}
+
+	if( bBlendBench )
+	{
+		BlendBench( 1920, 1080 );
+		return 0;
+	}
+
+	if( bTexBench )
+	{
+#ifdef ES_BENCH_GL
+		TextureBench( argc, argv, 1280, 720 );
+		return 0;
+#else
+		printf( "-texbench needs a GL context, it is in es-texbench\n" );
+		return 1;
+#endif
+	}
+
+	if( bFlockBench )
+	{
+		FlockBench( 50000, 5000, 5, 1000 );
+		return 0;
+	}
+
+	if( !netBenchUrl.empty() )
+	{
+		NetBench( netBenchUrl, 32, 4 );
+		return 0;
+	}
+
+	if( directory.empty() || numFrames == 0 )
+	{
+		Usage();
+		return 1;
+	}
+
+	g_Log->Startup();
+
+	if( !settingsRoot.empty() && !g_Settings()->Init( settingsRoot, settingsRoot, true ) )
+	{
+		printf( "failed to read settings from %s\n", settingsRoot.c_str() );
+		return 1;
+	}
+
+	ContentDecoder::spCPlaylist spPlaylist = new CDirectoryPlaylist( directory );
+	if( spPlaylist->Size() == 0 )
+	{
+		printf( "no .avi files in %s\n", directory.c_str() );
+		return 1;
+	}
+
+	AVPixelFormat pf = bYUV ? AV_PIX_FMT_YUV420P : AV_PIX_FMT_BGR32;
+
+	ContentDecoder::spCContentDecoder spDecoder = new ContentDecoder::CContentDecoder( spPlaylist, false, true, queueLength, pf );
+	spDecoder->ForceTransitions( bTransitions );
+
+	if( !spDecoder->Start() )
+	{
+		printf( "decoder failed to start\n" );
+		return 1;
+	}
+
+	ContentDecoder::CVideoFramePool &framePool = ContentDecoder::g_VideoFramePool();
+	uint64 poolAllocationsStart = framePool.Allocations();
+	uint32 heapAllocationsStart = g_HeapAllocations;
+
+	//	Time from asking for a frame until it is there, as the render thread would see it.
+	Base::CLatencyHistogram frameLatency;
+	uint32 transitionFrames = 0;
+	uint32 lateFrames = 0;
+
+	Base::CTimer timer;
+	timer.Reset();
+
+	for( uint32 i=0; i<numFrames; i++ )
+	{
+		if( fps > 0.0 )
+		{
+			fp8 due = i / fps;
+			fp8 now = timer.Time();
+			if( due > now )
+				boost::this_thread::sleep( boost::posix_time::microseconds( (int64)( ( due - now ) * 1e6 ) ) );
+		}
+
+		uint64 start = Base::CLatencyStats::Now();
+
+		ContentDecoder::spCVideoFrame spFrame = spDecoder->Frame();
+		while( spFrame.IsNull() )
+		{
+			if( Base::CLatencyStats::Now() - start > 10000000 )
+				break;
+
+			boost::this_thread::sleep( boost::posix_time::microseconds( 100 ) );
+			spFrame = spDecoder->Frame();
+		}
+
+		if( spFrame.IsNull() )
+		{
+			printf( "decoder stalled for 10 seconds after %u frames\n", i );
+			numFrames = i;
+			break;
+		}
+
+		uint64 wait = Base::CLatencyStats::Now() - start;
+		frameLatency.Record( (uint32)wait );
+		if( fps > 0.0 && wait > 1e6 / fps )
+			lateFrames++;
+
+		ContentDecoder::sMetaData metaData;
+		spFrame->GetMetaData( metaData );
+		if( !metaData.m_SecondFrame.IsNull() )
+			transitionFrames++;
+	}
+
+	fp8 elapsed = timer.Time();
+	if( numFrames == 0 )
+		numFrames = 1;
+	uint32 heapAllocations = g_HeapAllocations - heapAllocationsStart;
+	uint64 poolAllocations = framePool.Allocations() - poolAllocationsStart;
+
+	uint64 rss, peakRss;
+	MemoryUsage( rss, peakRss );
+
+	spDecoder->Close();
+
+	printf( "\n%u frames in %.2f s: %.1f fps, %u decoder threads\n", numFrames, elapsed, numFrames / elapsed, spDecoder->DecoderThreads() );
+	printf( "transition frames: %u\n", transitionFrames );
+	if( fps > 0.0 )
+		printf( "frames later than 1/%.1f s: %u\n", fps, lateFrames );
+	printf( "frame wait p50/p95/p99: %.2f/%.2f/%.2f ms\n", frameLatency.Percentile( 50 ) / 1000.0, frameLatency.Percentile( 95 ) / 1000.0, frameLatency.Percentile( 99 ) / 1000.0 );
+	printf( "heap allocations: %.2f per frame, frame pool allocations: %.2f per frame\n", heapAllocations / (fp8)numFrames, poolAllocations / (fp8)numFrames );
+	printf( "rss: %llu kB, peak %llu kB\n", (unsigned long long)rss, (unsigned long long)peakRss );
+
+	Base::CLatencyStats &latency = Base::g_LatencyStats();
+	printf( "\nstage p50/p95/p99:\n" );
+	for( uint32 i=0; i<Base::eLatencyNumStages; i++ )
+		printf( "  %-12s %s\n", Base::CLatencyStats::StageName( (Base::eLatencyStage)i ), latency.Report( (Base::eLatencyStage)i ).c_str() );
+
+	spDecoder = NULL;
+	spPlaylist = NULL;
+
+	g_Log->Shutdown();
+
+	return 0;
+}
@@ -96,14 +96,16 @@ class	CElectricSheep
 		uint32 m_curPlayingID;
 		uint32 m_curPlayingGen;
 		uint64 m_lastPlayedSeconds;
+
+		//	Player counters at the last hud stats refresh, to report the upload cost per decoded frame.
+		uint64 m_LastUploadBytes;
+		uint64 m_LastFramesDecoded;
 		
-#ifdef DO_THREAD_UPDATE
-		boost::barrier* m_pUpdateBarrier;
-		
-		boost::thread_group *m_pUpdateThreads;
+		//	One thread per frame display the main loop doesn't draw, see CreateRenderThreads().
+		boost::thread_group *m_pRenderThreads;
 		
-		boost::mutex m_BarrierMutex;
-#endif
+		//	Held by the main loop while it draws, and to start or stop the render threads, so displays never change hands mid frame.
+		boost::mutex m_RenderThreadsMutex;
 		
 
 		//	Init tuplestorage.
@@ -158,10 +160,7 @@ class	CElectricSheep
 				m_AppData = std::string(getenv("HOME"))+"/.electricsheep/";
 				m_WorkingDir = SHAREDIR;
 #endif			
-#ifdef DO_THREAD_UPDATE
-				m_pUpdateBarrier = NULL;
-				m_pUpdateThreads = NULL;
-#endif
+				m_pRenderThreads = NULL;
 			}
 
 			virtual ~CElectricSheep()
@@ -202,14 +201,12 @@ class	CElectricSheep
                 //	Init the display and create decoder.
                 if( !g_Player().Startup() )
                     return false;
-					
-#ifdef DO_THREAD_UPDATE
-				CreateUpdateThreads();
-#endif
 
 				m_curPlayingID = 0;
 				m_curPlayingGen = 0;
 				m_lastPlayedSeconds = 0;
+				m_LastUploadBytes = 0;
+				m_LastFramesDecoded = 0;
 
                 //	Set framerate.
                 m_PlayerFps = g_Settings()->Get( "settings.player.player_fps", 20. );
@@ -253,6 +250,8 @@ class	CElectricSheep
                 m_HudManager->Add( "displaystats", new Hud::CStatsConsole( Base::Math::CRect( 1, 1 ), hudFontName, hudFontSize ) );
                 Hud::spCStatsConsole spStats = (Hud::spCStatsConsole)m_HudManager->Get( "displaystats" );
                 spStats->Add( new Hud::CStringStat( "decodefps", "Decoding video at ", "? fps" ) );
+				spStats->Add( new Hud::CStringStat( "decodeheadroom", "Decoder headroom: ", "measuring..." ) );
+				spStats->Add( new Hud::CStringStat( "decodequality", "Decode quality: ", "full quality" ) );
 				
 
                 int32 displayMode = g_Settings()->Get( "settings.player.DisplayMode", 0 );
@@ -269,6 +268,10 @@ class	CElectricSheep
 					g_Player().Renderer()->Description() +
 					" display at ", " fps", 1.0 ) );
 
+				spStats->Add( new Hud::CStringStat( "framepool", "Frame pool: ", "..." ) );
+				spStats->Add( new Hud::CStringStat( "renderstats", "Per frame: ", "..." ) );
+				spStats->Add( new Hud::CStringStat( "upload", "Texture upload: ", "..." ) );
+				spStats->Add( new Hud::CLatencyStat( "latency", "Latency p50/p95/p99:" ) );
 				spStats->Add( new Hud::CStringStat( "currentid", "Currently playing sheep: ", "n/a" ) );
                 spStats->Add( new Hud::CStringStat( "uptime", "\nClient uptime: ", "...." ) );
 
@@ -280,6 +283,7 @@ class	CElectricSheep
                 spStats->Add( new Hud::CStringStat( "server", "Server is ", "not known yet" ) );
                 spStats->Add( new Hud::CStringStat( "transfers", "", "" ) );
 				spStats->Add( new Hud::CStringStat( "deleted", "", "" ) );
+				spStats->Add( new Hud::CStringStat( "evicted", "Evicted: ", "" ) );
 				spStats->Add( new Hud::CStringStat( "bsurvivors", "", "" ) );
 				if (m_MultipleInstancesMode == true)
 					spStats->Add( new Hud::CTimeCountDownStat( "svstat", "", "Downloading disabled, read-only mode" ) );
@@ -392,6 +396,14 @@ class	CElectricSheep
                 g_Player().Start();
 				m_F1F4Timer.Reset();
 				m_LastCPUCheckTime = m_Timer.Time();
+				m_LastUploadBytes = g_Player().UploadBytes();
+				m_LastFramesDecoded = g_Player().FramesDecoded();
+
+				//	Only now, the render threads start drawing right away.
+				{
+					boost::mutex::scoped_lock lock( m_RenderThreadsMutex );
+					CreateRenderThreads();
+				}
 				return true;
 			}
 
@@ -400,9 +412,10 @@ class	CElectricSheep
 			{
 				printf( "CElectricSheep::Shutdown()\n" );
 
-#ifdef DO_THREAD_UPDATE
-				DestroyUpdateThreads();
-#endif
+				{
+					boost::mutex::scoped_lock lock( m_RenderThreadsMutex );
+					DestroyRenderThreads();
+				}
 
 				m_spSplashPos = NULL;
 				m_spSplashNeg = NULL;
@@ -416,6 +429,9 @@ class	CElectricSheep
 				if( !m_bConfigMode )
 				{	
 					g_ContentDownloader().Shutdown();
+
+					//	Nothing queues transcodes anymore, a half written stream is thrown away.
+					ContentDecoder::g_DXTTranscoder().Shutdown();
 					
 					//	This stuff was never started in config mode.
 					if (m_MultipleInstancesMode == false)
@@ -425,6 +441,12 @@ class	CElectricSheep
 						g_NetworkManager->Shutdown();						
 					}
 					g_Player().Shutdown();
+					ContentDecoder::g_ProbeCache().Shutdown();
+
+					std::string latencyFile = g_Settings()->Root() + "latency.txt";
+					if( !Base::g_LatencyStats().Dump( latencyFile ) )
+						g_Log->Warning( "Failed to write %s", latencyFile.c_str() );
+
 					g_Settings()->Shutdown();
 				}
 			}
@@ -494,20 +516,333 @@ class	CElectricSheep
 											
 				return ss.str();
 			}
-			
-#ifdef DO_THREAD_UPDATE
-			//
-			virtual void CreateUpdateThreads()
+
+			/*
+				UpdateHudStats().
+				Refreshes what the stats consoles show. Called on the hud tick, not every frame.
+			*/
+			void UpdateHudStats( const std::string &batteryStatus )
 			{
-				int displayCnt = g_Player().GetDisplayCount();
-									
-				m_pUpdateBarrier = new boost::barrier( displayCnt + 1 );
+				Hud::spCStatsConsole spStats = (Hud::spCStatsConsole)m_HudManager->Get( "displaystats" );
+				std::stringstream decodefpsstr;
+				decodefpsstr.precision(2);
+				decodefpsstr << std::fixed << m_CurrentFps << " fps";
+				((Hud::CStringStat *)spStats->Get( "decodefps" ))->SetSample( decodefpsstr.str() );
+
+				ContentDecoder::spCContentDecoder spDecoder = g_Player().Decoder();
+				if( !spDecoder.IsNull() && spDecoder->DecodeFps() > 0.0 )
+				{
+					fp8 maxDecodeFps = spDecoder->DecodeFps();
+					std::stringstream headroomstr;
+					headroomstr.precision(1);
+					headroomstr << std::fixed << maxDecodeFps / m_CurrentFps << "x (" << maxDecodeFps << " fps max, " << spDecoder->DecoderThreads() << " threads)";
+					((Hud::CStringStat *)spStats->Get( "decodeheadroom" ))->SetSample( headroomstr.str() );
+				}
+				if( !spDecoder.IsNull() )
+				{
+					uint32 degradeLevel = spDecoder->DegradeLevel();
+					std::stringstream qualitystr;
+					if( degradeLevel == ContentDecoder::eDegradeNone )
+						qualitystr << ContentDecoder::CDecodeDegrader::LevelName( degradeLevel );
+					else
+						qualitystr << "level " << degradeLevel << ", " << ContentDecoder::CDecodeDegrader::LevelName( degradeLevel );
+					((Hud::CStringStat *)spStats->Get( "decodequality" ))->SetSample( qualitystr.str() );
+				}
+
+				ContentDecoder::CVideoFramePool &framePool = ContentDecoder::g_VideoFramePool();
+				std::stringstream framepoolstr;
+				framepoolstr << framePool.Allocations() << " allocated (" << (framePool.BytesAllocated() >> 20) << " MB), " << framePool.Reuses() << " recycled";
+				((Hud::CStringStat *)spStats->Get( "framepool" ))->SetSample( framepoolstr.str() );
+
+				//	Only the gl renderer counts.
+				if( g_Player().Renderer()->Type() == DisplayOutput::eGL )
+				{
+					const DisplayOutput::sRenderStats renderStats = g_Player().Renderer()->FrameStats();
+					std::stringstream renderstr;
+					renderstr << renderStats.m_GLCalls << " GL calls, " << renderStats.m_DrawCalls << " draws (" << renderStats.m_Vertices << " vertices), "
+							<< renderStats.m_StateChanges << " state changes, " << renderStats.m_StateElided << " elided";
+					((Hud::CStringStat *)spStats->Get( "renderstats" ))->SetSample( renderstr.str() );
+				}
+
+				//	Summed over all displays, so with shared contexts it stays at one frame's worth however many there are.
+				const uint64 uploadBytes = g_Player().UploadBytes();
+				const uint64 framesDecoded = g_Player().FramesDecoded();
+				if( framesDecoded > m_LastFramesDecoded )
+				{
+					std::stringstream uploadstr;
+					uploadstr << ((uploadBytes - m_LastUploadBytes) / (framesDecoded - m_LastFramesDecoded)) / 1024 << " KB per decoded frame, "
+							<< g_Player().GetDisplayCount() << " display(s)";
+					((Hud::CStringStat *)spStats->Get( "upload" ))->SetSample( uploadstr.str() );
+				}
+				m_LastUploadBytes = uploadBytes;
+				m_LastFramesDecoded = framesDecoded;
+
+				uint32 playingID = g_Player().GetCurrentPlayingSheepID();
+				uint32 playingGen = g_Player().GetCurrentPlayingSheepGeneration();
+				uint16 playCnt = g_PlayCounter().PlayCount( playingGen, playingID ) - 1;
+				
+				char strCurID[256];
+				if (m_curPlayingID != playingID || m_curPlayingGen != playingGen)
+				{
+					if (playCnt > 0)
+					{
+						time_t lastatime = g_Player().GetCurrentPlayingatime();
+						time_t currenttime = time(NULL);
+						m_lastPlayedSeconds = (uint64)floor(difftime(currenttime, lastatime));
+					}
+					else
+						m_lastPlayedSeconds = 0;
+					
+					m_curPlayingID = playingID;
+					m_curPlayingGen = playingGen;
+				}
+				
+				char playCntStr[128];
+										
+				if (playCnt > 0)
+					sprintf(playCntStr, "Played: %hu time%s %s\nLast time: %s ago", 
+						playCnt, 
+						(playCnt == 1) ? "" : "s",
+						( g_PlayCounter().ReadOnlyPlayCounts() ) ? " (not updated, read-only instance)" : "",
+						FormatTimeDiff(m_lastPlayedSeconds, false).c_str()
+						);
+				else
+					strcpy(playCntStr, "Playing for the first time");
+				
+				snprintf( strCurID, 256, "#%d.%05d (%s)\n%s\n",
+					g_Player().GetCurrentPlayingGeneration(),
+					playingID,
+					g_Player().IsCurrentPlayingEdge() ? "edge" : "loop",
+					playCntStr
+					);
+				if (playingID != 0)
+					((Hud::CStringStat *)spStats->Get( "currentid" ))->SetSample( strCurID );
+
+				//	Prettify uptime.
+				uint64	uptime = (uint64)m_Timer.Time();
+
+				char strHP[128];
+				snprintf( strHP, 127, "%s", FormatTimeDiff(uptime, true).c_str() );
+				((Hud::CStringStat *)spStats->Get( "uptime" ))->SetSample( strHP );
+
+				//	Serverstats.
+				spStats = (Hud::spCStatsConsole)m_HudManager->Get( "serverstats" );
+				
+				std::stringstream tmpstr;
+				uint64 flockcount = 0;
+				uint64 flockmbs = 0;
+				uint64 flockcountfree = ContentDownloader::Shepherd::getClientFlockCount(0);
+				uint64 flockcountgold = ContentDownloader::Shepherd::getClientFlockCount(1);
+				uint64 flockmbsfree = ContentDownloader::Shepherd::getClientFlockMBs(0);
+				uint64 flockmbsgold = ContentDownloader::Shepherd::getClientFlockMBs(1);
+				switch ( g_Player().UsedSheepType() )
+				{
+				case 0: // only gold, if any
+					{
+						flockcount = flockcountgold;
+						flockmbs = flockmbsgold;
+						if (g_Player().HasGoldSheep() == false)
+						{
+							flockcount += flockcountfree;
+							flockmbs += flockmbsfree;
+						}
+					}
+					break;
+				case 1: // free sheep only
+						flockcount = flockcountfree;
+						flockmbs = flockmbsfree;
+					break;
+				case 2: // all sheep
+						flockcount = flockcountfree + flockcountgold;
+						flockmbs = flockmbsfree + flockmbsgold;
+					break;
+				};
+				tmpstr << flockcount << ((g_Player().UsedSheepType() == 0 && g_Player().HasGoldSheep() == true) ? " gold sheep, " : " sheep, ") << flockmbs << "MB";
+				((Hud::CStringStat *)spStats->Get( "all" ))->SetSample(tmpstr.str());
+
+				const char *servername = ContentDownloader::Shepherd::serverName( false );
+				if ( servername != NULL && servername[0] )
+				{
+					((Hud::CStringStat *)spStats->Get( "server" ))->SetSample( servername );
+					((Hud::CStringStat *)spStats->Get( "server" ))->Visible( true );
+				}
+				else
+					((Hud::CStringStat *)spStats->Get( "server" ))->Visible( false );
 				
-				m_pUpdateThreads = new boost::thread_group;
+
+				Hud::CStringStat	*pTmp = (Hud::CStringStat *)spStats->Get( "transfers" );
+				if( pTmp )
+				{
+					std::string serverStatus = g_NetworkManager->Status();
+					if( serverStatus == "" )
+						pTmp->Visible( false );
+					else
+					{
+						pTmp->SetSample( serverStatus );
+						pTmp->Visible( true );
+					}
+				}
 				
-				for (int i = 0; i < displayCnt; i++)
+				pTmp = (Hud::CStringStat *)spStats->Get( "loginstatus" );
+				if( pTmp )
 				{
-					boost::thread* th = new boost::thread(&CElectricSheep::UpdateFrameThread, this, i);
+					bool visible = true;
+					
+					const char *role = ContentDownloader::Shepherd::role();
+					std::string loginstatus;
+					if (role != NULL)
+						loginstatus = role;
+					else
+						visible = false;
+						
+					if( loginstatus.empty() || loginstatus == "none" )
+					{
+						pTmp->SetSample( "Not logged in" );
+					}
+					else
+					{
+						std::stringstream loginstatusstr;
+						loginstatusstr << "Logged in as " << ContentDownloader::SheepGenerator::nickName() << " (" << loginstatus << ")";
+						pTmp->SetSample( loginstatusstr.str() );
+					}
+					
+					pTmp->Visible( visible );
+				}
+
+				pTmp = (Hud::CStringStat *)spStats->Get( "bsurvivors" );
+				if( pTmp )
+				{
+					std::stringstream survivors;
+
+					survivors << "Survivors: median cut=" << g_PlayCounter().GetMedianCutSurvivors();
+					
+					if (m_SeamlessPlayback)
+					survivors << ", dead end eliminator=" << g_PlayCounter().GetDeadEndCutSurvivors();
+
+					pTmp->SetSample( survivors.str() );
+					pTmp->Visible( true );
+				}
+				
+				pTmp = (Hud::CStringStat *)spStats->Get( "deleted" );
+				if( pTmp )
+				{
+					std::string deleted;
+					if (ContentDownloader::Shepherd::PopOverflowMessage( deleted ) && (deleted != ""))
+					{
+						pTmp->SetSample( deleted );
+						pTmp->Visible( true );
+					} else
+						pTmp->Visible( false );
+				}
+
+				pTmp = (Hud::CStringStat *)spStats->Get( "evicted" );
+				if( pTmp )
+				{
+					uint64 oldest = ContentDownloader::Shepherd::getEvictedCount( true );
+					uint64 mostplayed = ContentDownloader::Shepherd::getEvictedCount( false );
+
+					std::stringstream evicted;
+					evicted << oldest << " oldest, " << mostplayed << " most played, " << ContentDownloader::Shepherd::getEvictedMBs() << "MB";
+
+					pTmp->SetSample( evicted.str() );
+					pTmp->Visible( oldest + mostplayed > 0 );
+				}
+
+				pTmp = (Hud::CStringStat *)spStats->Get( "zconnerror" );
+				if( pTmp )
+				{
+					if (m_ConnectionErrors.size() > 0)
+					{
+						std::string allConnectionErrors;
+						for (size_t ii = 0; ii < m_ConnectionErrors.size(); ++ii)
+							allConnectionErrors += m_ConnectionErrors.at(ii) + "\n";
+						if (allConnectionErrors.size() > 0)
+							allConnectionErrors.erase(allConnectionErrors.size() - 1);
+						pTmp->SetSample( allConnectionErrors );
+						pTmp->Visible( true );
+					} else
+						pTmp->Visible( false );
+				}
+
+				Hud::CTimeCountDownStat *pTcd = (Hud::CTimeCountDownStat *)spStats->Get( "svstat" );
+				if( pTcd )
+				{
+					bool isnew = false;
+					
+					std::string dlState = ContentDownloader::Shepherd::downloadState( isnew );
+					
+					if ( isnew )
+					{
+						pTcd->SetSample( dlState );
+						pTcd->Visible( true );
+					}
+				}
+
+				//	Renderer stats.
+				spStats = (Hud::spCStatsConsole)m_HudManager->Get( "renderstats" );
+				((Hud::CIntCounter *)spStats->Get( "rendering" ))->SetSample( ContentDownloader::Shepherd::FramesRendering() );
+				((Hud::CIntCounter *)spStats->Get( "totalframes" ))->SetSample( ContentDownloader::Shepherd::TotalFramesRendered() );
+				
+				Hud::CStringStat *batteryStat = ((Hud::CStringStat *)spStats->Get( "zbattery" ));
+				
+				if (batteryStat != NULL)
+					batteryStat->SetSample( batteryStatus );
+				
+				if (m_CpuUsageTotal != -1 && m_CpuUsageES != -1)
+				{
+					std::stringstream temp;
+					
+					temp << " ES " << m_CpuUsageES << "%, total " << m_CpuUsageTotal << "% ";
+
+					if ( ContentDownloader::Shepherd::RenderingAllowed() )
+						temp << "(new rendering allowed)";
+					else
+						temp << "(new rendering blocked)";
+
+					((Hud::CStringStat *)spStats->Get( "zzacpu" ))->SetSample( temp.str() );
+				}
+
+				pTcd = (Hud::CTimeCountDownStat *)spStats->Get( "countdown" );
+				if( pTcd )
+				{
+					bool isnew = false;
+					
+					std::string renderState = ContentDownloader::Shepherd::renderState( isnew );
+					
+					if ( isnew )
+					{
+						pTcd->SetSample( renderState );
+						pTcd->Visible( true );
+					}
+				}
+			}
+			
+			/*
+				CreateRenderThreads().
+				Every display is drawn by a thread of its own, paced by its own swaps, so a slow or differently refreshing monitor holds up no other.
+				The main loop keeps the displays drawn with the frame display of unit 0, those get the hud and the events.
+				Displays sharing a frame display draw from the same textures, one thread draws them all.
+				Call with m_RenderThreadsMutex held.
+			*/
+			virtual void CreateRenderThreads()
+			{
+				const uint32 displayCnt = g_Player().GetDisplayCount();
+				const uint32 mainOwner = g_Player().FrameOwner( 0 );
+				
+				for (uint32 i = 0; i < displayCnt; i++)
+				{
+					if ( i == mainOwner || g_Player().FrameOwner( i ) != i )
+						continue;
+
+					//	A context can only be current on one thread.
+					for (uint32 j = 0; j < displayCnt; j++)
+						if ( g_Player().FrameOwner( j ) == i )
+							g_Player().ReleaseDisplay( j );
+
+					if ( m_pRenderThreads == NULL )
+						m_pRenderThreads = new boost::thread_group;
+
+					boost::thread* th = new boost::thread(&CElectricSheep::RenderThread, this, i);
 #ifdef WIN32
 					SetThreadPriority( (HANDLE)th->native_handle(), THREAD_PRIORITY_HIGHEST );
 					SetThreadPriorityBoost( (HANDLE)th->native_handle(), FALSE );
@@ -516,73 +851,83 @@ class	CElectricSheep
 					sp.sched_priority = sched_get_priority_max(SCHED_RR); //HIGH_PRIORITY_CLASS - THREAD_PRIORITY_NORMAL
 					pthread_setschedparam( (pthread_t)th->native_handle(), SCHED_RR, &sp );
 #endif
-					m_pUpdateThreads->add_thread(th);
+					m_pRenderThreads->add_thread(th);
 				}
+
+				if ( m_pRenderThreads != NULL )
+					g_Log->Info( "%u displays, %u drawn by render threads", displayCnt, (uint32)m_pRenderThreads->size() );
 			}
 			
-			//
-			virtual void DestroyUpdateThreads()
+			//	Call with m_RenderThreadsMutex held.
+			virtual void DestroyRenderThreads()
 			{
-				if ( m_pUpdateThreads != NULL )
+				if ( m_pRenderThreads != NULL )
 				{
-					m_pUpdateThreads->interrupt_all();
-					m_pUpdateThreads->join_all();
+					m_pRenderThreads->interrupt_all();
+					m_pRenderThreads->join_all();
 					
-					SAFE_DELETE(m_pUpdateThreads);
+					SAFE_DELETE(m_pRenderThreads);
 				}
-
-				SAFE_DELETE(m_pUpdateBarrier);
 			}
-#endif
 
 			//
 			virtual bool Update()
 			{
-				g_Player().BeginFrameUpdate();
+				boost::mutex::scoped_lock lock( m_RenderThreadsMutex );
 
-#ifdef DO_THREAD_UPDATE
-				{
-					boost::mutex::scoped_lock lock( m_BarrierMutex );
-				
-					m_pUpdateBarrier->wait();
-				
-					m_pUpdateBarrier->wait();
-				}
-#else
+				const uint32 mainOwner = g_Player().FrameOwner( 0 );
 				uint32 displayCnt = g_Player().GetDisplayCount();
 									
                 bool ret = true;
 				for (uint32 i = 0; i < displayCnt; i++)
 				{
+					//	Drawn by a render thread.
+					if ( m_pRenderThreads != NULL && g_Player().FrameOwner( i ) != mainOwner )
+						continue;
+
 					ret &= DoRealFrameUpdate(i);
                     if ( !ret )
                         break;
 				}				
-#endif
 								
-				g_Player().EndFrameUpdate();
+				g_Player().EndFrameUpdate( mainOwner );
 
 				return ret;
 			}
 			
-#ifdef DO_THREAD_UPDATE
-			virtual void UpdateFrameThread(int32 displayUnit)
+			/*
+				RenderThread().
+				Draws the displays using the frame display of unit _owner until interrupted, or the player closes.
+			*/
+			virtual void RenderThread(uint32 _owner)
 			{
 				try {
 					while (true)
 					{
-						m_pUpdateBarrier->wait();
-						
-						DoRealFrameUpdate(displayUnit);
-						
-						m_pUpdateBarrier->wait();
+						boost::this_thread::interruption_point();
+
+						bool ret = true;
+						uint32 displayCnt = g_Player().GetDisplayCount();
+						for (uint32 i = 0; i < displayCnt && ret; i++)
+							if ( g_Player().FrameOwner( i ) == _owner )
+								ret = DoRealFrameUpdate(i);
+
+						if ( !ret )
+							break;
+
+						g_Player().EndFrameUpdate( _owner );
 					}
 				}
 				catch(boost::thread_interrupted const&)
 				{
 				}
+
+				//	Hand the contexts back, whoever draws these next takes them.
+				uint32 displayCnt = g_Player().GetDisplayCount();
+				for (uint32 i = 0; i < displayCnt; i++)
+					if ( g_Player().FrameOwner( i ) == _owner )
+						g_Player().ReleaseDisplay( i );
 			}
-#endif
 			
 			virtual bool DoRealFrameUpdate(uint32 displayUnit)
 			{
@@ -594,7 +939,7 @@ class	CElectricSheep
 					if( g_Player().Closed() )
 					{
 						g_Log->Info( "Player closed..." );
-						g_Player().Renderer()->EndFrame();
+						g_Player().EndDisplayFrame( displayUnit );
 						return false;
 					}
 
@@ -740,239 +1085,12 @@ class	CElectricSheep
 						else
 							ContentDownloader::Shepherd::SetRenderingAllowed(true);
 
-						//	Update some stats.
+						//	Stats are refreshed on the hud tick, the display fps is the only one that counts frames.
 						Hud::spCStatsConsole spStats = (Hud::spCStatsConsole)m_HudManager->Get( "displaystats" );
-						std::stringstream decodefpsstr;
-						decodefpsstr.precision(2);
-						decodefpsstr << std::fixed << m_CurrentFps << " fps";
-						((Hud::CStringStat *)spStats->Get( "decodefps" ))->SetSample( decodefpsstr.str() );
 						((Hud::CIntCounter *)spStats->Get( "displayfps" ))->AddSample( 1 );
 
-						uint32 playingID = g_Player().GetCurrentPlayingSheepID();
-						uint32 playingGen = g_Player().GetCurrentPlayingSheepGeneration();
-						uint16 playCnt = g_PlayCounter().PlayCount( playingGen, playingID ) - 1;
-						
-						char strCurID[256];
-						if (m_curPlayingID != playingID || m_curPlayingGen != playingGen)
-						{
-							if (playCnt > 0)
-							{
-								time_t lastatime = g_Player().GetCurrentPlayingatime();
-								time_t currenttime = time(NULL);
-								m_lastPlayedSeconds = (uint64)floor(difftime(currenttime, lastatime));
-							}
-							else
-								m_lastPlayedSeconds = 0;
-							
-							m_curPlayingID = playingID;
-							m_curPlayingGen = playingGen;
-						}
-						
-						char playCntStr[128];
-												
-						if (playCnt > 0)
-							sprintf(playCntStr, "Played: %hu time%s %s\nLast time: %s ago", 
-								playCnt, 
-								(playCnt == 1) ? "" : "s",
-								( g_PlayCounter().ReadOnlyPlayCounts() ) ? " (not updated, read-only instance)" : "",
-								FormatTimeDiff(m_lastPlayedSeconds, false).c_str()
-								);
-						else
-							strcpy(playCntStr, "Playing for the first time");
-						
-						snprintf( strCurID, 256, "#%d.%05d (%s)\n%s\n",
-							g_Player().GetCurrentPlayingGeneration(),
-							playingID,
-							g_Player().IsCurrentPlayingEdge() ? "edge" : "loop",
-							playCntStr
-							);
-						if (playingID != 0)
-							((Hud::CStringStat *)spStats->Get( "currentid" ))->SetSample( strCurID );
-
-						//	Prettify uptime.
-						uint64	uptime = (uint64)m_Timer.Time();
-
-						char strHP[128];
-						snprintf( strHP, 127, "%s", FormatTimeDiff(uptime, true).c_str() );
-						((Hud::CStringStat *)spStats->Get( "uptime" ))->SetSample( strHP );
-
-						//	Serverstats.
-						spStats = (Hud::spCStatsConsole)m_HudManager->Get( "serverstats" );
-						
-						std::stringstream tmpstr;
-						uint64 flockcount = 0;
-						uint64 flockmbs = 0;
-						uint64 flockcountfree = ContentDownloader::Shepherd::getClientFlockCount(0);
-						uint64 flockcountgold = ContentDownloader::Shepherd::getClientFlockCount(1);
-						uint64 flockmbsfree = ContentDownloader::Shepherd::getClientFlockMBs(0);
-						uint64 flockmbsgold = ContentDownloader::Shepherd::getClientFlockMBs(1);
-						switch ( g_Player().UsedSheepType() )
-						{
-						case 0: // only gold, if any
-							{
-								flockcount = flockcountgold;
-								flockmbs = flockmbsgold;
-								if (g_Player().HasGoldSheep() == false)
-								{
-									flockcount += flockcountfree;
-									flockmbs += flockmbsfree;
-								}
-							}
-							break;
-						case 1: // free sheep only
-								flockcount = flockcountfree;
-								flockmbs = flockmbsfree;
-							break;
-						case 2: // all sheep
-								flockcount = flockcountfree + flockcountgold;
-								flockmbs = flockmbsfree + flockmbsgold;
-							break;
-						};
-						tmpstr << flockcount << ((g_Player().UsedSheepType() == 0 && g_Player().HasGoldSheep() == true) ? " gold sheep, " : " sheep, ") << flockmbs << "MB";
-						((Hud::CStringStat *)spStats->Get( "all" ))->SetSample(tmpstr.str());
-
-						const char *servername = ContentDownloader::Shepherd::serverName( false );
-						if ( servername != NULL && servername[0] )
-						{
-							((Hud::CStringStat *)spStats->Get( "server" ))->SetSample( servername );
-							((Hud::CStringStat *)spStats->Get( "server" ))->Visible( true );
-						}
-						else
-							((Hud::CStringStat *)spStats->Get( "server" ))->Visible( false );
-						
-
-						Hud::CStringStat	*pTmp = (Hud::CStringStat *)spStats->Get( "transfers" );
-						if( pTmp )
-						{
-							std::string serverStatus = g_NetworkManager->Status();
-							if( serverStatus == "" )
-								pTmp->Visible( false );
-							else
-							{
-								pTmp->SetSample( serverStatus );
-								pTmp->Visible( true );
-							}
-						}
-						
-						pTmp = (Hud::CStringStat *)spStats->Get( "loginstatus" );
-						if( pTmp )
-						{
-							bool visible = true;
-							
-							const char *role = ContentDownloader::Shepherd::role();
-							std::string loginstatus;
-							if (role != NULL)
-								loginstatus = role;
-							else
-								visible = false;
-								
-							if( loginstatus.empty() || loginstatus == "none" )
-							{
-								pTmp->SetSample( "Not logged in" );
-							}
-							else
-							{
-								std::stringstream loginstatusstr;
-								loginstatusstr << "Logged in as " << ContentDownloader::SheepGenerator::nickName() << " (" << loginstatus << ")";
-								pTmp->SetSample( loginstatusstr.str() );
-							}
-							
-							pTmp->Visible( visible );
-						}
-
-						pTmp = (Hud::CStringStat *)spStats->Get( "bsurvivors" );
-						if( pTmp )
-						{
-							std::stringstream survivors;
-
-							survivors << "Survivors: median cut=" << g_PlayCounter().GetMedianCutSurvivors();
-							
-							if (m_SeamlessPlayback)
-							survivors << ", dead end eliminator=" << g_PlayCounter().GetDeadEndCutSurvivors();
-
-							pTmp->SetSample( survivors.str() );
-							pTmp->Visible( true );
-						}
-						
-						pTmp = (Hud::CStringStat *)spStats->Get( "deleted" );
-						if( pTmp )
-						{
-							std::string deleted;
-							if (ContentDownloader::Shepherd::PopOverflowMessage( deleted ) && (deleted != ""))
-							{
-								pTmp->SetSample( deleted );
-								pTmp->Visible( true );
-							} else
-								pTmp->Visible( false );
-						}
-
-						pTmp = (Hud::CStringStat *)spStats->Get( "zconnerror" );
-						if( pTmp )
-						{
-							if (m_ConnectionErrors.size() > 0)
-							{
-								std::string allConnectionErrors;
-								for (size_t ii = 0; ii < m_ConnectionErrors.size(); ++ii)
-									allConnectionErrors += m_ConnectionErrors.at(ii) + "\n";
-								if (allConnectionErrors.size() > 0)
-									allConnectionErrors.erase(allConnectionErrors.size() - 1);
-								pTmp->SetSample( allConnectionErrors );
-								pTmp->Visible( true );
-							} else
-								pTmp->Visible( false );
-						}
-
-						Hud::CTimeCountDownStat *pTcd = (Hud::CTimeCountDownStat *)spStats->Get( "svstat" );
-						if( pTcd )
-						{
-							bool isnew = false;
-							
-							std::string dlState = ContentDownloader::Shepherd::downloadState( isnew );
-							
-							if ( isnew )
-							{
-								pTcd->SetSample( dlState );
-								pTcd->Visible( true );
-							}
-						}
-
-						//	Renderer stats.
-						spStats = (Hud::spCStatsConsole)m_HudManager->Get( "renderstats" );
-						((Hud::CIntCounter *)spStats->Get( "rendering" ))->SetSample( ContentDownloader::Shepherd::FramesRendering() );
-						((Hud::CIntCounter *)spStats->Get( "totalframes" ))->SetSample( ContentDownloader::Shepherd::TotalFramesRendered() );
-						
-						Hud::CStringStat *batteryStat = ((Hud::CStringStat *)spStats->Get( "zbattery" ));
-						
-						if (batteryStat != NULL)
-							batteryStat->SetSample( batteryStatus );
-						
-						if (m_CpuUsageTotal != -1 && m_CpuUsageES != -1)
-						{
-							std::stringstream temp;
-							
-							temp << " ES " << m_CpuUsageES << "%, total " << m_CpuUsageTotal << "% ";
-
-							if ( ContentDownloader::Shepherd::RenderingAllowed() )
-								temp << "(new rendering allowed)";
-							else
-								temp << "(new rendering blocked)";
-
-							((Hud::CStringStat *)spStats->Get( "zzacpu" ))->SetSample( temp.str() );
-						}
-
-						pTcd = (Hud::CTimeCountDownStat *)spStats->Get( "countdown" );
-						if( pTcd )
-						{
-							bool isnew = false;
-							
-							std::string renderState = ContentDownloader::Shepherd::renderState( isnew );
-							
-							if ( isnew )
-							{
-								pTcd->SetSample( renderState );
-								pTcd->Visible( true );
-							}
-						}
+						if( m_HudManager->Tick() )
+							UpdateHudStats( batteryStatus );
 
 						//	Finally render hud.
 						m_HudManager->Render( g_Player().Renderer() );
@@ -145,17 +145,13 @@ class	CElectricSheep_Mac : public CElectricSheep
 				}
 				else
 				{
-#ifdef DO_THREAD_UPDATE
-					boost::mutex::scoped_lock lock( m_BarrierMutex );
+					boost::mutex::scoped_lock lock( m_RenderThreadsMutex );
 					
-					DestroyUpdateThreads();
-#endif
+					DestroyRenderThreads();
 
 					g_Player().AddDisplay( _glContext );
 										
-#ifdef DO_THREAD_UPDATE
-					CreateUpdateThreads();
-#endif
+					CreateRenderThreads();
 				}
 			}
 		
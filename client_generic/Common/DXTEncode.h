@@ -0,0 +1,170 @@
+#ifndef	_DXTENCODE_H_
+#define	_DXTENCODE_H_
+
+#include	"base.h"
+
+namespace	Base
+{
+
+/*
+	CDXTEncode.
+	BC1 (DXT1) compressor for opaque pictures: 4x4 pixel blocks become two RGB565 endpoints and 2 bit indices, 8 bytes per block.
+	Endpoints are the inset corners of the block's colour bounding box, on the diagonal that follows how the channels correlate.
+	Not the best quality there is, but fast enough to transcode a sheep at idle priority in about its play time.
+*/
+class	CDXTEncode
+{
+	static inline uint16	To565( const int32 _r, const int32 _g, const int32 _b )
+	{
+		return (uint16)( ( ( _r >> 3 ) << 11 ) | ( ( _g >> 2 ) << 5 ) | ( _b >> 3 ) );
+	}
+
+	static inline void	From565( const uint16 _c, int32 *_pRGB )
+	{
+		int32 r = ( _c >> 11 ) & 31, g = ( _c >> 5 ) & 63, b = _c & 31;
+		_pRGB[0] = ( r << 3 ) | ( r >> 2 );
+		_pRGB[1] = ( g << 2 ) | ( g >> 4 );
+		_pRGB[2] = ( b << 3 ) | ( b >> 2 );
+	}
+
+	//	_pBlock is 16 RGBA pixels, row by row.
+	static void	EncodeBlock( const uint8 *_pBlock, uint8 *_pDst )
+	{
+		int32 mn[3] = { 255, 255, 255 }, mx[3] = { 0, 0, 0 }, sum[3] = { 0, 0, 0 };
+
+		for( uint32 i=0; i<16; i++ )
+			for( uint32 c=0; c<3; c++ )
+			{
+				int32 v = _pBlock[ i*4 + c ];
+				if( v < mn[c] )	mn[c] = v;
+				if( v > mx[c] )	mx[c] = v;
+				sum[c] += v;
+			}
+
+		//	Flip green and blue on the box diagonal if they run against red (or against each other when red is flat).
+		int32 cov[2] = { 0, 0 };
+		for( uint32 i=0; i<16; i++ )
+		{
+			int32 r = _pBlock[ i*4 ] * 16 - sum[0];
+			int32 g = _pBlock[ i*4 + 1 ] * 16 - sum[1];
+			int32 b = _pBlock[ i*4 + 2 ] * 16 - sum[2];
+			cov[0] += ( mx[0] != mn[0] ) ? r * g : 0;
+			cov[1] += ( mx[0] != mn[0] ) ? r * b : g * b;
+		}
+
+		if( cov[0] < 0 )	{	int32 t = mn[1]; mn[1] = mx[1]; mx[1] = t;	}
+		if( cov[1] < 0 )	{	int32 t = mn[2]; mn[2] = mx[2]; mx[2] = t;	}
+
+		//	Pull the ends in by 1/16 of the range, the extremes are rarely worth an exact endpoint.
+		int32 e0[3], e1[3];
+		for( uint32 c=0; c<3; c++ )
+		{
+			int32 inset = ( mx[c] - mn[c] ) / 16;
+			e0[c] = mx[c] - inset;
+			e1[c] = mn[c] + inset;
+		}
+
+		uint16 c0 = To565( e0[0], e0[1], e0[2] );
+		uint16 c1 = To565( e1[0], e1[1], e1[2] );
+		uint32 indices = 0;
+
+		if( c0 != c1 )
+		{
+			//	c0 > c1 selects the four colour mode.
+			if( c0 < c1 )
+			{
+				uint16 t = c0; c0 = c1; c1 = t;
+			}
+
+			int32 palette[4][3];
+			From565( c0, palette[0] );
+			From565( c1, palette[1] );
+			for( uint32 c=0; c<3; c++ )
+			{
+				palette[2][c] = ( 2 * palette[0][c] + palette[1][c] ) / 3;
+				palette[3][c] = ( palette[0][c] + 2 * palette[1][c] ) / 3;
+			}
+
+			for( uint32 i=0; i<16; i++ )
+			{
+				uint32 best = 0;
+				int32 bestDist = 0x7fffffff;
+				for( uint32 p=0; p<4; p++ )
+				{
+					int32 dr = _pBlock[ i*4 ] - palette[p][0];
+					int32 dg = _pBlock[ i*4 + 1 ] - palette[p][1];
+					int32 db = _pBlock[ i*4 + 2 ] - palette[p][2];
+					int32 dist = dr*dr + dg*dg + db*db;
+					if( dist < bestDist )
+					{
+						bestDist = dist;
+						best = p;
+					}
+				}
+
+				indices |= best << ( i * 2 );
+			}
+		}
+
+		_pDst[0] = (uint8)( c0 & 0xff );
+		_pDst[1] = (uint8)( c0 >> 8 );
+		_pDst[2] = (uint8)( c1 & 0xff );
+		_pDst[3] = (uint8)( c1 >> 8 );
+		_pDst[4] = (uint8)( indices & 0xff );
+		_pDst[5] = (uint8)( ( indices >> 8 ) & 0xff );
+		_pDst[6] = (uint8)( ( indices >> 16 ) & 0xff );
+		_pDst[7] = (uint8)( indices >> 24 );
+	}
+
+	public:
+			static uint32	BlocksWide( const uint32 _width )	{	return ( _width + 3 ) / 4;	}
+			static uint32	BlocksHigh( const uint32 _height )	{	return ( _height + 3 ) / 4;	}
+
+			//	Bytes of a compressed _width x _height picture.
+			static uint32	Size( const uint32 _width, const uint32 _height )
+			{
+				return BlocksWide( _width ) * BlocksHigh( _height ) * 8;
+			}
+
+			/*
+				EncodeBC1().
+				Compresses a _width x _height RGBA picture into Size() bytes at _pDst, block rows top to bottom.
+				Partial blocks at the right and bottom edges repeat the last column and row.
+			*/
+			static void	EncodeBC1( const uint8 *_pRGBA, const uint32 _pitch, const uint32 _width, const uint32 _height, uint8 *_pDst )
+			{
+				uint8 block[ 16 * 4 ];
+
+				for( uint32 by=0; by<BlocksHigh( _height ); by++ )
+					for( uint32 bx=0; bx<BlocksWide( _width ); bx++ )
+					{
+						for( uint32 y=0; y<4; y++ )
+						{
+							uint32 sy = by*4 + y;
+							if( sy >= _height )
+								sy = _height - 1;
+
+							for( uint32 x=0; x<4; x++ )
+							{
+								uint32 sx = bx*4 + x;
+								if( sx >= _width )
+									sx = _width - 1;
+
+								const uint8 *pSrc = _pRGBA + sy * _pitch + sx * 4;
+								uint8 *pBlock = block + ( y*4 + x ) * 4;
+								pBlock[0] = pSrc[0];
+								pBlock[1] = pSrc[1];
+								pBlock[2] = pSrc[2];
+								pBlock[3] = 255;
+							}
+						}
+
+						EncodeBlock( block, _pDst );
+						_pDst += 8;
+					}
+			}
+};
+
+};
+
+#endif
@@ -0,0 +1,260 @@
+#ifndef	_FRAMEBLEND_H_
+#define	_FRAMEBLEND_H_
+
+#include	<math.h>
+#include	<stdlib.h>
+#include	"base.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+	#define	FRAMEBLEND_SSE2
+	#include	<emmintrin.h>
+#endif
+
+//	AVX2 code is compiled per function and only run when the cpu has it, the rest of the build stays plain SSE2.
+#if defined(FRAMEBLEND_SSE2) && ( ( defined(__GNUC__) && ( __GNUC__ > 4 || ( __GNUC__ == 4 && __GNUC_MINOR__ >= 9 ) ) ) || defined(__clang__) )
+	#define	FRAMEBLEND_AVX2
+	#define	FRAMEBLEND_AVX2_TARGET	__attribute__(( target( "avx2" ) ))
+	#include	<immintrin.h>
+#elif defined(FRAMEBLEND_SSE2) && defined(_MSC_VER) && _MSC_VER >= 1700
+	#define	FRAMEBLEND_AVX2
+	#define	FRAMEBLEND_AVX2_TARGET
+	#include	<immintrin.h>
+	#include	<intrin.h>
+#endif
+
+namespace	Base
+{
+
+/*
+	CFrameBlend.
+	Weighted sum of up to kMaxSources 8 bit pictures, byte by byte, with the result clamped to 0..255.
+	This is the cpu version of the interpolation shaders: weights are 2.14 fixed point, sources are taken in pairs and summed with pmaddwd.
+*/
+class	CFrameBlend
+{
+	public:
+			enum	{	kMaxSources = 8, kWeightBits = 14	};
+
+			enum	eKernel
+			{
+				eScalar = 0,
+				eSSE2,
+				eAVX2
+			};
+
+	private:
+			static inline uint8	Saturate( const int32 _v )
+			{
+				return (uint8)( _v < 0 ? 0 : ( _v > 255 ? 255 : _v ) );
+			}
+
+			//	Fixed point weights padded to an even count, the sum is kept exact so equal sources pass through unchanged.
+			static uint32	Quantize( const uint8 *const *_ppSrc, const fp4 *_pWeights, const uint32 _numSources, const uint8 **_ppOut, int16 *_pOut )
+			{
+				const fp4 one = (fp4)( 1 << kWeightBits );
+				fp4 sum = 0.f;
+				int32 qsum = 0;
+				uint32 largest = 0;
+
+				for( uint32 i=0; i<_numSources; i++ )
+				{
+					fp4 w = _pWeights[i] * one;
+					if( w > 32767.f )	w = 32767.f;
+					if( w < -32767.f )	w = -32767.f;
+
+					_ppOut[i] = _ppSrc[i];
+					_pOut[i] = (int16)floorf( w + 0.5f );
+					sum += w;
+					qsum += _pOut[i];
+
+					if( abs( _pOut[i] ) > abs( _pOut[ largest ] ) )
+						largest = i;
+				}
+
+				int32 fixedSum = (int32)floorf( sum + 0.5f );
+				int32 corrected = _pOut[ largest ] + fixedSum - qsum;
+				if( corrected >= -32767 && corrected <= 32767 )
+					_pOut[ largest ] = (int16)corrected;
+
+				uint32 num = _numSources;
+				if( num & 1 )
+				{
+					_ppOut[ num ] = _ppSrc[0];
+					_pOut[ num ] = 0;
+					num++;
+				}
+
+				return num;
+			}
+
+			static void	BlendScalar( uint8 *_pDst, const uint8 *const *_ppSrc, const int16 *_pWeights, const uint32 _numSources, const uint32 _start, const uint32 _end )
+			{
+				for( uint32 b=_start; b<_end; b++ )
+				{
+					int32 acc = 1 << ( kWeightBits - 1 );
+					for( uint32 i=0; i<_numSources; i++ )
+						acc += (int32)_pWeights[i] * _ppSrc[i][b];
+
+					_pDst[b] = Saturate( acc >> kWeightBits );
+				}
+			}
+
+#ifdef FRAMEBLEND_SSE2
+			static uint32	BlendSSE2( uint8 *_pDst, const uint8 *const *_ppSrc, const int16 *_pWeights, const uint32 _numSources, const uint32 _start, const uint32 _numBytes )
+			{
+				const __m128i zero = _mm_setzero_si128();
+				const __m128i round = _mm_set1_epi32( 1 << ( kWeightBits - 1 ) );
+
+				//	(w0, w1) repeated, multiplies interleaved pixel pairs of two sources.
+				__m128i weights[ kMaxSources / 2 ];
+				for( uint32 p=0; p<_numSources/2; p++ )
+					weights[p] = _mm_set1_epi32( (int32)( (uint16)_pWeights[ 2*p ] | ( (uint32)(uint16)_pWeights[ 2*p + 1 ] << 16 ) ) );
+
+				uint32 b = _start;
+				for( ; b + 16 <= _numBytes; b += 16 )
+				{
+					__m128i acc0 = round, acc1 = round, acc2 = round, acc3 = round;
+
+					for( uint32 p=0; p<_numSources/2; p++ )
+					{
+						__m128i s0 = _mm_loadu_si128( (const __m128i *)( _ppSrc[ 2*p ] + b ) );
+						__m128i s1 = _mm_loadu_si128( (const __m128i *)( _ppSrc[ 2*p + 1 ] + b ) );
+						__m128i lo = _mm_unpacklo_epi8( s0, s1 );
+						__m128i hi = _mm_unpackhi_epi8( s0, s1 );
+
+						acc0 = _mm_add_epi32( acc0, _mm_madd_epi16( _mm_unpacklo_epi8( lo, zero ), weights[p] ) );
+						acc1 = _mm_add_epi32( acc1, _mm_madd_epi16( _mm_unpackhi_epi8( lo, zero ), weights[p] ) );
+						acc2 = _mm_add_epi32( acc2, _mm_madd_epi16( _mm_unpacklo_epi8( hi, zero ), weights[p] ) );
+						acc3 = _mm_add_epi32( acc3, _mm_madd_epi16( _mm_unpackhi_epi8( hi, zero ), weights[p] ) );
+					}
+
+					__m128i r0 = _mm_packs_epi32( _mm_srai_epi32( acc0, kWeightBits ), _mm_srai_epi32( acc1, kWeightBits ) );
+					__m128i r1 = _mm_packs_epi32( _mm_srai_epi32( acc2, kWeightBits ), _mm_srai_epi32( acc3, kWeightBits ) );
+					_mm_storeu_si128( (__m128i *)( _pDst + b ), _mm_packus_epi16( r0, r1 ) );
+				}
+
+				return b;
+			}
+#endif
+
+#ifdef FRAMEBLEND_AVX2
+			//	Same as BlendSSE2(), unpacks and packs stay within 128 bit lanes so the byte order comes out right.
+			static FRAMEBLEND_AVX2_TARGET uint32	BlendAVX2( uint8 *_pDst, const uint8 *const *_ppSrc, const int16 *_pWeights, const uint32 _numSources, const uint32 _start, const uint32 _numBytes )
+			{
+				const __m256i zero = _mm256_setzero_si256();
+				const __m256i round = _mm256_set1_epi32( 1 << ( kWeightBits - 1 ) );
+
+				__m256i weights[ kMaxSources / 2 ];
+				for( uint32 p=0; p<_numSources/2; p++ )
+					weights[p] = _mm256_set1_epi32( (int32)( (uint16)_pWeights[ 2*p ] | ( (uint32)(uint16)_pWeights[ 2*p + 1 ] << 16 ) ) );
+
+				uint32 b = _start;
+				for( ; b + 32 <= _numBytes; b += 32 )
+				{
+					__m256i acc0 = round, acc1 = round, acc2 = round, acc3 = round;
+
+					for( uint32 p=0; p<_numSources/2; p++ )
+					{
+						__m256i s0 = _mm256_loadu_si256( (const __m256i *)( _ppSrc[ 2*p ] + b ) );
+						__m256i s1 = _mm256_loadu_si256( (const __m256i *)( _ppSrc[ 2*p + 1 ] + b ) );
+						__m256i lo = _mm256_unpacklo_epi8( s0, s1 );
+						__m256i hi = _mm256_unpackhi_epi8( s0, s1 );
+
+						acc0 = _mm256_add_epi32( acc0, _mm256_madd_epi16( _mm256_unpacklo_epi8( lo, zero ), weights[p] ) );
+						acc1 = _mm256_add_epi32( acc1, _mm256_madd_epi16( _mm256_unpackhi_epi8( lo, zero ), weights[p] ) );
+						acc2 = _mm256_add_epi32( acc2, _mm256_madd_epi16( _mm256_unpacklo_epi8( hi, zero ), weights[p] ) );
+						acc3 = _mm256_add_epi32( acc3, _mm256_madd_epi16( _mm256_unpackhi_epi8( hi, zero ), weights[p] ) );
+					}
+
+					__m256i r0 = _mm256_packs_epi32( _mm256_srai_epi32( acc0, kWeightBits ), _mm256_srai_epi32( acc1, kWeightBits ) );
+					__m256i r1 = _mm256_packs_epi32( _mm256_srai_epi32( acc2, kWeightBits ), _mm256_srai_epi32( acc3, kWeightBits ) );
+					_mm256_storeu_si256( (__m256i *)( _pDst + b ), _mm256_packus_epi16( r0, r1 ) );
+				}
+
+				return b;
+			}
+
+			static bool	HasAVX2()
+			{
+#ifdef _MSC_VER
+				int info[4];
+				__cpuid( info, 1 );
+				//	OSXSAVE and AVX, then the OS has to save the ymm registers.
+				if( ( info[2] & ( 1 << 27 ) ) == 0 || ( info[2] & ( 1 << 28 ) ) == 0 || ( _xgetbv( 0 ) & 6 ) != 6 )
+					return false;
+				__cpuid( info, 0 );
+				if( info[0] < 7 )
+					return false;
+				__cpuidex( info, 7, 0 );
+				return ( info[1] & ( 1 << 5 ) ) != 0;
+#else
+				__builtin_cpu_init();
+				return __builtin_cpu_supports( "avx2" ) != 0;
+#endif
+			}
+#endif
+
+	public:
+			/*
+				Best().
+				Fastest kernel this cpu runs.
+			*/
+			static eKernel	Best()
+			{
+#ifdef FRAMEBLEND_AVX2
+				static const bool bAVX2 = HasAVX2();
+				if( bAVX2 )
+					return eAVX2;
+#endif
+#ifdef FRAMEBLEND_SSE2
+				return eSSE2;
+#else
+				return eScalar;
+#endif
+			}
+
+			static bool	Supported( const eKernel _kernel )
+			{
+				return _kernel <= Best();
+			}
+
+			static const char *KernelName( const eKernel _kernel )
+			{
+				static const char *names[] = { "scalar", "sse2", "avx2" };
+				return names[ _kernel ];
+			}
+
+			/*
+				Blend().
+				_pDst[b] = sum( _pWeights[i] * _ppSrc[i][b] ) for _numBytes bytes. _pDst may be one of the sources.
+				Kernels the cpu doesn't have fall back to the best one it does.
+			*/
+			static void	Blend( uint8 *_pDst, const uint8 *const *_ppSrc, const fp4 *_pWeights, const uint32 _numSources, const uint32 _numBytes, eKernel _kernel = Best() )
+			{
+				if( _numSources == 0 || _numSources > kMaxSources )
+					return;
+
+				const uint8 *sources[ kMaxSources ];
+				int16 weights[ kMaxSources ];
+				const uint32 numSources = Quantize( _ppSrc, _pWeights, _numSources, sources, weights );
+
+				if( !Supported( _kernel ) )
+					_kernel = Best();
+
+				//	Each pass returns where it stopped, the next one does the remainder.
+				uint32 done = 0;
+#ifdef FRAMEBLEND_AVX2
+				if( _kernel == eAVX2 )
+					done = BlendAVX2( _pDst, sources, weights, numSources, done, _numBytes );
+#endif
+#ifdef FRAMEBLEND_SSE2
+				if( _kernel >= eSSE2 )
+					done = BlendSSE2( _pDst, sources, weights, numSources, done, _numBytes );
+#endif
+				BlendScalar( _pDst, sources, weights, numSources, done, _numBytes );
+			}
+};
+
+};
+
+#endif
@@ -0,0 +1,244 @@
+#ifndef	_LATENCYSTATS_H_
+#define	_LATENCYSTATS_H_
+
+#include	<stdio.h>
+#include	<string>
+#include	<sstream>
+#include	<iomanip>
+#include	"base.h"
+#include	"Singleton.h"
+
+#ifdef WIN32
+	#include	<windows.h>
+#else
+#ifdef MAC
+	#include	<mach/mach_time.h>
+#else
+	#include	<time.h>
+#endif
+#endif
+
+namespace	Base
+{
+
+/*
+	CLatencyHistogram.
+	Log scale histogram with 8 buckets per power of two (values are within 12.5% of the bucket bounds).
+	Recording is a single relaxed atomic increment, so any thread can feed it without locks.
+*/
+class	CLatencyHistogram
+{
+	enum {	kSubBits = 3, kSub = 1 << kSubBits, kBuckets = ( 32 - kSubBits + 1 ) * kSub	};
+
+	volatile uint32	m_Buckets[ kBuckets ];
+	volatile uint32	m_Count;
+
+	static inline void	Increment( volatile uint32 *_p )
+	{
+#ifdef WIN32
+		InterlockedIncrement( (volatile LONG *)_p );
+#else
+		__atomic_fetch_add( _p, 1, __ATOMIC_RELAXED );
+#endif
+	}
+
+	static inline uint32	Bucket( const uint32 _value )
+	{
+		if( _value < kSub )
+			return _value;
+
+		uint32 octave = 0;
+		while( ( _value >> octave ) > 1 )
+			octave++;
+
+		return ( octave - kSubBits + 1 ) * kSub + ( ( _value >> ( octave - kSubBits ) ) & ( kSub - 1 ) );
+	}
+
+	//	Largest value that falls into _bucket.
+	static inline uint32	UpperBound( const uint32 _bucket )
+	{
+		if( _bucket < kSub )
+			return _bucket;
+
+		uint32 shift = _bucket / kSub - 1;
+		uint64 lower = (uint64)( kSub + _bucket % kSub ) << shift;
+		return (uint32)( lower + ( (uint64)1 << shift ) - 1 );
+	}
+
+	public:
+			CLatencyHistogram()	{	Reset();	}
+
+			void	Reset()
+			{
+				for( uint32 i=0; i<kBuckets; i++ )
+					m_Buckets[i] = 0;
+				m_Count = 0;
+			}
+
+			void	Record( const uint32 _value )
+			{
+				Increment( &m_Buckets[ Bucket( _value ) ] );
+				Increment( &m_Count );
+			}
+
+			uint32	Count() const	{	return m_Count;	}
+
+			//	Value below which _percent of the samples fall, 0 without samples.
+			uint32	Percentile( const fp8 _percent ) const
+			{
+				uint32 count = m_Count;
+				if( count == 0 )
+					return 0;
+
+				uint64 wanted = (uint64)( count * _percent / 100.0 + 0.5 );
+				if( wanted < 1 )
+					wanted = 1;
+
+				uint64 seen = 0;
+				for( uint32 i=0; i<kBuckets; i++ )
+				{
+					seen += m_Buckets[i];
+					if( seen >= wanted )
+						return UpperBound( i );
+				}
+
+				return UpperBound( kBuckets - 1 );
+			}
+};
+
+/*
+	Stages a frame passes on its way to the screen, and the opening of a sheep.
+*/
+enum	eLatencyStage
+{
+	eLatencyDemux = 0,		//	av_read_frame().
+	eLatencyDecode,			//	avcodec_send_packet()/avcodec_receive_frame().
+	eLatencyScale,			//	sws_scale() or the YUV plane copy.
+	eLatencyBlend,			//	Frame interpolation on the cpu, CCPUFrameDisplay.
+	eLatencyQueueWait,		//	Time a decoded frame sat in the decoder queue.
+	eLatencyUpload,			//	Texture upload in CFrameDisplay::GrabFrame().
+	eLatencyEndFrame,		//	CRendererGL::EndFrame().
+	eLatencySwap,			//	Buffer swap.
+	eLatencyQueueDepth,		//	Decoder queue depth seen by the render thread, in frames.
+	eLatencyOpen,			//	CContentDecoder::Open(), per sheep.
+	eLatencyNumStages
+};
+
+/*
+	CLatencyStats.
+	Always on per stage histograms, timings are in microseconds.
+*/
+class	CLatencyStats : public CSingleton<CLatencyStats>
+{
+	friend class CSingleton<CLatencyStats>;
+
+	CLatencyHistogram	m_Stages[ eLatencyNumStages ];
+
+	CLatencyStats()	{};
+
+	public:
+			virtual ~CLatencyStats()	{	SingletonActive( false );	};
+
+			bool	Shutdown( void )	{	return true;	};
+			const char *Description()	{	return "Latency stats";	};
+
+			//	Monotonic time in microseconds.
+			static inline uint64	Now()
+			{
+#ifdef WIN32
+				static LARGE_INTEGER frequency = { 0 };
+				LARGE_INTEGER counter;
+				if( frequency.QuadPart == 0 )
+					QueryPerformanceFrequency( &frequency );
+				QueryPerformanceCounter( &counter );
+				return (uint64)( counter.QuadPart / ( frequency.QuadPart / 1000000.0 ) );
+#else
+#ifdef MAC
+				static mach_timebase_info_data_t timebase = { 0, 0 };
+				if( timebase.denom == 0 )
+					mach_timebase_info( &timebase );
+				return mach_absolute_time() * timebase.numer / timebase.denom / 1000;
+#else
+				timespec time;
+				clock_gettime( CLOCK_MONOTONIC, &time );
+				return (uint64)time.tv_sec * 1000000 + (uint64)time.tv_nsec / 1000;
+#endif
+#endif
+			}
+
+			static const char *StageName( const eLatencyStage _stage )
+			{
+				static const char *names[ eLatencyNumStages ] = { "demux", "decode", "scale", "cpu blend", "queue wait", "upload", "end frame", "swap", "queue depth", "sheep open" };
+				return names[ _stage ];
+			}
+
+			inline void	Record( const eLatencyStage _stage, const uint32 _value )	{	m_Stages[ _stage ].Record( _value );	};
+			inline void	RecordSince( const eLatencyStage _stage, const uint64 _start )	{	m_Stages[ _stage ].Record( (uint32)( Now() - _start ) );	};
+
+			const CLatencyHistogram	&Stage( const eLatencyStage _stage ) const	{	return m_Stages[ _stage ];	};
+
+			/*
+				Report().
+				"p50/p95/p99" of a stage, in milliseconds, or frames for the queue depth.
+			*/
+			std::string	Report( const eLatencyStage _stage ) const
+			{
+				const CLatencyHistogram &h = m_Stages[ _stage ];
+				std::stringstream s;
+
+				if( h.Count() == 0 )
+					return "no samples";
+
+				if( _stage == eLatencyQueueDepth )
+					s << h.Percentile( 50 ) << "/" << h.Percentile( 95 ) << "/" << h.Percentile( 99 ) << " frames";
+				else
+					s << std::fixed << std::setprecision( 2 ) << h.Percentile( 50 ) / 1000.0 << "/" << h.Percentile( 95 ) / 1000.0 << "/" << h.Percentile( 99 ) / 1000.0 << " ms";
+
+				return s.str();
+			}
+
+			/*
+				Dump().
+				Writes p50/p95/p99 of all stages to _file.
+			*/
+			bool	Dump( const std::string &_file ) const
+			{
+				FILE *pFile = fopen( _file.c_str(), "w" );
+				if( pFile == NULL )
+					return false;
+
+				fprintf( pFile, "stage\tsamples\tp50\tp95\tp99\n" );
+				for( uint32 i=0; i<eLatencyNumStages; i++ )
+				{
+					const CLatencyHistogram &h = m_Stages[i];
+					fprintf( pFile, "%s\t%u\t%u\t%u\t%u\n", StageName( (eLatencyStage)i ), h.Count(), h.Percentile( 50 ), h.Percentile( 95 ), h.Percentile( 99 ) );
+				}
+				fprintf( pFile, "(times in microseconds, queue depth in frames)\n" );
+
+				fclose( pFile );
+				return true;
+			}
+};
+
+/*
+	Helper for singleton.
+*/
+inline CLatencyStats &g_LatencyStats( void )	{	return( CLatencyStats::Instance() );	}
+
+/*
+	CLatencyScope.
+	Records the time until it goes out of scope.
+*/
+class	CLatencyScope
+{
+	eLatencyStage	m_Stage;
+	uint64			m_Start;
+
+	public:
+			CLatencyScope( const eLatencyStage _stage ) : m_Stage( _stage ), m_Start( CLatencyStats::Now() )	{};
+			~CLatencyScope()	{	g_LatencyStats().RecordSince( m_Stage, m_Start );	};
+};
+
+};
+
+#endif
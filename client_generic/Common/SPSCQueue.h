@@ -0,0 +1,201 @@
+#ifndef __SPSC_QUEUE__
+#define __SPSC_QUEUE__
+
+#include "base.h"
+#include "boost/thread/thread.hpp"
+#include "boost/thread/mutex.hpp"
+#include "boost/thread/condition_variable.hpp"
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+namespace Base
+{
+
+/*
+	CSPSCQueue.
+	Bounded single producer / single consumer ring, the lock free replacement of CBlockingQueue on hot paths.
+	push() is producer only, pop()/peek()/popDiscarded() are consumer only, size()/empty() may be called from anywhere.
+	The mutex and condition are only touched when a side has to block on a full or empty ring.
+*/
+template <typename T> class CSPSCQueue
+{
+	//	Keep the indices written by different threads on different cache lines.
+	enum { kCacheLine = 64 };
+
+	T		*m_pRing;
+	uint32	m_Mask;
+	uint32	m_maxQueueElements;
+
+	char	m_Pad0[ kCacheLine ];
+
+	//	Free running counters, slot is index & m_Mask.
+	volatile uint32	m_Head;			//	Written by the consumer.
+	volatile uint32	m_ConsumerWaiting;
+
+	char	m_Pad1[ kCacheLine ];
+
+	volatile uint32	m_Tail;			//	Written by the producer.
+	volatile uint32	m_DiscardMark;	//	Everything before this index is to be thrown away by the consumer.
+	volatile uint32	m_ProducerWaiting;
+
+	char	m_Pad2[ kCacheLine ];
+
+	boost::mutex				m_WaitMutex;
+	boost::condition_variable	m_NotFull;
+	boost::condition_variable	m_NotEmpty;
+
+	//	MSVC volatile accesses already have acquire/release semantics.
+#ifdef WIN32
+	static inline uint32	LoadAcquire( volatile uint32 *_p )					{	return *_p;		}
+	static inline void		StoreRelease( volatile uint32 *_p, uint32 _v )		{	*_p = _v;		}
+	static inline void		FullBarrier()										{	MemoryBarrier();	}
+#else
+	static inline uint32	LoadAcquire( volatile uint32 *_p )					{	return __atomic_load_n( _p, __ATOMIC_ACQUIRE );	}
+	static inline void		StoreRelease( volatile uint32 *_p, uint32 _v )		{	__atomic_store_n( _p, _v, __ATOMIC_RELEASE );	}
+	static inline void		FullBarrier()										{	__atomic_thread_fence( __ATOMIC_SEQ_CST );	}
+#endif
+
+	inline bool	full()	{	return ( LoadAcquire( &m_Tail ) - LoadAcquire( &m_Head ) ) >= m_maxQueueElements;	}
+
+	//	Called after moving an index, wakes the other side if it went to sleep. The barrier pairs with the one taken before a side goes to sleep in push()/peek().
+	inline void	wake( volatile uint32 *_pWaiting, boost::condition_variable &_cond )
+	{
+		FullBarrier();
+		if( LoadAcquire( _pWaiting ) )
+		{
+			boost::mutex::scoped_lock lock( m_WaitMutex );
+			_cond.notify_one();
+		}
+	}
+
+	void	allocate( uint32 _capacity )
+	{
+		uint32 size = 1;
+		while( size < _capacity )
+			size <<= 1;
+
+		delete [] m_pRing;
+		m_pRing = new T[ size ];
+		m_Mask = size - 1;
+		m_maxQueueElements = _capacity;
+		m_Head = m_Tail = m_DiscardMark = 0;
+	}
+
+public:
+	CSPSCQueue( const uint32 _capacity = 64 ) : m_pRing( NULL ), m_ConsumerWaiting( 0 ), m_ProducerWaiting( 0 )
+	{
+		allocate( _capacity );
+	}
+
+	~CSPSCQueue()
+	{
+		delete [] m_pRing;
+	}
+
+	//	Resizes the ring, only valid while no other thread uses the queue. Pending elements are lost.
+	void	setMaxQueueElements( const uint32 _maxElements )
+	{
+		allocate( _maxElements > 0 ? _maxElements : 1 );
+	}
+
+	/*
+		push().
+		Producer side, blocks while the ring is full. The wait is a boost interruption point.
+	*/
+	bool	push( const T &_el )
+	{
+		if( full() )
+		{
+			boost::mutex::scoped_lock lock( m_WaitMutex );
+			StoreRelease( &m_ProducerWaiting, 1 );
+			FullBarrier();
+			while( full() )
+				m_NotFull.wait( lock );
+			StoreRelease( &m_ProducerWaiting, 0 );
+		}
+
+		uint32 tail = m_Tail;
+		m_pRing[ tail & m_Mask ] = _el;
+		StoreRelease( &m_Tail, tail + 1 );
+
+		wake( &m_ConsumerWaiting, m_NotEmpty );
+		return true;
+	}
+
+	/*
+		peek().
+		Consumer side, returns the oldest element without removing it.
+	*/
+	bool	peek( T &_el, bool _wait = false )
+	{
+		uint32 head = m_Head;
+		if( LoadAcquire( &m_Tail ) == head )
+		{
+			if( !_wait )
+				return false;
+
+			boost::mutex::scoped_lock lock( m_WaitMutex );
+			StoreRelease( &m_ConsumerWaiting, 1 );
+			FullBarrier();
+			while( LoadAcquire( &m_Tail ) == head )
+				m_NotEmpty.wait( lock );
+			StoreRelease( &m_ConsumerWaiting, 0 );
+		}
+
+		_el = m_pRing[ head & m_Mask ];
+		return true;
+	}
+
+	/*
+		pop().
+		Consumer side, removes the oldest element.
+	*/
+	bool	pop( T &_el, bool _wait = false )
+	{
+		if( !peek( _el, _wait ) )
+			return false;
+
+		StoreRelease( &m_Head, m_Head + 1 );
+		wake( &m_ProducerWaiting, m_NotFull );
+		return true;
+	}
+
+	/*
+		discard().
+		Producer side, marks everything pushed so far as stale.
+		The consumer collects the stale elements with popDiscarded(), this side never touches the head of the ring.
+	*/
+	void	discard()
+	{
+		StoreRelease( &m_DiscardMark, m_Tail );
+	}
+
+	/*
+		popDiscarded().
+		Consumer side, pops one element older than the last discard() mark. Returns false once there are none left.
+	*/
+	bool	popDiscarded( T &_el )
+	{
+		if( (int32)( LoadAcquire( &m_DiscardMark ) - m_Head ) <= 0 )
+			return false;
+
+		return pop( _el, false );
+	}
+
+	bool	empty()
+	{
+		return LoadAcquire( &m_Tail ) == LoadAcquire( &m_Head );
+	}
+
+	size_t	size()
+	{
+		uint32 head = LoadAcquire( &m_Head );
+		return (size_t)( LoadAcquire( &m_Tail ) - head );
+	}
+};
+
+}
+
+#endif
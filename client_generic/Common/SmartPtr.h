@@ -151,7 +151,9 @@ namespace Base
 template<class T> class CRefCountRep
 {
 	T		*m_pRealPtr;
-	long	m_counter;
+
+	//	Atomic, so a pointer can be copied and dropped on any thread. Assigning to the same SmartPtr from two threads is still a race.
+	volatile long	m_counter;
 
 	//	Constructors and destructor
 	public:
@@ -160,6 +162,7 @@ template<class T> class CRefCountRep
 
 			long	incrRefCount();
 			long	decrRefCount();
+			long	getRefCount() const;
 
 			T		*getPointer() const;
 			T		*getRealPointer() const;
@@ -180,8 +183,16 @@ template<class T> CRefCountRep<T>::~CRefCountRep()
 }
 
 //
-template<class T> long	CRefCountRep<T>::incrRefCount()			{	m_counter++;	return( m_counter );	}
-template<class T> long	CRefCountRep<T>::decrRefCount()			{	m_counter--;	return( m_counter );	}
+#ifdef	WIN32
+template<class T> long	CRefCountRep<T>::incrRefCount()			{	return( ::InterlockedIncrement( &m_counter ) );	}
+template<class T> long	CRefCountRep<T>::decrRefCount()			{	return( ::InterlockedDecrement( &m_counter ) );	}
+template<class T> long	CRefCountRep<T>::getRefCount() const	{	return( ::InterlockedCompareExchange( (volatile long *)&m_counter, 0, 0 ) );	}
+#else
+template<class T> long	CRefCountRep<T>::incrRefCount()			{	return( __atomic_add_fetch( &m_counter, 1, __ATOMIC_RELAXED ) );	}
+template<class T> long	CRefCountRep<T>::decrRefCount()			{	return( __atomic_sub_fetch( &m_counter, 1, __ATOMIC_ACQ_REL ) );	}
+//	Acquire, so whatever the other threads did with the object before they let go of it is visible once the count says they have.
+template<class T> long	CRefCountRep<T>::getRefCount() const	{	return( __atomic_load_n( &m_counter, __ATOMIC_ACQUIRE ) );	}
+#endif
 template<class T> T		*CRefCountRep<T>::getPointer() const	{	return( m_pRealPtr );	}
 template<class T> T		*CRefCountRep<T>::getRealPointer() const{	return( m_pRealPtr );	}
 template<class T> bool	CRefCountRep<T>::isNull() const			{	return( m_pRealPtr == NULL );	}
@@ -212,6 +223,7 @@ template<class T> class CSyncAccessRep
 
 			long	incrRefCount();
 			long	decrRefCount();
+			long	getRefCount() const;
 
 			CSyncAccess<T>	getPointer() const;
 			T		*getRealPointer() const;
@@ -278,6 +290,8 @@ template<class T> long	CSyncAccessRep<T>::decrRefCount()
 #endif
 }
 
+template<class T> long	CSyncAccessRep<T>::getRefCount() const	{	return( m_counter );	}
+
 
 //	Object of type ACCESS (CSyncAccess<T>) will be automatically created on the stack.
 template<class T> CSyncAccess<T>	CSyncAccessRep<T>::getPointer() const		{	return( this );	}
@@ -451,6 +465,10 @@ template<class T, class REP, class ACCESS = T *> class SmartPtr : public SmartPt
 			bool	IsNull() const;
 			long	GetRefCount() const;
 			REP		*GetRepPtr() const;
+
+			//	Detach(), Attach(). Hand a reference over without counting, Detach() gives it up without dropping it, Attach() takes over one given up so.
+			REP		*Detach();
+			void	Attach( REP *_rep );
 };
 
 //
@@ -583,7 +601,7 @@ template<class T, class REP, class ACCESS> bool	SmartPtr<T,REP,ACCESS>::IsNull()
 template<class T, class REP, class ACCESS> long	SmartPtr<T,REP,ACCESS>::GetRefCount() const
 {
 	ASSERT( ! IsNull() );
-	return(	GetRepPtr()->m_counter );
+	return(	GetRepPtr()->getRefCount() );
 }
 
 //
@@ -592,6 +610,21 @@ template<class T, class REP, class ACCESS> REP	*SmartPtr<T,REP,ACCESS>::GetRepPt
 	return(	(REP *)m_rep );
 }
 
+//
+template<class T, class REP, class ACCESS> REP	*SmartPtr<T,REP,ACCESS>::Detach()
+{
+	REP	*rep = GetRepPtr();
+	m_rep = NULL;
+	return( rep );
+}
+
+//
+template<class T, class REP, class ACCESS> void	SmartPtr<T,REP,ACCESS>::Attach( REP *_rep )
+{
+	DecrRefCount();
+	m_rep = _rep;
+}
+
 //
 template<class T, class REP, class ACCESS> void	SmartPtr<T,REP,ACCESS>::IncrRefCount()
 {
@@ -3,6 +3,7 @@
 
 #include "Log.h"
 #include "pool.h"
+#include "boost/thread/mutex.hpp"
 
 /*
 
@@ -138,6 +139,97 @@ template <size_t _size, size_t TGrow = 4> class CLinkPool : public CPoolBase
 //
 template <size_t _size, size_t TGrow> CChunk *CLinkPool<_size, TGrow>::m_pMemoryPool = NULL;
 
+/*
+	CSyncLinkPool.
+	Same as CLinkPool, but safe to allocate from one thread and deallocate from another.
+	Keeps its own freelist, so it never shares chunks with the unlocked pools of the same size.
+*/
+template <size_t _size, size_t TGrow = 4> class CSyncLinkPool : public CPoolBase
+{
+	boost::mutex	m_Lock;
+
+	//	No copy constructor or assignment operator.
+	CSyncLinkPool( const CSyncLinkPool & );
+	void operator = ( const CSyncLinkPool & );
+
+	CSyncLinkPool() : m_pMemoryPool( NULL ), m_Count( 0 )
+	{
+		g_Log->Info( "SyncPool<%d> created", _size );
+	};
+
+	virtual ~CSyncLinkPool()
+	{
+		Purge();
+	}
+
+	static size_t Pad( size_t _wantedSize )	{	return _wantedSize >= sizeof( CChunk ) ? _wantedSize: sizeof( CChunk );	}
+
+	CChunk	*m_pMemoryPool;
+
+	//	Number of chunks ever taken from the system heap.
+	unsigned int	m_Count;
+
+	inline void Push( CChunk *_pNode )
+	{
+		ASSERT( _pNode );
+		_pNode->m_pNext = m_pMemoryPool;
+		m_pMemoryPool = _pNode;
+	}
+
+	inline CChunk	*Pop()
+	{
+		CChunk	*pNode = m_pMemoryPool;
+		if( pNode )
+			m_pMemoryPool = pNode->m_pNext;
+
+		return pNode;
+	}
+
+	public:
+			void	*Allocate()
+			{
+				boost::mutex::scoped_lock lock( m_Lock );
+
+				void *pMem = Pop();
+				if( pMem == NULL )
+				{
+					for( unsigned int i=0; i<TGrow; i++ )
+						Push( reinterpret_cast<CChunk *>( AllocSys( Pad( _size ) ) ) );
+
+					m_Count += TGrow;
+					pMem = Pop();
+				}
+
+				return pMem;
+			}
+
+			void	Deallocate( void *_pData )
+			{
+				boost::mutex::scoped_lock lock( m_Lock );
+				Push( reinterpret_cast<CChunk *>(_pData) );
+			}
+
+			virtual void Purge()
+			{
+				boost::mutex::scoped_lock lock( m_Lock );
+				while( m_pMemoryPool )
+					DeallocSys( Pop() );
+			}
+
+			unsigned int	SystemAllocations()
+			{
+				boost::mutex::scoped_lock lock( m_Lock );
+				return m_Count;
+			}
+
+			static CSyncLinkPool &Instance()
+			{
+				static CSyncLinkPool instance;
+				return( instance );
+			}
+};
+
 };
 
+
 #endif
@@ -28,6 +28,7 @@
 #include	"Log.h"
 #include	"Timer.h"
 #include	"Settings.h"
+#include	"LatencyStats.h"
 
 using namespace boost;
 
@@ -45,15 +46,17 @@ CContentDecoder::CContentDecoder( spCPlaylist _spPlaylist, bool _bStartByRandom,
 	//	We want errors!
 	av_log_set_level( AV_LOG_ERROR );
 
-    m_pScaler = NULL;
-    m_ScalerWidth = 0;
-    m_ScalerHeight = 0;
+    m_pScalers[0] = NULL;
+    m_pScalers[1] = NULL;
     
 	m_bStartByRandom = _bStartByRandom;
 	
 	m_bCalculateTransitions = _bCalculateTransitions;
+	m_bForceTransitions = false;
 
 	m_pDecoderThread = NULL;
+	m_pPrefetchThread = NULL;
+	m_pNextSheepThread = NULL;
 	
 	m_FrameQueue.setMaxQueueElements(_queueLenght);
 	
@@ -67,7 +70,7 @@ CContentDecoder::CContentDecoder( spCPlaylist _spPlaylist, bool _bStartByRandom,
 	
 	m_bForceNext = false;
 		
-	m_sharedFrame = NULL;
+	m_FramesServed = 0;
 	
 	m_Initialized = false;
 	m_NoSheeps = true;
@@ -78,6 +81,34 @@ CContentDecoder::CContentDecoder( spCPlaylist _spPlaylist, bool _bStartByRandom,
 	
 	m_MainVideoInfo = NULL;//new sMainVideoInfo();
 	m_SecondVideoInfo = NULL;
+
+	//	0 means one thread per core.
+	int32 threads = g_Settings()->Get( "settings.player.DecoderThreads", 0 );
+	if( threads <= 0 )
+		threads = (int32)boost::thread::hardware_concurrency();
+	if( threads < 1 )
+		threads = 1;
+	m_DecoderThreads = (uint32)( ( threads > 16 ) ? 16 : threads );
+
+	std::string threadType = g_Settings()->Get( "settings.player.DecoderThreadType", std::string("auto") );
+	if( threadType == "frame" )
+		m_DecoderThreadType = FF_THREAD_FRAME;
+	else if( threadType == "slice" )
+		m_DecoderThreadType = FF_THREAD_SLICE;
+	else
+		m_DecoderThreadType = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
+	m_DecodeSecondsPerFrame = 0.0;
+	m_LoopCacheBytes = 0;
+	m_bDXTFrames = false;
+
+	m_QueueCapacity = _queueLenght;
+	m_LastQueuedTime = 0.0;
+	m_WallSecondsPerFrame = 0.0;
+	m_Degrader.Enable( g_Settings()->Get( "settings.player.AdaptiveDecode", true ) );
+
+	if( g_Settings()->Root() != "?" )
+		g_ProbeCache().Load( g_Settings()->Root() + "probecache.txt" );
 }
 
 /*
@@ -101,12 +132,20 @@ void	CContentDecoder::Destroy()
 	{
 		SAFE_DELETE(m_SecondVideoInfo);
 	}
+
+	while( !m_Prefetched.empty() )
+	{
+		delete m_Prefetched.front();
+		m_Prefetched.pop_front();
+	}
     
-    if( m_pScaler )
+    for( uint32 i=0; i<2; i++ )
     {
-        g_Log->Info( "deleting m_pScalar" );
-        sws_freeContext( m_pScaler );
-        m_pScaler = NULL;
+        if( m_pScalers[i] )
+        {
+            sws_freeContext( m_pScalers[i] );
+            m_pScalers[i] = NULL;
+        }
     }
 }
 
@@ -132,8 +171,113 @@ int	CContentDecoder::DumpError( int _err )
 }
 
 /*
+	ThreadBudget().
+	Codec threads for a stream. With transitions the main and the second stream decode at the same time, the second one gets half of the budget.
+	Only a transition stream opened at lowres is a second stream for good, it is reopened when it becomes the main one.
+	Every other stream can end up as the main one without being reopened, so it gets the main share.
+*/
+uint32	CContentDecoder::ThreadBudget( const bool _bSecond )
+{
+	if( !m_bCalculateTransitions )
+		return m_DecoderThreads;
+
+	uint32 second = m_DecoderThreads / 2;
+	if( second < 1 )
+		second = 1;
+
+	if( _bSecond )
+		return second;
+
+	return ( m_DecoderThreads > second ) ? m_DecoderThreads - second : 1;
+}
+
+/*
+	ApplyProbeInfo().
+	Fills in what avformat_find_stream_info() would have found, from the probe cache.
+	Returns false if the demuxer disagrees with the cache, the stream is probed then.
 */
-bool	CContentDecoder::Open( sOpenVideoInfo *ovi )
+bool	CContentDecoder::ApplyProbeInfo( sOpenVideoInfo *ovi, const sProbeInfo &_probe )
+{
+	AVFormatContext *pFormatContext = ovi->m_pFormatContext;
+	if( _probe.m_StreamIndex < 0 || (uint32)_probe.m_StreamIndex >= pFormatContext->nb_streams )
+		return false;
+
+	AVStream *pStream = pFormatContext->streams[ _probe.m_StreamIndex ];
+	AVCodecParameters *pPar = pStream->codecpar;
+
+	const AVCodecDescriptor *pDescriptor = avcodec_descriptor_get_by_name( _probe.m_Codec.c_str() );
+	if( pPar->codec_type != AVMEDIA_TYPE_VIDEO || pDescriptor == NULL || pPar->codec_id != pDescriptor->id )
+		return false;
+
+	if( pPar->width == 0 || pPar->height == 0 )
+	{
+		pPar->width = _probe.m_Width;
+		pPar->height = _probe.m_Height;
+	}
+	else if( pPar->width != _probe.m_Width || pPar->height != _probe.m_Height )
+		return false;
+
+	if( pPar->format < 0 )
+		pPar->format = av_get_pix_fmt( _probe.m_PixelFormat.c_str() );
+
+	if( pPar->codec_tag == 0 )
+		pPar->codec_tag = _probe.m_CodecTag;
+
+	if( pPar->extradata == NULL && !_probe.m_Extradata.empty() )
+	{
+		pPar->extradata = (uint8_t *)av_mallocz( _probe.m_Extradata.size() + AV_INPUT_BUFFER_PADDING_SIZE );
+		if( pPar->extradata == NULL )
+			return false;
+		memcpy( pPar->extradata, &_probe.m_Extradata[0], _probe.m_Extradata.size() );
+		pPar->extradata_size = (int)_probe.m_Extradata.size();
+	}
+
+	if( pStream->avg_frame_rate.num == 0 && _probe.m_FrameRateNum != 0 )
+		pStream->avg_frame_rate = av_make_q( _probe.m_FrameRateNum, _probe.m_FrameRateDen );
+
+	if( _probe.m_bExactCount )
+		pStream->nb_frames = _probe.m_FrameCount;
+
+	ovi->m_pVideoStream = pStream;
+	ovi->m_VideoStreamID = _probe.m_StreamIndex;
+	return true;
+}
+
+/*
+	StoreProbeInfo().
+	Puts what probing found out about a freshly opened stream into the probe cache.
+*/
+void	CContentDecoder::StoreProbeInfo( sOpenVideoInfo *ovi )
+{
+	AVStream *pStream = ovi->m_pVideoStream;
+	AVCodecParameters *pPar = pStream->codecpar;
+
+	sProbeInfo probe;
+	probe.m_Format = ovi->m_pFormatContext->iformat->name;
+	//	Demuxers like "mov,mp4,m4a" register under the first name.
+	probe.m_Format = probe.m_Format.substr( 0, probe.m_Format.find( ',' ) );
+	probe.m_StreamIndex = ovi->m_VideoStreamID;
+	probe.m_Codec = avcodec_get_name( pPar->codec_id );
+	probe.m_CodecTag = pPar->codec_tag;
+	probe.m_Width = pPar->width;
+	probe.m_Height = pPar->height;
+	const char *pPixelFormat = av_get_pix_fmt_name( (AVPixelFormat)pPar->format );
+	probe.m_PixelFormat = pPixelFormat ? pPixelFormat : "none";
+	probe.m_TimeBaseNum = pStream->time_base.num;
+	probe.m_TimeBaseDen = pStream->time_base.den;
+	probe.m_FrameRateNum = pStream->avg_frame_rate.num;
+	probe.m_FrameRateDen = pStream->avg_frame_rate.den;
+	if( pPar->extradata_size > 0 )
+		probe.m_Extradata.assign( pPar->extradata, pPar->extradata + pPar->extradata_size );
+	probe.m_FrameCount = ovi->m_totalFrameCount;
+	probe.m_bExactCount = false;
+
+	g_ProbeCache().Store( ovi->m_Path, probe );
+}
+
+/*
+*/
+bool	CContentDecoder::Open( sOpenVideoInfo *ovi, const uint32 _threads )
 {
 	if (ovi == NULL)
 		return false;
@@ -151,29 +295,80 @@ bool	CContentDecoder::Open( sOpenVideoInfo *ovi )
 	}
 	g_Log->Info( "Opening: %s", _filename.c_str() );
 
-	if( DumpError( avformat_open_input( &ovi->m_pFormatContext, _filename.c_str(), NULL, NULL ) ) < 0 )
+	uint64 openStart = Base::CLatencyStats::Now();
+
+	//	Transcoded already, nothing to demux or decode. Otherwise the .avi plays while the transcoder makes the stream for next time.
+	if( m_bDXTFrames )
+	{
+		ovi->m_pDXTStream = new CDXTStream();
+		if( ovi->m_pDXTStream->Open( _filename ) )
+		{
+			ovi->m_totalFrameCount = ovi->m_pDXTStream->NumFrames();
+			ovi->m_ReadingTrailingFrames = false;
+			ovi->m_bIndexing = false;
+
+			uint64 openTime = Base::CLatencyStats::Now() - openStart;
+			Base::g_LatencyStats().Record( Base::eLatencyOpen, (uint32)openTime );
+
+			g_Log->Info( "Open done(), %u BC1 frames, %.1f ms", ovi->m_totalFrameCount, openTime / 1000.0 );
+			return true;
+		}
+
+		SAFE_DELETE( ovi->m_pDXTStream );
+		g_DXTTranscoder().Queue( _filename );
+	}
+
+	//	A sheep seen before opens with the demuxer and stream parameters from the probe cache, without probing.
+	sProbeInfo probe;
+	bool bCached = g_ProbeCache().Lookup( ovi->m_Path, probe );
+	const AVInputFormat *pInputFormat = bCached ? av_find_input_format( probe.m_Format.c_str() ) : NULL;
+
+	//	Read through a memory mapping when possible, libavformat's own file protocol otherwise.
+	ovi->m_pMappedFile = new CMappedFile();
+	if( ovi->m_pMappedFile->Open( _filename ) )
+	{
+		ovi->m_pFormatContext = avformat_alloc_context();
+		if( ovi->m_pFormatContext )
+		{
+			ovi->m_pFormatContext->pb = ovi->m_pMappedFile->IOContext();
+			ovi->m_pFormatContext->flags |= AVFMT_FLAG_CUSTOM_IO;
+		}
+	}
+	else
+		SAFE_DELETE( ovi->m_pMappedFile );
+
+	if( DumpError( avformat_open_input( &ovi->m_pFormatContext, _filename.c_str(), pInputFormat, NULL ) ) < 0 )
 	{
 		g_Log->Warning( "Failed to open %s...", _filename.c_str() );
 		return false;
 	}
 
-	if( DumpError( avformat_find_stream_info( ovi->m_pFormatContext, NULL ) ) < 0 )
+	if( bCached && !ApplyProbeInfo( ovi, probe ) )
 	{
-		g_Log->Error( "av_find_stream_info failed with %s...", _filename.c_str() );
-		return false;
+		g_Log->Warning( "Probe cache entry doesn't match %s, probing", _filename.c_str() );
+		bCached = false;
 	}
 
-	//	Find video stream;
-	ovi->m_VideoStreamID = -1;
-    for( uint32 i=0; i<ovi->m_pFormatContext->nb_streams; i++ )
-    {
-        if( ovi->m_pFormatContext->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO )
-        {
-            ovi->m_pVideoStream = ovi->m_pFormatContext->streams[i];
-            ovi->m_VideoStreamID = static_cast<int32>(i);
-            break;
-        }
-    }
+	if( !bCached )
+	{
+		if( DumpError( avformat_find_stream_info( ovi->m_pFormatContext, NULL ) ) < 0 )
+		{
+			g_Log->Error( "av_find_stream_info failed with %s...", _filename.c_str() );
+			return false;
+		}
+
+		//	Find video stream;
+		ovi->m_VideoStreamID = -1;
+		for( uint32 i=0; i<ovi->m_pFormatContext->nb_streams; i++ )
+		{
+			if( ovi->m_pFormatContext->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO )
+			{
+				ovi->m_pVideoStream = ovi->m_pFormatContext->streams[i];
+				ovi->m_VideoStreamID = static_cast<int32>(i);
+				break;
+			}
+		}
+	}
 
     if( ovi->m_VideoStreamID == -1 )
     {
@@ -208,6 +403,12 @@ bool	CContentDecoder::Open( sOpenVideoInfo *ovi )
 
     ovi->m_pFormatContext->flags |= AVFMT_FLAG_IGNIDX;		//	Ignore index.
 
+    ovi->m_pVideoCodecContext->thread_count = (int)_threads;
+    ovi->m_pVideoCodecContext->thread_type = m_DecoderThreadType;
+
+    if( ovi->m_Lowres > 0 )
+        ovi->m_pVideoCodecContext->lowres = ( ovi->m_Lowres < ovi->m_pVideoCodec->max_lowres ) ? ovi->m_Lowres : ovi->m_pVideoCodec->max_lowres;
+
     if( DumpError( avcodec_open2( ovi->m_pVideoCodecContext, ovi->m_pVideoCodec, NULL ) ) < 0 )
     {
         g_Log->Error( "avcodec_open failed for %s", _filename.c_str() );
@@ -215,15 +416,27 @@ bool	CContentDecoder::Open( sOpenVideoInfo *ovi )
     }
 	
     ovi->m_pFrame = av_frame_alloc();
+    ovi->m_pPacket = av_packet_alloc();
 	
-	if (ovi->m_pVideoStream->nb_frames > 0)
+	if( bCached && probe.m_bExactCount )
+		ovi->m_totalFrameCount = probe.m_FrameCount;
+	else if (ovi->m_pVideoStream->nb_frames > 0)
 		ovi->m_totalFrameCount = static_cast<uint32>(ovi->m_pVideoStream->nb_frames);
 	else
 		ovi->m_totalFrameCount = uint32(((((double)ovi->m_pFormatContext->duration/(double)AV_TIME_BASE)) / av_q2d(ovi->m_pVideoStream->avg_frame_rate) + .5));
 		
 	ovi->m_ReadingTrailingFrames = false;
 
-	g_Log->Info( "Open done()" );
+	if( !bCached )
+		StoreProbeInfo( ovi );
+
+	//	Count frames until the end of the stream, unless the cache knows them already.
+	ovi->m_bIndexing = !( bCached && probe.m_bExactCount );
+
+	uint64 openTime = Base::CLatencyStats::Now() - openStart;
+	Base::g_LatencyStats().Record( Base::eLatencyOpen, (uint32)openTime );
+
+	g_Log->Info( "Open done(), %d decoder threads, %.1f ms%s", ovi->m_pVideoCodecContext->thread_count, openTime / 1000.0, bCached ? " (probe cached)" : "" );
 
     return true;
 }
@@ -237,12 +450,18 @@ void	CContentDecoder::Close()
 	Stop();
 
 	ClearQueue();
+	m_FrameHandoff.Clear();
 
 	Destroy();
 
 	m_spPlaylist = NULL;
 
-	g_Log->Info( "closed..." );
+	//	Only writes the file if an entry changed.
+	g_ProbeCache().Save();
+
+	g_Log->Info( "closed... frame pool: %llu allocated (%llu bytes), %llu recycled, %llu discarded",
+				 (unsigned long long)g_VideoFramePool().Allocations(), (unsigned long long)g_VideoFramePool().BytesAllocated(),
+				 (unsigned long long)g_VideoFramePool().Reuses(), (unsigned long long)g_VideoFramePool().Discards() );
 
 }
 
@@ -257,60 +476,119 @@ void	CContentDecoder::Close()
 	}
 }*/
 
+/*
+	SheepInfoFromPath().
+	Unopened info for a sheep file, NULL if the file is gone or marked as deleted.
+*/
+sOpenVideoInfo*	CContentDecoder::SheepInfoFromPath( const std::string &_name )
+{
+	uint32 Generation, ID, First, Last;
+	std::string fname;
+
+	sOpenVideoInfo *retOVI = new sOpenVideoInfo;
+
+	retOVI->m_Path.assign(_name);
+
+	if( m_spPlaylist->GetSheepInfoFromPath( _name, Generation, ID, First, Last, fname ) )
+	{
+		boost::filesystem::path p( _name );
+
+		std::string xxxname( _name );
+		xxxname.replace(xxxname.size() - 3, 3, "xxx");
+
+		if ( !boost::filesystem::exists( p ) || boost::filesystem::exists( p/xxxname ) )
+		{
+			delete retOVI;
+			return NULL;
+		}
+
+		retOVI->m_SheepID = ID;
+		retOVI->m_Generation = Generation;
+		retOVI->m_First = First;
+		retOVI->m_Last = Last;
+		retOVI->m_bSpecialSheep = false;
+	}
+	else
+	{
+		retOVI->m_bSpecialSheep = true;
+	}
+
+	return retOVI;
+}
+
 sOpenVideoInfo*	CContentDecoder::GetNextSheepInfo()
 {
 	std::string name;
 
-	sOpenVideoInfo *retOVI = NULL;
-	
-	bool sheepfound = false;
-	
-	while ( !sheepfound && m_NextSheepQueue.pop(name, true) )
+	while ( m_NextSheepQueue.pop(name, true) )
 	{
 		if ( name.empty() )
 			break;
 
-		uint32 Generation, ID, First, Last;
-		std::string fname;
-											
-		sheepfound = true;
-		
-		retOVI = new sOpenVideoInfo;
-		
-		retOVI->m_Path.assign(name);
-			
-		if( m_spPlaylist->GetSheepInfoFromPath( name, Generation, ID, First, Last, fname ) )
-		{				
-			boost::filesystem::path p( name );
-			
-			if ( !boost::filesystem::exists( p ) )
+		sOpenVideoInfo *retOVI = SheepInfoFromPath( name );
+		if ( retOVI != NULL )
+			return retOVI;
+	}
+
+	return NULL;
+}
+
+/*
+	PrefetchSheep().
+	Thread function, keeps the next kPrefetchSheep sheep from the playlist opened and primed.
+*/
+void	CContentDecoder::PrefetchSheep()
+{
+	try {
+
+		while( !m_bStop )
+		{
 			{
-				sheepfound = false;
-				continue;
+				boost::mutex::scoped_lock lock( m_PrefetchMutex );
+				while( m_Prefetched.size() >= kPrefetchSheep )
+					m_PrefetchCond.wait( lock );
 			}
-			
-			std::string xxxname( name );
-			xxxname.replace(xxxname.size() - 3, 3, "xxx");
-			
-			if ( boost::filesystem::exists( p/xxxname ) )
+
+			sOpenVideoInfo *ovi = GetNextSheepInfo();
+			if( ovi == NULL )
+				continue;
+
+			//	Transition target or not, it plays on as the main stream.
+			if( !Open( ovi, ThreadBudget( false ) ) )
 			{
-				sheepfound = false;
+				g_Log->Warning( "Prefetching %s failed", ovi->m_Path.c_str() );
+				delete ovi;
 				continue;
 			}
 
-			retOVI->m_SheepID = ID;
-			retOVI->m_Generation = Generation;
-			retOVI->m_First = First;
-			retOVI->m_Last = Last;
-			retOVI->m_bSpecialSheep = false;
-		}
-		else
-		{
-			retOVI->m_bSpecialSheep = true;			
+			PrimeSheep( ovi );
+
+			boost::mutex::scoped_lock lock( m_PrefetchMutex );
+			m_Prefetched.push_back( ovi );
+			m_PrefetchCond.notify_all();
 		}
 	}
-	
-	return retOVI;
+	catch(thread_interrupted const&)
+	{
+	}
+}
+
+/*
+	NextPrefetchedSheep().
+	Next sheep to play, usually already opened by the prefetch thread so switching doesn't stall the decoder.
+*/
+sOpenVideoInfo*	CContentDecoder::NextPrefetchedSheep()
+{
+	boost::mutex::scoped_lock lock( m_PrefetchMutex );
+
+	while( m_Prefetched.empty() )
+		m_PrefetchCond.wait( lock );
+
+	sOpenVideoInfo *ovi = m_Prefetched.front();
+	m_Prefetched.pop_front();
+	m_PrefetchCond.notify_all();
+
+	return ovi;
 }
 
 /*
@@ -328,81 +606,114 @@ bool	CContentDecoder::NextSheepForPlaying( int32 _forceNext )
 	
 	if (_forceNext != 0 )
     {
-        std::string secondPath("");
-        
-        if (m_SecondVideoInfo != NULL && m_SecondVideoInfo->m_NumIterations == 0)
-           secondPath.assign(m_SecondVideoInfo->m_Path);
-        
-        SAFE_DELETE(m_SecondVideoInfo);
-        
+        //	Sheep to play before whatever is prefetched, in playing order.
+        std::deque<sOpenVideoInfo *> upcoming;
+
         if (_forceNext < 0)
         {
             uint32 _numPrevious = (uint32)(-_forceNext);
             
             if ( m_SheepHistoryQueue.size() > 0 )
             {
-                if (!secondPath.empty())
-                    m_NextSheepQueue.push( secondPath, false, false );
-                
                 std::string name;
                 
                 for ( uint32 i = 0; i < _numPrevious; i++ )
                 {
-                    while ( m_SheepHistoryQueue.pop( name, false, false ) )
+                    if ( m_SheepHistoryQueue.pop( name, false, false ) )
                     {
-                        m_NextSheepQueue.push( name, false, false );
-                        
-                        break;
+                        sOpenVideoInfo *ovi = SheepInfoFromPath( name );
+                        if ( ovi != NULL )
+                            upcoming.push_front( ovi );
                     }
                 }
             }
+            else
+                SAFE_DELETE(m_SecondVideoInfo);
         }
-        else
+        
+        if (m_SecondVideoInfo != NULL && m_SecondVideoInfo->m_NumIterations == 0)
         {
-            if (!secondPath.empty())
-                m_NextSheepQueue.push(secondPath, false, false);
+            //	Still untouched and opened for the main stream, it can be played as it is. Otherwise reopen.
+            if (m_SecondVideoInfo->m_iCurrentFileFrameCount == 0 && m_SecondVideoInfo->m_Lowres == 0)
+            {
+                m_SecondVideoInfo->m_bTransition = false;
+                upcoming.push_back( m_SecondVideoInfo );
+                m_SecondVideoInfo = NULL;
+            }
+            else
+            {
+                sOpenVideoInfo *ovi = SheepInfoFromPath( m_SecondVideoInfo->m_Path );
+                if ( ovi != NULL )
+                    upcoming.push_back( ovi );
+            }
         }
+        
+        SAFE_DELETE(m_SecondVideoInfo);
+
+        boost::mutex::scoped_lock lock( m_PrefetchMutex );
+        m_Prefetched.insert( m_Prefetched.begin(), upcoming.begin(), upcoming.end() );
+        m_PrefetchCond.notify_all();
     }
 				
-	SAFE_DELETE(m_MainVideoInfo);
+	//	A loop sheep plays again from its own demuxer and codec, or from the pictures cached during the first iteration.
+	bool bRewound = false;
+	if (_forceNext == 0 && m_SecondVideoInfo == NULL && m_MainVideoInfo != NULL && LoopAgain( m_MainVideoInfo ))
+	{
+		bRewound = Rewind( m_MainVideoInfo );
+
+		//	Couldn't seek, reopen it instead.
+		if (!bRewound)
+		{
+			m_SecondVideoInfo = new sOpenVideoInfo(m_MainVideoInfo);
+			m_SecondVideoInfo->m_NumIterations++;
+		}
+	}
+
+	if (!bRewound)
+	{
+		SAFE_DELETE(m_MainVideoInfo);
 	
-	m_MainVideoInfo = m_SecondVideoInfo;
+		m_MainVideoInfo = m_SecondVideoInfo;
 	
-	m_SecondVideoInfo = NULL;
+		m_SecondVideoInfo = NULL;
 	
-	if (m_MainVideoInfo == NULL)
-	{
-		m_MainVideoInfo = GetNextSheepInfo();
-		
 		if (m_MainVideoInfo == NULL)
-			return false;
+		{
+			m_MainVideoInfo = NextPrefetchedSheep();
+		
+			if (m_MainVideoInfo == NULL)
+				return false;
+		}
 	}
 	
 	if (!m_MainVideoInfo->m_bSpecialSheep)
 	{
-		if (m_SecondVideoInfo == NULL)
-		{
-			if (m_MainVideoInfo->IsLoop() && m_LoopIterations > 0 && m_MainVideoInfo->m_NumIterations < (m_LoopIterations - 1))
-			{
-				m_SecondVideoInfo = new sOpenVideoInfo(m_MainVideoInfo);
-				m_SecondVideoInfo->m_NumIterations++;
-			}
-			else
-				m_SecondVideoInfo = GetNextSheepInfo();
-
-		}
+		//	No successor while the loop has iterations left, they are rewinds of the main stream.
+		if (m_SecondVideoInfo == NULL && !LoopAgain( m_MainVideoInfo ))
+			m_SecondVideoInfo = NextPrefetchedSheep();
 	}
 	else
 		m_NoSheeps = true;
 	
 	if (!m_MainVideoInfo->IsOpen())
 	{
-		if (!Open( m_MainVideoInfo ))
+		if (!Open( m_MainVideoInfo, ThreadBudget( false ) ))
 			return false;
 	}
-	else
+	else if (m_MainVideoInfo->m_bTransition)
 	{
-		//if the video was already open (m_SecondVideoInfo previously),
+		//	A transition target opened at lowres, with the second stream's threads, goes on at full size as the main stream.
+		if (m_MainVideoInfo->m_Lowres > 0 && m_MainVideoInfo->m_pVideoCodecContext != NULL)
+		{
+			sOpenVideoInfo *ovi = ReopenFullSize( m_MainVideoInfo );
+			if (ovi != NULL)
+			{
+				SAFE_DELETE(m_MainVideoInfo);
+				m_MainVideoInfo = ovi;
+			}
+		}
+
+		//if the video was already decoding (transition target previously),
 		//we need to assure seamless continuation
 		m_MainVideoInfo->m_NextIsSeam = true;
 	}
@@ -428,14 +739,123 @@ bool	CContentDecoder::NextSheepForPlaying( int32 _forceNext )
 	else
 		return false;
 		
-	if (m_bCalculateTransitions && m_SecondVideoInfo != NULL && !m_SecondVideoInfo->IsOpen() && m_MainVideoInfo->m_Last != m_SecondVideoInfo->m_SheepID && m_MainVideoInfo->m_SheepID != m_SecondVideoInfo->m_First && m_MainVideoInfo->m_Last != m_SecondVideoInfo->m_First && (m_MainVideoInfo->m_Generation / 10000) == (m_SecondVideoInfo->m_Generation / 10000))
+	if (m_bCalculateTransitions && m_SecondVideoInfo != NULL && (m_bForceTransitions ? !m_SecondVideoInfo->m_bSpecialSheep : (m_MainVideoInfo->m_Last != m_SecondVideoInfo->m_SheepID && m_MainVideoInfo->m_SheepID != m_SecondVideoInfo->m_First && m_MainVideoInfo->m_Last != m_SecondVideoInfo->m_First && (m_MainVideoInfo->m_Generation / 10000) == (m_SecondVideoInfo->m_Generation / 10000))))
 	{
-		Open( m_SecondVideoInfo );
+		//	Still starving after everything else, the transition stream decodes at half size. It is reopened if it was prefetched at full size, and again at full size once it is the main stream.
+		if (m_Degrader.Level() >= eDegradeTransitionLowres && m_SecondVideoInfo->m_Lowres == 0 && m_SecondVideoInfo->m_iCurrentFileFrameCount == 0)
+		{
+			if (!m_SecondVideoInfo->IsOpen())
+				m_SecondVideoInfo->m_Lowres = 1;
+			else if (m_SecondVideoInfo->m_pVideoCodec != NULL && m_SecondVideoInfo->m_pVideoCodec->max_lowres > 0)
+			{
+				sOpenVideoInfo *ovi = SheepInfoFromPath( m_SecondVideoInfo->m_Path );
+				if ( ovi != NULL )
+				{
+					ovi->m_Lowres = 1;
+					SAFE_DELETE(m_SecondVideoInfo);
+					m_SecondVideoInfo = ovi;
+				}
+			}
+		}
+
+		if (m_SecondVideoInfo->IsOpen() || Open( m_SecondVideoInfo, ThreadBudget( m_SecondVideoInfo->m_Lowres > 0 ) ))
+		{
+			m_SecondVideoInfo->m_bTransition = true;
+
+			//	It starts decoding in a moment, make sure nothing of it was dropped from the page cache while it waited.
+			if( m_SecondVideoInfo->m_pMappedFile )
+				m_SecondVideoInfo->m_pMappedFile->WillNeed();
+			else if( m_SecondVideoInfo->m_pDXTStream )
+				m_SecondVideoInfo->m_pDXTStream->WillNeed();
+		}
 	}
 
 	return true;
 }
 
+/*
+	LoopAgain().
+	True if ovi is a loop sheep with iterations left after the current one.
+*/
+bool	CContentDecoder::LoopAgain( sOpenVideoInfo *ovi )
+{
+	return ( ovi->IsLoop() && m_LoopIterations > 0 && ovi->m_NumIterations < (m_LoopIterations - 1) );
+}
+
+/*
+	Rewind().
+	Starts the next iteration of a loop sheep without reopening it: seek to the start and flush the codec.
+	Nothing needs to be read again when the first iteration went into the loop cache, or for a BC1 stream.
+*/
+bool	CContentDecoder::Rewind( sOpenVideoInfo *ovi )
+{
+	if( !ovi->IsOpen() )
+		return false;
+
+	if( !ovi->m_LoopCache.Complete() && ovi->m_pDXTStream == NULL )
+	{
+		int64 start = ( ovi->m_pVideoStream->start_time != AV_NOPTS_VALUE ) ? ovi->m_pVideoStream->start_time : 0;
+		int err = av_seek_frame( ovi->m_pFormatContext, ovi->m_VideoStreamID, start, AVSEEK_FLAG_BACKWARD );
+		if( err < 0 )
+		{
+			g_Log->Warning( "Failed to rewind %s", ovi->m_Path.c_str() );
+			DumpError( err );
+			return false;
+		}
+
+		avcodec_flush_buffers( ovi->m_pVideoCodecContext );
+	}
+
+	while ( !ovi->m_PrimedFrames.empty() )
+	{
+		av_frame_free( &ovi->m_PrimedFrames.front() );
+		ovi->m_PrimedFrames.pop_front();
+	}
+
+	ovi->m_iCurrentFileFrameCount = 0;
+	ovi->m_ReadingTrailingFrames = false;
+	ovi->m_NextIsSeam = false;
+	ovi->m_bTransition = false;
+	ovi->m_bIndexing = false;
+	ovi->m_NumIterations++;
+
+	return true;
+}
+
+/*
+	ReopenFullSize().
+	Opens ovi again at full size with the main stream's threads, and decodes up to the picture ovi got to.
+	NULL if that fails, ovi plays on at the size it has then.
+*/
+sOpenVideoInfo *CContentDecoder::ReopenFullSize( sOpenVideoInfo *ovi )
+{
+	sOpenVideoInfo *full = new sOpenVideoInfo( ovi );
+	if( !Open( full, ThreadBudget( false ) ) )
+	{
+		delete full;
+		return NULL;
+	}
+
+	//	Only the transition showed these, at most kTransitionFrameLength of them.
+	for( uint32 i=0; i<ovi->m_iCurrentFileFrameCount; i++ )
+	{
+		if( !DecodeFrame( full ) )
+		{
+			g_Log->Warning( "Failed to catch up with %s at full size", ovi->m_Path.c_str() );
+			delete full;
+			return NULL;
+		}
+
+		av_frame_unref( full->m_pFrame );
+	}
+
+	full->m_iCurrentFileFrameCount = ovi->m_iCurrentFileFrameCount;
+	full->m_CurrentFileatime = ovi->m_CurrentFileatime;
+	full->m_bTransition = true;
+
+	return full;
+}
+
 /*
 	CalculateNextSheep().
 	Thread function.
@@ -492,6 +912,9 @@ void	CContentDecoder::CalculateNextSheep()
 					}
 				}
 				
+				//	Get the file into the page cache while it waits in the queue.
+				CMappedFile::Readahead( _spath );
+
 				m_NextSheepQueue.push( _spath );
 			}
 			else
@@ -507,29 +930,30 @@ void	CContentDecoder::CalculateNextSheep()
 	}
 }
 
-CVideoFrame *CContentDecoder::ReadOneFrame(sOpenVideoInfo *ovi)
+/*
+	DecodeFrame().
+	Decodes the next picture of the stream into ovi->m_pFrame, returns false at the end of the stream or on errors.
+*/
+bool	CContentDecoder::DecodeFrame( sOpenVideoInfo *ovi )
 {
-	if (ovi == NULL)
-		return NULL;
-					
 	AVFormatContext	*pFormatContext = ovi->m_pFormatContext;
-
-	if( !pFormatContext )
-        return NULL;
-
-    AVPacket* packet;
-    int	frameDecoded = 0;
+    AVPacket* packet = ovi->m_pPacket;
 	AVFrame *pFrame = ovi->m_pFrame;
     AVCodecContext	*pVideoCodecContext = ovi->m_pVideoCodecContext;
-	CVideoFrame *pVideoFrame = NULL;
+
+    Base::CLatencyStats &latency = Base::g_LatencyStats();
+    uint64 decodeStart = Base::CLatencyStats::Now();
+    uint64 demuxTime = 0;
 
     while(true)
       {
         int receiveFrameResult = avcodec_receive_frame( pVideoCodecContext, pFrame );
         if (receiveFrameResult == 0)
           {
-            frameDecoded = 1;
-            break;
+            // decode is the whole call minus the time spent reading packets
+            latency.Record( Base::eLatencyDecode, (uint32)( Base::CLatencyStats::Now() - decodeStart - demuxTime ) );
+            latency.Record( Base::eLatencyDemux, (uint32)demuxTime );
+            return true;
           }
         else if (receiveFrameResult == AVERROR(EAGAIN))
           {
@@ -546,94 +970,261 @@ CVideoFrame *CContentDecoder::ReadOneFrame(sOpenVideoInfo *ovi)
             break;
           }
         
-        // read new packet
-        packet = av_packet_alloc();
-        
-        packet->data = NULL;
-        packet->size = 0;
-        
         if (ovi->m_ReadingTrailingFrames) {
           // all frames were read, and no new packets can be sent
           break;
         }
         
-        if ( av_read_frame( pFormatContext, packet ) < 0 )
+        // read new packet, the packet is reused for the whole stream
+        uint64 demuxStart = Base::CLatencyStats::Now();
+        int readResult = av_read_frame( pFormatContext, packet );
+        demuxTime += Base::CLatencyStats::Now() - demuxStart;
+
+        if ( readResult < 0 )
           {
+            // enter draining mode, so frames still buffered in the (threaded) decoder come out
             ovi->m_ReadingTrailingFrames = true;
-            av_packet_free(&packet);
+            // a read error leaves the frame count short
+            if( readResult != AVERROR_EOF )
+              ovi->m_bIndexing = false;
+            avcodec_send_packet( pVideoCodecContext, NULL );
             continue;
           }
             
         if( packet->stream_index != ovi->m_VideoStreamID )
           {
             g_Log->Error("Mismatching stream ID");
+            av_packet_unref(packet);
             break;
           }
         
         if ( avcodec_send_packet( pVideoCodecContext, packet ) < 0 )
           {
             g_Log->Warning( "Failed to decode video frame: avcodec_send_packet() < 0" );
+            av_packet_unref(packet);
             break;
           }
         
-        av_packet_free(&packet);
+        av_packet_unref(packet);
     }
 
+    return false;
+}
+
+/*
+	PrimeSheep().
+	Decodes the first few pictures of a freshly opened stream ahead of time, on the prefetch thread.
+*/
+void	CContentDecoder::PrimeSheep( sOpenVideoInfo *ovi )
+{
+	if( ovi->m_pDXTStream )
+		return;
+
+	for( uint32 i=0; i<kPrimeFrames; i++ )
+	{
+		if( !DecodeFrame( ovi ) )
+			break;
+
+		AVFrame *pPrimed = av_frame_alloc();
+		if( pPrimed == NULL )
+		{
+			av_frame_unref( ovi->m_pFrame );
+			break;
+		}
+
+		av_frame_move_ref( pPrimed, ovi->m_pFrame );
+		ovi->m_PrimedFrames.push_back( pPrimed );
+	}
+}
+
+CVideoFrame *CContentDecoder::ReadOneFrame(sOpenVideoInfo *ovi)
+{
+	if (ovi == NULL)
+		return NULL;
+
+	if( ovi->m_pDXTStream )
+		return ReadDXTFrame( ovi );
+					
+	if( !ovi->m_pFormatContext )
+        return NULL;
+
+	if( ovi->m_NumIterations > 0 && ovi->m_LoopCache.Complete() )
+		return ReplayFrame( ovi );
+
+	//	First pass through a sheep that will loop, keep its pictures for the next iterations.
+	if( ovi->m_iCurrentFileFrameCount == 0 && ovi->m_NumIterations == 0 && ovi->IsLoop() && m_LoopIterations > 1 )
+		ovi->m_LoopCache.Begin( m_LoopCacheBytes );
+
+    int	frameDecoded = 0;
+	AVFrame *pFrame = ovi->m_pFrame;
+    AVCodecContext	*pVideoCodecContext = ovi->m_pVideoCodecContext;
+	CVideoFrame *pVideoFrame = NULL;
+
+	const bool bTransition = ( ovi == m_SecondVideoInfo );
+	ApplyDegradation( ovi );
+
+	if( !ovi->m_PrimedFrames.empty() )
+	{
+		AVFrame *pPrimed = ovi->m_PrimedFrames.front();
+		ovi->m_PrimedFrames.pop_front();
+		av_frame_move_ref( pFrame, pPrimed );
+		av_frame_free( &pPrimed );
+		frameDecoded = 1;
+	}
+	else if( DecodeFrame( ovi ) )
+		frameDecoded = 1;
+
     //	Do we have a fresh frame?
     if( frameDecoded != 0 )
     {
-        //	If the decoded video has a different resolution, delete the scaler to trigger it to be recreated.
-        if( m_ScalerWidth != (uint32)pVideoCodecContext->width || m_ScalerHeight != (uint32)pVideoCodecContext->height )
-        {
-            g_Log->Info( "size doesn't match, recreating" );
+        pVideoFrame = new CVideoFrame( pVideoCodecContext, m_WantedPixelFormat, ovi->m_Path );
+        AVFrame	*pDest = pVideoFrame->Frame();
+        Base::CLatencyScope scaleScope( Base::eLatencyScale );
 
-            if( m_pScaler )
-            {
-                g_Log->Info( "deleting m_pScalar" );
-                sws_freeContext( m_pScaler );
-                m_pScaler = NULL;
-            }
+        if( m_WantedPixelFormat == AV_PIX_FMT_YUV420P && pVideoCodecContext->pix_fmt == AV_PIX_FMT_YUV420P )
+        {
+            //	Passthrough, the planes only move into the packed layout. Colour conversion happens in the shader.
+            int w = pVideoCodecContext->width;
+            int h = pVideoCodecContext->height;
+            av_image_copy_plane( pDest->data[0], pDest->linesize[0], pFrame->data[0], pFrame->linesize[0], w, h );
+            av_image_copy_plane( pDest->data[1], pDest->linesize[1], pFrame->data[1], pFrame->linesize[1], (w + 1) / 2, (h + 1) / 2 );
+            av_image_copy_plane( pDest->data[2], pDest->linesize[2], pFrame->data[2], pFrame->linesize[2], (w + 1) / 2, (h + 1) / 2 );
         }
-
-        //	Make sure scaler is created.
-        if( m_pScaler == NULL )
+        else
         {
-            g_Log->Info( "creating m_pScaler" );
+            //	Reused as long as size, format and filter stay the same.
+            SwsContext *&pScaler = m_pScalers[ bTransition ? 1 : 0 ];
+            int scaleFlags = ( m_Degrader.Level() >= eDegradeFastScale ) ? SWS_FAST_BILINEAR : SWS_BICUBIC;
 
-            m_pScaler = sws_getContext(	pVideoCodecContext->width, pVideoCodecContext->height, pVideoCodecContext->pix_fmt,
-                                            pVideoCodecContext->width, pVideoCodecContext->height, m_WantedPixelFormat, SWS_BICUBIC, NULL, NULL, NULL );
+            pScaler = sws_getCachedContext( pScaler, pVideoCodecContext->width, pVideoCodecContext->height, pVideoCodecContext->pix_fmt,
+                                            pVideoCodecContext->width, pVideoCodecContext->height, m_WantedPixelFormat, scaleFlags, NULL, NULL, NULL );
 
-            //	Store width & height now...
-            m_ScalerWidth = static_cast<uint32>(pVideoCodecContext->width);
-            m_ScalerHeight = (uint32)pVideoCodecContext->height;
-
-            if( m_pScaler == NULL )
+            if( pScaler == NULL )
+            {
                 g_Log->Warning( "scaler == null" );
-        }
+                av_frame_unref( pFrame );
+                delete pVideoFrame;
+                return NULL;
+            }
 
-        pVideoFrame = new CVideoFrame( pVideoCodecContext, m_WantedPixelFormat, std::string(ovi->m_Path) );
-        AVFrame	*pDest = pVideoFrame->Frame();
+            sws_scale( pScaler, pFrame->data, pFrame->linesize, 0, pVideoCodecContext->height, pDest->data, pDest->linesize );
+        }
 
-        sws_scale( m_pScaler, pFrame->data, pFrame->linesize, 0, pVideoCodecContext->height, pDest->data, pDest->linesize );
-        
         av_frame_unref( pFrame );
+
+        if( ovi->m_LoopCache.Recording() )
+            ovi->m_LoopCache.Add( pVideoFrame );
         
-		ovi->m_iCurrentFileFrameCount++;
-
-        pVideoFrame->SetMetaData_SheepID( ovi->m_SheepID );
-        pVideoFrame->SetMetaData_SheepGeneration( ovi->m_Generation );
-        pVideoFrame->SetMetaData_IsEdge( ovi->IsEdge() );
-        pVideoFrame->SetMetaData_atime( ovi->m_CurrentFileatime );
-        pVideoFrame->SetMetaData_IsSeam( ovi->m_NextIsSeam );
-        pVideoFrame->SetMetaData_FrameIdx( ovi->m_iCurrentFileFrameCount );
-        pVideoFrame->SetMetaData_MaxFrameIdx( ovi->m_totalFrameCount );
-        ovi->m_NextIsSeam = false;
+        TagFrame( ovi, pVideoFrame );
+    }
+    else
+    {
+        if( ovi->m_bIndexing && ovi->m_ReadingTrailingFrames )
+        {
+            //	Played through from the start, the frame count is exact now.
+            g_ProbeCache().StoreFrameCount( ovi->m_Path, ovi->m_iCurrentFileFrameCount );
+            ovi->m_bIndexing = false;
+        }
+
+        if( ovi->m_LoopCache.Recording() )
+        {
+            ovi->m_LoopCache.Finish( ovi->m_ReadingTrailingFrames ? ovi->m_iCurrentFileFrameCount : 0 );
+            if( ovi->m_LoopCache.Complete() )
+                g_Log->Info( "Loop cache holds %u frames (%llu KB) of %s", ovi->m_LoopCache.NumFrames(), (unsigned long long)( ovi->m_LoopCache.Bytes() >> 10 ), ovi->m_Path.c_str() );
+        }
     }
 
-    av_packet_free(&packet);
     return pVideoFrame;
 }
 
+/*
+	ApplyDegradation().
+	Sets the codec's skip options for the current degradation level, before each frame so changes take effect right away.
+*/
+void	CContentDecoder::ApplyDegradation( sOpenVideoInfo *ovi )
+{
+	AVCodecContext *pVideoCodecContext = ovi->m_pVideoCodecContext;
+	uint32 level = m_Degrader.Level();
+
+	if( level >= eDegradeLoopFilterAll )
+		pVideoCodecContext->skip_loop_filter = AVDISCARD_ALL;
+	else if( level >= eDegradeLoopFilterNonRef )
+		pVideoCodecContext->skip_loop_filter = AVDISCARD_NONREF;
+	else
+		pVideoCodecContext->skip_loop_filter = AVDISCARD_DEFAULT;
+}
+
+/*
+	ReplayFrame().
+	Next picture of a loop iteration, copied out of the loop cache instead of decoded.
+*/
+CVideoFrame *CContentDecoder::ReplayFrame( sOpenVideoInfo *ovi )
+{
+	CLoopCache &cache = ovi->m_LoopCache;
+
+	if( ovi->m_iCurrentFileFrameCount >= cache.NumFrames() )
+		return NULL;
+
+	CVideoFrame *pVideoFrame = new CVideoFrame( cache.Width(), cache.Height(), m_WantedPixelFormat, ovi->m_Path );
+	if( !cache.Restore( ovi->m_iCurrentFileFrameCount, pVideoFrame ) )
+	{
+		g_Log->Warning( "Loop cache replay failed for %s", ovi->m_Path.c_str() );
+		delete pVideoFrame;
+		return NULL;
+	}
+
+	TagFrame( ovi, pVideoFrame );
+	return pVideoFrame;
+}
+
+/*
+	ReadDXTFrame().
+	Next picture of a BC1 stream, the blocks are copied out of the mapping as they are.
+*/
+CVideoFrame *CContentDecoder::ReadDXTFrame( sOpenVideoInfo *ovi )
+{
+	CDXTStream *pStream = ovi->m_pDXTStream;
+
+	const uint8 *pBlocks = pStream->Frame( ovi->m_iCurrentFileFrameCount );
+	if( pBlocks == NULL )
+		return NULL;
+
+	CVideoFrame *pVideoFrame = new CVideoFrame( pStream->Width(), pStream->Height(), kPixelFormatDXT1, ovi->m_Path );
+	Base::spCAlignedBuffer &spBuffer = pVideoFrame->StorageBuffer();
+	if( spBuffer.IsNull() || spBuffer->Size() < pStream->FrameBytes() )
+	{
+		g_Log->Warning( "No storage for BC1 frame of %s", ovi->m_Path.c_str() );
+		delete pVideoFrame;
+		return NULL;
+	}
+
+	{
+		Base::CLatencyScope scaleScope( Base::eLatencyScale );
+		memcpy( spBuffer->GetBufferPtr(), pBlocks, pStream->FrameBytes() );
+	}
+
+	TagFrame( ovi, pVideoFrame );
+	return pVideoFrame;
+}
+
+/*
+	TagFrame().
+	Counts the picture and stamps it with where it came from.
+*/
+void	CContentDecoder::TagFrame( sOpenVideoInfo *ovi, CVideoFrame *pVideoFrame )
+{
+	ovi->m_iCurrentFileFrameCount++;
+
+	pVideoFrame->SetMetaData_SheepID( ovi->m_SheepID );
+	pVideoFrame->SetMetaData_SheepGeneration( ovi->m_Generation );
+	pVideoFrame->SetMetaData_IsEdge( ovi->IsEdge() );
+	pVideoFrame->SetMetaData_atime( ovi->m_CurrentFileatime );
+	pVideoFrame->SetMetaData_IsSeam( ovi->m_NextIsSeam );
+	pVideoFrame->SetMetaData_FrameIdx( ovi->m_iCurrentFileFrameCount );
+	pVideoFrame->SetMetaData_MaxFrameIdx( ovi->m_totalFrameCount );
+	ovi->m_NextIsSeam = false;
+}
+
 /*
 	ReadPackets().
 	Thread function.
@@ -660,6 +1251,8 @@ void	CContentDecoder::ReadPackets()
 				
 			if (nextForced == 0)
 			{
+				fp8 decodeStart = m_DecodeTimer.Time();
+
 				CVideoFrame *pMainVideoFrame = ReadOneFrame(m_MainVideoInfo);
 				
 				if (pMainVideoFrame != NULL)
@@ -668,7 +1261,7 @@ void	CContentDecoder::ReadPackets()
 					
 #define kTransitionFrameLength	60
 				
-					if (m_SecondVideoInfo != NULL && m_SecondVideoInfo->IsOpen() && m_MainVideoInfo->m_iCurrentFileFrameCount >= (m_MainVideoInfo->m_totalFrameCount - kTransitionFrameLength))
+					if (m_SecondVideoInfo != NULL && m_SecondVideoInfo->m_bTransition && m_SecondVideoInfo->IsOpen() && m_MainVideoInfo->m_iCurrentFileFrameCount >= (m_MainVideoInfo->m_totalFrameCount - kTransitionFrameLength))
 						pSecondVideoFrame = ReadOneFrame(m_SecondVideoInfo);
 					
 					if (pSecondVideoFrame != NULL)
@@ -682,8 +1275,37 @@ void	CContentDecoder::ReadPackets()
 					}
 					else
 						pMainVideoFrame->SetMetaData_TransitionProgress(0.f);
+
+					//	Busy time only, the push below may block on a full queue.
+					{
+						fp8 decodeTime = m_DecodeTimer.Time() - decodeStart;
+						boost::mutex::scoped_lock lock( m_DecodeStatsMutex );
+						if( m_DecodeSecondsPerFrame <= 0.0 )
+							m_DecodeSecondsPerFrame = decodeTime;
+						else
+							m_DecodeSecondsPerFrame += ( decodeTime - m_DecodeSecondsPerFrame ) * 0.05;
+					}
 					
+					pMainVideoFrame->SetQueuedTime( Base::CLatencyStats::Now() );
 					m_FrameQueue.push( pMainVideoFrame );
+
+					//	Wall time per frame includes waiting for room in the queue, it stays well above the busy time while the decoder keeps up.
+					{
+						fp8 queuedTime = m_DecodeTimer.Time();
+						boost::mutex::scoped_lock lock( m_DecodeStatsMutex );
+						if( m_LastQueuedTime > 0.0 )
+						{
+							fp8 wallTime = queuedTime - m_LastQueuedTime;
+							if( m_WallSecondsPerFrame <= 0.0 )
+								m_WallSecondsPerFrame = wallTime;
+							else
+								m_WallSecondsPerFrame += ( wallTime - m_WallSecondsPerFrame ) * 0.05;
+						}
+						m_LastQueuedTime = queuedTime;
+
+						if( m_Degrader.Update( (uint32)m_FrameQueue.size(), m_QueueCapacity, m_DecodeSecondsPerFrame, m_WallSecondsPerFrame ) )
+							g_Log->Info( "Decode quality: %s", CDecodeDegrader::LevelName( m_Degrader.Level() ) );
+					}
 					
 					bDoNextSheep = false;
 					
@@ -696,8 +1318,9 @@ void	CContentDecoder::ReadPackets()
 				
 				NextSheepForPlaying( nextForced );
 				
+				//	The queued frames belong to the skipped sheep, let the render thread drop them.
 				if ( nextForced != 0 )
-					ClearQueue();
+					m_FrameQueue.discard();
 			}
 		}
 
@@ -711,36 +1334,52 @@ void	CContentDecoder::ReadPackets()
 	g_Log->Info( "Ending decoder thread..." );
 }
 
-void CContentDecoder::ResetSharedFrame()
-{
-	m_sharedFrame = NULL;
-}
-
 /*
 	Frame().
-	Pop a frame from the decoder queue.
+	The next frame for display reader _reader (0 to CFrameHandoff::kMaxReaders - 1), uncopied. Frame buffers are never written after decoding.
+	If another reader already popped a frame this one hasn't seen, that is the one returned, so displays playing the same decoder
+	show the same frames, each popped from the queue once. Safe to call from a render thread per reader, never blocks:
+	NULL when the queue is empty, or another reader is popping and nothing is waiting for this one yet.
 	User must free this resource!
 */
-spCVideoFrame CContentDecoder::Frame()
+spCVideoFrame CContentDecoder::Frame( const uint32 _reader )
 {
-	//mutex::scoped_lock lock( m_sharedFrameMutex );
-	
-	if ( m_sharedFrame.IsNull() )
+	spCVideoFrame spFrame = NULL;
+
+	if( !m_FrameHandoff.Claim() )
 	{
-		CVideoFrame *tmp = NULL;
-	   
-		if ( !m_FrameQueue.pop( tmp, false ) )
-		{
-			tmp = NULL;
-		}
-	   
-		m_sharedFrame = tmp;
+		//	Someone else is popping, what it gets lands in our mailbox, and until then the display keeps its frame.
+		//	No spinning for it, a render thread runs realtime and would starve the one holding the claim.
+		m_FrameHandoff.Take( _reader, spFrame );
+		return spFrame;
 	}
-	else
-		m_sharedFrame->CopyBuffer();
 
+	//	Handed over before we got the claim.
+	if( m_FrameHandoff.Take( _reader, spFrame ) )
+	{
+		m_FrameHandoff.Release();
+		return spFrame;
+	}
+
+	CVideoFrame *tmp = NULL;
+
+	while ( m_FrameQueue.popDiscarded( tmp ) )
+		delete tmp;
+   
+	Base::g_LatencyStats().Record( Base::eLatencyQueueDepth, (uint32)m_FrameQueue.size() );
+
+	if ( m_FrameQueue.pop( tmp, false ) )
+	{
+		Base::g_LatencyStats().RecordSince( Base::eLatencyQueueWait, tmp->QueuedTime() );
+		m_FramesServed++;
+
+		spFrame = tmp;
+		m_FrameHandoff.Publish( _reader, spFrame );
+	}
+
+	m_FrameHandoff.Release();
 
-	return m_sharedFrame;
+	return spFrame;
 }
 
 
@@ -758,6 +1397,11 @@ bool	CContentDecoder::Start()
 	
 	//abs is a protection against malicious negative numbers giving large integer when converted to uint32
     m_LoopIterations = static_cast<uint32>(g_Settings()->Get( "settings.player.LoopIterations", 2 ));
+	if( m_bForceTransitions )
+		m_LoopIterations = 1;
+
+	int32 loopCacheMB = g_Settings()->Get( "settings.player.LoopCacheMB", 192 );
+	m_LoopCacheBytes = ( loopCacheMB > 0 ) ? ( (uint64)loopCacheMB << 20 ) : 0;
 
 	//	Start by opening, so we have a context to work with.
 	m_bStop = false;
@@ -776,6 +1420,8 @@ bool	CContentDecoder::Start()
 	while ( Initialized() == false )
 		thread::sleep( get_system_time() + posix_time::milliseconds(100) );
 		
+	m_pPrefetchThread = new thread( bind( &CContentDecoder::PrefetchSheep, this ) );
+
 	m_pDecoderThread = new thread( bind( &CContentDecoder::ReadPackets, this ) );
 	
 	int retry = 0;
@@ -806,6 +1452,13 @@ void	CContentDecoder::Stop()
 		m_pDecoderThread->join();
 		SAFE_DELETE( m_pDecoderThread );
 	}
+
+	if( m_pPrefetchThread )
+	{
+		m_pPrefetchThread->interrupt();
+		m_pPrefetchThread->join();
+		SAFE_DELETE( m_pPrefetchThread );
+	}
 	
 	if( m_pNextSheepThread )
 	{
@@ -815,17 +1468,16 @@ void	CContentDecoder::Stop()
 	}
 }
 
-void CContentDecoder::ClearQueue( uint32 leave )
+/*
+	ClearQueue().
+	Consumer side of the frame queue, only call it from the render thread or with the decoder thread stopped.
+*/
+void CContentDecoder::ClearQueue()
 {
-	while ( m_FrameQueue.size() > leave )
-	{
-		CVideoFrame *vf;
-		
-		if ( m_FrameQueue.pop( vf, false, false ) )
-		{
-			delete vf;
-		}
-	}
+	CVideoFrame *vf;
+
+	while ( m_FrameQueue.pop( vf, false ) )
+		delete vf;
 }
 
 /*
@@ -835,6 +1487,26 @@ uint32	CContentDecoder::QueueLength()
 	return (uint32)m_FrameQueue.size();
 }
 
+/*
+	DecodeFps().
+	How fast the decoder thread could run, the headroom over the player rate is DecodeFps() / player fps.
+*/
+fp8	CContentDecoder::DecodeFps()
+{
+	boost::mutex::scoped_lock lock( m_DecodeStatsMutex );
+	return ( m_DecodeSecondsPerFrame > 0.0 ) ? 1.0 / m_DecodeSecondsPerFrame : 0.0;
+}
+
+/*
+	DegradeLevel().
+	How far the decoder stepped down to keep the frame queue filled, eDegradeNone at full quality.
+*/
+uint32	CContentDecoder::DegradeLevel()
+{
+	boost::mutex::scoped_lock lock( m_DecodeStatsMutex );
+	return m_Degrader.Level();
+}
+
 /*
 */
 void CContentDecoder::ForceNext( int32 forced )
@@ -40,13 +40,25 @@ extern "C"{
 #include	"base.h"
 #include	<string>
 #include	<queue>
+#include	<deque>
+#include	<vector>
 #include	"boost/thread/thread.hpp"
 #include	"boost/thread/mutex.hpp"
+#include	"boost/thread/condition_variable.hpp"
 #include	"boost/thread/xtime.hpp"
 #include	"boost/bind/bind.hpp"
 #include	"Frame.h"
+#include	"FrameHandoff.h"
 #include	"Playlist.h"
 #include	"BlockingQueue.h"
+#include	"SPSCQueue.h"
+#include	"ProbeCache.h"
+#include	"MappedFile.h"
+#include	"LoopCache.h"
+#include	"DecodeDegrader.h"
+#include	"DXTStream.h"
+#include	"DXTTranscoder.h"
+#include	"Timer.h"
 
 namespace ContentDecoder
 {
@@ -55,7 +67,10 @@ struct sOpenVideoInfo
 {
 	sOpenVideoInfo() 
 	:	m_pFrame(NULL),
+		m_pPacket(NULL),
 		m_pFormatContext(NULL),
+		m_pMappedFile(NULL),
+		m_pDXTStream(NULL),
 		m_pVideoCodecContext(NULL),
 		m_pVideoCodecParameters(NULL),
 		m_pVideoCodec(NULL),
@@ -71,13 +86,19 @@ struct sOpenVideoInfo
 		m_bSpecialSheep(false),
 		m_NumIterations(0),
 		m_NextIsSeam(false),
-		m_ReadingTrailingFrames(false)
+		m_ReadingTrailingFrames(false),
+		m_bTransition(false),
+		m_bIndexing(false),
+		m_Lowres(0)
 		
 	{ }
 	
 	sOpenVideoInfo( const sOpenVideoInfo* ovi)
 	:	m_pFrame(NULL),
+		m_pPacket(NULL),
 		m_pFormatContext(NULL),
+		m_pMappedFile(NULL),
+		m_pDXTStream(NULL),
 		m_pVideoCodecContext(NULL),
 		m_pVideoCodecParameters(NULL),
 		m_pVideoCodec(NULL),
@@ -94,7 +115,10 @@ struct sOpenVideoInfo
 		m_bSpecialSheep(ovi->m_bSpecialSheep),
 		m_NumIterations(ovi->m_NumIterations),
 		m_NextIsSeam(false),
-		m_ReadingTrailingFrames(false)
+		m_ReadingTrailingFrames(false),
+		m_bTransition(false),
+		m_bIndexing(false),
+		m_Lowres(0)
 	{ }
 	
 	virtual ~sOpenVideoInfo()
@@ -109,19 +133,32 @@ struct sOpenVideoInfo
 		{
 			avformat_close_input( &m_pFormatContext );
 		}
+
+		//	After the format context, which reads through it.
+		SAFE_DELETE( m_pMappedFile );
+		SAFE_DELETE( m_pDXTStream );
 		
 		if ( m_pFrame )
 		{
 			av_frame_free( &m_pFrame );
 			m_pFrame = NULL;
 		}
+
+		if ( m_pPacket )
+			av_packet_free( &m_pPacket );
+
+		while ( !m_PrimedFrames.empty() )
+		{
+			av_frame_free( &m_PrimedFrames.front() );
+			m_PrimedFrames.pop_front();
+		}
 	}
 	
 	bool IsLoop() { return (!m_bSpecialSheep && !IsEdge()); }
 	
 	void Reset() { m_pFormatContext = NULL; }
 	
-	bool IsOpen() { return (m_pFormatContext != NULL); }
+	bool IsOpen() { return (m_pFormatContext != NULL || m_pDXTStream != NULL); }
 	
 	bool EqualsTo( sOpenVideoInfo *ovi )
 	{
@@ -137,7 +174,13 @@ struct sOpenVideoInfo
 	}
 	
 	AVFrame			*m_pFrame;
+	AVPacket		*m_pPacket;
 	AVFormatContext	*m_pFormatContext;
+	CMappedFile		*m_pMappedFile;
+
+	//	Set instead of the ffmpeg contexts when the sheep plays from its pre-transcoded BC1 stream.
+	CDXTStream		*m_pDXTStream;
+
 	AVCodecContext	*m_pVideoCodecContext;
 	AVCodecParameters	*m_pVideoCodecParameters;
 	const AVCodec			*m_pVideoCodec;
@@ -155,8 +198,27 @@ struct sOpenVideoInfo
 	uint32			m_NumIterations;
 	bool			m_NextIsSeam;
 	bool			m_ReadingTrailingFrames;
+
+	//	Set once the stream is picked as transition target, so it decodes alongside the main stream.
+	bool			m_bTransition;
+
+	//	Pictures decoded ahead of time by the prefetch thread, handed out before decoding further.
+	std::deque<AVFrame *>	m_PrimedFrames;
+
+	//	Set while the probe cache doesn't know the exact frame count yet, the frames are counted on the way to the end.
+	bool			m_bIndexing;
+
+	//	Pictures of the first iteration of a loop sheep, replayed by the following ones.
+	CLoopCache		m_LoopCache;
+
+	//	Set before Open(), decodes at 1/2^m_Lowres of the size if the codec can.
+	int				m_Lowres;
 };
 
+//	How many upcoming sheep are kept opened, and how many pictures of each are decoded in advance.
+#define	kPrefetchSheep	2
+#define	kPrimeFrames	3
+
 /*
 	CContentDecoder.
 	Video decoding wrapper for ffmpeg, influenced by glover.
@@ -171,9 +233,8 @@ class CContentDecoder
 	uint32				m_FadeOut;
 	uint32				m_FadeCount;
 	
-    SwsContext		*m_pScaler;
-    uint32			m_ScalerWidth;
-    uint32			m_ScalerHeight;
+    //	Pixel format conversion, the transition stream has its own so the two don't thrash when their sizes differ.
+    SwsContext		*m_pScalers[2];
 
 	//	Thread & threadfunction.
 	boost::thread	*m_pDecoderThread;
@@ -182,8 +243,16 @@ class CContentDecoder
 	boost::thread	*m_pNextSheepThread;
 	void			CalculateNextSheep();
 
+	//	Opens the upcoming sheep ahead of the decoder thread.
+	boost::thread	*m_pPrefetchThread;
+	void			PrefetchSheep();
+
+	std::deque<sOpenVideoInfo *>	m_Prefetched;
+	boost::mutex				m_PrefetchMutex;
+	boost::condition_variable	m_PrefetchCond;
+
 	//	Queue for decoded frames.
-	Base::CBlockingQueue<CVideoFrame *>	m_FrameQueue;
+	Base::CSPSCQueue<CVideoFrame *>	m_FrameQueue;
 	boost::shared_mutex	m_ForceNextMutex;
 
 	//	Codec context & working objects.
@@ -201,11 +270,20 @@ class CContentDecoder
 	
 	
 	uint32			m_LoopIterations;
+
+	//	settings.player.LoopCacheMB, how much memory the decoded pictures of one loop sheep may take.
+	uint64			m_LoopCacheBytes;
+
+	//	Play sheep from their .dxt streams when there is one, and have the missing ones made.
+	bool			m_bDXTFrames;
 	
 	int32			m_bForceNext;
 	
-	spCVideoFrame	m_sharedFrame;
-	boost::mutex	m_sharedFrameMutex;
+	//	Shares popped frames between the displays playing this decoder.
+	CFrameHandoff	m_FrameHandoff;
+
+	//	Frames handed out by Frame(), each counted once however many displays show it.
+	uint64			m_FramesServed;
 	
 	bool			m_bStartByRandom;
 
@@ -215,12 +293,45 @@ class CContentDecoder
 	
 	bool			m_bCalculateTransitions;
 
-	bool	Open( sOpenVideoInfo *ovi );
+	//	Crossfade at every sheep change, graph neighbours or not (benchmarking).
+	bool			m_bForceTransitions;
+
+	//	Codec threading, settings.player.DecoderThreads is the budget for main + transition stream together.
+	uint32			m_DecoderThreads;
+	int				m_DecoderThreadType;
+
+	//	Smoothed decoder busy time per output frame, measured on the decoder thread.
+	Base::CTimer	m_DecodeTimer;
+	fp8				m_DecodeSecondsPerFrame;
+	boost::mutex	m_DecodeStatsMutex;
+
+	//	Steps decode quality down while the frame queue starves, fed from the decoder thread.
+	CDecodeDegrader	m_Degrader;
+	uint32			m_QueueCapacity;
+	fp8				m_LastQueuedTime;
+	fp8				m_WallSecondsPerFrame;
+
+	void	ApplyDegradation( sOpenVideoInfo *ovi );
+
+	uint32	ThreadBudget( const bool _bSecond );
+	bool	Open( sOpenVideoInfo *ovi, const uint32 _threads );
+	bool	ApplyProbeInfo( sOpenVideoInfo *ovi, const sProbeInfo &_probe );
+	void	StoreProbeInfo( sOpenVideoInfo *ovi );
+	sOpenVideoInfo*		SheepInfoFromPath( const std::string &_name );
 	sOpenVideoInfo*		GetNextSheepInfo();
+	sOpenVideoInfo*		NextPrefetchedSheep();
 	bool	NextSheepForPlaying( int32 _forceNext = 0 );
+	bool	LoopAgain( sOpenVideoInfo *ovi );
+	bool	Rewind( sOpenVideoInfo *ovi );
+	sOpenVideoInfo*		ReopenFullSize( sOpenVideoInfo *ovi );
 	void	Destroy();
 	
+	bool	DecodeFrame( sOpenVideoInfo *ovi );
+	void	PrimeSheep( sOpenVideoInfo *ovi );
 	CVideoFrame *ReadOneFrame(sOpenVideoInfo *ovi);
+	CVideoFrame *ReplayFrame( sOpenVideoInfo *ovi );
+	CVideoFrame *ReadDXTFrame( sOpenVideoInfo *ovi );
+	void	TagFrame( sOpenVideoInfo *ovi, CVideoFrame *pVideoFrame );
 
 	static int DumpError( int _err );
 
@@ -234,10 +345,16 @@ class CContentDecoder
 			void	Stop();
 
 			//CVideoFrame *DecodeFrame();
-			void	ResetSharedFrame();
-			spCVideoFrame Frame();
+			spCVideoFrame Frame( const uint32 _reader = 0 );
+			uint64	FramesServed()	{	return m_FramesServed;	};
 
 			bool	Stopped()	{	return m_bStop; };
+
+			//	Call before Start(). Loop repeats are skipped as well, so every sheep change is a transition.
+			void	ForceTransitions( const bool _bForce )	{	m_bForceTransitions = _bForce;	};
+
+			//	Call before Start(). Frames of sheep with a .dxt stream come out as kPixelFormatDXT1 instead of the wanted format.
+			void	EnableDXTFrames( const bool _bEnable )	{	m_bDXTFrames = _bEnable;	};
 			bool	Healthy()	{ return true; };
 
 			bool	PlayNoSheepIntro()	
@@ -250,8 +367,15 @@ class CContentDecoder
 
 			uint32	QueueLength();
 			
-			void ClearQueue( uint32 leave = 0 );
+			void ClearQueue();
 			
+			//	Frames per second the decoder could deliver, 0 until measured.
+			fp8		DecodeFps();
+			uint32	DecoderThreads()	{	return m_DecoderThreads;	};
+
+			//	Current eDegradeLevel, see DecodeDegrader.h.
+			uint32	DegradeLevel();
+
 			void ForceNext( int32 forced = 1 );
 			int32 NextForced( void );
 };
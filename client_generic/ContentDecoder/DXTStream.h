@@ -0,0 +1,155 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//    electricsheep for windows - collaborative screensaver
+//    Copyright 2003 Nicholas Long <nlong@cox.net>
+//	  electricsheep for windows is based of software
+//	  written by Scott Draves <source@electricsheep.org>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+///////////////////////////////////////////////////////////////////////////////
+#ifndef	_DXTSTREAM_H_
+#define	_DXTSTREAM_H_
+
+#include	<string>
+#include	<string.h>
+#include	<sys/stat.h>
+#include	"base.h"
+#include	"DXTEncode.h"
+#include	"MappedFile.h"
+
+namespace ContentDecoder
+{
+
+#define	kDXTStreamVersion	1
+
+/*
+	sDXTStreamHeader.
+	Start of a .dxt file, followed by m_NumFrames pictures of m_FrameBytes BC1 blocks each.
+	m_SourceSize and m_SourceMtime are the .avi it was made from, a stream that doesn't match them is stale.
+*/
+struct	sDXTStreamHeader
+{
+	char	m_Magic[4];
+	uint32	m_Version;
+	uint32	m_Width;
+	uint32	m_Height;
+	uint32	m_NumFrames;
+	uint32	m_FrameBytes;
+	uint32	m_FpsNum;
+	uint32	m_FpsDen;
+	uint64	m_SourceSize;
+	int64	m_SourceMtime;
+
+	void	Init( const uint32 _width, const uint32 _height, const uint64 _sourceSize, const int64 _sourceMtime )
+	{
+		memcpy( m_Magic, "ESBC", 4 );
+		m_Version = kDXTStreamVersion;
+		m_Width = _width;
+		m_Height = _height;
+		m_NumFrames = 0;
+		m_FrameBytes = Base::CDXTEncode::Size( _width, _height );
+		m_FpsNum = 0;
+		m_FpsDen = 1;
+		m_SourceSize = _sourceSize;
+		m_SourceMtime = _sourceMtime;
+	}
+};
+
+/*
+	CDXTStream.
+	A sheep pre-transcoded to BC1 compressed pictures, stored next to its .avi. Frames go to the texture as they are, no decoding.
+*/
+class	CDXTStream
+{
+	CMappedFile			m_File;
+	sDXTStreamHeader	m_Header;
+
+	public:
+			CDXTStream()
+			{
+				memset( &m_Header, 0, sizeof(m_Header) );
+			}
+
+			/*
+				CompanionPath().
+				Where the stream for _avi lives.
+			*/
+			static std::string	CompanionPath( const std::string &_avi )
+			{
+				std::string path( _avi );
+				size_t dot = path.find_last_of( '.' );
+				if( dot != std::string::npos && path.find_first_of( "/\\", dot ) == std::string::npos )
+					path.erase( dot );
+
+				return path + ".dxt";
+			}
+
+			static bool	SourceStamp( const std::string &_avi, uint64 &_size, int64 &_mtime )
+			{
+				struct stat fs;
+				if( ::stat( _avi.c_str(), &fs ) != 0 )
+					return false;
+
+				_size = (uint64)fs.st_size;
+				_mtime = (int64)fs.st_mtime;
+				return true;
+			}
+
+			/*
+				Open().
+				Maps the stream of _avi. False if there is none, or it is stale, truncated or from another version.
+			*/
+			bool	Open( const std::string &_avi )
+			{
+				uint64 sourceSize;
+				int64 sourceMtime;
+				if( !SourceStamp( _avi, sourceSize, sourceMtime ) )
+					return false;
+
+				if( !m_File.Open( CompanionPath( _avi ) ) || m_File.Size() < (int64)sizeof(sDXTStreamHeader) )
+					return false;
+
+				memcpy( &m_Header, m_File.Data(), sizeof(sDXTStreamHeader) );
+
+				if( memcmp( m_Header.m_Magic, "ESBC", 4 ) != 0 || m_Header.m_Version != kDXTStreamVersion ||
+					m_Header.m_SourceSize != sourceSize || m_Header.m_SourceMtime != sourceMtime ||
+					m_Header.m_NumFrames == 0 || m_Header.m_FrameBytes != Base::CDXTEncode::Size( m_Header.m_Width, m_Header.m_Height ) ||
+					m_File.Size() != (int64)sizeof(sDXTStreamHeader) + (int64)m_Header.m_NumFrames * m_Header.m_FrameBytes )
+					return false;
+
+				return true;
+			}
+
+			//	Size of the frames, whole blocks.
+			uint32	Width() const		{	return Base::CDXTEncode::BlocksWide( m_Header.m_Width ) * 4;	}
+			uint32	Height() const		{	return Base::CDXTEncode::BlocksHigh( m_Header.m_Height ) * 4;	}
+			uint32	NumFrames() const	{	return m_Header.m_NumFrames;	}
+			uint32	FrameBytes() const	{	return m_Header.m_FrameBytes;	}
+
+			const uint8	*Frame( const uint32 _index ) const
+			{
+				if( _index >= m_Header.m_NumFrames )
+					return NULL;
+
+				return m_File.Data() + sizeof(sDXTStreamHeader) + (size_t)_index * m_Header.m_FrameBytes;
+			}
+
+			void	WillNeed()	{	m_File.WillNeed();	}
+};
+
+}
+
+#endif
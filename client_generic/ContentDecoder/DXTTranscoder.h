@@ -0,0 +1,370 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//    electricsheep for windows - collaborative screensaver
+//    Copyright 2003 Nicholas Long <nlong@cox.net>
+//	  electricsheep for windows is based of software
+//	  written by Scott Draves <source@electricsheep.org>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+///////////////////////////////////////////////////////////////////////////////
+#ifndef	_DXTTRANSCODER_H_
+#define	_DXTTRANSCODER_H_
+
+extern "C"{
+#if defined(WIN32) || defined(MAC) || defined (LINUX_GNU)
+	#include "libavcodec/avcodec.h"
+	#include "libavformat/avformat.h"
+	#include "libswscale/swscale.h"
+#else
+	#include "avcodec.h"
+	#include "avformat.h"
+	#include "swscale.h"
+#endif
+}
+
+#include	<stdio.h>
+#include	<string>
+#include	<deque>
+#include	<vector>
+#include	<algorithm>
+#include	"base.h"
+#include	"Log.h"
+#include	"Singleton.h"
+#include	"DXTEncode.h"
+#include	"DXTStream.h"
+#include	"boost/thread/thread.hpp"
+#include	"boost/thread/mutex.hpp"
+#include	"boost/thread/condition_variable.hpp"
+#include	"boost/bind/bind.hpp"
+
+#ifndef WIN32
+	#include	<pthread.h>
+	#include	<sched.h>
+#endif
+
+namespace ContentDecoder
+{
+
+/*
+	CDXTTranscoder.
+	Ingest stage for the BC1 playback path: turns queued sheep into .dxt streams next to their .avi, one at a time on an idle priority thread.
+	The stream is written to .dxt.tmp and renamed when complete, so the player never sees half of one.
+*/
+class	CDXTTranscoder : public Base::CSingleton<CDXTTranscoder>
+{
+	friend class Base::CSingleton<CDXTTranscoder>;
+
+	//	Everything one transcode holds, released however it ends.
+	struct	sJob
+	{
+		AVFormatContext	*m_pFormatContext;
+		AVCodecContext	*m_pCodecContext;
+		AVFrame			*m_pFrame;
+		AVPacket		*m_pPacket;
+		SwsContext		*m_pScaler;
+		FILE			*m_pFile;
+		int				m_StreamID;
+
+		sDXTStreamHeader	m_Header;
+		std::vector<uint8>	m_RGBA;
+		std::vector<uint8>	m_Blocks;
+
+		sJob() : m_pFormatContext( NULL ), m_pCodecContext( NULL ), m_pFrame( NULL ), m_pPacket( NULL ), m_pScaler( NULL ), m_pFile( NULL ), m_StreamID( -1 )	{}
+
+		~sJob()
+		{
+			if( m_pFile )
+				fclose( m_pFile );
+			if( m_pScaler )
+				sws_freeContext( m_pScaler );
+			if( m_pPacket )
+				av_packet_free( &m_pPacket );
+			if( m_pFrame )
+				av_frame_free( &m_pFrame );
+			if( m_pCodecContext )
+				avcodec_free_context( &m_pCodecContext );
+			if( m_pFormatContext )
+				avformat_close_input( &m_pFormatContext );
+		}
+	};
+
+	boost::mutex				m_Lock;
+	boost::condition_variable	m_Cond;
+	std::deque<std::string>		m_Queue;
+	boost::thread				*m_pThread;
+	volatile bool				m_bStop;
+
+	uint32	m_Transcoded;
+	uint32	m_Failed;
+
+	CDXTTranscoder() : m_pThread( NULL ), m_bStop( false ), m_Transcoded( 0 ), m_Failed( 0 )	{}
+
+	//	Compress and append every picture the codec has ready.
+	bool	DrainFrames( sJob &_job )
+	{
+		while( avcodec_receive_frame( _job.m_pCodecContext, _job.m_pFrame ) == 0 )
+		{
+			AVFrame *pFrame = _job.m_pFrame;
+			if( (uint32)pFrame->width != _job.m_Header.m_Width || (uint32)pFrame->height != _job.m_Header.m_Height )
+			{
+				av_frame_unref( pFrame );
+				return false;
+			}
+
+			_job.m_pScaler = sws_getCachedContext( _job.m_pScaler, pFrame->width, pFrame->height, (AVPixelFormat)pFrame->format,
+													pFrame->width, pFrame->height, AV_PIX_FMT_RGBA, SWS_BICUBIC, NULL, NULL, NULL );
+			if( _job.m_pScaler == NULL )
+			{
+				av_frame_unref( pFrame );
+				return false;
+			}
+
+			uint8 *dst[4] = { &_job.m_RGBA[0], NULL, NULL, NULL };
+			int dstPitch[4] = { pFrame->width * 4, 0, 0, 0 };
+			sws_scale( _job.m_pScaler, pFrame->data, pFrame->linesize, 0, pFrame->height, dst, dstPitch );
+			av_frame_unref( pFrame );
+
+			Base::CDXTEncode::EncodeBC1( &_job.m_RGBA[0], _job.m_Header.m_Width * 4, _job.m_Header.m_Width, _job.m_Header.m_Height, &_job.m_Blocks[0] );
+			if( fwrite( &_job.m_Blocks[0], 1, _job.m_Blocks.size(), _job.m_pFile ) != _job.m_Blocks.size() )
+				return false;
+
+			_job.m_Header.m_NumFrames++;
+
+			if( m_bStop )
+				return false;
+		}
+
+		return true;
+	}
+
+	bool	Transcode( const std::string &_avi, const std::string &_tmp )
+	{
+		sJob job;
+
+		uint64 sourceSize;
+		int64 sourceMtime;
+		if( !CDXTStream::SourceStamp( _avi, sourceSize, sourceMtime ) )
+			return false;
+
+		if( avformat_open_input( &job.m_pFormatContext, _avi.c_str(), NULL, NULL ) < 0 )
+			return false;
+
+		if( avformat_find_stream_info( job.m_pFormatContext, NULL ) < 0 )
+			return false;
+
+		job.m_StreamID = av_find_best_stream( job.m_pFormatContext, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0 );
+		if( job.m_StreamID < 0 )
+			return false;
+
+		AVStream *pStream = job.m_pFormatContext->streams[ job.m_StreamID ];
+		const AVCodec *pCodec = avcodec_find_decoder( pStream->codecpar->codec_id );
+		if( pCodec == NULL )
+			return false;
+
+		job.m_pCodecContext = avcodec_alloc_context3( pCodec );
+		if( job.m_pCodecContext == NULL || avcodec_parameters_to_context( job.m_pCodecContext, pStream->codecpar ) < 0 )
+			return false;
+
+		//	Background work, one thread is plenty.
+		job.m_pCodecContext->thread_count = 1;
+		if( avcodec_open2( job.m_pCodecContext, pCodec, NULL ) < 0 )
+			return false;
+
+		if( job.m_pCodecContext->width <= 0 || job.m_pCodecContext->height <= 0 )
+			return false;
+
+		job.m_pFrame = av_frame_alloc();
+		job.m_pPacket = av_packet_alloc();
+		if( job.m_pFrame == NULL || job.m_pPacket == NULL )
+			return false;
+
+		job.m_Header.Init( (uint32)job.m_pCodecContext->width, (uint32)job.m_pCodecContext->height, sourceSize, sourceMtime );
+		job.m_Header.m_FpsNum = (uint32)pStream->avg_frame_rate.num;
+		job.m_Header.m_FpsDen = (uint32)pStream->avg_frame_rate.den;
+		job.m_RGBA.resize( (size_t)job.m_Header.m_Width * job.m_Header.m_Height * 4 );
+		job.m_Blocks.resize( job.m_Header.m_FrameBytes );
+
+		job.m_pFile = fopen( _tmp.c_str(), "wb" );
+		if( job.m_pFile == NULL )
+			return false;
+
+		//	Header again at the end, once the frame count is known.
+		if( fwrite( &job.m_Header, sizeof(sDXTStreamHeader), 1, job.m_pFile ) != 1 )
+			return false;
+
+		while( av_read_frame( job.m_pFormatContext, job.m_pPacket ) >= 0 )
+		{
+			//	A damaged packet only costs its picture, like it does in playback.
+			bool bOk = true;
+			if( job.m_pPacket->stream_index == job.m_StreamID )
+			{
+				avcodec_send_packet( job.m_pCodecContext, job.m_pPacket );
+				bOk = DrainFrames( job );
+			}
+
+			av_packet_unref( job.m_pPacket );
+			if( !bOk )
+				return false;
+		}
+
+		avcodec_send_packet( job.m_pCodecContext, NULL );
+		if( !DrainFrames( job ) || job.m_Header.m_NumFrames == 0 )
+			return false;
+
+		if( fseek( job.m_pFile, 0, SEEK_SET ) != 0 || fwrite( &job.m_Header, sizeof(sDXTStreamHeader), 1, job.m_pFile ) != 1 )
+			return false;
+
+		int err = fclose( job.m_pFile );
+		job.m_pFile = NULL;
+		return ( err == 0 );
+	}
+
+	void	Worker()
+	{
+		while( true )
+		{
+			std::string avi;
+			{
+				boost::mutex::scoped_lock lock( m_Lock );
+				while( m_Queue.empty() && !m_bStop )
+					m_Cond.wait( lock );
+
+				if( m_bStop )
+					return;
+
+				avi = m_Queue.front();
+				m_Queue.pop_front();
+			}
+
+			//	Made already, by an earlier run.
+			CDXTStream existing;
+			if( existing.Open( avi ) )
+				continue;
+
+			std::string dxt = CDXTStream::CompanionPath( avi );
+			std::string tmp = dxt + ".tmp";
+
+			g_Log->Info( "Transcoding %s", avi.c_str() );
+
+			bool bOk = Transcode( avi, tmp );
+
+			//	The sheep may have been evicted while it was transcoded, nothing would delete its stream after that.
+			uint64 size;
+			int64 mtime;
+			bool bGone = !CDXTStream::SourceStamp( avi, size, mtime );
+			if( bOk && !bGone )
+			{
+#ifdef WIN32
+				remove( dxt.c_str() );
+#endif
+				bOk = ( rename( tmp.c_str(), dxt.c_str() ) == 0 );
+
+				//	Or in between.
+				if( bOk && !CDXTStream::SourceStamp( avi, size, mtime ) )
+				{
+					remove( dxt.c_str() );
+					bGone = true;
+				}
+			}
+
+			boost::mutex::scoped_lock lock( m_Lock );
+			if( bGone )
+			{
+				remove( tmp.c_str() );
+				g_Log->Info( "%s is gone, dropped its transcode", avi.c_str() );
+			}
+			else if( bOk )
+				m_Transcoded++;
+			else
+			{
+				remove( tmp.c_str() );
+				if( !m_bStop )
+				{
+					m_Failed++;
+					g_Log->Warning( "Transcoding %s failed", avi.c_str() );
+				}
+			}
+		}
+	}
+
+	public:
+			virtual ~CDXTTranscoder()
+			{
+				Shutdown();
+				SingletonActive( false );
+			}
+
+			bool	Shutdown( void )
+			{
+				{
+					boost::mutex::scoped_lock lock( m_Lock );
+					m_bStop = true;
+					m_Queue.clear();
+					m_Cond.notify_all();
+				}
+
+				if( m_pThread )
+				{
+					m_pThread->join();
+					SAFE_DELETE( m_pThread );
+				}
+
+				return true;
+			}
+
+			const char *Description()	{	return "DXT transcoder";	}
+
+			/*
+				Queue().
+				Transcode _avi when there is nothing better to do, unless it is queued already.
+			*/
+			void	Queue( const std::string &_avi )
+			{
+				boost::mutex::scoped_lock lock( m_Lock );
+
+				if( m_bStop || std::find( m_Queue.begin(), m_Queue.end(), _avi ) != m_Queue.end() )
+					return;
+
+				m_Queue.push_back( _avi );
+				m_Cond.notify_all();
+
+				if( m_pThread == NULL )
+				{
+					m_pThread = new boost::thread( boost::bind( &CDXTTranscoder::Worker, this ) );
+#ifdef WIN32
+					SetThreadPriority( (HANDLE)m_pThread->native_handle(), THREAD_PRIORITY_IDLE );
+#elif defined(SCHED_IDLE)
+					struct sched_param sp;
+					sp.sched_priority = 0;
+					pthread_setschedparam( (pthread_t)m_pThread->native_handle(), SCHED_IDLE, &sp );
+#endif
+				}
+			}
+
+			//	Counters.
+			uint32	Transcoded()	{	boost::mutex::scoped_lock lock( m_Lock );	return m_Transcoded;	}
+			uint32	Failed()		{	boost::mutex::scoped_lock lock( m_Lock );	return m_Failed;	}
+			uint32	Pending()		{	boost::mutex::scoped_lock lock( m_Lock );	return (uint32)m_Queue.size();	}
+};
+
+/*
+	Helper for singleton.
+*/
+inline CDXTTranscoder &g_DXTTranscoder( void )	{	return( CDXTTranscoder::Instance() );	}
+
+}
+
+#endif
@@ -0,0 +1,138 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//    electricsheep for windows - collaborative screensaver
+//    Copyright 2003 Nicholas Long <nlong@cox.net>
+//	  electricsheep for windows is based of software
+//	  written by Scott Draves <source@electricsheep.org>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+///////////////////////////////////////////////////////////////////////////////
+#ifndef	_DECODEDEGRADER_H_
+#define	_DECODEDEGRADER_H_
+
+#include	"base.h"
+
+namespace ContentDecoder
+{
+
+/*
+	Degradation levels, each one keeps the savings of the ones below it.
+*/
+enum	eDegradeLevel
+{
+	eDegradeNone = 0,
+	eDegradeFastScale,			//	SWS_FAST_BILINEAR instead of SWS_BICUBIC for the pixel format conversion.
+	eDegradeLoopFilterNonRef,	//	No deblocking of frames nothing else predicts from.
+	eDegradeLoopFilterAll,		//	No deblocking at all.
+	eDegradeTransitionLowres,	//	The transition stream decodes at half resolution, if the codec can.
+	eDegradeNumLevels
+};
+
+//	Frames in a row with the queue below a quarter full and not filling up before stepping down.
+#define	kDegradeDownFrames	8
+
+//	Frames in a row with the queue three quarters full and the decoder mostly idle before stepping back up.
+#define	kDegradeUpFrames	150
+
+//	Busy part of the time per frame under which the decoder is considered to have room for the next better level.
+#define	kDegradeUpLoad		0.5
+
+/*
+	CDecodeDegrader.
+	Closed loop control of how much work the decoder does per frame. Fed once per queued frame with the queue depth and
+	the smoothed busy and wall clock time per frame: a starving queue steps the level down quickly, sustained headroom steps it back up slowly.
+*/
+class	CDecodeDegrader
+{
+	uint32	m_Level;
+	uint32	m_PrevDepth;
+	uint32	m_LowFrames;
+	uint32	m_HighFrames;
+	bool	m_bEnabled;
+
+	public:
+			CDecodeDegrader() : m_Level( eDegradeNone ), m_PrevDepth( 0 ), m_LowFrames( 0 ), m_HighFrames( 0 ), m_bEnabled( true )	{}
+
+			void	Enable( const bool _bEnabled )
+			{
+				m_bEnabled = _bEnabled;
+				if( !m_bEnabled )
+					Reset();
+			}
+
+			void	Reset()
+			{
+				m_Level = eDegradeNone;
+				m_PrevDepth = 0;
+				m_LowFrames = 0;
+				m_HighFrames = 0;
+			}
+
+			/*
+				Update().
+				_busy is the decode time per frame, _wall the time between queued frames including waits for a full queue.
+				Returns true if the level changed.
+			*/
+			bool	Update( const uint32 _queueDepth, const uint32 _queueCapacity, const fp8 _busy, const fp8 _wall )
+			{
+				if( !m_bEnabled || _queueCapacity == 0 )
+					return false;
+
+				//	A growing queue is filling up after a start or a skip, not starving.
+				const bool bFilling = ( _queueDepth > m_PrevDepth );
+				m_PrevDepth = _queueDepth;
+
+				if( _queueDepth * 4 < _queueCapacity && !bFilling )
+				{
+					m_HighFrames = 0;
+					if( ++m_LowFrames >= kDegradeDownFrames && m_Level + 1 < eDegradeNumLevels )
+					{
+						m_Level++;
+						m_LowFrames = 0;
+						return true;
+					}
+					return false;
+				}
+
+				m_LowFrames = 0;
+
+				if( _queueDepth * 4 >= _queueCapacity * 3 && _wall > 0.0 && _busy < _wall * kDegradeUpLoad )
+				{
+					if( ++m_HighFrames >= kDegradeUpFrames && m_Level > eDegradeNone )
+					{
+						m_Level--;
+						m_HighFrames = 0;
+						return true;
+					}
+				}
+				else
+					m_HighFrames = 0;
+
+				return false;
+			}
+
+			uint32	Level() const	{	return m_Level;	}
+
+			static const char *LevelName( const uint32 _level )
+			{
+				static const char *names[] = { "full quality", "fast scaling", "no deblocking on non-reference frames", "no deblocking", "half resolution transitions" };
+				return ( _level < eDegradeNumLevels ) ? names[ _level ] : "?";
+			}
+};
+
+}
+
+#endif
@@ -2,14 +2,14 @@
 #define DIRECTIRYPLAYLIST_H_INCLUDED
 
 #include <set>
-#include "playlist.h"
+#include "LoopingPlaylist.h"
 #include <boost/filesystem/operations.hpp>
 
 using boost::filesystem::directory_iterator;
 
 /**
 	CDirectoryPlaylist.
-	Scans a directory for avi files and loops them.
+	Scans a directory for avi files and loops them, in file name order.
 */
 class	CDirectoryPlaylist : public ContentDecoder::CLoopingPlaylist
 {
@@ -20,15 +20,18 @@ class	CDirectoryPlaylist : public ContentDecoder::CLoopingPlaylist
 
 				for( directory_iterator i(_directory), end; i != end; ++i )
 				{
-					std::string file = i->string();
+					std::string file = i->path().string();
 					size_t pos = file.rfind('.');
 					if( pos != std::string::npos )
 					{
 						const std::string ext  = file.substr( pos+1 );
 						if( ext == "avi" )
-							Add( file );
+							valid.insert( file );
 					}
 				}
+
+				for( std::set<std::string>::const_iterator i = valid.begin(); i != valid.end(); ++i )
+					Add( *i );
 			}
 };
 
@@ -27,6 +27,7 @@
 #include	"SmartPtr.h"
 #include	"linkpool.h"
 #include	"AlignedBuffer.h"
+#include	"FramePool.h"
 
 namespace ContentDecoder
 {
@@ -65,44 +66,54 @@ class CVideoFrame
 
 		Base::spCAlignedBuffer m_spBuffer;
 		AVFrame		*m_pFrame;
+		uint64		m_Generation;
+		AVPixelFormat	m_Format;
+		uint64		m_QueuedTime;
+
+		void	Init( const std::string &_filename )
+		{
+			m_MetaData.m_Fade = 1.f;
+			m_MetaData.m_FileName = _filename;
+			m_MetaData.m_LastAccessTime = 0;
+			m_MetaData.m_SheepID = 0;
+			m_MetaData.m_SheepGeneration = 0;
+			m_MetaData.m_IsEdge = false;
+			m_MetaData.m_IsSeam = false;
+			m_MetaData.m_SecondFrame = NULL;
+			m_MetaData.m_TransitionProgress = 0.f;
+
+			//	Pixel storage comes from the frame pool, and goes back there when we die.
+			if( !g_VideoFramePool().Acquire( m_Width, m_Height, m_Format, m_spBuffer, m_pFrame, m_Generation ) )
+				g_Log->Error( "m_pFrame == NULL" );
+		}
 
 	public:
-		CVideoFrame( AVCodecContext *_pCodecContext, AVPixelFormat _format, std::string _filename ) : m_pFrame(NULL)
+		CVideoFrame( AVCodecContext *_pCodecContext, AVPixelFormat _format, const std::string &_filename ) : m_pFrame(NULL), m_Generation(0), m_Format(_format), m_QueuedTime(0)
 			{
 				assert( _pCodecContext );
 				if ( _pCodecContext == NULL)
 					g_Log->Info( "_pCodecContext == NULL" );
 
-				m_MetaData.m_Fade = 1.f;
-				m_MetaData.m_FileName = _filename;
-				m_MetaData.m_LastAccessTime = 0;
-				m_MetaData.m_SheepID = 0;
-				m_MetaData.m_SheepGeneration = 0;
-				m_MetaData.m_IsEdge = false;
-				m_MetaData.m_IsSeam = false;
-				m_MetaData.m_SecondFrame = NULL;
-				m_MetaData.m_TransitionProgress = 0.f;
-
 				m_Width = static_cast<uint32>(_pCodecContext->width);
 				m_Height = static_cast<uint32>(_pCodecContext->height);
 
+				Init( _filename );
+			}
 
-                m_pFrame = av_frame_alloc();
-				
-				if (m_pFrame != NULL)
-				{
-					int32 numBytes = av_image_get_buffer_size( _format, _pCodecContext->width, _pCodecContext->height, 1 );
-					m_spBuffer = new Base::CAlignedBuffer( static_cast<uint32>(numBytes) * sizeof(uint8) );
-					av_image_fill_arrays( m_pFrame->data, m_pFrame->linesize, m_spBuffer->GetBufferPtr(), _format, _pCodecContext->width, _pCodecContext->height, 1 );
-				} else
-					g_Log->Error( "m_pFrame == NULL" );
+			//	Same, for a picture that doesn't come from a codec (loop replay).
+			CVideoFrame( const uint32 _width, const uint32 _height, AVPixelFormat _format, const std::string &_filename ) : m_Width(_width), m_Height(_height), m_pFrame(NULL), m_Generation(0), m_Format(_format), m_QueuedTime(0)
+			{
+				Init( _filename );
 			}
 
 			virtual ~CVideoFrame()
 			{
 				if( m_pFrame )
 				{
-                    av_frame_free( &m_pFrame );
+					if( g_VideoFramePool().SingletonActive() )
+						g_VideoFramePool().Release( m_spBuffer, m_pFrame );
+					else
+						av_frame_free( &m_pFrame );
 				}
             }
 
@@ -172,6 +183,13 @@ class CVideoFrame
 			inline	uint32	Height()						{	return m_Height;	};
 
 			inline	AVFrame	*Frame()	{	return m_pFrame;	};
+			inline	AVPixelFormat	Format()	{	return m_Format;	};
+
+			//	True if the storage holds the packed Y/U/V planes described in FramePool.h instead of RGB pixels.
+			inline	bool	IsPackedYUV()	{	return m_Format == AV_PIX_FMT_YUV420P;	};
+
+			//	True if the storage holds BC1 blocks from a pre-transcoded stream.
+			inline	bool	IsDXT1()		{	return m_Format == kPixelFormatDXT1;	};
 
 			virtual inline uint8		*Data()
 			{
@@ -186,15 +204,12 @@ class CVideoFrame
 				return m_spBuffer;
 			};
 			
-			virtual void CopyBuffer()
-			{
-				Base::CAlignedBuffer *newBuffer = new Base::CAlignedBuffer( m_spBuffer->Size() );
-				
-				memcpy( newBuffer->GetBufferPtr(), m_spBuffer->GetBufferPtr(), m_spBuffer->Size() );
-				
+			//	Identifies the decoded picture, unchanged no matter how many times the frame is shown.
+			inline	uint64	Generation()	{	return m_Generation;	};
 
-				m_spBuffer = newBuffer;
-			};
+			//	When the frame entered the decoder queue, CLatencyStats::Now() time.
+			inline	void	SetQueuedTime( const uint64 _time )	{	m_QueuedTime = _time;	};
+			inline	uint64	QueuedTime()	{	return m_QueuedTime;	};
 
 
 			virtual inline int32	Stride()
@@ -205,7 +220,7 @@ class CVideoFrame
 				return m_pFrame->linesize[0];
 			};
 
-			//POOLED( CVideoFrame, Memory::CLinkPool );
+			POOLED( CVideoFrame, Memory::CSyncLinkPool );
 };
 
 
@@ -0,0 +1,136 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//    electricsheep for windows - collaborative screensaver
+//    Copyright 2003 Nicholas Long <nlong@cox.net>
+//	  electricsheep for windows is based of software
+//	  written by Scott Draves <source@electricsheep.org>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+///////////////////////////////////////////////////////////////////////////////
+#ifndef	_FRAMEHANDOFF_H_
+#define	_FRAMEHANDOFF_H_
+
+#include	"base.h"
+#include	"Frame.h"
+
+#ifdef WIN32
+#include	<windows.h>
+#endif
+
+namespace ContentDecoder
+{
+
+/*
+	CFrameHandoff.
+	Passes the frame one reader took off the decoder queue to all the other readers of the same decoder, without locks.
+	Every reader (a frame display, possibly on its own render thread) has a mailbox holding the newest frame it hasn't seen yet.
+	The reader that wants a frame while its mailbox is empty claims the queue, pops the next frame and puts it in every other mailbox,
+	so however many displays play a decoder, each frame is popped once and shown by all of them.
+*/
+class	CFrameHandoff
+{
+	public:
+		enum { kMaxReaders = 16 };
+
+	private:
+		//	A frame reference, detached from its spCVideoFrame, so handing it over allocates nothing.
+		typedef	Base::CRefCountRep<CVideoFrame>	tFrameRef;
+
+		//	Each reference owned by exactly one thread at a time, moved in and out with an atomic exchange.
+		tFrameRef	*volatile	m_pMailbox[ kMaxReaders ];
+
+		//	One past the highest reader that ever asked, frames are only handed to those.
+		volatile uint32	m_NumReaders;
+
+		//	Set while a reader pops and distributes a frame.
+		volatile uint32	m_Claim;
+
+#ifdef WIN32
+		static inline tFrameRef	*Exchange( tFrameRef *volatile *_pp, tFrameRef *_p )				{	return (tFrameRef *)InterlockedExchangePointer( (PVOID volatile *)_pp, _p );	}
+		static inline bool	CompareExchange( volatile uint32 *_p, uint32 _expected, uint32 _v )		{	return (uint32)InterlockedCompareExchange( (volatile LONG *)_p, (LONG)_v, (LONG)_expected ) == _expected;	}
+		static inline uint32	LoadAcquire( volatile uint32 *_p )									{	return *_p;		}
+		static inline void		StoreRelease( volatile uint32 *_p, uint32 _v )						{	*_p = _v;		}
+#else
+		static inline tFrameRef	*Exchange( tFrameRef *volatile *_pp, tFrameRef *_p )				{	return __atomic_exchange_n( _pp, _p, __ATOMIC_ACQ_REL );	}
+		static inline bool	CompareExchange( volatile uint32 *_p, uint32 _expected, uint32 _v )		{	return __atomic_compare_exchange_n( _p, &_expected, _v, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED );	}
+		static inline uint32	LoadAcquire( volatile uint32 *_p )									{	return __atomic_load_n( _p, __ATOMIC_ACQUIRE );	}
+		static inline void		StoreRelease( volatile uint32 *_p, uint32 _v )						{	__atomic_store_n( _p, _v, __ATOMIC_RELEASE );	}
+#endif
+
+	public:
+			CFrameHandoff() : m_NumReaders( 0 ), m_Claim( 0 )
+			{
+				for( uint32 i = 0; i < kMaxReaders; i++ )
+					m_pMailbox[ i ] = NULL;
+			}
+
+			~CFrameHandoff()
+			{
+				Clear();
+			}
+
+			/*
+				Take().
+				Reader side. Moves the frame waiting for _reader into _spFrame, false if nothing was handed over since the last call.
+			*/
+			bool	Take( const uint32 _reader, spCVideoFrame &_spFrame )
+			{
+				uint32 num = LoadAcquire( &m_NumReaders );
+				while( num <= _reader && !CompareExchange( &m_NumReaders, num, _reader + 1 ) )
+					num = LoadAcquire( &m_NumReaders );
+
+				tFrameRef *pRef = Exchange( &m_pMailbox[ _reader ], NULL );
+				if( pRef == NULL )
+					return false;
+
+				_spFrame.Attach( pRef );
+				return true;
+			}
+
+			//	Claim(), Release(). Only the reader holding the claim may pop the decoder queue and Publish().
+			bool	Claim()		{	return CompareExchange( &m_Claim, 0, 1 );	}
+			void	Release()	{	StoreRelease( &m_Claim, 0 );	}
+
+			/*
+				Publish().
+				Claim holder only. Hands _spFrame to every reader but _reader, replacing frames they haven't taken yet.
+			*/
+			void	Publish( const uint32 _reader, spCVideoFrame _spFrame )
+			{
+				const uint32 num = LoadAcquire( &m_NumReaders );
+				for( uint32 i = 0; i < num; i++ )
+				{
+					if( i == _reader )
+						continue;
+
+					//	A counted copy for the mailbox, and the replaced one dropped.
+					spCVideoFrame spRef( _spFrame );
+					spRef.Attach( Exchange( &m_pMailbox[ i ], spRef.Detach() ) );
+				}
+			}
+
+			//	Drops all waiting frames, only while no reader is active.
+			void	Clear()
+			{
+				spCVideoFrame spRef;
+				for( uint32 i = 0; i < kMaxReaders; i++ )
+					spRef.Attach( Exchange( &m_pMailbox[ i ], NULL ) );
+			}
+};
+
+}
+
+#endif
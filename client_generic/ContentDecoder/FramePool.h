@@ -0,0 +1,276 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//    electricsheep for windows - collaborative screensaver
+//    Copyright 2003 Nicholas Long <nlong@cox.net>
+//	  electricsheep for windows is based of software
+//	  written by Scott Draves <source@electricsheep.org>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+///////////////////////////////////////////////////////////////////////////////
+#ifndef	_FRAMEPOOL_H_
+#define	_FRAMEPOOL_H_
+
+#include	<map>
+#include	<list>
+#include	<vector>
+#include	"base.h"
+#include	"Log.h"
+#include	"Singleton.h"
+#include	"AlignedBuffer.h"
+#include	"DXTEncode.h"
+#include	"boost/thread/mutex.hpp"
+
+namespace ContentDecoder
+{
+
+//	Upper bound of idle storages kept per frame geometry, a bit more than the decoder queue length.
+#define	kMaxPooledFrames	48
+
+/*
+	Packed YUV420 layout.
+	AV_PIX_FMT_YUV420P frames are stored as a single 8 bit picture so they upload as one texture:
+	the Y plane on top, the U and V planes side by side below it, V starting at PackedYUVWidth()/2.
+*/
+inline uint32	PackedYUVWidth( const uint32 _width )	{	return ( ( (_width + 1) / 2 ) * 2 + 3 ) & ~3u;	}
+inline uint32	PackedYUVHeight( const uint32 _height )	{	return _height + (_height + 1) / 2;	}
+
+/*
+	BC1 compressed frames, from pre-transcoded .dxt streams. Not a format ffmpeg knows, so it is kept out of its range.
+	Stored as block rows, linesize[0] is the bytes of one row of 4x4 blocks.
+*/
+#define	kPixelFormatDXT1	((AVPixelFormat)( AV_PIX_FMT_NB + 1 ))
+
+/*
+	CVideoFramePool.
+	Recycles the pixel storage (aligned buffer + AVFrame) of decoded frames, so steady state playback does no heap allocations for frame data.
+	Storage is acquired on the decoder thread and released on the render thread, hence the lock.
+	A released buffer that is still referenced (the texture keeps the last uploaded one) is parked until the reference goes away.
+*/
+class	CVideoFramePool : public Base::CSingleton<CVideoFramePool>
+{
+	friend class Base::CSingleton<CVideoFramePool>;
+
+	typedef struct
+	{
+		Base::spCAlignedBuffer	m_spBuffer;
+		AVFrame					*m_pFrame;
+	} sStorage;
+
+	typedef	std::vector<sStorage>	StorageList;
+	typedef	std::map<uint64, StorageList>	StorageMap;
+
+	boost::mutex	m_Lock;
+
+	StorageMap	m_Free;
+
+	//	Storages the render thread may still reference, they are only reused once their count is down to the pool's own reference.
+	std::list<sStorage>	m_Parked;
+
+	uint64	m_Allocations;
+	uint64	m_Reuses;
+	uint64	m_Discards;
+	uint64	m_BytesAllocated;
+
+	//	Bumped for every acquired storage, so a (buffer, generation) pair names one decoded picture even when buffers are recycled.
+	uint64	m_Generation;
+
+	CVideoFramePool() : m_Allocations( 0 ), m_Reuses( 0 ), m_Discards( 0 ), m_BytesAllocated( 0 ), m_Generation( 0 )	{};
+
+	static inline uint64	Key( const uint32 _width, const uint32 _height, const AVPixelFormat _format )
+	{
+		return ( (uint64)_width << 40 ) | ( (uint64)_height << 16 ) | (uint64)( _format & 0xFFFF );
+	}
+
+	static inline void	Destroy( sStorage &_storage )
+	{
+		if( _storage.m_pFrame )
+			av_frame_free( &_storage.m_pFrame );
+		_storage.m_spBuffer = NULL;
+	}
+
+	//	Move parked storages nobody else references anymore back to the free lists. Called with m_Lock held.
+	//	The other references are dropped without the lock, the atomic count orders that against the reuse here.
+	void	Unpark()
+	{
+		for( std::list<sStorage>::iterator it = m_Parked.begin(); it != m_Parked.end(); )
+		{
+			if( it->m_spBuffer.GetRefCount() <= 1 )
+			{
+				AVFrame *pFrame = it->m_pFrame;
+				StorageList &list = m_Free[ Key( (uint32)pFrame->width, (uint32)pFrame->height, (AVPixelFormat)pFrame->format ) ];
+				if( list.size() < kMaxPooledFrames )
+					list.push_back( *it );
+				else
+				{
+					Destroy( *it );
+					m_Discards++;
+				}
+
+				it = m_Parked.erase( it );
+			}
+			else
+				++it;
+		}
+	}
+
+	public:
+			virtual ~CVideoFramePool()
+			{
+				Purge();
+				SingletonActive( false );
+			}
+
+			bool	Shutdown( void )	{	Purge();	return true;	}
+			const char *Description()	{	return "Video frame pool";	}
+
+			/*
+				Acquire().
+				Returns storage for a _width x _height frame of _format, with the AVFrame planes pointing into the buffer.
+				_generation is a fresh nonzero id for the content about to be written into it.
+			*/
+			bool	Acquire( const uint32 _width, const uint32 _height, const AVPixelFormat _format, Base::spCAlignedBuffer &_spBuffer, AVFrame *&_pFrame, uint64 &_generation )
+			{
+				{
+					boost::mutex::scoped_lock lock( m_Lock );
+
+					_generation = ++m_Generation;
+
+					Unpark();
+
+					StorageMap::iterator it = m_Free.find( Key( _width, _height, _format ) );
+					if( it != m_Free.end() && !it->second.empty() )
+					{
+						_spBuffer = it->second.back().m_spBuffer;
+						_pFrame = it->second.back().m_pFrame;
+						it->second.pop_back();
+						m_Reuses++;
+						return true;
+					}
+				}
+
+				_pFrame = av_frame_alloc();
+				if( _pFrame == NULL )
+					return false;
+
+				int32 numBytes;
+				if( _format == AV_PIX_FMT_YUV420P )
+				{
+					uint32 pitch = PackedYUVWidth( _width );
+					numBytes = (int32)( pitch * PackedYUVHeight( _height ) );
+					_spBuffer = new Base::CAlignedBuffer( static_cast<uint32>(numBytes) * sizeof(uint8) );
+
+					uint8 *pBase = _spBuffer->GetBufferPtr();
+					_pFrame->data[0] = pBase;
+					_pFrame->data[1] = pBase + pitch * _height;
+					_pFrame->data[2] = _pFrame->data[1] + pitch / 2;
+					_pFrame->linesize[0] = _pFrame->linesize[1] = _pFrame->linesize[2] = (int)pitch;
+				}
+				else if( _format == kPixelFormatDXT1 )
+				{
+					numBytes = (int32)Base::CDXTEncode::Size( _width, _height );
+					_spBuffer = new Base::CAlignedBuffer( static_cast<uint32>(numBytes) * sizeof(uint8) );
+					_pFrame->data[0] = _spBuffer->GetBufferPtr();
+					_pFrame->linesize[0] = (int)( Base::CDXTEncode::BlocksWide( _width ) * 8 );
+				}
+				else
+				{
+					numBytes = av_image_get_buffer_size( _format, (int)_width, (int)_height, 1 );
+					_spBuffer = new Base::CAlignedBuffer( static_cast<uint32>(numBytes) * sizeof(uint8) );
+					av_image_fill_arrays( _pFrame->data, _pFrame->linesize, _spBuffer->GetBufferPtr(), _format, (int)_width, (int)_height, 1 );
+				}
+
+				//	Remember the geometry, used as key when the storage comes back.
+				_pFrame->width = (int)_width;
+				_pFrame->height = (int)_height;
+				_pFrame->format = _format;
+
+				boost::mutex::scoped_lock lock( m_Lock );
+				m_Allocations++;
+				m_BytesAllocated += (uint64)numBytes;
+				return true;
+			}
+
+			/*
+				Release().
+				Hands storage back, _spBuffer and _pFrame are cleared.
+			*/
+			void	Release( Base::spCAlignedBuffer &_spBuffer, AVFrame *&_pFrame )
+			{
+				if( _pFrame == NULL )
+				{
+					_spBuffer = NULL;
+					return;
+				}
+
+				sStorage storage;
+				storage.m_spBuffer = _spBuffer;
+				storage.m_pFrame = _pFrame;
+				_spBuffer = NULL;
+				_pFrame = NULL;
+
+				boost::mutex::scoped_lock lock( m_Lock );
+				if( storage.m_spBuffer.IsNull() )
+				{
+					Destroy( storage );
+					m_Discards++;
+					return;
+				}
+
+				if( m_Parked.size() >= kMaxPooledFrames )
+					Unpark();
+
+				if( m_Parked.size() >= kMaxPooledFrames )
+				{
+					Destroy( storage );
+					m_Discards++;
+				}
+				else
+					m_Parked.push_back( storage );
+			}
+
+			/*
+				Purge().
+				Frees all idle storage, called on shutdown and when the stream geometry changes.
+			*/
+			void	Purge()
+			{
+				boost::mutex::scoped_lock lock( m_Lock );
+
+				for( StorageMap::iterator it = m_Free.begin(); it != m_Free.end(); ++it )
+					for( size_t i=0; i<it->second.size(); i++ )
+						Destroy( it->second[i] );
+				m_Free.clear();
+
+				for( std::list<sStorage>::iterator it = m_Parked.begin(); it != m_Parked.end(); ++it )
+					Destroy( *it );
+				m_Parked.clear();
+			}
+
+			//	Counters.
+			uint64	Allocations()		{	boost::mutex::scoped_lock lock( m_Lock );	return m_Allocations;	}
+			uint64	Reuses()			{	boost::mutex::scoped_lock lock( m_Lock );	return m_Reuses;		}
+			uint64	Discards()			{	boost::mutex::scoped_lock lock( m_Lock );	return m_Discards;		}
+			uint64	BytesAllocated()	{	boost::mutex::scoped_lock lock( m_Lock );	return m_BytesAllocated;	}
+};
+
+/*
+	Helper for singleton.
+*/
+inline CVideoFramePool &g_VideoFramePool( void )	{	return( CVideoFramePool::Instance() );	}
+
+}
+
+#endif
@@ -0,0 +1,169 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//    electricsheep for windows - collaborative screensaver
+//    Copyright 2003 Nicholas Long <nlong@cox.net>
+//	  electricsheep for windows is based of software
+//	  written by Scott Draves <source@electricsheep.org>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+///////////////////////////////////////////////////////////////////////////////
+#ifndef	_LOOPCACHE_H_
+#define	_LOOPCACHE_H_
+
+#include	<vector>
+#include	<string.h>
+#include	"base.h"
+#include	"AlignedBuffer.h"
+#include	"Frame.h"
+
+namespace ContentDecoder
+{
+
+/*
+	CLoopCache.
+	Copies of the pictures of the first pass through a loop sheep, so the following iterations are replayed without decoding.
+	Recording gives up as soon as the sheep doesn't fit in the budget, a partial cache is never used.
+	Only touched by the decoder thread.
+*/
+class	CLoopCache
+{
+	std::vector<Base::spCAlignedBuffer>	m_Frames;
+
+	uint64			m_Budget;
+	uint64			m_Bytes;
+	uint32			m_Width;
+	uint32			m_Height;
+	AVPixelFormat	m_Format;
+	bool			m_bRecording;
+	bool			m_bComplete;
+
+	public:
+			CLoopCache() : m_Budget( 0 ), m_Bytes( 0 ), m_Width( 0 ), m_Height( 0 ), m_Format( AV_PIX_FMT_NONE ), m_bRecording( false ), m_bComplete( false )	{}
+
+			/*
+				Begin().
+				Starts recording, _budget is the most memory the copies may take. 0 disables the cache.
+			*/
+			void	Begin( const uint64 _budget )
+			{
+				Clear();
+				m_Budget = _budget;
+				m_bRecording = ( _budget > 0 );
+			}
+
+			/*
+				Add().
+				Appends a copy of the next picture.
+			*/
+			void	Add( CVideoFrame *_pFrame )
+			{
+				if( !m_bRecording )
+					return;
+
+				Base::spCAlignedBuffer &spSource = _pFrame->StorageBuffer();
+				if( spSource.IsNull() )
+				{
+					Abandon();
+					return;
+				}
+
+				if( m_Frames.empty() )
+				{
+					m_Width = _pFrame->Width();
+					m_Height = _pFrame->Height();
+					m_Format = _pFrame->Format();
+				}
+				else if( _pFrame->Width() != m_Width || _pFrame->Height() != m_Height || _pFrame->Format() != m_Format )
+				{
+					Abandon();
+					return;
+				}
+
+				const uint32 size = spSource->Size();
+				if( m_Bytes + size > m_Budget )
+				{
+					Abandon();
+					return;
+				}
+
+				Base::spCAlignedBuffer spCopy = new Base::CAlignedBuffer( size );
+				if( !spCopy->IsValid() )
+				{
+					Abandon();
+					return;
+				}
+
+				memcpy( spCopy->GetBufferPtr(), spSource->GetBufferPtr(), size );
+				m_Frames.push_back( spCopy );
+				m_Bytes += size;
+			}
+
+			/*
+				Finish().
+				The first pass is over, the cache is usable if every one of its _numFrames pictures made it in.
+			*/
+			void	Finish( const uint32 _numFrames )
+			{
+				if( !m_bRecording )
+					return;
+
+				m_bRecording = false;
+				m_bComplete = ( _numFrames > 0 && _numFrames == m_Frames.size() );
+				if( !m_bComplete )
+					Clear();
+			}
+
+			/*
+				Restore().
+				Copies picture _index into _pFrame, which must have the geometry the cache was recorded with.
+			*/
+			bool	Restore( const uint32 _index, CVideoFrame *_pFrame )
+			{
+				if( !m_bComplete || _index >= m_Frames.size() )
+					return false;
+
+				Base::spCAlignedBuffer &spDest = _pFrame->StorageBuffer();
+				if( spDest.IsNull() || _pFrame->Width() != m_Width || _pFrame->Height() != m_Height || _pFrame->Format() != m_Format || spDest->Size() != m_Frames[ _index ]->Size() )
+					return false;
+
+				memcpy( spDest->GetBufferPtr(), m_Frames[ _index ]->GetBufferPtr(), spDest->Size() );
+				return true;
+			}
+
+			void	Abandon()
+			{
+				Clear();
+				m_bRecording = false;
+			}
+
+			void	Clear()
+			{
+				m_Frames.clear();
+				m_Bytes = 0;
+				m_bComplete = false;
+			}
+
+			bool	Recording() const	{	return m_bRecording;	}
+			bool	Complete() const	{	return m_bComplete;	}
+			uint32	NumFrames() const	{	return (uint32)m_Frames.size();	}
+			uint64	Bytes() const		{	return m_Bytes;	}
+			uint32	Width() const		{	return m_Width;	}
+			uint32	Height() const		{	return m_Height;	}
+};
+
+}
+
+#endif
@@ -2,7 +2,7 @@
 #define _LOOPINGPLAYLIST_H
 
 #include "Playlist.h"
-#include <queue>
+#include <vector>
 
 namespace	ContentDecoder
 {
@@ -32,20 +32,25 @@ class	CLoopingPlaylist : public CPlaylist
 				return( true );
 			}
 
-			virtual bool	Next( std::string &_result )
+			virtual uint32	Size()	{	return static_cast<uint32>(m_List.size());	}
+
+			virtual bool	Next( std::string &_result, bool& _bEnoughSheep, uint32 /*_curID*/, const bool /*_bRebuild*/ = false, bool /*_bStartByRandom*/ = false )
 			{
 				if( m_List.empty() )
 					return false;
 
-				printf( "%d\n", m_Index );
 				_result = m_List[ m_Index ];
 
 				m_Index++;
-				if( m_Index >= m_List.capacity() )
+				if( m_Index >= m_List.size() )
 					m_Index = 0;
 
+				_bEnoughSheep = true;
+
 				return true;
 			}
+
+			virtual bool	ChooseSheepForPlaying( uint32 /*curGen*/, uint32 /*curID*/ )	{	return true;	}
 };
 
 MakeSmartPointers( CLoopingPlaylist );
@@ -0,0 +1,269 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//    electricsheep for windows - collaborative screensaver
+//    Copyright 2003 Nicholas Long <nlong@cox.net>
+//	  electricsheep for windows is based of software
+//	  written by Scott Draves <source@electricsheep.org>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+///////////////////////////////////////////////////////////////////////////////
+#ifndef	_MAPPEDFILE_H_
+#define	_MAPPEDFILE_H_
+
+#include	<string>
+#include	<string.h>
+#include	<stdio.h>
+#include	"base.h"
+
+#ifdef WIN32
+	#include	<windows.h>
+#else
+	#include	<sys/types.h>
+	#include	<sys/stat.h>
+	#include	<sys/mman.h>
+	#include	<fcntl.h>
+	#include	<unistd.h>
+#endif
+
+extern "C"{
+	#include "libavformat/avio.h"
+	#include "libavutil/mem.h"
+	#include "libavutil/error.h"
+}
+
+namespace ContentDecoder
+{
+
+//	Size of the buffer libavformat reads through.
+#define	kMappedIOBufferSize	(64 * 1024)
+
+/*
+	CMappedFile.
+	Read only memory mapping of a sheep, handed to libavformat as custom AVIOContext so packets are read without syscalls.
+*/
+class	CMappedFile
+{
+	const uint8	*m_pData;
+	int64		m_Size;
+	int64		m_Position;
+
+	AVIOContext	*m_pIOContext;
+
+#ifdef WIN32
+	HANDLE	m_hFile;
+	HANDLE	m_hMapping;
+#endif
+
+	static int	Read( void *_pOpaque, uint8_t *_pBuffer, int _size )
+	{
+		CMappedFile *pThis = (CMappedFile *)_pOpaque;
+
+		int64 remaining = pThis->m_Size - pThis->m_Position;
+		if( remaining <= 0 )
+			return AVERROR_EOF;
+
+		int n = ( remaining < _size ) ? (int)remaining : _size;
+		memcpy( _pBuffer, pThis->m_pData + pThis->m_Position, (size_t)n );
+		pThis->m_Position += n;
+		return n;
+	}
+
+	static int64_t	Seek( void *_pOpaque, int64_t _offset, int _whence )
+	{
+		CMappedFile *pThis = (CMappedFile *)_pOpaque;
+
+		if( _whence & AVSEEK_SIZE )
+			return pThis->m_Size;
+
+		int64 position;
+		switch( _whence & ~AVSEEK_FORCE )
+		{
+			case SEEK_SET:	position = _offset;	break;
+			case SEEK_CUR:	position = pThis->m_Position + _offset;	break;
+			case SEEK_END:	position = pThis->m_Size + _offset;	break;
+			default:		return AVERROR(EINVAL);
+		}
+
+		if( position < 0 || position > pThis->m_Size )
+			return AVERROR(EINVAL);
+
+		pThis->m_Position = position;
+		return position;
+	}
+
+	void	Unmap()
+	{
+		if( m_pIOContext )
+		{
+			av_freep( &m_pIOContext->buffer );
+			avio_context_free( &m_pIOContext );
+		}
+
+#ifdef WIN32
+		if( m_pData )
+			UnmapViewOfFile( m_pData );
+		if( m_hMapping )
+			CloseHandle( m_hMapping );
+		if( m_hFile != INVALID_HANDLE_VALUE )
+			CloseHandle( m_hFile );
+		m_hMapping = NULL;
+		m_hFile = INVALID_HANDLE_VALUE;
+#else
+		if( m_pData )
+			munmap( (void *)m_pData, (size_t)m_Size );
+#endif
+		m_pData = NULL;
+		m_Size = 0;
+		m_Position = 0;
+	}
+
+	public:
+			CMappedFile() : m_pData( NULL ), m_Size( 0 ), m_Position( 0 ), m_pIOContext( NULL )
+			{
+#ifdef WIN32
+				m_hFile = INVALID_HANDLE_VALUE;
+				m_hMapping = NULL;
+#endif
+			}
+
+			~CMappedFile()
+			{
+				Unmap();
+			}
+
+			/*
+				Open().
+				Maps _path and sets up the AVIOContext. False if the file can't be mapped, the caller then lets libavformat open it.
+			*/
+			bool	Open( const std::string &_path )
+			{
+				Unmap();
+
+#ifdef WIN32
+				m_hFile = CreateFileA( _path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+				if( m_hFile == INVALID_HANDLE_VALUE )
+					return false;
+
+				LARGE_INTEGER size;
+				if( !GetFileSizeEx( m_hFile, &size ) || size.QuadPart == 0 )
+				{
+					Unmap();
+					return false;
+				}
+
+				m_hMapping = CreateFileMappingA( m_hFile, NULL, PAGE_READONLY, 0, 0, NULL );
+				if( m_hMapping == NULL )
+				{
+					Unmap();
+					return false;
+				}
+
+				m_pData = (const uint8 *)MapViewOfFile( m_hMapping, FILE_MAP_READ, 0, 0, 0 );
+				if( m_pData == NULL )
+				{
+					Unmap();
+					return false;
+				}
+				m_Size = (int64)size.QuadPart;
+#else
+				int fd = open( _path.c_str(), O_RDONLY );
+				if( fd < 0 )
+					return false;
+
+				struct stat fs;
+				if( fstat( fd, &fs ) != 0 || fs.st_size == 0 || (uint64)fs.st_size > (uint64)(size_t)-1 )
+				{
+					close( fd );
+					return false;
+				}
+
+				void *p = mmap( NULL, (size_t)fs.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+				close( fd );
+				if( p == MAP_FAILED )
+					return false;
+
+				m_pData = (const uint8 *)p;
+				m_Size = (int64)fs.st_size;
+#endif
+
+				uint8 *pBuffer = (uint8 *)av_malloc( kMappedIOBufferSize );
+				if( pBuffer == NULL )
+				{
+					Unmap();
+					return false;
+				}
+
+				m_pIOContext = avio_alloc_context( pBuffer, kMappedIOBufferSize, 0, this, Read, NULL, Seek );
+				if( m_pIOContext == NULL )
+				{
+					av_free( pBuffer );
+					Unmap();
+					return false;
+				}
+
+				WillNeed();
+				return true;
+			}
+
+			AVIOContext	*IOContext()	{	return m_pIOContext;	}
+			const uint8	*Data() const	{	return m_pData;	}
+			int64		Size() const	{	return m_Size;	}
+
+			/*
+				WillNeed().
+				Asks the kernel to start reading the whole mapping into the page cache, returns right away.
+			*/
+			void	WillNeed()
+			{
+#if !defined(WIN32) && defined(MADV_WILLNEED)
+				if( m_pData )
+					madvise( (void *)m_pData, (size_t)m_Size, MADV_WILLNEED );
+#endif
+			}
+
+			/*
+				Readahead().
+				Same for a file that isn't opened yet, so a queued sheep is in the page cache by the time it plays.
+			*/
+			static void	Readahead( const std::string &_path )
+			{
+#ifndef WIN32
+				int fd = open( _path.c_str(), O_RDONLY );
+				if( fd < 0 )
+					return;
+
+#if defined(MAC) && defined(F_RDADVISE)
+				struct stat fs;
+				if( fstat( fd, &fs ) == 0 && fs.st_size > 0 )
+				{
+					struct radvisory ra;
+					ra.ra_offset = 0;
+					ra.ra_count = ( fs.st_size > 0x7fffffff ) ? 0x7fffffff : (int)fs.st_size;
+					fcntl( fd, F_RDADVISE, &ra );
+				}
+#elif defined(POSIX_FADV_WILLNEED)
+				posix_fadvise( fd, 0, 0, POSIX_FADV_WILLNEED );
+#endif
+				close( fd );
+#else
+				(void)_path;
+#endif
+			}
+};
+
+}
+
+#endif
@@ -0,0 +1,377 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//    electricsheep for windows - collaborative screensaver
+//    Copyright 2003 Nicholas Long <nlong@cox.net>
+//	  electricsheep for windows is based of software
+//	  written by Scott Draves <source@electricsheep.org>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+///////////////////////////////////////////////////////////////////////////////
+#ifndef	_PROBECACHE_H_
+#define	_PROBECACHE_H_
+
+#include	<map>
+#include	<string>
+#include	<vector>
+#include	<sstream>
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<sys/stat.h>
+#include	"base.h"
+#include	"Log.h"
+#include	"Singleton.h"
+#include	"boost/thread/mutex.hpp"
+
+extern "C"{
+	#include "libavcodec/avcodec.h"
+	#include "libavutil/pixdesc.h"
+}
+
+namespace ContentDecoder
+{
+
+//	Entries beyond this that weren't used since startup are dropped when saving.
+#define	kMaxProbeEntries	4096
+
+/*
+	sProbeInfo.
+	What avformat_find_stream_info() found out about a sheep, plus what only a full playback tells.
+*/
+struct	sProbeInfo
+{
+	sProbeInfo() : m_Size( 0 ), m_MTime( 0 ), m_StreamIndex( -1 ), m_CodecTag( 0 ), m_Width( 0 ), m_Height( 0 ),
+					m_TimeBaseNum( 0 ), m_TimeBaseDen( 1 ), m_FrameRateNum( 0 ), m_FrameRateDen( 1 ), m_FrameCount( 0 ), m_bExactCount( false ), m_bUsed( false )	{}
+
+	//	Key, besides the path.
+	uint64		m_Size;
+	int64		m_MTime;
+
+	std::string	m_Format;		//	Demuxer short name.
+	int32		m_StreamIndex;
+	std::string	m_Codec;		//	avcodec_get_name().
+	uint32		m_CodecTag;
+	int32		m_Width;
+	int32		m_Height;
+	std::string	m_PixelFormat;	//	av_get_pix_fmt_name().
+	int32		m_TimeBaseNum;
+	int32		m_TimeBaseDen;
+	int32		m_FrameRateNum;
+	int32		m_FrameRateDen;
+	std::vector<uint8>	m_Extradata;
+
+	//	Frame count, exact once the sheep was played through.
+	uint32		m_FrameCount;
+	bool		m_bExactCount;
+
+	bool		m_bUsed;
+
+	//	Same entry, whether it was used or not.
+	bool	operator==( const sProbeInfo &_b ) const
+	{
+		return m_Size == _b.m_Size && m_MTime == _b.m_MTime && m_Format == _b.m_Format && m_StreamIndex == _b.m_StreamIndex &&
+				m_Codec == _b.m_Codec && m_CodecTag == _b.m_CodecTag && m_Width == _b.m_Width && m_Height == _b.m_Height &&
+				m_PixelFormat == _b.m_PixelFormat && m_TimeBaseNum == _b.m_TimeBaseNum && m_TimeBaseDen == _b.m_TimeBaseDen &&
+				m_FrameRateNum == _b.m_FrameRateNum && m_FrameRateDen == _b.m_FrameRateDen && m_Extradata == _b.m_Extradata &&
+				m_FrameCount == _b.m_FrameCount && m_bExactCount == _b.m_bExactCount;
+	}
+};
+
+/*
+	CProbeCache.
+	Persistent per sheep stream parameters, keyed on path, size and modification time, so opening a known sheep skips probing.
+	Opens happen on the decoder and the prefetch thread, hence the lock.
+*/
+class	CProbeCache : public Base::CSingleton<CProbeCache>
+{
+	friend class Base::CSingleton<CProbeCache>;
+
+	typedef	std::map<std::string, sProbeInfo>	ProbeMap;
+
+	boost::mutex	m_Lock;
+
+	ProbeMap	m_Entries;
+	std::string	m_File;
+	bool		m_bLoaded;
+	bool		m_bDirty;
+
+	uint64	m_Hits;
+	uint64	m_Misses;
+
+	CProbeCache() : m_bLoaded( false ), m_bDirty( false ), m_Hits( 0 ), m_Misses( 0 )	{};
+
+	static bool	Stat( const std::string &_path, uint64 &_size, int64 &_mtime )
+	{
+		struct stat fs;
+		if( ::stat( _path.c_str(), &fs ) != 0 )
+			return false;
+
+		_size = (uint64)fs.st_size;
+		_mtime = (int64)fs.st_mtime;
+		return true;
+	}
+
+	static std::string	Hex( const std::vector<uint8> &_data )
+	{
+		static const char digits[] = "0123456789abcdef";
+		std::string s;
+		s.reserve( _data.size() * 2 );
+		for( size_t i=0; i<_data.size(); i++ )
+		{
+			s += digits[ _data[i] >> 4 ];
+			s += digits[ _data[i] & 15 ];
+		}
+		return s.empty() ? "-" : s;
+	}
+
+	static void	Unhex( const std::string &_s, std::vector<uint8> &_data )
+	{
+		_data.clear();
+		if( _s == "-" )
+			return;
+		for( size_t i=0; i+1<_s.size(); i+=2 )
+			_data.push_back( (uint8)strtoul( _s.substr( i, 2 ).c_str(), NULL, 16 ) );
+	}
+
+	//	One tab separated line per sheep.
+	static std::string	Format( const std::string &_path, const sProbeInfo &_info )
+	{
+		std::stringstream s;
+		s << _path << "\t" << _info.m_Size << "\t" << _info.m_MTime << "\t" << _info.m_Format << "\t" << _info.m_StreamIndex << "\t"
+		  << _info.m_Codec << "\t" << _info.m_CodecTag << "\t" << _info.m_Width << "\t" << _info.m_Height << "\t" << _info.m_PixelFormat << "\t"
+		  << _info.m_TimeBaseNum << "\t" << _info.m_TimeBaseDen << "\t" << _info.m_FrameRateNum << "\t" << _info.m_FrameRateDen << "\t"
+		  << _info.m_FrameCount << "\t" << ( _info.m_bExactCount ? 1 : 0 ) << "\t" << Hex( _info.m_Extradata );
+
+		return s.str();
+	}
+
+	static bool	Parse( const std::string &_line, std::string &_path, sProbeInfo &_info )
+	{
+		std::vector<std::string> fields;
+		std::string::size_type start = 0, tab;
+		while( ( tab = _line.find( '\t', start ) ) != std::string::npos )
+		{
+			fields.push_back( _line.substr( start, tab - start ) );
+			start = tab + 1;
+		}
+		fields.push_back( _line.substr( start ) );
+
+		if( fields.size() != 17 )
+			return false;
+
+		_path = fields[0];
+		_info.m_Size = strtoull( fields[1].c_str(), NULL, 10 );
+		_info.m_MTime = strtoll( fields[2].c_str(), NULL, 10 );
+		_info.m_Format = fields[3];
+		_info.m_StreamIndex = atoi( fields[4].c_str() );
+		_info.m_Codec = fields[5];
+		_info.m_CodecTag = (uint32)strtoul( fields[6].c_str(), NULL, 10 );
+		_info.m_Width = atoi( fields[7].c_str() );
+		_info.m_Height = atoi( fields[8].c_str() );
+		_info.m_PixelFormat = fields[9];
+		_info.m_TimeBaseNum = atoi( fields[10].c_str() );
+		_info.m_TimeBaseDen = atoi( fields[11].c_str() );
+		_info.m_FrameRateNum = atoi( fields[12].c_str() );
+		_info.m_FrameRateDen = atoi( fields[13].c_str() );
+		_info.m_FrameCount = (uint32)strtoul( fields[14].c_str(), NULL, 10 );
+		_info.m_bExactCount = fields[15] == "1";
+		Unhex( fields[16], _info.m_Extradata );
+
+		return _info.m_StreamIndex >= 0 && !_info.m_Format.empty() && !_info.m_Codec.empty();
+	}
+
+	public:
+			virtual ~CProbeCache()
+			{
+				SingletonActive( false );
+			}
+
+			bool	Shutdown( void )	{	Save();	return true;	}
+			const char *Description()	{	return "Probe cache";	}
+
+			/*
+				Load().
+				Reads the cache from _file once, later calls with the same file do nothing.
+			*/
+			void	Load( const std::string &_file )
+			{
+				boost::mutex::scoped_lock lock( m_Lock );
+
+				if( m_bLoaded && _file == m_File )
+					return;
+
+				m_File = _file;
+				m_bLoaded = true;
+				m_Entries.clear();
+
+				FILE *pFile = fopen( m_File.c_str(), "r" );
+				if( pFile == NULL )
+					return;
+
+				std::string line;
+				char buffer[ 4096 ];
+				uint32 numBad = 0;
+				while( fgets( buffer, sizeof(buffer), pFile ) )
+				{
+					line += buffer;
+					if( line.empty() || line[ line.size() - 1 ] != '\n' )
+						continue;
+
+					line.erase( line.size() - 1 );
+					std::string path;
+					sProbeInfo info;
+					if( Parse( line, path, info ) )
+						m_Entries[ path ] = info;
+					else
+						numBad++;
+					line.clear();
+				}
+				fclose( pFile );
+
+				if( numBad > 0 )
+					g_Log->Warning( "Probe cache: skipped %u bad entries in %s", numBad, m_File.c_str() );
+				g_Log->Info( "Probe cache: %u sheep from %s", (uint32)m_Entries.size(), m_File.c_str() );
+			}
+
+			/*
+				Save().
+				Writes the cache back if anything changed.
+			*/
+			bool	Save()
+			{
+				boost::mutex::scoped_lock lock( m_Lock );
+
+				if( !m_bDirty || m_File.empty() )
+					return true;
+
+				if( m_Entries.size() > kMaxProbeEntries )
+					for( ProbeMap::iterator it = m_Entries.begin(); it != m_Entries.end(); )
+					{
+						if( !it->second.m_bUsed )
+							m_Entries.erase( it++ );
+						else
+							++it;
+					}
+
+				std::string tmp = m_File + ".tmp";
+				FILE *pFile = fopen( tmp.c_str(), "w" );
+				if( pFile == NULL )
+				{
+					g_Log->Warning( "Probe cache: unable to write %s", tmp.c_str() );
+					return false;
+				}
+
+				for( ProbeMap::iterator it = m_Entries.begin(); it != m_Entries.end(); ++it )
+					fprintf( pFile, "%s\n", Format( it->first, it->second ).c_str() );
+
+				bool bOk = ( fclose( pFile ) == 0 );
+#ifdef WIN32
+				remove( m_File.c_str() );
+#endif
+				if( !bOk || rename( tmp.c_str(), m_File.c_str() ) != 0 )
+				{
+					g_Log->Warning( "Probe cache: unable to replace %s", m_File.c_str() );
+					remove( tmp.c_str() );
+					return false;
+				}
+
+				m_bDirty = false;
+				return true;
+			}
+
+			/*
+				Lookup().
+				Cached info for _path, if the file still has the size and modification time it had when it was probed.
+			*/
+			bool	Lookup( const std::string &_path, sProbeInfo &_info )
+			{
+				uint64 size;
+				int64 mtime;
+				bool bStat = Stat( _path, size, mtime );
+
+				boost::mutex::scoped_lock lock( m_Lock );
+
+				ProbeMap::iterator it = m_Entries.find( _path );
+				if( !bStat || it == m_Entries.end() || it->second.m_Size != size || it->second.m_MTime != mtime )
+				{
+					m_Misses++;
+					return false;
+				}
+
+				it->second.m_bUsed = true;
+				_info = it->second;
+				m_Hits++;
+				return true;
+			}
+
+			/*
+				Store().
+				Remembers the probe result for _path, keyed on the current size and modification time.
+			*/
+			void	Store( const std::string &_path, const sProbeInfo &_info )
+			{
+				if( _path.find_first_of( "\t\n" ) != std::string::npos )
+					return;
+
+				sProbeInfo info = _info;
+				if( !Stat( _path, info.m_Size, info.m_MTime ) )
+					return;
+				info.m_bUsed = true;
+
+				boost::mutex::scoped_lock lock( m_Lock );
+				sProbeInfo &entry = m_Entries[ _path ];
+				if( !( entry == info ) )
+					m_bDirty = true;
+				entry = info;
+			}
+
+			/*
+				StoreFrameCount().
+				Exact frame count of _path, after it was played through. Ignored if the file changed since it was probed.
+			*/
+			void	StoreFrameCount( const std::string &_path, const uint32 _frameCount )
+			{
+				uint64 size;
+				int64 mtime;
+				if( !Stat( _path, size, mtime ) )
+					return;
+
+				boost::mutex::scoped_lock lock( m_Lock );
+
+				ProbeMap::iterator it = m_Entries.find( _path );
+				if( it == m_Entries.end() || it->second.m_Size != size || it->second.m_MTime != mtime )
+					return;
+
+				if( it->second.m_bExactCount && it->second.m_FrameCount == _frameCount )
+					return;
+
+				it->second.m_FrameCount = _frameCount;
+				it->second.m_bExactCount = true;
+				m_bDirty = true;
+			}
+
+			//	Counters.
+			uint64	Hits()		{	boost::mutex::scoped_lock lock( m_Lock );	return m_Hits;		}
+			uint64	Misses()	{	boost::mutex::scoped_lock lock( m_Lock );	return m_Misses;	}
+};
+
+/*
+	Helper for singleton.
+*/
+inline CProbeCache &g_ProbeCache( void )	{	return( CProbeCache::Instance() );	}
+
+}
+
+#endif
@@ -99,7 +99,7 @@ Sheep::setURL(const char *url)
 //		Sets the URL for this sheep.
 //
 {
-	if(fURL == NULL)
+	if(fURL != NULL)
 	{
 		delete [] fURL;
 		fURL = NULL;
@@ -121,7 +121,7 @@ Sheep::setFileName(const char *filename)
 //		Sets the filename of the sheep.
 //
 {
-	if(fFileName == NULL)
+	if(fFileName != NULL)
 	{
 		delete [] fFileName;
 		fFileName = NULL;
@@ -31,9 +31,10 @@
 //#include <boost/format.hpp>
 //#include <boost/date_time/posix_time/posix_time.hpp>
 
-#include <zlib.h>
 #include <time.h>
 #include <math.h>
+#include <algorithm>
+#include "expat.h"
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -62,6 +63,7 @@
 #include "Log.h"
 #include "Timer.h"
 #include "PlayCounter.h"
+#include "DXTTranscoder.h"
 #if defined(WIN32) && defined(_MSC_VER)
 #include "../msvc/msvc_fix.h"
 #endif
@@ -73,6 +75,14 @@ using namespace std;
 using namespace boost;
 
 #define MAXBUF 1024
+
+//	Removes the pre-transcoded BC1 stream of a sheep file along with it, if there is one, and a transcode in progress.
+static void	removeDXTStream( const char *_aviName )
+{
+	std::string dxt = ContentDecoder::CDXTStream::CompanionPath( _aviName );
+	remove( dxt.c_str() );
+	remove( ( dxt + ".tmp" ).c_str() );
+}
 #define TIMEOUT 600
 static const int32 MAX_TIMEOUT = 24*60*60; // 1 day
 #define MIN_MEGABYTES 1024
@@ -86,7 +96,6 @@ static const uint32 INIT_DELAY = 60;
 int SheepDownloader::fDownloadedSheep = 0;
 uint32 SheepDownloader::fCurrentGeneration = 0;
 bool SheepDownloader::fGotList = false;
-bool SheepDownloader::fListDirty = true;
 time_t SheepDownloader::fLastListTime = 0;
 
 boost::mutex SheepDownloader::s_DownloaderMutex;
@@ -99,8 +108,22 @@ SheepDownloader::SheepDownloader()
 	fCurrentGeneration = 0;
 	m_bAborted = false;
 	fGotList = false;
-	fListDirty = true;
+	fPlayedDecayed = false;
 	updateCachedSheep();
+
+	//	The one full build of the eviction index, from here on it follows downloads, deletions and plays.
+	{
+		boost::mutex::scoped_lock lockthis( s_DownloaderMutex );
+		boost::mutex::scoped_lock lockindex( fEvictionMutex );
+		for( uint32 i=0; i<fClientFlock.size(); i++ )
+		{
+			Sheep *currentSheep = fClientFlock[i];
+			if( !currentSheep->deleted() && !currentSheep->isTemp() )
+				fEvictionIndex.Insert( currentSheep, g_PlayCounter().PlayCount( currentSheep->generation(), currentSheep->id() ) );
+		}
+	}
+	g_PlayCounter().SetPlayedHook( playedCallback, this );
+
 	deleteCached(0, 0);
 	deleteCached(0, 1);
 }
@@ -109,9 +132,51 @@ SheepDownloader::SheepDownloader()
 */
 SheepDownloader::~SheepDownloader()
 {
+	g_PlayCounter().SetPlayedHook( NULL, NULL );
 	clearFlocks();
 }
 
+/*
+	playedCallback().
+	Called from the player thread for every play, inside CPlayCounter::IncPlayCount(). Only queues it, deleteCached() applies it.
+*/
+void	SheepDownloader::playedCallback( void *data, uint32 generation, uint32 id, bool decayed )
+{
+	SheepDownloader *pThis = (SheepDownloader *)data;
+	boost::mutex::scoped_lock lockplayed( pThis->fPlayedMutex );
+
+	//	Every count was scaled down, not only this one, a refresh of all of them covers the queued plays too.
+	if( decayed || pThis->fPlayedDecayed )
+	{
+		pThis->fPlayedDecayed = true;
+		pThis->fPlayed.clear();
+	}
+	else
+		pThis->fPlayed.push_back( CSheepIndex::Key( generation, id ) );
+}
+
+/*
+	applyPlayed().
+	Download thread, with fEvictionMutex held.
+*/
+void	SheepDownloader::applyPlayed()
+{
+	std::vector<uint64> played;
+	bool decayed;
+	{
+		boost::mutex::scoped_lock lockplayed( fPlayedMutex );
+		played.swap( fPlayed );
+		decayed = fPlayedDecayed;
+		fPlayedDecayed = false;
+	}
+
+	if( decayed )
+		fEvictionIndex.Keys( played );
+
+	for( size_t i=0; i<played.size(); i++ )
+		fEvictionIndex.Update( played[i], g_PlayCounter().PlayCount( (uint32)( played[i] >> 32 ), (uint32)played[i] ) );
+}
+
 /*
 */
 void	SheepDownloader::initializeDownloader()
@@ -149,16 +214,23 @@ void SheepDownloader::clearFlocks()
 		SAFE_DELETE( fServerFlock[i] );
 
 	fServerFlock.clear();
+	fServerIndex.Clear();
+	fDownloadQueue.Clear();
 
 	fGotList = false;
 
-	fListDirty = true;
+	//	Nothing left to refresh, the next list has to come from the server.
+	fLastListTime = 0;
 
 	//	Clear the client flock.
 	for(unsigned i = 0; i < fClientFlock.size(); i++)
 		delete fClientFlock[i];
 
 	fClientFlock.clear();
+	fClientIndex.Clear();
+
+	boost::mutex::scoped_lock lockindex( fEvictionMutex );
+	fEvictionIndex.Clear();
 }
 
 void SheepDownloader::Abort( void )
@@ -168,19 +240,36 @@ void SheepDownloader::Abort( void )
 	m_bAborted = true;
 }
 
-//	Downloads the given sheep from the server and supplies a unique name for it based on it's ids.
-bool SheepDownloader::downloadSheep( Sheep *sheep )
+//	Starts the download of the given sheep from the server into its .tmp file, it runs alongside the others on the network manager.
+//	What an earlier, interrupted download left in the .tmp file isn't downloaded again.
+Network::spCFileStreamer SheepDownloader::startDownload( Sheep *sheep )
 {
 	if( sheep->downloaded() )
-		return false;
+		return NULL;
 
 	char tmp[32];
 	//	To identify transfer.
 	snprintf( tmp, 32, "Sheep #%d.%05d", sheep->generation(), sheep->id() );
 
-	Network::spCFileDownloader spDownload = new Network::CFileDownloader( tmp );
+	char filename[ MAXBUF ];
+	snprintf( filename, MAXBUF, "%s%05d=%05d=%05d=%05d.avi.tmp", Shepherd::mpegPath(), sheep->generation(), sheep->id(), sheep->firstId(), sheep->lastId() );
+
+	Network::spCFileStreamer spDownload = new Network::CFileStreamer( tmp );
+	if( !spDownload->Open( filename, sheep->fileSize() ) )
+		return NULL;
 
-	bool dlded = spDownload->Perform( sheep->URL() );
+	spDownload->Start( sheep->URL() );
+
+	return spDownload;
+}
+
+//	Finishes the download of the given sheep and supplies a unique name for it based on it's ids.
+bool SheepDownloader::downloadSheep( Sheep *sheep, Network::spCFileStreamer spDownload )
+{
+	if( spDownload == NULL )
+		return false;
+
+	bool dlded = spDownload->Finish();
 
 	{
 		boost::mutex::scoped_lock lockthis( m_AbortMutex );
@@ -199,257 +288,330 @@ bool SheepDownloader::downloadSheep( Sheep *sheep )
 		return false;
 	}
 
-	if (sheep->fileSize() != spDownload->Data().size())
+	if (sheep->fileSize() != spDownload->Size())
 	{
 		g_Log->Warning( "Failed to download %s - file size mismatch.\n", sheep->URL() );
 		return false;
 	}
-	//	Save file.
+	//	The .tmp file is complete, give it its real name.
 	char filename[ MAXBUF ];
     snprintf( filename, MAXBUF, "%s%05d=%05d=%05d=%05d.avi", Shepherd::mpegPath(), sheep->generation(), sheep->id(), sheep->firstId(), sheep->lastId() );
-    if( !spDownload->Save( filename ) )
+    std::string tmpname = std::string( filename ) + ".tmp";
+    if( rename( tmpname.c_str(), filename ) != 0 )
     {
     	g_Log->Error( "Unable to save %s\n", filename );
+    	remove( tmpname.c_str() );
     	return false;
     }
 
+	//	In the cache now, it can be evicted like the rest. It is as old as its file, like the sheep read from disk.
+	{
+		Sheep cached( *sheep );
+		struct stat sbuf;
+		if( stat( filename, &sbuf ) == 0 )
+			cached.setFileWriteTime( sbuf.st_mtime );
+
+		boost::mutex::scoped_lock lockindex( fEvictionMutex );
+		fEvictionIndex.Insert( &cached, g_PlayCounter().PlayCount( sheep->generation(), sheep->id() ) );
+	}
+
+	//	Transcode it to BC1 frames while it waits to be played.
+	if( g_Settings()->Get( "settings.player.DXTFrames", false ) )
+		ContentDecoder::g_DXTTranscoder().Queue( filename );
+
     return true;
 }
 
-#if 1//DASVO_TEST
-//
-void SheepDownloader::handleListElement(TiXmlElement* listElement)
+/*
+	CSheepListParser.
+	Parses the sheep list with expat while it downloads and works out how it differs from the server flock.
+	The flock is only read here, from the network thread while the downloader waits for the list, parseSheepList() makes the changes once the list is complete.
+*/
+class CSheepListParser : public Network::CInflateStreamer
 {
-	int32 cur_gen = 0;
+	friend class SheepDownloader;
 
-	listElement->QueryIntAttribute("gen", &cur_gen);
+	XML_Parser	m_Parser;
 
-	if (cur_gen <= 0 )
-    {
-		cur_gen = 0;
-        g_Log->Error( "generation must be positive.\n" );
-    }
+	//	The server flock as it was before this list.
+	const CSheepIndex	&m_Index;
+
+	//	Scratch sheep for the element being parsed.
+	Sheep		m_Parsed;
 
-	setCurrentGeneration( static_cast<uint32>(cur_gen) );
+	uint32		m_Generation;
+	uint32		m_NumEntries;
+	bool		m_bInMessage;
+	std::string	m_Text;
 
-	TiXmlElement* pChildNode;
-	for ( pChildNode = listElement->FirstChildElement(); pChildNode; pChildNode = pChildNode->NextSiblingElement() )
+	//	The delta. New sheep, flock sheep with their new values, and every flock sheep still on the list.
+	SheepArray	m_Added;
+	std::vector< std::pair<Sheep *, Sheep *> >	m_Changed;
+	std::vector<Sheep *>	m_Listed;
+
+	//	Expunged sheep and their files, and what the server had to say.
+	std::vector< std::pair<uint64, std::string> >	m_Expunged;
+	std::vector<std::string>	m_Messages;
+	std::vector<std::string>	m_Errors;
+
+	static bool	Differs( const Sheep *_pA, const Sheep *_pB )
 	{
-		const char* name = pChildNode->Value();
+		if( _pA->fileWriteTime() != _pB->fileWriteTime() || _pA->fileSize() != _pB->fileSize() || _pA->rating() != _pB->rating() ||
+			_pA->firstId() != _pB->firstId() || _pA->lastId() != _pB->lastId() )
+			return true;
 
-		if( !strcmp( "sheep", name ) )
+		if( _pA->URL() == NULL || _pB->URL() == NULL )
+			return _pA->URL() != _pB->URL();
+
+		return strcmp( _pA->URL(), _pB->URL() ) != 0;
+	}
+
+	void	sheepElement( const char **atts )
+	{
+		if( 0 == m_Generation )
+			g_Log->Error( "malformed list, received sheep without generation set.\n" );
+
+		m_Parsed.setGeneration( m_Generation );
+		m_Parsed.setId( 0 );
+		m_Parsed.setType( 0 );
+		m_Parsed.setFileWriteTime( 0 );
+		m_Parsed.setFileSize( 0 );
+		m_Parsed.setRating( 0 );
+		m_Parsed.setFirstId( 0 );
+		m_Parsed.setLastId( 0 );
+		m_Parsed.setURL( NULL );
+
+		const char *state = NULL;
+		for( int i=0; atts[i]; i += 2 )
 		{
-			const char *state = NULL;
-			if( 0 == currentGeneration() )
-				g_Log->Error( "malformed list, received sheep without generation set.\n" );
-
-			//	Create a new sheep and parse the attributes.
-			Sheep *newSheep = new Sheep();
-			newSheep->setGeneration( currentGeneration() );
-
-			const char *a;
-			if ((a = pChildNode->Attribute("id")))		newSheep->setId(static_cast<uint32>(atoi(a)));
-			if ((a = pChildNode->Attribute("type")))		newSheep->setType(atoi(a));
-			if ((a = pChildNode->Attribute("time")))		newSheep->setFileWriteTime(atoi(a));
-			if ((a = pChildNode->Attribute("size")))		newSheep->setFileSize(static_cast<uint64>(atol(a)));
-			if ((a = pChildNode->Attribute("rating")))	newSheep->setRating(atoi(a));
-			if ((a = pChildNode->Attribute("first")))		newSheep->setFirstId(static_cast<uint32>(atoi(a)));
-			if ((a = pChildNode->Attribute("last")))		newSheep->setLastId(static_cast<uint32>(atoi(a)));
-			if ((a = pChildNode->Attribute("state")))		state = a;
-			if ((a = pChildNode->Attribute("url")))		newSheep->setURL(a);
-			
-            // TODO: fix malformed state, potential error
-			if (state != NULL)
-            {
-                if( !strcmp(state, "done") && (0 == newSheep->type()) )
-                    fServerFlock.push_back(newSheep);
-                else
-                {
-                    if( !strcmp( state, "expunge" ) )
-                    {
-                        char buf[ MAXBUF ];
-                        sprintf(buf, "%s%05d=%05d=%05d=%05d.avi", Shepherd::mpegPath(), newSheep->generation(), newSheep->id(), newSheep->firstId(), newSheep->lastId() );
-                        remove( buf );
-                    }
-
-                    SAFE_DELETE( newSheep );
-                }
-            }
+			const char *a = atts[i+1];
+			if (!strcmp(atts[i], "id"))				m_Parsed.setId(static_cast<uint32>(atoi(a)));
+			else if (!strcmp(atts[i], "type"))		m_Parsed.setType(atoi(a));
+			else if (!strcmp(atts[i], "time"))		m_Parsed.setFileWriteTime(atoi(a));
+			else if (!strcmp(atts[i], "size"))		m_Parsed.setFileSize(static_cast<uint64>(atol(a)));
+			else if (!strcmp(atts[i], "rating"))	m_Parsed.setRating(atoi(a));
+			else if (!strcmp(atts[i], "first"))		m_Parsed.setFirstId(static_cast<uint32>(atoi(a)));
+			else if (!strcmp(atts[i], "last"))		m_Parsed.setLastId(static_cast<uint32>(atoi(a)));
+			else if (!strcmp(atts[i], "state"))		state = a;
+			else if (!strcmp(atts[i], "url"))		m_Parsed.setURL(a);
 		}
-		else if( !strcmp( "message", name ) )
-		{
-			setHasMessage( true );
 
-			const char *txt = pChildNode->GetText();
-			if (txt)
-				Shepherd::addMessageText( txt, strlen(txt), 30 );
+		if( state == NULL )
+			return;
 
+		if( !strcmp( state, "done" ) && ( 0 == m_Parsed.type() ) )
+		{
+			Sheep *pSheep = m_Index.Find( m_Parsed.generation(), m_Parsed.id() );
+			if( pSheep == NULL )
+				m_Added.push_back( new Sheep( m_Parsed ) );
+			else
+			{
+				m_Listed.push_back( pSheep );
+				if( Differs( pSheep, &m_Parsed ) )
+					m_Changed.push_back( std::make_pair( pSheep, new Sheep( m_Parsed ) ) );
+			}
 		}
-		else if( !strcmp( "error", name ) )
+		else if( !strcmp( state, "expunge" ) )
 		{
-			char server_error_type[ MAXBUF ];
+			char buf[ MAXBUF ];
+			snprintf( buf, MAXBUF, "%s%05d=%05d=%05d=%05d.avi", Shepherd::mpegPath(), m_Parsed.generation(), m_Parsed.id(), m_Parsed.firstId(), m_Parsed.lastId() );
+			m_Expunged.push_back( std::make_pair( CSheepIndex::Key( m_Parsed.generation(), m_Parsed.id() ), std::string( buf ) ) );
+		}
+	}
 
-			const char *a = pChildNode->Attribute("type");
+	static void XMLCALL	startElement( void *userData, const char *name, const char **atts )
+	{
+		CSheepListParser *pList = (CSheepListParser *)userData;
 
-			if( a )
-			{
-				if( !strcmp( a, "unauthenticated" ) )
-					strncpy( server_error_type, "Invalid Nickname or Password", MAXBUF );
-				else
-					strncpy( server_error_type, a, MAXBUF );
+		if( !strcmp( "list", name ) )
+		{
+			for( int i=0; atts[i]; i += 2 )
+				if( !strcmp( atts[i], "gen" ) )
+					pList->m_Generation = static_cast<uint32>( std::max( atoi( atts[i+1] ), 0 ) );
 
-				Shepherd::addMessageText( server_error_type, strlen( server_error_type ), 180 ); //	3 minutes
-			}
+			if( 0 == pList->m_Generation )
+				g_Log->Error( "generation must be positive.\n" );
+
+			return;
+		}
+
+		pList->m_NumEntries++;
+
+		if( !strcmp( "sheep", name ) )
+			pList->sheepElement( atts );
+		else if( !strcmp( "message", name ) )
+		{
+			pList->m_bInMessage = true;
+			pList->m_Text.clear();
+		}
+		else if( !strcmp( "error", name ) )
+		{
+			for( int i=0; atts[i]; i += 2 )
+				if( !strcmp( atts[i], "type" ) )
+					pList->m_Errors.push_back( !strcmp( atts[i+1], "unauthenticated" ) ? "Invalid Nickname or Password" : atts[i+1] );
 		}
 	}
-}
-#else
-//
-void SheepDownloader::getEndElement(void *userData, const char *name)
-{
-	SheepDownloader *dl = (SheepDownloader *)userData;
-    if( !strcmp( "message", name ) )
-		dl->setHasMessage( false );
-}
 
-//
-void SheepDownloader::characterHandler(void *userData, const char *s, int len)
-{
-	SheepDownloader *dl = (SheepDownloader *)userData;
-    if( dl->hasMessage() )
-		Shepherd::addMessageText( s, len, 30 );
-}
+	static void XMLCALL	endElement( void *userData, const char *name )
+	{
+		CSheepListParser *pList = (CSheepListParser *)userData;
 
-//
-void SheepDownloader::listStartElement(void *userData, const char *name, const char **atts)
-{
-	SheepDownloader *dl = (SheepDownloader *)userData;
-	int i = 0;
+		if( pList->m_bInMessage && !strcmp( "message", name ) )
+		{
+			pList->m_bInMessage = false;
+			if( !pList->m_Text.empty() )
+				pList->m_Messages.push_back( pList->m_Text );
+		}
+	}
 
-    if( !strcmp( "list", name ) )
+	static void XMLCALL	characterHandler( void *userData, const char *s, int len )
 	{
-		while( atts[i] )
+		CSheepListParser *pList = (CSheepListParser *)userData;
+
+		if( pList->m_bInMessage )
+			pList->m_Text.append( s, static_cast<size_t>(len) );
+	}
+
+	protected:
+		bool	Consume( const uint8 *_pData, const size_t _len )
 		{
-			if( !strcmp( atts[i], "gen" ) )
+			if( XML_Parse( m_Parser, (const char *)_pData, (int)_len, 0 ) == XML_STATUS_ERROR )
 			{
-				dl->setCurrentGeneration( atoi( atts[i+1] ) );
-				if (dl->currentGeneration() == 0 )
-					g_Log->Error( "generation must be positive.\n" );
-
-				break;
+				g_Log->Error( "%s at line %d\n", XML_ErrorString( XML_GetErrorCode( m_Parser ) ), (int)XML_GetCurrentLineNumber( m_Parser ) );
+				return false;
 			}
-			i += 2;
-		}
-    }
-	else if( !strcmp( "sheep", name ) )
-	{
-		const char *state = NULL;
-		if( 0 == dl->currentGeneration() )
-			g_Log->Error( "malformed list, received sheep without generation set.\n" );
 
-		//	Create a new sheep and parse the attributes.
-		Sheep *newSheep = new Sheep();
-		newSheep->setGeneration( dl->currentGeneration() );
+			return true;
+		}
 
-		while( atts[i] )
+	public:
+		CSheepListParser( const CSheepIndex &_index ) : CInflateStreamer( "Sheep list" ), m_Index( _index ), m_Generation( 0 ), m_NumEntries( 0 ), m_bInMessage( false )
 		{
-			const char *a = atts[i+1];
-			if (!strcmp(atts[i], "id"))				newSheep->setId(atoi(a));
-			else if (!strcmp(atts[i], "type"))		newSheep->setType(atoi(a));
-			else if (!strcmp(atts[i], "time"))		newSheep->setFileWriteTime(atoi(a));
-			else if (!strcmp(atts[i], "size"))		newSheep->setFileSize(atol(a));
-			else if (!strcmp(atts[i], "rating"))	newSheep->setRating(atoi(a));
-			else if (!strcmp(atts[i], "first"))		newSheep->setFirstId(atoi(a));
-			else if (!strcmp(atts[i], "last"))		newSheep->setLastId(atoi(a));
-			else if (!strcmp(atts[i], "state"))		state = a;
-			else if (!strcmp(atts[i], "url"))		newSheep->setURL(a);
-			i += 2;
+			m_Parser = XML_ParserCreate( NULL );
+			XML_SetUserData( m_Parser, this );
+			XML_SetElementHandler( m_Parser, startElement, endElement );
+			XML_SetCharacterDataHandler( m_Parser, characterHandler );
+
+			m_Listed.reserve( _index.size() );
 		}
-		if( !strcmp(state, "done") && (0 == newSheep->type()) )
-            dl->fServerFlock.push_back(newSheep);
-		else
+
+		virtual ~CSheepListParser()
 		{
-			if( !strcmp( state, "expunge" ) )
-			{
-				char buf[ MAXBUF ];
-				sprintf(buf, "%s%05d=%05d=%05d=%05d.avi", Shepherd::mpegPath(), newSheep->generation(), newSheep->id(), newSheep->firstId(), newSheep->lastId() );
-				remove( buf );
-			}
+			g_NetworkManager->Cancel( this );
+
+			XML_ParserFree( m_Parser );
 
-			SAFE_DELETE( newSheep );
+			for( size_t i=0; i<m_Added.size(); i++ )
+				delete m_Added[i];
+
+			for( size_t i=0; i<m_Changed.size(); i++ )
+				delete m_Changed[i].second;
 		}
-    }
-	else if( !strcmp( "message", name ) )	dl->setHasMessage( true );
-	else if( !strcmp( "error", name ) )
-	{
-		char server_error_type[ MAXBUF ];
 
-		while( atts[i] )
+		virtual bool	Finish()
 		{
-			if( !strcmp( atts[i], "type" ) )
-			{
-				if( !strcmp( atts[i+1], "unauthenticated" ) )
-					strncpy( server_error_type, "Invalid Nickname or Password", MAXBUF );
-				else
-					strncpy( server_error_type, atts[i+1], MAXBUF );
+			if( !CInflateStreamer::Finish() )
+				return false;
 
-				Shepherd::addMessageText( server_error_type, strlen( server_error_type ), 180 ); //	3 minutes
+			//	Tells expat there is nothing more, so a list that stopped short shows.
+			if( XML_Parse( m_Parser, NULL, 0, 1 ) == XML_STATUS_ERROR )
+			{
+				g_Log->Error( "%s at line %d\n", XML_ErrorString( XML_GetErrorCode( m_Parser ) ), (int)XML_GetCurrentLineNumber( m_Parser ) );
+				return false;
 			}
 
-			i += 2;
+			return true;
 		}
-    }
-}
-#endif
+};
 
-//	Parse the sheep list and create the server sheep.
-void SheepDownloader::parseSheepList()
+/*
+	parseSheepList().
+	Brings the server flock in line with the list that came in, only the sheep that were added, dropped or changed are touched.
+*/
+void SheepDownloader::parseSheepList( CSheepListParser &_list )
 {
  	boost::mutex::scoped_lock lockthis( s_DownloaderMutex );
 
-	char pbuf[MAXBUF];
+	setCurrentGeneration( _list.m_Generation );
 
-	//	Open the file.
-	sprintf(pbuf, "%slist_%s.xml", Shepherd::xmlPath(), Shepherd::role());
+	{
+		boost::mutex::scoped_lock lockindex( fEvictionMutex );
+		for( size_t i=0; i<_list.m_Expunged.size(); i++ )
+		{
+			fEvictionIndex.Remove( _list.m_Expunged[i].first );
+			remove( _list.m_Expunged[i].second.c_str() );
+			removeDXTStream( _list.m_Expunged[i].second.c_str() );
+		}
+	}
 
-	TiXmlDocument doc(pbuf);
-	if (doc.LoadFile())
+	for( size_t i=0; i<_list.m_Messages.size(); i++ )
 	{
-		TiXmlHandle hDoc(&doc);
-		TiXmlElement* listElement;
+		setHasMessage( true );
+		Shepherd::addMessageText( _list.m_Messages[i].c_str(), _list.m_Messages[i].size(), 30 );
+	}
 
-		listElement=hDoc.FirstChild( "list" ).Element();
-		
-		//only if there is at least one child in the list, we delete the list from previous request
-		if (listElement && listElement->FirstChildElement() != NULL)
-		{
-			fGotList = false;
+	for( size_t i=0; i<_list.m_Errors.size(); i++ )
+		Shepherd::addMessageText( _list.m_Errors[i].c_str(), _list.m_Errors[i].size(), 180 ); //	3 minutes
 
-			SheepArray::iterator it = fServerFlock.begin();
-			while(it != fServerFlock.end())
-			{
-				delete *it;
-				it++;
-			}
-			fServerFlock.clear();
+	//	Only if there is at least one child in the list, the flock from the previous request is replaced.
+	if( _list.m_NumEntries == 0 )
+	{
+		g_Log->Error( "There are no sheep in the downloaded list, is that correct?!?\n" );
+		return;
+	}
 
-			handleListElement(listElement);
-		}
-		else 
+	fGotList = false;
+
+	//	Changed sheep take the new values, in place so everything pointing at them stays valid.
+	for( size_t i=0; i<_list.m_Changed.size(); i++ )
+	{
+		Sheep *pSheep = _list.m_Changed[i].first;
+		const Sheep *pNew = _list.m_Changed[i].second;
+
+		pSheep->setFileWriteTime( pNew->fileWriteTime() );
+		pSheep->setFileSize( pNew->fileSize() );
+		pSheep->setRating( pNew->rating() );
+		pSheep->setFirstId( pNew->firstId() );
+		pSheep->setLastId( pNew->lastId() );
+		pSheep->setURL( pNew->URL() );
+	}
+
+	//	Sheep that are no longer listed. Nothing to look for when all of them still are.
+	std::vector<Sheep *> &listed = _list.m_Listed;
+	std::sort( listed.begin(), listed.end() );
+	listed.erase( std::unique( listed.begin(), listed.end() ), listed.end() );
+
+	size_t removed = 0;
+	if( listed.size() != fServerFlock.size() )
+	{
+		size_t kept = 0;
+		for( size_t i=0; i<fServerFlock.size(); i++ )
 		{
-			g_Log->Error( "There are no sheep in the downloaded list, is that correct?!?\n" );
-			return;
+			if( std::binary_search( listed.begin(), listed.end(), fServerFlock[i] ) )
+				fServerFlock[ kept++ ] = fServerFlock[i];
+			else
+			{
+				fServerIndex.Erase( fServerFlock[i] );
+				delete fServerFlock[i];
+			}
 		}
+
+		removed = fServerFlock.size() - kept;
+		fServerFlock.resize( kept );
 	}
-	else
+
+	//	The flock owns the new sheep from here on.
+	for( size_t i=0; i<_list.m_Added.size(); i++ )
 	{
-		g_Log->Error( "%s at line %d\n", doc.ErrorDesc(), doc.ErrorRow() );
-		return;
+		fServerFlock.push_back( _list.m_Added[i] );
+		fServerIndex.Insert( _list.m_Added[i] );
 	}
 
-	//remove( pbuf );
+	g_Log->Info( "Sheep list: %u new, %u changed, %u gone, %u listed", (uint32)_list.m_Added.size(), (uint32)_list.m_Changed.size(), (uint32)removed, (uint32)fServerFlock.size() );
+
+	_list.m_Added.clear();
+
 	fGotList = true;
-	fListDirty = false;
 }
 
 /*
@@ -461,8 +623,13 @@ void	SheepDownloader::updateCachedSheep()
  	boost::mutex::scoped_lock lockthis( s_DownloaderMutex );
 
 	//	Get the client flock.
-	if( Shepherd::getClientFlock( &fClientFlock ) )
+	bool bGotFlock = Shepherd::getClientFlock( &fClientFlock );
+	fClientIndex.Build( fClientFlock );
+
+	if( bGotFlock )
 	{
+		boost::mutex::scoped_lock lockindex( fEvictionMutex );
+
 		//	Run through the client flock to find deleted sheep.
 		for( uint32 i=0; i<fClientFlock.size(); i++ )
 		{
@@ -472,18 +639,11 @@ void	SheepDownloader::updateCachedSheep()
 			//	Check if it is deleted.
 			if( currentSheep->deleted() && fGotList )
 			{
-				//	If it is than run through the server flock to see if it is still there.
-				uint32 j;
-				for( j=0; j<fServerFlock.size(); j++ )
-				{
-					if( fServerFlock[j]->id() == currentSheep->id() && fServerFlock[j]->generation() == currentSheep->generation() )
-						break;
-				}
-
 				//	If it was not found on the server then it is time to delete the file.
-				if( j == fServerFlock.size() )
+				if( fServerIndex.Find( currentSheep->generation(), currentSheep->id() ) == NULL )
 				{
 					g_Log->Info( "Deleting %s", currentSheep->fileName() );
+					removeDXTStream( currentSheep->fileName() );
 					if (remove( currentSheep->fileName() ) != 0)
 						g_Log->Warning( "Failed to remove %s", currentSheep->fileName());
 					else
@@ -497,32 +657,30 @@ void	SheepDownloader::updateCachedSheep()
 			}
 			else if( currentSheep->isTemp() )
 			{
-				g_Log->Info( "Deleting %s", currentSheep->fileName() );
-				if (remove( currentSheep->fileName() ) != 0)
-					g_Log->Warning( "Failed to remove %s", currentSheep->fileName());
+				//	An interrupted download, kept to be resumed as long as the server still has the same sheep.
+				if( fGotList )
+				{
+					Sheep *shp = fServerIndex.Find( currentSheep->generation(), currentSheep->id() );
+					if( shp == NULL || shp->firstId() != currentSheep->firstId() || shp->lastId() != currentSheep->lastId() )
+					{
+						g_Log->Info( "Deleting %s", currentSheep->fileName() );
+						if (remove( currentSheep->fileName() ) != 0)
+							g_Log->Warning( "Failed to remove %s", currentSheep->fileName());
+					}
+				}
 				continue;
 			}
 
+			//	Its BC1 stream may have been written since, that counts against the cache too.
+			fEvictionIndex.Resize( CSheepIndex::Key( currentSheep->generation(), currentSheep->id() ), currentSheep->fileSize() );
+
 			if (fGotList)
 			{
 				//	Update the sheep rating from the server.
-				for( uint32 j=0; j<fServerFlock.size(); j++ )
-				{
-					Sheep *shp = fServerFlock[j];
-					if( shp->id() == currentSheep->id() && shp->generation() == currentSheep->generation() )
-						if( shp->firstId() == currentSheep->firstId() )
-							if( shp->lastId() == currentSheep->lastId() )
-							{
-								currentSheep->setRating( shp->rating() );
-								break;
-							}
-				}
+				Sheep *shp = fServerIndex.Find( currentSheep->generation(), currentSheep->id() );
+				if( shp != NULL && shp->firstId() == currentSheep->firstId() && shp->lastId() == currentSheep->lastId() )
+					currentSheep->setRating( shp->rating() );
 			}
-
-			//	Should use win native call but i don't know what it is.
-			struct stat stat_buf;
-			if( -1 != stat( currentSheep->fileName(), &stat_buf ) )
-				currentSheep->setFileWriteTime( stat_buf.st_mtime );
 		}
 
 //		fRenderer->updateClientFlock( fClientFlock );
@@ -570,102 +728,68 @@ boost::uintmax_t availableBytes;
 /*
 	deleteCached().
 	This function will make sure there is enough room in the cache for any newly downloaded files.
-	If the cache is to large than the oldest and worst rated files will be deleted.
+	If the cache is to large than the oldest or the most played files will be deleted, picked off fEvictionIndex.
 */
 void	SheepDownloader::deleteCached( const uint64 &size, const int getGenerationType )
 {
-	double total;
-    time_t oldest_time; // oldest time for sheep with highest playcount
-    int highest_playcount;
-    uint32 best; // oldest sheep with highest playcount
-	time_t oldest_sheep_time; // oldest time for sheep (from whole flock)
-	uint32 oldest; // oldest sheep index
+	if( Shepherd::cacheSize(getGenerationType) == 0 )
+		return;
 
-//	updateCachedSheep();
+	boost::mutex::scoped_lock lockindex( fEvictionMutex );
 
-	if( Shepherd::cacheSize(getGenerationType) != 0 )
+	applyPlayed();
+
+	while( true )
 	{
-		while( fClientFlock.size() )
+		//	If a file is found and the cache has overflowed then start deleting.
+		uint64 key;
+		if( !fEvictionIndex.MostPlayed( getGenerationType, key ) || !cacheOverflow( (double)size + (double)fEvictionIndex.Bytes( getGenerationType ), getGenerationType ) )
 		{
-			//	Initialize some data.
-			total = size;
-			oldest_time = 0;
-			highest_playcount = 0;
-			best = 0;
-			oldest = 0;
-			oldest_sheep_time = 0;
-
-			//	Iterate the client flock to get the oldest and worst_rated file.
-			for( uint32 i=0; i<fClientFlock.size(); i++ )
-			{
-				Sheep *curSheep = fClientFlock[i];
-				//	If the file is allready deleted than skip.
-				if( curSheep->deleted() || curSheep->isTemp() || curSheep->getGenerationType() != getGenerationType )
-					continue;
+			//	Cache is ok so return.
+			return;
+		}
 
-				//	Store the file size.
-				total += curSheep->fileSize();
-				
-				if ( oldest_sheep_time == 0 || oldest_sheep_time > curSheep->fileWriteTime() )
-				{
-					oldest = i;
-					oldest_sheep_time = curSheep->fileWriteTime();
-				}
-				
-				uint16 curPlayCount = g_PlayCounter().PlayCount(curSheep->generation(), curSheep->id());
-				
-				if( oldest_time == 0 || 
-					( curPlayCount > highest_playcount) ||
-					( (curPlayCount == highest_playcount) && (curSheep->fileWriteTime() < oldest_time) )
-					)
-				{
-					//	Update this as the file to delete if necessary.
-					best = i;
-					oldest_time = curSheep->fileWriteTime();
-					highest_playcount = g_PlayCounter().PlayCount(curSheep->generation(), curSheep->id());
-				}
-			}
+		const bool bOldest = ( rand() % 2 == 0 );
+		if( bOldest )
+			fEvictionIndex.Oldest( getGenerationType, key );
 
-			//	If a file is found and the cache has overflowed then start deleting.
-			if( oldest_time && cacheOverflow( total, getGenerationType ) )
-			{
-				if (rand() % 2 == 0)
-				{
-					best = oldest;
-					oldest_time = oldest_sheep_time;
-					g_Log->Info("Deleting oldest sheep");
-				} else
-					g_Log->Info("Deleting most played sheep");
-
-				std::string filename(fClientFlock[ best ]->fileName());
-				if (filename.find_last_of("/\\") != filename.npos)
-					filename.erase( filename.begin(), filename.begin() + static_cast<std::string::difference_type>(filename.find_last_of("/\\")) + 1);
-
-				uint16 playcount = g_PlayCounter().PlayCount( fClientFlock[ best ]->generation(), fClientFlock[ best ]->id() ) - 1;
-				std::stringstream temp;
-				std::string temptime = ctime( &oldest_time );
-				temptime.erase(temptime.size() - 1);
-				
-				temp << "Deleted: " << filename << ", played:" << playcount << " time" <<  ((playcount == 1) ? "," : "s,") << temptime;
-				Shepherd::AddOverflowMessage( temp.str() );
-				g_Log->Info("%s", temp.str().c_str());
-				deleteSheep( fClientFlock[ best ] );
-			}
-			else
-			{
-				//	Cache is ok so return.
-				return;
-			}
+		//	Removed behind the downloader's back since it was indexed.
+		Sheep *best = fClientIndex.Find( key );
+		if( best == NULL || best->deleted() )
+		{
+			fEvictionIndex.Remove( key );
+			continue;
 		}
-    }
+
+		g_Log->Info( bOldest ? "Deleting oldest sheep" : "Deleting most played sheep" );
+
+		std::string filename(best->fileName());
+		if (filename.find_last_of("/\\") != filename.npos)
+			filename.erase( filename.begin(), filename.begin() + static_cast<std::string::difference_type>(filename.find_last_of("/\\")) + 1);
+
+		uint16 playcount = g_PlayCounter().PlayCount( best->generation(), best->id() ) - 1;
+		time_t writeTime = best->fileWriteTime();
+		std::stringstream temp;
+		std::string temptime = ctime( &writeTime );
+		temptime.erase(temptime.size() - 1);
+
+		temp << "Deleted: " << filename << ", played:" << playcount << " time" <<  ((playcount == 1) ? "," : "s,") << temptime;
+		Shepherd::AddOverflowMessage( temp.str() );
+		Shepherd::addEvictedSheep( bOldest, best->fileSize() );
+		g_Log->Info("%s", temp.str().c_str());
+		deleteSheep( best );
+	}
 }
 
 /*
 	deleteSheep().
-
+	The caller holds fEvictionMutex.
 */
 void	SheepDownloader::deleteSheep( Sheep *sheep )
 {
+	fEvictionIndex.Remove( CSheepIndex::Key( sheep->generation(), sheep->id() ) );
+
+	removeDXTStream( sheep->fileName() );
 	if (remove( sheep->fileName() ) != 0)
 		g_Log->Warning( "Failed to remove %s", sheep->fileName());
 	else
@@ -712,6 +836,8 @@ void	SheepDownloader::deleteSheep( Sheep *sheep )
 */
 void	SheepDownloader::deleteSheepId( uint32 sheepId )
 {
+	boost::mutex::scoped_lock lockindex( fEvictionMutex );
+
 	for( uint32 i=0; i<fClientFlock.size(); i++ )
 	{
 		Sheep *curSheep = fClientFlock[i];
@@ -754,12 +880,8 @@ bool SheepDownloader::isFolderAccessible( const char *folder )
 */
 void	SheepDownloader::findSheepToDownload()
 {
-	int best_rating;
-	time_t best_ctime;
     int best_anim;
-	int best_rating_old;
 	int best_anim_old;
-	time_t best_ctime_old;
 
 	try {
 #ifndef	DEBUG
@@ -835,8 +957,6 @@ void	SheepDownloader::findSheepToDownload()
 			{
 				best_anim_old = -1;
 				std::string best_anim_old_url;
-				best_ctime_old = 0;
-				best_rating_old = INT_MAX;
 
 				//	Reset the generation number.
 				setCurrentGeneration( 0 );
@@ -845,94 +965,102 @@ void	SheepDownloader::findSheepToDownload()
 				if( getSheepList() )
 				{
 					Shepherd::setDownloadState("Searching for sheep to download...");
-					
-					if (fListDirty)
-					{
-						//clearFlocks();
-						parseSheepList();
-					}
-					else 
+
+					//	Every sheep on the list is tried at most once per pass, best first.
 					{
-						fGotList = true;
+						boost::mutex::scoped_lock lockthis( s_DownloaderMutex );
+						fDownloadQueue.Build( fServerFlock );
 					}
 
+					size_t downloadedcount = 0;
+					bool bCounted = false;
+
+					//	How many sheep are fetched at once, they share the connections of the network manager.
+					const size_t parallel = (size_t)Base::Math::Clamped( g_Settings()->Get( "settings.content.parallel_downloads", 2 ), 1, 8 );
+
+					//	Sheep being fetched, a slot is refilled as soon as any of them is done, so no connection waits on a slow one.
+					std::vector<uint32> active;
+					std::vector<Network::spCFileStreamer> downloads;
+					uint64 activeBytes[ 2 ] = { 0, 0 };
+
 					do
 					{
-						best_rating = INT_MIN;
-						best_ctime = 0;
 						best_anim = -1;
 
 						updateCachedSheep();
 
 						boost::mutex::scoped_lock lockthis( s_DownloaderMutex );
 
-						unsigned int i;
-						unsigned int j;
-						
-						size_t downloadedcount = 0;
-						for( i=0; i<fServerFlock.size(); i++ )
+						//	Count what is already in the cache once, after that only this loop adds to it.
+						if( !bCounted )
 						{
-							//	Iterate the client flock to see if it allready exists in the cache.
-							for( j=0; j<fClientFlock.size(); j++ )
-							{
-								if( (fServerFlock[i]->id() == fClientFlock[j]->id()) && (fServerFlock[i]->generation() == fClientFlock[j]->generation()) )
-								{
+							for( size_t i=0; i<fServerFlock.size(); i++ )
+								if( fClientIndex.Contains( fServerFlock[i] ) )
 									downloadedcount++;
-									break;
-								}
-							}
+
+							bCounted = true;
 						}
-						//	Iterate the server flock to find the next sheep to download.
-						for( i=0; i<fServerFlock.size(); i++ )
+
+						//	Next best sheep that aren't in the cache yet and fit in it, until the free slots are taken.
+						uint32 next;
+						while( active.size() < parallel && fDownloadQueue.Pop( next ) )
 						{
-							//	Iterate the client flock to see if it allready exists in the cache.
-							for( j=0; j<fClientFlock.size(); j++ )
-							{
-								if( (fServerFlock[i]->id() == fClientFlock[j]->id()) && (fServerFlock[i]->generation() == fClientFlock[j]->generation()) )
-									break;
-							}
+							Sheep *candidate = fServerFlock[ next ];
+							if( fClientIndex.Contains( candidate ) || cacheOverflow( (double)candidate->fileSize(), candidate->getGenerationType() ) )
+								continue;
 
-							//	If it is not found and the cache is ok to store than check if the file should be downloaded based on rating and server file write time.
-							if( (j == fClientFlock.size()) && !cacheOverflow((double)fServerFlock[i]->fileSize(), fServerFlock[i]->getGenerationType()) )
+							//	Room is made for everything being fetched, a sheep that doesn't fit in with the others waits for a slot to free up.
+							const int type = candidate->getGenerationType();
+							if( !active.empty() && cacheOverflow( (double)( activeBytes[ type ] + candidate->fileSize() ), type ) )
 							{
-								//	Check if it is the best file to download.
-								if( (best_ctime == 0 && best_ctime_old == 0) ||
-									(fServerFlock[i]->rating() > best_rating && fServerFlock[i]->rating() <= best_rating_old) ||
-									(fServerFlock[i]->rating() == best_rating && fServerFlock[i]->fileWriteTime() < best_ctime ) )
-									{
-										if ( fServerFlock[i]->rating() != best_rating_old ||
-											(fServerFlock[i]->rating() == best_rating_old  && fServerFlock[i]->fileWriteTime() > best_ctime_old) )
-										{
-											best_rating = fServerFlock[i]->rating();
-											best_ctime = fServerFlock[i]->fileWriteTime();
-											best_anim = static_cast<int>(i);
-										}
-									}
+								fDownloadQueue.Push( candidate, next );
+								break;
 							}
+
+							deleteCached( activeBytes[ type ] + candidate->fileSize(), type );
+
+							time_t writeTime = candidate->fileWriteTime();
+							g_Log->Info( "Best sheep to download rating=%d, fServerFlock index=%u, write time=%s", candidate->rating(), next, ctime(&writeTime) );
+
+							active.push_back( next );
+							activeBytes[ type ] += candidate->fileSize();
+							downloads.push_back( startDownload( candidate ) );
 						}
 
-						//	Found a valid sheep so download it.
-						if( best_anim != -1 )
+						//	Found valid sheep so download them.
+						if( !active.empty() )
 						{
-							best_ctime_old = best_ctime;
-							best_rating_old = best_rating;
-							//	Make enough room in the cache for it.
-							deleteCached( fServerFlock[ static_cast<size_t>(best_anim) ]->fileSize(), fServerFlock[ static_cast<size_t>(best_anim) ]->getGenerationType() );
+							best_anim = static_cast<int>(active[0]);
 
 							std::stringstream downloadingsheepstr;
-							downloadingsheepstr << "Downloading sheep " << downloadedcount+1 << "/" << fServerFlock.size() << "...\n";
-							Shepherd::setDownloadState(downloadingsheepstr.str() + fServerFlock[ static_cast<size_t>(best_anim) ]->URL());
-						
-							g_Log->Info( "Best sheep to download rating=%d, fServerFlock index=%d, write time=%s", best_rating, best_anim, ctime(&best_ctime) );
-							if( downloadSheep( fServerFlock[ static_cast<size_t>(best_anim) ] ) )
+							downloadingsheepstr << "Downloading sheep " << downloadedcount+1;
+							if( active.size() > 1 )
+								downloadingsheepstr << "-" << downloadedcount+active.size();
+							downloadingsheepstr << "/" << fServerFlock.size() << "...\n";
+							Shepherd::setDownloadState(downloadingsheepstr.str() + fServerFlock[ active[0] ]->URL());
+
+							//	Whichever is done first.
+							std::vector<Network::CCurlTransfer *> transfers;
+							for( size_t b=0; b<downloads.size(); b++ )
+								transfers.push_back( downloads[b] );
+
+							const size_t done = g_NetworkManager->WaitAny( transfers );
+							Sheep *sheep = fServerFlock[ active[ done ] ];
+
+							if( downloadSheep( sheep, downloads[ done ] ) )
 							{
 								//failureSleepDuration = 0;
 								badSheepSleepDuration = TIMEOUT;
+								downloadedcount++;
 							} else
 							{
-								best_anim_old = best_anim;
-								best_anim_old_url = fServerFlock[ static_cast<size_t>(best_anim_old) ]->URL();
+								best_anim_old = static_cast<int>(active[ done ]);
+								best_anim_old_url = sheep->URL();
 							}
+
+							activeBytes[ sheep->getGenerationType() ] -= sheep->fileSize();
+							active.erase( active.begin() + done );
+							downloads.erase( downloads.begin() + done );
 						}
 						boost::this_thread::interruption_point();
 					} while (best_anim != -1);
@@ -986,94 +1114,36 @@ void	SheepDownloader::findSheepToDownload()
 
 /*
 	getSheepList().
-	This method will download the sheep list and uncompress it.
+	This method will download the sheep list and bring the server flock up to date with it.
+	The list is inflated and parsed as it comes in, it never hits the disk.
 */
 bool	SheepDownloader::getSheepList()
 {
-	const char *xmlPath = Shepherd::xmlPath();
+	if( fLastListTime != 0 && time(0) - fLastListTime < MIN_READ_INTERVAL )
+		return true;
 
-	char filename[ MAX_PATH ];
-    snprintf( filename, MAX_PATH, "%slist_%s.xml", xmlPath, Shepherd::role() );
-
-	struct stat stat_buf;
-	if( -1 != stat( filename, &stat_buf) )
-	{
-		if( time(0) - stat_buf.st_mtime < MIN_READ_INTERVAL )
-			return true;
-	}
-	
 	Shepherd::setDownloadState("Getting sheep list...");
 
-    snprintf( filename, MAX_PATH, "%slist.gzip", xmlPath );
-
 	//	Create the url for getting the cp file to create the frame
 	char 	url[ MAXBUF*5 ];
     snprintf( url, MAXBUF*5, "%scgi/list?v=%s&u=%s",	ContentDownloader::Shepherd::serverName(),
 																CLIENT_VERSION,
 																Shepherd::uniqueID() );
 
-	Network::spCFileDownloader spDownload = new Network::CFileDownloader( "Sheep list" );
-	if( !spDownload->Perform( url ) )
+	CSheepListParser list( fServerIndex );
+	if( !list.Perform( url ) )
 	{
-		if( spDownload->ResponseCode() == 304 )	//	"Not Modified"
-			return true;
-
-		if( spDownload->ResponseCode() == 401 )
+		if( list.ResponseCode() == 401 )
 			g_ContentDownloader().ServerFallback();
 
 		g_Log->Error( "Failed to download %s.\n", url );
 		return false;
 	}
 
-	//	Save the data to file.
-    if( !spDownload->Save( filename ) )
-    {
-    	g_Log->Error( "Unable to save %s\n", filename );
-    	return false;
-    }
-
-	//	Save file time.
+	//	Save list time.
 	time( &fLastListTime );
 
-	//	Open the file to write the uncompressed xml data.
-	snprintf( filename, MAX_PATH, "%slist_%s.xml", xmlPath, Shepherd::role() );
-	FILE *outXML = fopen( filename, "wb" );
-	if( outXML == NULL )
-		return false;
-
-	//	Reset the current generation
-	//setCurrentGeneration( 0 );
-
-	//	Gzopen the compressed file to uncompress.
-	snprintf( filename, MAX_PATH, "%slist.gzip", xmlPath );
-	gzFile gzinF = gzopen( filename, "rb" );
-	if( gzinF == NULL )
-	{
-		g_Log->Error( "Unable to open %s", filename );
-		fclose( outXML );
-		return false;
-	}
-
-	//	Uncompress the data.
-	char	buf[ MAXBUF ];
-	int numBytes = 0;
-	do
-	{
-		numBytes = gzread( gzinF, buf, 250 );
-		if (numBytes <= 0)
-            break;
-		fwrite( buf, static_cast<size_t>(numBytes), 1, outXML );
-	} while( !gzeof( gzinF ) );
-
-	//	Close the input and output file.
-	gzclose( gzinF );
-	fclose( outXML );
-
-	fListDirty = true;
-
-	//	Delete the temp file with the compressed data.
-	snprintf( filename, MAX_PATH, "%slist.gzip", xmlPath );
-	remove( filename );
+	parseSheepList( list );
 
 	return true;
 }
@@ -23,17 +23,14 @@
 #ifndef _SHEEPDOWNLOADER_H_
 #define _SHEEPDOWNLOADER_H_
 
-#if 1//DASVO_TEST
-#include "tinyxml.h"
-#else
-#include "expat.h"
-#endif
 #include "Sheep.h"
+#include "SheepIndex.h"
 #include "Networking.h"
 
 namespace ContentDownloader
 {
 class SheepRenderer;
+class CSheepListParser;
 
 /*
 
@@ -47,6 +44,24 @@ class SheepDownloader
 	// sheep flocks
 	SheepArray fServerFlock;
 	SheepArray fClientFlock;
+
+	//	Lookups by generation and id into the flocks above, rebuilt along with them.
+	CSheepIndex fServerIndex;
+	CSheepIndex fClientIndex;
+
+	//	Server sheep not tried yet in the current pass over the list.
+	CDownloadQueue fDownloadQueue;
+
+	//	Client sheep in the order deleteCached() evicts them, built with the downloader and kept up to date after that.
+	CEvictionIndex fEvictionIndex;
+	boost::mutex fEvictionMutex;
+
+	//	Plays reported by the player thread, applied to fEvictionIndex by deleteCached(), so the player never waits for an eviction.
+	//	fPlayedDecayed means every count changed and the whole index is refreshed instead.
+	std::vector<uint64> fPlayed;
+	bool fPlayedDecayed;
+	boost::mutex fPlayedMutex;
+
 	SheepRenderer *fRenderer;
 
 	// boolean for message checks
@@ -63,8 +78,11 @@ class SheepDownloader
 	
 	protected:
 
-		//	Downloads the given sheep and queues it up for rendering.
-		bool downloadSheep( Sheep *sheep );
+		//	Starts downloading the given sheep, NULL if it can't be.
+		Network::spCFileStreamer startDownload( Sheep *sheep );
+
+		//	Waits for the download startDownload() gave and queues the sheep up for rendering.
+		bool downloadSheep( Sheep *sheep, Network::spCFileStreamer spDownload );
 
 		//	Function to parse the cache and find a sheep to download.
 		void findSheepToDownload();
@@ -80,17 +98,8 @@ class SheepDownloader
 
 		bool isFolderAccessible( const char *folder );
 
-		//	This methods parses the sheep list and intializes the array of server sheep.
-		void parseSheepList();
-
-#if 1//DASVO_TEST
-		void handleListElement(TiXmlElement* listElement);
-#else
-		//	Functions to parse the XML structures.
-		static void listStartElement( void *userData, const char *name, const char **atts );
-		static void characterHandler( void *userData, const char *s, int len );
-		static void getEndElement( void *userData, const char *name );
-#endif
+		//	Applies the changes a freshly parsed sheep list made to the array of server sheep.
+		void parseSheepList( CSheepListParser &_list );
 
 		//	Message retrival from server.
 		void setHasMessage(const bool &hasMessage) { fHasMessage = hasMessage; }
@@ -109,9 +118,13 @@ class SheepDownloader
 
 		void deleteSheep(Sheep *sheep);
 
+		//	Queues a play for fEvictionIndex.
+		static void playedCallback( void *data, uint32 generation, uint32 id, bool decayed );
+
+		//	Moves the played sheep in fEvictionIndex, the caller holds fEvictionMutex.
+		void applyPlayed();
+
 		static bool fGotList;
-		
-		static bool fListDirty;
 
 	public:
 			SheepDownloader();
@@ -123,7 +136,7 @@ class SheepDownloader
 
 			static uint32 currentGeneration() { return fCurrentGeneration; }
 
-			static bool getSheepList();
+			bool getSheepList();
 
 
 			// add to the number of downloaded sheep (called by torrent)
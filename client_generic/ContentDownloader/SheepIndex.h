@@ -0,0 +1,361 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//    electricsheep for windows - collaborative screensaver
+//    Copyright 2003 Nicholas Long <nlong@cox.net>
+//	  electricsheep for windows is based of software
+//	  written by Scott Draves <source@electricsheep.org>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+///////////////////////////////////////////////////////////////////////////////
+#ifndef _SHEEPINDEX_H_
+#define _SHEEPINDEX_H_
+
+#include <set>
+#include <vector>
+#include <algorithm>
+#include "boost/unordered_map.hpp"
+#include "Sheep.h"
+
+namespace ContentDownloader
+{
+
+/*
+	CSheepIndex.
+	Looks up the sheep of a flock by generation and id, instead of scanning the whole flock for it.
+	It only points into the flock it was built from, so it has to be rebuilt whenever that flock is.
+*/
+class CSheepIndex
+{
+	typedef boost::unordered_map<uint64, Sheep *> IndexMap;
+	IndexMap	m_Index;
+
+	public:
+			static uint64	Key( const uint32 _generation, const uint32 _id )	{	return ((uint64)_generation << 32) | _id;	}
+
+			/*
+				Build().
+				Indexes every sheep in _flock, the first one wins if the same sheep is listed twice, like the scans did.
+				Unfinished downloads are left out, they aren't in the cache yet.
+			*/
+			void	Build( const SheepArray &_flock )
+			{
+				m_Index.clear();
+				m_Index.rehash( _flock.size() );
+
+				for( size_t i=0; i<_flock.size(); i++ )
+					if( !_flock[i]->isTemp() )
+						m_Index.insert( IndexMap::value_type( Key( _flock[i]->generation(), _flock[i]->id() ), _flock[i] ) );
+			}
+
+			void	Clear()		{	m_Index.clear();	}
+
+			//	Insert(), Erase(). Keep the index in step with a flock that changes a few sheep at a time.
+			void	Insert( Sheep *_pSheep )
+			{
+				if( !_pSheep->isTemp() )
+					m_Index.insert( IndexMap::value_type( Key( _pSheep->generation(), _pSheep->id() ), _pSheep ) );
+			}
+
+			void	Erase( const Sheep *_pSheep )
+			{
+				IndexMap::iterator it = m_Index.find( Key( _pSheep->generation(), _pSheep->id() ) );
+				if( it != m_Index.end() && it->second == _pSheep )
+					m_Index.erase( it );
+			}
+
+			Sheep	*Find( const uint32 _generation, const uint32 _id ) const	{	return Find( Key( _generation, _id ) );	}
+
+			Sheep	*Find( const uint64 _key ) const
+			{
+				IndexMap::const_iterator it = m_Index.find( _key );
+				return ( it != m_Index.end() ) ? it->second : NULL;
+			}
+
+			bool	Contains( const Sheep *_pSheep ) const	{	return m_Index.find( Key( _pSheep->generation(), _pSheep->id() ) ) != m_Index.end();	}
+
+			size_t	size() const	{	return m_Index.size();	}
+};
+
+/*
+	CDownloadQueue.
+	Max heap of server flock indices, the sheep to download first on top: highest rating, then oldest on the server, then first in the list.
+	It is built in one go for every pass over the list and each sheep comes off it once, so a sheep that failed to download isn't retried in the same pass.
+	Whether a sheep is still worth downloading is up to the caller when it comes off, the cache changes underneath between downloads.
+*/
+class CDownloadQueue
+{
+	struct sCandidate
+	{
+		int		m_Rating;
+		time_t	m_WriteTime;
+		uint32	m_Index;
+	};
+
+	//	Ordering for the std heap functions, true if _a should be downloaded after _b.
+	static bool	Later( const sCandidate &_a, const sCandidate &_b )
+	{
+		if( _a.m_Rating != _b.m_Rating )
+			return _a.m_Rating < _b.m_Rating;
+
+		if( _a.m_WriteTime != _b.m_WriteTime )
+			return _a.m_WriteTime > _b.m_WriteTime;
+
+		return _a.m_Index > _b.m_Index;
+	}
+
+	std::vector<sCandidate>	m_Heap;
+
+	public:
+			/*
+				Build().
+				Queues every sheep in _serverFlock, O(n).
+			*/
+			void	Build( const SheepArray &_serverFlock )
+			{
+				m_Heap.resize( _serverFlock.size() );
+				for( size_t i=0; i<_serverFlock.size(); i++ )
+				{
+					m_Heap[i].m_Rating = _serverFlock[i]->rating();
+					m_Heap[i].m_WriteTime = _serverFlock[i]->fileWriteTime();
+					m_Heap[i].m_Index = (uint32)i;
+				}
+
+				std::make_heap( m_Heap.begin(), m_Heap.end(), Later );
+			}
+
+			/*
+				Pop().
+				Takes the best sheep left off the queue, O(log n). False once all of them came off.
+			*/
+			bool	Pop( uint32 &_index )
+			{
+				if( m_Heap.empty() )
+					return false;
+
+				std::pop_heap( m_Heap.begin(), m_Heap.end(), Later );
+				_index = m_Heap.back().m_Index;
+				m_Heap.pop_back();
+				return true;
+			}
+
+			/*
+				Push().
+				Puts a sheep that came off back on, O(log n).
+			*/
+			void	Push( const Sheep *_pSheep, const uint32 _index )
+			{
+				sCandidate candidate;
+				candidate.m_Rating = _pSheep->rating();
+				candidate.m_WriteTime = _pSheep->fileWriteTime();
+				candidate.m_Index = _index;
+
+				m_Heap.push_back( candidate );
+				std::push_heap( m_Heap.begin(), m_Heap.end(), Later );
+			}
+
+			void	Clear()		{	m_Heap.clear();	}
+
+			size_t	size() const	{	return m_Heap.size();	}
+};
+
+/*
+	CEvictionIndex.
+	The client sheep deleteCached() chooses from, per generation type, in both orders it alternates between:
+	most played first with the oldest first among equal play counts, and oldest first.
+	Built once when the downloader starts and kept in step after that, so evicting k sheep is O(k log n) instead of a flock scan for every sheep.
+	Entries go by generation and id rather than by Sheep, the client flock is read again from disk every pass and its sheep with it.
+*/
+class CEvictionIndex
+{
+	struct sEntry
+	{
+		uint16	m_PlayCount;
+		time_t	m_WriteTime;
+		uint32	m_Order;
+		uint64	m_Key;
+	};
+
+	//	Insertion order breaks the ties, like the flock order did for the scan.
+	struct MorePlayed
+	{
+		bool	operator()( const sEntry &_a, const sEntry &_b ) const
+		{
+			if( _a.m_PlayCount != _b.m_PlayCount )
+				return _a.m_PlayCount > _b.m_PlayCount;
+
+			if( _a.m_WriteTime != _b.m_WriteTime )
+				return _a.m_WriteTime < _b.m_WriteTime;
+
+			return _a.m_Order < _b.m_Order;
+		}
+	};
+
+	struct Older
+	{
+		bool	operator()( const sEntry &_a, const sEntry &_b ) const
+		{
+			if( _a.m_WriteTime != _b.m_WriteTime )
+				return _a.m_WriteTime < _b.m_WriteTime;
+
+			return _a.m_Order < _b.m_Order;
+		}
+	};
+
+	typedef std::set<sEntry, MorePlayed>	PlayCountSet;
+	typedef std::set<sEntry, Older>			AgeSet;
+
+	PlayCountSet	m_ByPlayCount[ 2 ];
+	AgeSet			m_ByAge[ 2 ];
+
+	struct sSheep
+	{
+		sEntry	m_Entry;
+		uint64	m_Size;
+		int		m_Type;
+	};
+
+	typedef boost::unordered_map<uint64, sSheep> EntryMap;
+	EntryMap	m_Entries;
+
+	uint64	m_Bytes[ 2 ];
+	uint32	m_NextOrder;
+
+	public:
+			CEvictionIndex()
+			{
+				Clear();
+			}
+
+			void	Clear()
+			{
+				for( int i=0; i<2; i++ )
+				{
+					m_ByPlayCount[i].clear();
+					m_ByAge[i].clear();
+					m_Bytes[i] = 0;
+				}
+
+				m_Entries.clear();
+				m_NextOrder = 0;
+			}
+
+			/*
+				Insert().
+				Adds a sheep that can be evicted, O(log n). Sheep inserted later lose ties to earlier ones, a sheep that is in already stays as it is.
+			*/
+			void	Insert( const Sheep *_pSheep, const uint16 _playCount )
+			{
+				sSheep sheep;
+				sheep.m_Entry.m_PlayCount = _playCount;
+				sheep.m_Entry.m_WriteTime = _pSheep->fileWriteTime();
+				sheep.m_Entry.m_Order = m_NextOrder;
+				sheep.m_Entry.m_Key = CSheepIndex::Key( _pSheep->generation(), _pSheep->id() );
+				sheep.m_Size = _pSheep->fileSize();
+				sheep.m_Type = _pSheep->getGenerationType() ? 1 : 0;
+
+				if( !m_Entries.insert( EntryMap::value_type( sheep.m_Entry.m_Key, sheep ) ).second )
+					return;
+
+				m_NextOrder++;
+				m_ByPlayCount[ sheep.m_Type ].insert( sheep.m_Entry );
+				m_ByAge[ sheep.m_Type ].insert( sheep.m_Entry );
+				m_Bytes[ sheep.m_Type ] += sheep.m_Size;
+			}
+
+			/*
+				Remove().
+				Takes a sheep out once it is deleted, O(log n).
+			*/
+			void	Remove( const uint64 _key )
+			{
+				EntryMap::iterator it = m_Entries.find( _key );
+				if( it == m_Entries.end() )
+					return;
+
+				const int type = it->second.m_Type;
+				m_ByPlayCount[ type ].erase( it->second.m_Entry );
+				m_ByAge[ type ].erase( it->second.m_Entry );
+				m_Bytes[ type ] -= it->second.m_Size;
+				m_Entries.erase( it );
+			}
+
+			/*
+				Update().
+				New play count for a sheep, it keeps its place among equals, O(log n).
+			*/
+			void	Update( const uint64 _key, const uint16 _playCount )
+			{
+				EntryMap::iterator it = m_Entries.find( _key );
+				if( it == m_Entries.end() || it->second.m_Entry.m_PlayCount == _playCount )
+					return;
+
+				PlayCountSet &byPlayCount = m_ByPlayCount[ it->second.m_Type ];
+				byPlayCount.erase( it->second.m_Entry );
+				it->second.m_Entry.m_PlayCount = _playCount;
+				byPlayCount.insert( it->second.m_Entry );
+			}
+
+			/*
+				Resize().
+				New size for a sheep, when its BC1 stream shows up next to it. The size isn't sorted on, O(1).
+			*/
+			void	Resize( const uint64 _key, const uint64 _size )
+			{
+				EntryMap::iterator it = m_Entries.find( _key );
+				if( it == m_Entries.end() )
+					return;
+
+				m_Bytes[ it->second.m_Type ] += _size - it->second.m_Size;
+				it->second.m_Size = _size;
+			}
+
+			//	The candidates, false when there are no sheep of the type left.
+			bool	MostPlayed( const int _type, uint64 &_key ) const
+			{
+				if( m_ByPlayCount[ _type ].empty() )
+					return false;
+
+				_key = m_ByPlayCount[ _type ].begin()->m_Key;
+				return true;
+			}
+
+			bool	Oldest( const int _type, uint64 &_key ) const
+			{
+				if( m_ByAge[ _type ].empty() )
+					return false;
+
+				_key = m_ByAge[ _type ].begin()->m_Key;
+				return true;
+			}
+
+			//	Every sheep in the index, for when all the play counts changed at once.
+			void	Keys( std::vector<uint64> &_keys ) const
+			{
+				_keys.clear();
+				_keys.reserve( m_Entries.size() );
+				for( EntryMap::const_iterator it = m_Entries.begin(); it != m_Entries.end(); ++it )
+					_keys.push_back( it->first );
+			}
+
+			//	Size of all the sheep of the type, what the cache holds of it.
+			uint64	Bytes( const int _type ) const	{	return m_Bytes[ _type ];	}
+
+			size_t	size() const	{	return m_Entries.size();	}
+};
+
+};
+
+#endif
@@ -57,6 +57,9 @@ uint64 Shepherd::s_ClientFlockBytes = 0;
 uint64 Shepherd::s_ClientFlockGoldBytes = 0;
 uint64 Shepherd::s_ClientFlockCount = 0;
 uint64 Shepherd::s_ClientFlockGoldCount = 0;
+boost::atomic<uint64> Shepherd::s_EvictedOldestCount(0);
+boost::atomic<uint64> Shepherd::s_EvictedMostPlayedCount(0);
+boost::atomic<uint64> Shepherd::s_EvictedBytes(0);
 atomic_char_ptr Shepherd::fRootPath(NULL);
 atomic_char_ptr Shepherd::fMpegPath(NULL);
 atomic_char_ptr Shepherd::fXmlPath(NULL);
@@ -692,6 +695,15 @@ bool Shepherd::getSheep( const char *path, SheepArray *sheep )
 		{
 			std::string fname(itr->path().filename().string());
 
+			//	BC1 streams go with their sheep. One without is left over from a transcode that finished after the sheep was deleted.
+			std::string::size_type dxt = fname.rfind( ".dxt" );
+			if( dxt != std::string::npos && ( dxt + 4 == fname.size() || fname.compare( dxt, std::string::npos, ".dxt.tmp" ) == 0 ) )
+			{
+				if( !exists( p / ( fname.substr( 0, dxt ) + ".avi" ) ) )
+					remove(itr->path());
+				continue;
+			}
+
 			if( Shepherd::filenameIsXxx( fname.c_str() ) )
 			{
 				//	We have found an mpeg so check the filename to see if it is valid than add it
@@ -706,7 +718,7 @@ bool Shepherd::getSheep( const char *path, SheepArray *sheep )
 			}
 			else if( Shepherd::filenameIsTmp( fname.c_str() ) )
 			{
-				//	This file is an unfinished downloaded file so mark it for deletion.
+				//	This file is an unfinished download, the next download of the sheep resumes it.
 				if( 4 != sscanf( fname.c_str(), "%d=%d=%d=%d.avi.tmp", &generation, &id, &first, &last ) )
 				{
 					//	This file is from the older format so delete it from the cache.
@@ -753,9 +765,21 @@ bool Shepherd::getSheep( const char *path, SheepArray *sheep )
 			newSheep->setFileName( fbuf );
 			struct stat sbuf;
 
+			//	Modification time, the age the cache eviction goes by.
 			stat( fbuf, &sbuf );
-			newSheep->setFileWriteTime( sbuf.st_ctime );
-			newSheep->setFileSize( static_cast<uint64>(sbuf.st_size) );
+			newSheep->setFileWriteTime( sbuf.st_mtime );
+			uint64 fileSize = static_cast<uint64>(sbuf.st_size);
+
+			//	The pre-transcoded BC1 stream next to it counts against the cache as part of the sheep.
+			if( !isTemp && !isDeleted )
+			{
+				std::string dxtname( fbuf );
+				dxtname.replace( dxtname.size() - 3, 3, "dxt" );
+				if( stat( dxtname.c_str(), &sbuf ) == 0 )
+					fileSize += static_cast<uint64>(sbuf.st_size);
+			}
+
+			newSheep->setFileSize( fileSize );
 
 			//	Add it to the return array.
 			sheep->push_back( newSheep );
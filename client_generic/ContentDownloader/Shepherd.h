@@ -106,6 +106,11 @@ class Shepherd
 	static uint64 s_ClientFlockGoldBytes;
 	static uint64 s_ClientFlockGoldCount;
 
+	//	Sheep the cache evicted since startup, by the order they were picked in.
+	static boost::atomic<uint64> s_EvictedOldestCount;
+	static boost::atomic<uint64> s_EvictedMostPlayedCount;
+	static boost::atomic<uint64> s_EvictedBytes;
+
 	static atomic_char_ptr fRootPath;
 	static atomic_char_ptr fMpegPath;
 	static atomic_char_ptr fXmlPath;
@@ -387,6 +392,23 @@ class Shepherd
 					return s_ClientFlockGoldCount;
 				return 0;
 			}
+
+			static void addEvictedSheep(const bool oldest, const uint64 bytes)
+			{
+				if ( oldest )
+					++s_EvictedOldestCount;
+				else
+					++s_EvictedMostPlayedCount;
+				s_EvictedBytes += bytes;
+			}
+			static uint64 getEvictedCount(const bool oldest)
+			{
+				return oldest ? s_EvictedOldestCount.load() : s_EvictedMostPlayedCount.load();
+			}
+			static uint64 getEvictedMBs()
+			{
+				return s_EvictedBytes.load()/1024/1024;
+			}
 };
 
 };
@@ -74,6 +74,11 @@ bool	CTextureFlatDX::Upload( spCImage _spImage )
 {
 	m_spImage = _spImage;
 
+	//	Same pixels as last time, nothing to do.
+	uint64 generation = _spImage->GetGeneration();
+	if( generation != 0 && generation == m_UploadedGeneration && m_pTextureDX9 )
+		return true;
+
 	CImageFormat	format = m_spImage->GetFormat();
 
 	if( m_Size.iWidth() != (int32)_spImage->GetWidth() ||
@@ -122,6 +127,7 @@ bool	CTextureFlatDX::Upload( spCImage _spImage )
 	}
 
 	m_bDirty = true;
+	m_UploadedGeneration = generation;
 	return true;
 }
 
@@ -185,6 +185,15 @@ class	CDisplayOutput
 			void	ClearEvents();
 
 			virtual bool HasShaders() { return false; };
+
+			//	Displays answering the same non NULL group draw with contexts sharing their objects, a texture uploaded through one is there for all.
+			virtual const void	*ShareGroup()	{	return NULL;	};
+
+			//	Makes the display's context the one the calling thread draws with, where that isn't done for the renderer already.
+			virtual void	MakeCurrent()	{};
+
+			//	Lets go of the context on the calling thread, before another thread makes it current.
+			virtual void	DoneCurrent()	{};
 			uint32	Width()		
 			{	
 				return( m_Width );	    
@@ -15,7 +15,7 @@ namespace	DisplayOutput
 	CImage().
 
 */
-CImage::CImage() :  m_Format( eImage_None ), m_Width(0), m_Height(0), m_nMipMaps(0), m_bRef( false )
+CImage::CImage() :  m_Format( eImage_None ), m_Width(0), m_Height(0), m_nMipMaps(0), m_bRef( false ), m_Generation( 0 )
 {
 }
 
@@ -74,6 +74,7 @@ void	CImage::Create( const uint32 _w, const uint32 _h, const eImageFormat _forma
 	m_nMipMaps = _bMipmaps ? getNumberOfMipMapsFromDimesions() : 1;
 	m_Format = _format;
 	m_bRef = _bRef ;
+	m_Generation = 0;
 
 	if( !m_bRef )
 	{
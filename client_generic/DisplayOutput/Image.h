@@ -293,6 +293,9 @@ class	CImage	{
 
 		bool			m_bRef;
 
+		//	Identifies the content of m_spData, 0 if unknown. Lets textures skip uploading the same pixels twice.
+		uint64			m_Generation;
+
 	public:
 			CImage();
 			~CImage();
@@ -305,7 +308,8 @@ class	CImage	{
 			bool	Save( const std::string &_filename );
 			
 			Base::spCAlignedBuffer& GetStorageBuffer( void ) { return m_spData; }
-			void	SetStorageBuffer( Base::spCAlignedBuffer &buffer ) { m_spData = buffer; }
+			void	SetStorageBuffer( Base::spCAlignedBuffer &buffer, const uint64 _generation = 0 ) { m_spData = buffer; m_Generation = _generation; }
+			inline uint64	GetGeneration( void ) const { return m_Generation; }
 
 			uint8	*GetData( const uint32 _mipLevel ) const;
 			void	SetData( uint8	*_pData );
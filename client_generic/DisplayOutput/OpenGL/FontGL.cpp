@@ -3,6 +3,7 @@
 #include	"Settings.h"
 #include	<fstream>
 #include	<iostream>
+#include	<string.h>
 
 #ifdef LINUX_GNU
 #include <endian.h>
@@ -180,6 +181,85 @@ spCTextureFlat CFontGL::GetTexture( void )
 {
 	return m_spTextTexture;
 }
+
+/*
+	TextImage().
+	_text laid out like CRendererGL::Text() does it, with the glyphs copied out of the font image, one texel per pixel.
+*/
+spCImage CFontGL::TextImage( const std::string &_text )
+{
+	if( m_spTextImage == NULL )
+		return NULL;
+
+	const uint32 lineHeight = (uint32)m_lineHeight;
+	uint32 lines = 1, width = 0, x = 0;
+	for( size_t i = 0; i < _text.size(); i++ )
+	{
+		uint8 ch = static_cast<uint8>(_text[i]);
+		if( ch == '\n' )
+		{
+			lines++;
+			x = 0;
+			continue;
+		}
+
+		x += (uint32)CharWidth( ch );
+		if( x > width )
+			width = x;
+	}
+
+	if( lineHeight == 0 )
+		return NULL;
+
+	if( width == 0 )
+		width = 1;
+
+	spCImage spImage = new CImage();
+	spImage->Create( width, lines * lineHeight, eImage_RGBA8, false, false );
+
+	uint8 *pDst = spImage->GetData( 0 );
+	const uint8 *pSrc = m_spTextImage->GetData( 0 );
+	if( pDst == NULL || pSrc == NULL )
+		return NULL;
+
+	const uint32 dstPitch = spImage->GetPitch( 0 );
+	const uint32 srcPitch = m_spTextImage->GetPitch( 0 );
+	const uint32 srcWidth = m_spTextImage->GetWidth();
+	const uint32 srcHeight = m_spTextImage->GetHeight();
+
+	memset( pDst, 0, dstPitch * spImage->GetHeight() );
+
+	uint32 y = 0;
+	x = 0;
+	for( size_t i = 0; i < _text.size(); i++ )
+	{
+		uint8 ch = static_cast<uint8>(_text[i]);
+		if( ch == '\n' )
+		{
+			x = 0;
+			y += lineHeight;
+			continue;
+		}
+
+		Glyph *glyph = m_table[ch];
+		if( glyph == NULL )
+			continue;
+
+		uint32 advance = (uint32)glyph->advance;
+		uint32 srcX = (uint32)( glyph->tex_x1 * (fp4)srcWidth + 0.5f );
+		uint32 srcY = (uint32)( glyph->tex_y1 * (fp4)srcHeight + 0.5f );
+
+		uint32 copyWidth = ( srcX + advance > srcWidth ) ? srcWidth - srcX : advance;
+		uint32 copyHeight = ( srcY + lineHeight > srcHeight ) ? srcHeight - srcY : lineHeight;
+
+		for( uint32 row = 0; row < copyHeight; row++ )
+			memcpy( pDst + ( y + row ) * dstPitch + x * 4, pSrc + ( srcY + row ) * srcPitch + srcX * 4, copyWidth * 4 );
+
+		x += advance;
+	}
+
+	return spImage;
+}
 	
 void	CFontGL::Reupload()
 {
@@ -60,6 +60,8 @@ private:
 			Glyph *GetGlyph( uint8 c );
 			
 			spCTextureFlat GetTexture( void );
+
+			spCImage	TextImage( const std::string &_text );
 	
 			virtual void	Reupload();
 
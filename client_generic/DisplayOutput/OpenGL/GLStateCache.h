@@ -0,0 +1,563 @@
+#ifndef	_GLSTATECACHE_H_
+#define	_GLSTATECACHE_H_
+
+#include <stddef.h>
+#include <string.h>
+#include "base.h"
+#include "SmartPtr.h"
+#include "MathBase.h"
+#include "Renderer.h"
+#ifdef MAC
+#undef Random
+#include <OpenGL/CGLMacro.h>
+#endif
+
+//	Each thread draws with a context of its own.
+#ifdef _MSC_VER
+#define	GL_THREAD_LOCAL	__declspec( thread )
+#else
+#define	GL_THREAD_LOCAL	__thread
+#endif
+
+namespace	DisplayOutput
+{
+
+/*
+	sVertexGL.
+	One batched vertex, screen position, texture coordinate and packed color.
+*/
+struct	sVertexGL
+{
+	fp4		m_X, m_Y;
+	fp4		m_U, m_V;
+	uint8	m_Color[4];
+};
+
+/*
+	CGLStateCache.
+	Shadow of the GL state the renderer touches, so setting what is already set never reaches the driver.
+	Everything that binds, enables, blends, switches programs or loads matrices in the context has to come through here, or the shadow lies.
+
+	Quads are collected into a batch that grows as long as nothing a draw depends on changes, and go out with one glDrawArrays from a
+	persistent streaming vertex buffer. A state change that is actually issued draws the batch first, an elided one doesn't.
+
+	Contexts sharing their objects (see CDisplayOutput::ShareGroup()) each have a cache of their own, textures and shaders go through
+	the one of the context drawing, For(). Another context can't see what one uploads or deletes until it binds again, so those bump a
+	shared counter, and Resync() makes the others forget their bindings.
+*/
+class	CGLStateCache
+{
+	public:
+		enum
+		{
+			kMaxUnits = 32,
+
+			//	Vertices collected before the batch is drawn regardless.
+			kBatchVertices = 6 * 1024,
+
+			//	The vertex buffer holds a few batches, it is only orphaned when it wraps.
+			kBufferVertices = 4 * kBatchVertices,
+		};
+
+	private:
+		enum	eTarget
+		{
+			eTarget2D,
+			eTargetRect,
+			eTargetArray,
+			eNumTargets
+		};
+
+		struct	sUnit
+		{
+			//	Fixed function target enabled on the unit, 0 for none.
+			GLenum	m_Enabled;
+			GLuint	m_Bound[ eNumTargets ];
+		};
+
+#ifdef MAC
+		CGLContextObj cgl_ctx;
+#endif
+
+		sUnit		m_Units[ kMaxUnits ];
+		uint32		m_ActiveUnit;
+
+		//	Uploads bind on a unit of their own, so they don't disturb what is bound for drawing.
+		uint32		m_UploadUnit;
+		uint32		m_DrawUnits;
+		bool		m_bDisplaced;
+		GLuint		m_Displaced;
+
+		bool		m_bBlend;
+		GLenum		m_BlendSrc, m_BlendDst, m_BlendMode;
+
+		GLenum		m_MatrixMode;
+		fp4			m_Matrices[ 2 ][ 16 ];
+		bool		m_bMatrixValid[ 2 ];
+
+		GLhandleARB	m_Program;
+		bool		m_bProgramKnown;
+
+		//	Objects are shared with the other contexts of this group, NULL if not shared.
+		const void	*m_ShareGroup;
+		uint32		m_SeenChanges;
+
+		//	The batch.
+		sVertexGL	*m_pVertices;
+		uint32		m_NumVertices;
+		GLuint		m_VBO;
+		uint32		m_VBOOffset;
+
+		sRenderStats	m_Stats;
+
+		static uint32	Slot( const GLenum _target )
+		{
+			if( _target == GL_TEXTURE_2D_ARRAY_EXT )
+				return eTargetArray;
+
+			if( _target == GL_TEXTURE_RECTANGLE_ARB )
+				return eTargetRect;
+
+			return eTarget2D;
+		}
+
+		inline void	Issued( const uint32 _calls = 1 )
+		{
+			m_Stats.m_GLCalls += _calls;
+			m_Stats.m_StateChanges++;
+		}
+
+		inline void	Elided( void )
+		{
+			m_Stats.m_StateElided++;
+		}
+
+		static volatile uint32	&SharedChanges( void )
+		{
+			static volatile uint32 s_Changes = 0;
+			return s_Changes;
+		}
+
+		//	Something the other contexts of the group use changed, they have to see it.
+		void	Changed( void )
+		{
+			if( m_ShareGroup == NULL )
+				return;
+
+			glFlush();
+			m_Stats.m_GLCalls++;
+
+#ifdef WIN32
+			uint32 previous = (uint32)InterlockedIncrement( (volatile LONG *)&SharedChanges() ) - 1;
+#else
+			uint32 previous = __atomic_fetch_add( &SharedChanges(), 1, __ATOMIC_RELAXED );
+#endif
+			//	Our own change needs no resync, unless somebody else's came in before it.
+			if( previous == m_SeenChanges )
+				m_SeenChanges = previous + 1;
+		}
+
+		void	Bind( const uint32 _unit, const GLenum _target, const GLuint _id )
+		{
+			GLuint	&bound = m_Units[ _unit ].m_Bound[ Slot( _target ) ];
+			if( bound == _id )
+			{
+				Elided();
+				return;
+			}
+
+			Flush();
+			ActiveTexture( _unit );
+			glBindTexture( _target, _id );
+			bound = _id;
+			Issued();
+		}
+
+	public:
+#ifdef MAC
+			CGLStateCache( CGLContextObj glCtx ) : cgl_ctx( glCtx )
+#else
+			CGLStateCache()
+#endif
+			{
+				//	Starts out as a fresh context is, by the spec.
+				memset( m_Units, 0, sizeof(m_Units) );
+				m_ActiveUnit = 0;
+				m_DrawUnits = 0;
+				m_bDisplaced = false;
+				m_Displaced = 0;
+
+				m_bBlend = false;
+				m_BlendSrc = GL_ONE;
+				m_BlendDst = GL_ZERO;
+				m_BlendMode = GL_FUNC_ADD;
+
+				m_MatrixMode = GL_MODELVIEW;
+				m_bMatrixValid[0] = m_bMatrixValid[1] = false;
+
+				m_Program = 0;
+				m_bProgramKnown = true;
+
+				m_ShareGroup = NULL;
+				m_SeenChanges = SharedChanges();
+
+				memset( &m_Stats, 0, sizeof(m_Stats) );
+
+				//	Highest unit the context has, the frame displays use the low ones.
+				GLint units = 0;
+				glGetIntegerv( GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS_ARB, &units );
+				if( units <= 0 )
+					glGetIntegerv( GL_MAX_TEXTURE_UNITS_ARB, &units );
+				m_UploadUnit = (uint32)Base::Math::Clamped( units, 1, (GLint)kMaxUnits ) - 1;
+
+				m_pVertices = new sVertexGL[ kBatchVertices ];
+				m_NumVertices = 0;
+				m_VBO = 0;
+				m_VBOOffset = 0;
+
+				//	Nothing else uses vertex arrays, so the buffer stays bound and the pointers are set once.
+				const uint8 *pBase = (const uint8 *)m_pVertices;
+				if( GLEE_ARB_vertex_buffer_object )
+				{
+					glGenBuffersARB( 1, &m_VBO );
+					glBindBufferARB( GL_ARRAY_BUFFER_ARB, m_VBO );
+					glBufferDataARB( GL_ARRAY_BUFFER_ARB, kBufferVertices * sizeof(sVertexGL), NULL, GL_STREAM_DRAW_ARB );
+					pBase = NULL;
+				}
+
+				glClientActiveTextureARB( GL_TEXTURE0 );
+				glVertexPointer( 2, GL_FLOAT, sizeof(sVertexGL), pBase + offsetof( sVertexGL, m_X ) );
+				glTexCoordPointer( 2, GL_FLOAT, sizeof(sVertexGL), pBase + offsetof( sVertexGL, m_U ) );
+				glColorPointer( 4, GL_UNSIGNED_BYTE, sizeof(sVertexGL), pBase + offsetof( sVertexGL, m_Color ) );
+				glEnableClientState( GL_VERTEX_ARRAY );
+				glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+				glEnableClientState( GL_COLOR_ARRAY );
+			}
+
+			~CGLStateCache()
+			{
+				if( m_VBO != 0 )
+					glDeleteBuffersARB( 1, &m_VBO );
+
+				SAFE_DELETE_ARRAY( m_pVertices );
+			}
+
+			/*
+				Current().
+				The cache of the context the calling thread draws with, set by MakeCurrent().
+			*/
+			static CGLStateCache	*&Current( void )
+			{
+				static GL_THREAD_LOCAL CGLStateCache *s_pCurrent = NULL;
+				return s_pCurrent;
+			}
+
+			void	MakeCurrent( void )	{	Current() = this;	};
+
+			/*
+				For().
+				Cache to talk to for an object created with _pOwner: the current one if it shares objects with _pOwner, _pOwner otherwise.
+			*/
+			static CGLStateCache	*For( CGLStateCache *_pOwner )
+			{
+				CGLStateCache *pCurrent = Current();
+				if( pCurrent != NULL && pCurrent->m_ShareGroup != NULL && pCurrent->m_ShareGroup == _pOwner->m_ShareGroup )
+					return pCurrent;
+
+				return _pOwner;
+			}
+
+			void	Share( const void *_shareGroup )	{	m_ShareGroup = _shareGroup;	};
+			const void	*ShareGroup( void ) const	{	return m_ShareGroup;	};
+
+			/*
+				Resync().
+				True if another context of the group changed shared objects since the last call, everything is bound anew after that.
+			*/
+			bool	Resync( void )
+			{
+				if( m_ShareGroup == NULL || m_SeenChanges == SharedChanges() )
+					return false;
+
+				m_SeenChanges = SharedChanges();
+
+				Flush();
+				for( uint32 i=0; i<kMaxUnits; i++ )
+					for( uint32 t=0; t<eNumTargets; t++ )
+						m_Units[i].m_Bound[t] = (GLuint)~0;
+
+				m_bProgramKnown = false;
+				return true;
+			}
+
+			/*
+				Vertices().
+				Room for _count more vertices in the batch, drawn with whatever state is set at the next flush.
+			*/
+			sVertexGL	*Vertices( const uint32 _count )
+			{
+				if( m_NumVertices + _count > kBatchVertices )
+					Flush();
+
+				sVertexGL *pVertices = m_pVertices + m_NumVertices;
+				m_NumVertices += _count;
+				return pVertices;
+			}
+
+			/*
+				Flush().
+				Draws the batch, as triangles.
+			*/
+			void	Flush( void )
+			{
+				if( m_NumVertices == 0 )
+					return;
+
+				uint32 first = 0;
+				if( m_VBO != 0 )
+				{
+					if( m_VBOOffset + m_NumVertices > kBufferVertices )
+					{
+						//	Orphan, the driver hands over fresh memory instead of waiting for the draws still reading the old.
+						glBufferDataARB( GL_ARRAY_BUFFER_ARB, kBufferVertices * sizeof(sVertexGL), NULL, GL_STREAM_DRAW_ARB );
+						m_VBOOffset = 0;
+						m_Stats.m_GLCalls++;
+					}
+
+					glBufferSubDataARB( GL_ARRAY_BUFFER_ARB, m_VBOOffset * sizeof(sVertexGL), m_NumVertices * sizeof(sVertexGL), m_pVertices );
+					first = m_VBOOffset;
+					m_VBOOffset += m_NumVertices;
+					m_Stats.m_GLCalls++;
+				}
+
+				glDrawArrays( GL_TRIANGLES, (GLint)first, (GLsizei)m_NumVertices );
+
+				m_Stats.m_GLCalls++;
+				m_Stats.m_DrawCalls++;
+				m_Stats.m_Vertices += m_NumVertices;
+				m_NumVertices = 0;
+			}
+
+			/*
+			*/
+			void	ActiveTexture( const uint32 _unit )
+			{
+				if( _unit == m_ActiveUnit )
+					return;
+
+				//	Only selects what the next calls talk to, nothing drawn depends on it.
+				glActiveTextureARB( GL_TEXTURE0 + _unit );
+				m_ActiveUnit = _unit;
+				m_Stats.m_GLCalls++;
+			}
+
+			/*
+				BindTexture().
+				Binds _id for drawing on _unit, and enables _target for the fixed function pipeline when _bEnable is set.
+				Array textures are only read by shaders, they leave the enables alone.
+			*/
+			void	BindTexture( const uint32 _unit, const GLenum _target, const GLuint _id, const bool _bEnable )
+			{
+				m_DrawUnits |= 1 << _unit;
+
+				if( _bEnable )
+					EnableTexture( _unit, _target );
+
+				Bind( _unit, _target, _id );
+			}
+
+			/*
+				EnableTexture().
+				Fixed function texturing on _unit, from _target, or none with 0.
+				Unbinding a texture only needs this, the binding itself can stay until something else is bound.
+			*/
+			void	EnableTexture( const uint32 _unit, const GLenum _target )
+			{
+				sUnit &unit = m_Units[ _unit ];
+				if( unit.m_Enabled == _target )
+				{
+					Elided();
+					return;
+				}
+
+				Flush();
+				ActiveTexture( _unit );
+
+				if( unit.m_Enabled != 0 )
+				{
+					glDisable( unit.m_Enabled );
+					Issued();
+				}
+
+				if( _target != 0 )
+				{
+					glEnable( _target );
+					Issued();
+				}
+
+				unit.m_Enabled = _target;
+			}
+
+			/*
+				BeginUpload().
+				Binds _id for an upload, on the upload unit.
+				If that unit is also drawn with (few units in the context), whatever the upload replaces is put back by EndUpload().
+			*/
+			void	BeginUpload( const GLenum _target, const GLuint _id )
+			{
+				Flush();
+
+				GLuint bound = m_Units[ m_UploadUnit ].m_Bound[ Slot( _target ) ];
+				m_bDisplaced = ( m_DrawUnits & ( 1 << m_UploadUnit ) ) && bound != _id;
+				m_Displaced = bound;
+
+				Bind( m_UploadUnit, _target, _id );
+
+				//	The transfer itself.
+				m_Stats.m_GLCalls++;
+			}
+
+			void	EndUpload( const GLenum _target, const uint32 _bytes )
+			{
+				if( m_bDisplaced )
+					Bind( m_UploadUnit, _target, m_Displaced );
+
+				m_bDisplaced = false;
+				m_Stats.m_UploadBytes += _bytes;
+
+				if( _bytes > 0 )
+					Changed();
+			}
+
+			/*
+				DeleteTexture().
+				GL drops a deleted texture from every binding, and hands the name out again.
+			*/
+			void	DeleteTexture( const GLenum _target, const GLuint _id )
+			{
+				Flush();
+				glDeleteTextures( 1, &_id );
+				m_Stats.m_GLCalls++;
+
+				const uint32 slot = Slot( _target );
+				for( uint32 i=0; i<kMaxUnits; i++ )
+					if( m_Units[i].m_Bound[ slot ] == _id )
+						m_Units[i].m_Bound[ slot ] = 0;
+
+				//	The name can come back in any context of the group.
+				Changed();
+			}
+
+			/*
+			*/
+			void	UseProgram( const GLhandleARB _program )
+			{
+				if( m_bProgramKnown && _program == m_Program )
+				{
+					Elided();
+					return;
+				}
+
+				Flush();
+				glUseProgramObjectARB( _program );
+				m_Program = _program;
+				m_bProgramKnown = true;
+				Issued();
+			}
+
+			/*
+				DeleteProgram().
+				Taken out of use first, or the handle could come back for the next program while the cache thinks that one is current.
+			*/
+			void	DeleteProgram( const GLhandleARB _program )
+			{
+				if( !m_bProgramKnown || _program == m_Program )
+					UseProgram( 0 );
+
+				glDeleteObjectARB( _program );
+				m_Stats.m_GLCalls++;
+				Changed();
+			}
+
+			/*
+				Blend().
+				Blending off is cheaper than blending with one/zero, so that is what disabled means here.
+			*/
+			void	Blend( const bool _bEnable, const GLenum _src, const GLenum _dst, const GLenum _mode )
+			{
+				if( _bEnable != m_bBlend )
+				{
+					Flush();
+					if( _bEnable )
+						glEnable( GL_BLEND );
+					else
+						glDisable( GL_BLEND );
+					m_bBlend = _bEnable;
+					Issued();
+				}
+				else
+					Elided();
+
+				if( !_bEnable )
+					return;
+
+				if( _src != m_BlendSrc || _dst != m_BlendDst )
+				{
+					Flush();
+					glBlendFunc( _src, _dst );
+					m_BlendSrc = _src;
+					m_BlendDst = _dst;
+					Issued();
+				}
+				else
+					Elided();
+
+				if( _mode != m_BlendMode )
+				{
+					Flush();
+					glBlendEquation( _mode );
+					m_BlendMode = _mode;
+					Issued();
+				}
+				else
+					Elided();
+			}
+
+			/*
+				LoadMatrix().
+				GL_MODELVIEW or GL_PROJECTION, skipped when the matrix is the one already loaded.
+			*/
+			void	LoadMatrix( const GLenum _mode, const fp4 *_pMatrix )
+			{
+				const uint32 i = ( _mode == GL_PROJECTION ) ? 1 : 0;
+				if( m_bMatrixValid[i] && memcmp( m_Matrices[i], _pMatrix, sizeof(m_Matrices[i]) ) == 0 )
+				{
+					Elided();
+					return;
+				}
+
+				Flush();
+
+				if( _mode != m_MatrixMode )
+				{
+					glMatrixMode( _mode );
+					m_MatrixMode = _mode;
+					m_Stats.m_GLCalls++;
+				}
+
+				glLoadMatrixf( (const GLfloat *)_pMatrix );
+				memcpy( m_Matrices[i], _pMatrix, sizeof(m_Matrices[i]) );
+				m_bMatrixValid[i] = true;
+				Issued();
+			}
+
+			//	Counted since the last ResetStats().
+			const sRenderStats	&Stats( void ) const	{	return m_Stats;	};
+			void	ResetStats( void )	{	memset( &m_Stats, 0, sizeof(m_Stats) );	};
+};
+
+MakeSmartPointers( CGLStateCache );
+
+}
+
+#endif
@@ -0,0 +1,262 @@
+#ifndef	_PIXELSTREAMGL_H_
+#define	_PIXELSTREAMGL_H_
+
+#include <stddef.h>
+#include <string.h>
+#include "base.h"
+#include "Log.h"
+#ifdef MAC
+#undef Random
+#include <OpenGL/CGLMacro.h>
+#endif
+
+//	Number of pixel buffer objects each texture cycles through when streaming.
+#define	kNumStreamPBOs	2
+
+namespace	DisplayOutput
+{
+
+/*
+	sBufferStorageGL.
+	ARB_buffer_storage and ARB_sync, newer than GLee, so their entry points are looked up here. Get() expects a current context.
+*/
+struct	sBufferStorageGL
+{
+	typedef struct __GLsync	*Sync;
+
+	typedef void	(APIENTRY *tBufferStorage)( GLenum _target, GLsizeiptr _size, const void *_pData, GLbitfield _flags );
+	typedef void	*(APIENTRY *tMapBufferRange)( GLenum _target, GLintptr _offset, GLsizeiptr _length, GLbitfield _access );
+	typedef Sync	(APIENTRY *tFenceSync)( GLenum _condition, GLbitfield _flags );
+	typedef GLenum	(APIENTRY *tClientWaitSync)( Sync _sync, GLbitfield _flags, uint64 _timeout );
+	typedef void	(APIENTRY *tDeleteSync)( Sync _sync );
+
+	enum
+	{
+		kMapWrite = 0x0002,
+		kMapPersistent = 0x0040,
+		kMapCoherent = 0x0080,
+		kSyncGPUCommandsComplete = 0x9117,
+		kSyncFlushCommands = 0x0001,
+		kTimeoutExpired = 0x911B,
+		kWaitFailed = 0x911D,
+	};
+
+	bool	m_bLoaded;
+	bool	m_bAvailable;
+
+	tBufferStorage	BufferStorage;
+	tMapBufferRange	MapBufferRange;
+	tFenceSync		FenceSync;
+	tClientWaitSync	ClientWaitSync;
+	tDeleteSync		DeleteSync;
+
+	static bool	HasExtension( const char *_pExtensions, const char *_pName )
+	{
+		const size_t len = strlen( _pName );
+		for( const char *p = strstr( _pExtensions, _pName ); p != NULL; p = strstr( p + len, _pName ) )
+			if( ( p == _pExtensions || p[-1] == ' ' ) && ( p[len] == ' ' || p[len] == '\0' ) )
+				return true;
+
+		return false;
+	}
+
+	static void	*Proc( const char *_pName )
+	{
+#ifdef WIN32
+		return (void *)wglGetProcAddress( _pName );
+#elif defined(MAC)
+		(void)_pName;
+		return NULL;
+#else
+		return (void *)glXGetProcAddressARB( (const GLubyte *)_pName );
+#endif
+	}
+
+	void	Load( void )
+	{
+		m_bLoaded = true;
+		m_bAvailable = false;
+
+#ifndef MAC
+		//	The legacy contexts of the mac stop at 2.1.
+		const char *pExtensions = (const char *)glGetString( GL_EXTENSIONS );
+		if( pExtensions == NULL || !HasExtension( pExtensions, "GL_ARB_buffer_storage" ) || !HasExtension( pExtensions, "GL_ARB_sync" ) )
+			return;
+
+		BufferStorage = (tBufferStorage)Proc( "glBufferStorage" );
+		MapBufferRange = (tMapBufferRange)Proc( "glMapBufferRange" );
+		FenceSync = (tFenceSync)Proc( "glFenceSync" );
+		ClientWaitSync = (tClientWaitSync)Proc( "glClientWaitSync" );
+		DeleteSync = (tDeleteSync)Proc( "glDeleteSync" );
+
+		m_bAvailable = BufferStorage != NULL && MapBufferRange != NULL && FenceSync != NULL && ClientWaitSync != NULL && DeleteSync != NULL;
+		if( m_bAvailable )
+			g_Log->Info( "Streaming textures through persistently mapped buffers" );
+#endif
+	}
+
+	static sBufferStorageGL	&Get( void )
+	{
+		static sBufferStorageGL s = { false, false, NULL, NULL, NULL, NULL, NULL };
+		if( !s.m_bLoaded )
+			s.Load();
+
+		return s;
+	}
+};
+
+/*
+	CPixelStreamGL.
+	The pixel buffer objects a texture streams its pixels through, used in turn.
+	With ARB_buffer_storage they are mapped once for good, and a fence per buffer tells when the transfer reading it is done, so writing
+	the next frame neither maps nor orphans anything and only waits if the gpu is still on the frame from kNumStreamPBOs uploads ago.
+	Otherwise they are mapped around each write, and keep their storage, it is only reallocated when a frame needs more.
+*/
+class	CPixelStreamGL
+{
+#ifdef MAC
+	CGLContextObj cgl_ctx;
+#endif
+
+	GLuint	m_PBOs[ kNumStreamPBOs ];
+	uint8	*m_pMapped[ kNumStreamPBOs ];
+	sBufferStorageGL::Sync	m_Fences[ kNumStreamPBOs ];
+	uint32	m_Capacity;
+	uint32	m_Current;
+	bool	m_bPersistent;
+
+	//	Storage for _size bytes in every buffer, a buffer with immutable storage has to be replaced for that.
+	bool	Allocate( const uint32 _size )
+	{
+		Release();
+		glGenBuffersARB( kNumStreamPBOs, m_PBOs );
+
+		sBufferStorageGL &bs = sBufferStorageGL::Get();
+		m_bPersistent = bs.m_bAvailable;
+
+		for( uint32 i=0; i<kNumStreamPBOs; i++ )
+		{
+			glBindBufferARB( GL_PIXEL_UNPACK_BUFFER_ARB, m_PBOs[i] );
+			if( m_bPersistent )
+			{
+				const GLbitfield flags = sBufferStorageGL::kMapWrite | sBufferStorageGL::kMapPersistent | sBufferStorageGL::kMapCoherent;
+				bs.BufferStorage( GL_PIXEL_UNPACK_BUFFER_ARB, _size, NULL, flags );
+				m_pMapped[i] = (uint8 *)bs.MapBufferRange( GL_PIXEL_UNPACK_BUFFER_ARB, 0, _size, flags );
+				if( m_pMapped[i] == NULL )
+				{
+					g_Log->Warning( "Persistent mapping failed, mapping per frame" );
+					glBindBufferARB( GL_PIXEL_UNPACK_BUFFER_ARB, 0 );
+					bs.m_bAvailable = false;
+					return Allocate( _size );
+				}
+			}
+			else
+				glBufferDataARB( GL_PIXEL_UNPACK_BUFFER_ARB, _size, NULL, GL_STREAM_DRAW_ARB );
+		}
+
+		m_Capacity = _size;
+		return true;
+	}
+
+	public:
+#ifdef MAC
+			CPixelStreamGL( CGLContextObj glCtx ) : cgl_ctx( glCtx )
+#else
+			CPixelStreamGL()
+#endif
+			{
+				memset( m_PBOs, 0, sizeof(m_PBOs) );
+				memset( m_pMapped, 0, sizeof(m_pMapped) );
+				memset( m_Fences, 0, sizeof(m_Fences) );
+				m_Capacity = 0;
+				m_Current = 0;
+				m_bPersistent = false;
+			}
+
+			~CPixelStreamGL()
+			{
+				Release();
+			}
+
+			//	Deletes the buffers, expects the context they were made in (or one sharing with it) to be current.
+			void	Release( void )
+			{
+				if( m_PBOs[0] == 0 )
+					return;
+
+				sBufferStorageGL &bs = sBufferStorageGL::Get();
+				for( uint32 i=0; i<kNumStreamPBOs; i++ )
+				{
+					if( m_Fences[i] != NULL )
+						bs.DeleteSync( m_Fences[i] );
+
+					//	Deleting a buffer unmaps it.
+					m_Fences[i] = NULL;
+					m_pMapped[i] = NULL;
+				}
+
+				glDeleteBuffersARB( kNumStreamPBOs, m_PBOs );
+				memset( m_PBOs, 0, sizeof(m_PBOs) );
+				m_Capacity = 0;
+			}
+
+			/*
+				Write().
+				Copies _size bytes of pixels into the next buffer and leaves it bound to GL_PIXEL_UNPACK_BUFFER_ARB, the glTex*Image call
+				reading them then gets offset 0 (NULL) for its pixels, followed by Done(). False if they have to be uploaded directly.
+			*/
+			bool	Write( const uint8 *_pSrc, const uint32 _size )
+			{
+				if( !GLEE_ARB_pixel_buffer_object )
+					return false;
+
+				if( _size > m_Capacity && !Allocate( _size ) )
+					return false;
+
+				m_Current = (m_Current + 1) % kNumStreamPBOs;
+				glBindBufferARB( GL_PIXEL_UNPACK_BUFFER_ARB, m_PBOs[ m_Current ] );
+
+				if( m_bPersistent )
+				{
+					sBufferStorageGL &bs = sBufferStorageGL::Get();
+					if( m_Fences[ m_Current ] != NULL )
+					{
+						//	A second at most, rather a torn frame than a hang on a lost context.
+						GLenum result = bs.ClientWaitSync( m_Fences[ m_Current ], sBufferStorageGL::kSyncFlushCommands, 1000000000ull );
+						if( result == sBufferStorageGL::kTimeoutExpired || result == sBufferStorageGL::kWaitFailed )
+							g_Log->Warning( "Pixel buffer still in use, overwriting it" );
+
+						bs.DeleteSync( m_Fences[ m_Current ] );
+						m_Fences[ m_Current ] = NULL;
+					}
+
+					memcpy( m_pMapped[ m_Current ], _pSrc, _size );
+					return true;
+				}
+
+				uint8 *pDst = (uint8 *)glMapBufferARB( GL_PIXEL_UNPACK_BUFFER_ARB, GL_WRITE_ONLY_ARB );
+				if( pDst == NULL )
+				{
+					g_Log->Warning( "glMapBuffer failed, uploading directly" );
+					glBindBufferARB( GL_PIXEL_UNPACK_BUFFER_ARB, 0 );
+					return false;
+				}
+
+				memcpy( pDst, _pSrc, _size );
+				glUnmapBufferARB( GL_PIXEL_UNPACK_BUFFER_ARB );
+				return true;
+			}
+
+			//	The transfer out of the buffer Write() filled has been issued, fence it and unbind.
+			void	Done( void )
+			{
+				if( m_bPersistent )
+					m_Fences[ m_Current ] = sBufferStorageGL::Get().FenceSync( sBufferStorageGL::kSyncGPUCommandsComplete, 0 );
+
+				glBindBufferARB( GL_PIXEL_UNPACK_BUFFER_ARB, 0 );
+			}
+};
+
+}
+
+#endif
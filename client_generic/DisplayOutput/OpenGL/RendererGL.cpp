@@ -16,8 +16,12 @@
 
 #include	"RendererGL.h"
 #include	"TextureFlatGL.h"
+#ifndef MAC
+#include	"TextureArrayGL.h"
+#endif
 #include	"ShaderGL.h"
 #include	"FontGL.h"
+#include	"LatencyStats.h"
 
 namespace DisplayOutput
 {
@@ -63,6 +67,45 @@ int32	GetBlendMode( const int32 _src )
 	
 	return( formatLut[ _src ] );
 }
+
+/*
+	PackColor().
+
+*/
+static void	PackColor( const Base::Math::CVector4 &_color, uint8 *_pColor )
+{
+	_pColor[0] = (uint8)( Base::Math::saturate( _color.m_X ) * 255.0f + 0.5f );
+	_pColor[1] = (uint8)( Base::Math::saturate( _color.m_Y ) * 255.0f + 0.5f );
+	_pColor[2] = (uint8)( Base::Math::saturate( _color.m_Z ) * 255.0f + 0.5f );
+	_pColor[3] = (uint8)( Base::Math::saturate( _color.m_W ) * 255.0f + 0.5f );
+}
+
+/*
+	Vertex().
+
+*/
+static inline void	Vertex( sVertexGL &_vertex, const fp4 _x, const fp4 _y, const fp4 _u, const fp4 _v, const uint8 *_pColor )
+{
+	_vertex.m_X = _x;
+	_vertex.m_Y = _y;
+	_vertex.m_U = _u;
+	_vertex.m_V = _v;
+	memcpy( _vertex.m_Color, _pColor, 4 );
+}
+
+/*
+	Quad().
+	The two triangles of a quad, _rect in pixels.
+*/
+static void	Quad( sVertexGL *_pVertices, const Base::Math::CRect &_rect, const Base::Math::CRect &_uvRect, const uint8 *_pColor )
+{
+	Vertex( _pVertices[0], _rect.m_X0, _rect.m_Y0, _uvRect.m_X0, _uvRect.m_Y0, _pColor );
+	Vertex( _pVertices[1], _rect.m_X1, _rect.m_Y0, _uvRect.m_X1, _uvRect.m_Y0, _pColor );
+	Vertex( _pVertices[2], _rect.m_X1, _rect.m_Y1, _uvRect.m_X1, _uvRect.m_Y1, _pColor );
+	_pVertices[3] = _pVertices[0];
+	_pVertices[4] = _pVertices[2];
+	Vertex( _pVertices[5], _rect.m_X0, _rect.m_Y1, _uvRect.m_X0, _uvRect.m_Y1, _pColor );
+}
 	
 	
 /*
@@ -75,6 +118,9 @@ CRendererGL::CRendererGL() : CRenderer()
 */
 CRendererGL::~CRendererGL()
 {
+	//	Textures and shaders still around keep it alive, but the vertex buffer goes with the context.
+	m_spState = NULL;
+
 #ifdef  WIN32
 	wglMakeCurrent( NULL, NULL );
 	wglDeleteContext( m_RenderContext );
@@ -133,7 +179,12 @@ bool	CRendererGL::Initialize( spCDisplayOutput _spDisplay )
 
 #ifdef MAC
 	cgl_ctx = m_spDisplay->GetContext();
+	m_spState = new CGLStateCache( cgl_ctx );
+#else
+	SetCurrentGLContext();
+	m_spState = new CGLStateCache();
 #endif
+	m_spState->Share( m_spDisplay->ShareGroup() );
 
 	Defaults();
 
@@ -207,7 +258,14 @@ void CRendererGL::Verify( const char */*_file*/, const int32 /*_line*/ )
 */
 bool	CRendererGL::EndFrame( bool drawn )
 {
+	Base::CLatencyScope endFrameScope( Base::eLatencyEndFrame );
+
 	SetCurrentGLContext();
+
+	//	Whatever is still batched belongs to this frame.
+	m_spState->Flush();
+	m_FrameStats = m_spState->Stats();
+	m_spState->ResetStats();
 	
 	if( !CRenderer::EndFrame( drawn ) )
 		return false;
@@ -215,6 +273,7 @@ bool	CRendererGL::EndFrame( bool drawn )
 	if ( drawn )
 	{
 #ifdef  WIN32
+		Base::CLatencyScope swapScope( Base::eLatencySwap );
 		SwapBuffers( m_DeviceContext );
 #else
 		m_spDisplay->SwapBuffers();
@@ -236,15 +295,23 @@ bool	CRendererGL::EndFrame( bool drawn )
 */
 void	CRendererGL::Apply()
 {
-	SetCurrentGLContext();
-	
+	//	Uniforms go straight to the program, anything batched has to be drawn with the values it was queued with.
+	if( m_spSelectedShader != NULL )
+		m_spState->Flush();
+
+	//	Another display uploaded into textures we share, ours have to be bound again to see that.
+	if( m_spState->Resync() )
+	{
+		for( uint32 i=0; i<MAX_TEXUNIT; i++ )
+			m_aspActiveTextures[i] = NULL;
+	}
+
 	CRenderer::Apply();
 
 	//	Update world transformation.
 	if( isBit( m_bDirtyMatrices, eWorld ) )
 	{
-		glMatrixMode( GL_MODELVIEW );
-		glLoadMatrixf( (GLfloat *)(const fp4 *)m_WorldMat.m_Mat );
+		m_spState->LoadMatrix( GL_MODELVIEW, (const fp4 *)m_WorldMat.m_Mat );
 		remBit( m_bDirtyMatrices, static_cast<uint32>(eWorld) );
 	}
 
@@ -257,19 +324,15 @@ void	CRendererGL::Apply()
 	//	Update projection transformation.
 	if( isBit( m_bDirtyMatrices, eProjection ) )
 	{
-		glMatrixMode( GL_PROJECTION );
-		glLoadMatrixf( (GLfloat *)(const fp4 *)m_ProjMat.m_Mat );
+		m_spState->LoadMatrix( GL_PROJECTION, (const fp4 *)m_ProjMat.m_Mat );
 		remBit( m_bDirtyMatrices, static_cast<uint32>(eProjection) );
 	}
 	
-	//	Blend state.	Suboptimal!
+	//	Blend state.
 	if( m_spActiveBlend != m_spSelectedBlend )
 	{
 		m_spActiveBlend = m_spSelectedBlend;
-		
-		glEnable(GL_BLEND);
-		glBlendFunc(GetBlendConstant( m_spActiveBlend->m_Src ),GetBlendConstant( m_spActiveBlend->m_Dst ));
-		glBlendEquation(GetBlendMode( m_spActiveBlend->m_Mode ) );
+		m_spState->Blend( m_spActiveBlend->m_bEnabled, GetBlendConstant( m_spActiveBlend->m_Src ), GetBlendConstant( m_spActiveBlend->m_Dst ), GetBlendMode( m_spActiveBlend->m_Mode ) );
 	}
 }
 
@@ -277,8 +340,6 @@ void	CRendererGL::Apply()
 */
 void	CRendererGL::Reset( const uint32 _flags )
 {	
-	SetCurrentGLContext();
-	
 	CRenderer::Reset( _flags );
 }
 
@@ -290,9 +351,9 @@ spCTextureFlat	CRendererGL::NewTextureFlat( spCImage _spImage, const uint32 _fla
 	SetCurrentGLContext();
 
 #ifdef MAC
-	spCTextureFlat	spTex = new CTextureFlatGL( _flags | ( ( GetTextureTargetType() == eTexture2DRect ) ? kRectTexture : 0 ), cgl_ctx );
+	spCTextureFlat	spTex = new CTextureFlatGL( _flags | ( ( GetTextureTargetType() == eTexture2DRect ) ? kRectTexture : 0 ), cgl_ctx, m_spState );
 #else
-	spCTextureFlat	spTex = new CTextureFlatGL( _flags | ( ( GetTextureTargetType() == eTexture2DRect ) ? kRectTexture : 0 ) );
+	spCTextureFlat	spTex = new CTextureFlatGL( _flags | ( ( GetTextureTargetType() == eTexture2DRect ) ? kRectTexture : 0 ), m_spState );
 #endif
 
 	spTex->Upload( _spImage );
@@ -306,14 +367,32 @@ spCTextureFlat	CRendererGL::NewTextureFlat( const uint32 _flags )
 	SetCurrentGLContext();
 
 #ifdef MAC
-	spCTextureFlat	spTex = new CTextureFlatGL( _flags | ( ( GetTextureTargetType() == eTexture2DRect ) ? kRectTexture : 0 ), cgl_ctx );
+	spCTextureFlat	spTex = new CTextureFlatGL( _flags | ( ( GetTextureTargetType() == eTexture2DRect ) ? kRectTexture : 0 ), cgl_ctx, m_spState );
 #else
-	spCTextureFlat	spTex = new CTextureFlatGL( _flags | ( ( GetTextureTargetType() == eTexture2DRect ) ? kRectTexture : 0 ) );
+	spCTextureFlat	spTex = new CTextureFlatGL( _flags | ( ( GetTextureTargetType() == eTexture2DRect ) ? kRectTexture : 0 ), m_spState );
 #endif
 
 	return spTex;
 }
 
+/*
+	NewTextureArray().
+	Needs EXT_texture_array, which the mac renderer doesn't use.
+*/
+spCTextureArray	CRendererGL::NewTextureArray( const uint32 _numLayers, const uint32 _flags )
+{
+#ifdef MAC
+	return NULL;
+#else
+	SetCurrentGLContext();
+
+	if( !GLEE_EXT_texture_array )
+		return NULL;
+
+	return new CTextureArrayGL( _numLayers, _flags, m_spState );
+#endif
+}
+
 /*
 */
 eTextureTargetType	CRendererGL::GetTextureTargetType( void )
@@ -336,9 +415,9 @@ spCShader	CRendererGL::NewShader( const char *_pVertexShader, const char *_pFrag
 	SetCurrentGLContext();
 	
 #ifdef MAC
-	spCShader spShader = new CShaderGL( cgl_ctx );
+	spCShader spShader = new CShaderGL( cgl_ctx, m_spState );
 #else
-	spCShader spShader = new CShaderGL();
+	spCShader spShader = new CShaderGL( m_spState );
 #endif
 	if( !spShader->Build( _pVertexShader, _pFragmentShader  ) )
 		return NULL;
@@ -365,10 +444,12 @@ spCBaseFont	CRendererGL::NewFont( CFontDescription &_desc )
 	return m_glFont;
 }
 		
+/*
+	Text().
+	The glyphs only go into the batch, unbinding the font texture at the end draws them all at once.
+*/
 void CRendererGL::Text( spCBaseFont _spFont, const std::string &_text, const Base::Math::CVector4 &/*_color*/, const Base::Math::CRect &_rect, uint32 /*_flags*/ )
 {
-	SetCurrentGLContext();
-	
 	spCFontGL glFont = _spFont;
 	
 	spCTextureFlat texture = glFont->GetTexture();
@@ -416,8 +497,6 @@ void CRendererGL::Text( spCBaseFont _spFont, const std::string &_text, const Bas
 		
 Base::Math::CVector2 CRendererGL::GetTextExtent( spCBaseFont _spFont, const std::string &_text )
 {
-	SetCurrentGLContext();
-	
 	spCFontGL glFont = _spFont;
 	
 	fp4 lineheight = glFont->LineHeight();
@@ -460,80 +539,43 @@ Base::Math::CVector2 CRendererGL::GetTextExtent( spCBaseFont _spFont, const std:
 	return Base::Math::CVector2( textwidth / (fp4)m_spDisplay->Width(), textheight / (fp4)m_spDisplay->Height() ); 
 }	
 
+/*
+*/
+spCImage	CRendererGL::TextImage( spCBaseFont _spFont, const std::string &_text )
+{
+	spCFontGL glFont = _spFont;
+	if( glFont == NULL )
+		return NULL;
+
+	return glFont->TextImage( _text );
+}
+
 /*
  */
 void	CRendererGL::DrawQuad( const Base::Math::CRect &_rect, const Base::Math::CVector4 &_color )
 {
-	SetCurrentGLContext();
-	
-	const fp4 w05 = (fp4)m_spDisplay->Width() * 0.5f;
-	const fp4 h05 = (fp4)m_spDisplay->Height() * 0.5f;
-	Base::Math::CRect r( lerpMacro( -w05, w05, _rect.m_X0 ), lerpMacro( -h05, h05, _rect.m_Y0 ), lerpMacro( -w05, w05, _rect.m_X1 ), lerpMacro( -h05, h05, _rect.m_Y1 ) );
-			
-	glBegin(GL_TRIANGLE_FAN);
-	{
-		glColor4f( _color.m_X, _color.m_Y, _color.m_Z, _color.m_W );
-		
-		glVertex2f( r.m_X0, r.m_Y0 );
-		
-		glVertex2f( r.m_X1, r.m_Y0 );
-		
-		glVertex2f( r.m_X1, r.m_Y1 );
-		
-		glVertex2f( r.m_X0, r.m_Y1 );
-	}
-	glEnd();
+	DrawQuad( _rect, _color, Base::Math::CRect() );
 }
 	
 
 /*
+	DrawQuad().
+	Into the batch, it is drawn when the state changes or the frame ends.
 */
 void	CRendererGL::DrawQuad( const Base::Math::CRect &_rect, const Base::Math::CVector4 &_color, const Base::Math::CRect &_uvrect )
 {
-	SetCurrentGLContext();
-	
 	const fp4 w05 = (fp4)m_spDisplay->Width() * 0.5f;
 	const fp4 h05 = (fp4)m_spDisplay->Height() * 0.5f;
 	Base::Math::CRect r( lerpMacro( -w05, w05, _rect.m_X0 ), lerpMacro( -h05, h05, _rect.m_Y0 ), lerpMacro( -w05, w05, _rect.m_X1 ), lerpMacro( -h05, h05, _rect.m_Y1 ) );
-		
-	/*float vertices[]  = {r.m_X0, r.m_Y0, r.m_X1, r.m_Y0, r.m_X1, r.m_Y1, r.m_X0, r.m_Y1};
-	float texcoords[] = {_uvrect.m_X0, _uvrect.m_Y0, _uvrect.m_X1, _uvrect.m_Y0, _uvrect.m_X1, _uvrect.m_Y1, _uvrect.m_X0, _uvrect.m_Y1 };
-	
-	glVertexPointer(2, GL_FLOAT, 0, vertices);
-	glTexCoordPointer(2, GL_FLOAT, 0, texcoords);
-	glEnableClientState(GL_VERTEX_ARRAY);
-	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-	
-	glColor4f( _color.m_X, _color.m_Y, _color.m_Z, _color.m_W );
-	
-	glDrawArrays(GL_QUADS, 0, 4);
-	
-	glDisableClientState(GL_VERTEX_ARRAY);
-	glDisableClientState(GL_TEXTURE_COORD_ARRAY);*/
 
-	glBegin(GL_QUADS);
-	{
-		glColor4f( _color.m_X, _color.m_Y, _color.m_Z, _color.m_W );
-
-        glTexCoord2f( _uvrect.m_X0, _uvrect.m_Y0 );
-        glVertex2f( r.m_X0, r.m_Y0 );
-
-        glTexCoord2f( _uvrect.m_X1, _uvrect.m_Y0 );
-        glVertex2f( r.m_X1, r.m_Y0 );
+	uint8 color[4];
+	PackColor( _color, color );
 
-        glTexCoord2f( _uvrect.m_X1, _uvrect.m_Y1 );
-        glVertex2f( r.m_X1, r.m_Y1 );
-
-        glTexCoord2f( _uvrect.m_X0, _uvrect.m_Y1 );
-        glVertex2f( r.m_X0, r.m_Y1 );
-    }
-    glEnd();
+	Quad( m_spState->Vertices( 6 ), r, _uvrect, color );
 }
 	
 void	CRendererGL::DrawSoftQuad( const Base::Math::CRect &_rect, const Base::Math::CVector4 &_color, const fp4 _width )
 {
-	SetCurrentGLContext();
-	
 	if( m_spSoftCorner == NULL )
 	{
 		DisplayOutput::spCImage tmpImage = new DisplayOutput::CImage();
@@ -569,63 +611,45 @@ void	CRendererGL::DrawSoftQuad( const Base::Math::CRect &_rect, const Base::Math
 	SetTexture( m_spSoftCorner, 0 );
 	Apply();
 
-	glBegin(GL_TRIANGLE_STRIP);
+	//	The border as the triangles of a strip around it, position and texture coordinate per vertex.
+	const fp4 strip[24][4] =
 	{
-		glColor4f( _color.m_X, _color.m_Y, _color.m_Z, _color.m_W );
-
-		glTexCoord2f( _uvrect.m_X1, _uvrect.m_Y0 );
-        glVertex2f( x0, y0bw );
-		glTexCoord2f( _uvrect.m_X1, _uvrect.m_Y1 );
-        glVertex2f( x0, y0 );
-		glTexCoord2f( _uvrect.m_X0, _uvrect.m_Y0 );
-        glVertex2f( x0bw, y0bw );
-		glTexCoord2f( _uvrect.m_X0, _uvrect.m_Y1 );
-        glVertex2f( x0bw, y0 );
-		glTexCoord2f( _uvrect.m_X0, _uvrect.m_Y0 );
-        glVertex2f( x1bw, y0bw );
-		glTexCoord2f( _uvrect.m_X0, _uvrect.m_Y1 );
-        glVertex2f( x1bw, y0 );
-				
-		glTexCoord2f( _uvrect.m_X0, _uvrect.m_Y1 );
-        glVertex2f( x1bw, y0 );
-		glTexCoord2f( _uvrect.m_X1, _uvrect.m_Y1 );
-        glVertex2f( x1, y0 );
-		glTexCoord2f( _uvrect.m_X0, _uvrect.m_Y0 );
-        glVertex2f( x1bw, y0bw );
-		glTexCoord2f( _uvrect.m_X1, _uvrect.m_Y0 );
-        glVertex2f( x1, y0bw );
-		glTexCoord2f( _uvrect.m_X0, _uvrect.m_Y0 );
-        glVertex2f( x1bw, y1bw );
-		glTexCoord2f( _uvrect.m_X1, _uvrect.m_Y0 );
-        glVertex2f( x1, y1bw );
-		
-		glTexCoord2f( _uvrect.m_X1, _uvrect.m_Y0 );
-        glVertex2f( x1, y1bw );
-		glTexCoord2f( _uvrect.m_X1, _uvrect.m_Y1 );
-        glVertex2f( x1, y1 );
-		glTexCoord2f( _uvrect.m_X0, _uvrect.m_Y0 );
-        glVertex2f( x1bw, y1bw );
-		glTexCoord2f( _uvrect.m_X0, _uvrect.m_Y1 );
-        glVertex2f( x1bw, y1 );
-		glTexCoord2f( _uvrect.m_X0, _uvrect.m_Y0 );
-        glVertex2f( x0bw, y1bw );
-		glTexCoord2f( _uvrect.m_X0, _uvrect.m_Y1 );
-        glVertex2f( x0bw, y1 );		
-		
-		glTexCoord2f( _uvrect.m_X0, _uvrect.m_Y1 );
-        glVertex2f( x0bw, y1 );
-		glTexCoord2f( _uvrect.m_X1, _uvrect.m_Y1 );
-        glVertex2f( x0, y1 );
-		glTexCoord2f( _uvrect.m_X0, _uvrect.m_Y0 );
-        glVertex2f( x0bw, y1bw );
-		glTexCoord2f( _uvrect.m_X1, _uvrect.m_Y0 );
-        glVertex2f( x0, y1bw );
-		glTexCoord2f( _uvrect.m_X0, _uvrect.m_Y0 );
-        glVertex2f( x0bw, y0bw );
-		glTexCoord2f( _uvrect.m_X1, _uvrect.m_Y0 );
-        glVertex2f( x0, y0bw );
-	}
-	glEnd();
+		{ x0, y0bw, _uvrect.m_X1, _uvrect.m_Y0 },
+		{ x0, y0, _uvrect.m_X1, _uvrect.m_Y1 },
+		{ x0bw, y0bw, _uvrect.m_X0, _uvrect.m_Y0 },
+		{ x0bw, y0, _uvrect.m_X0, _uvrect.m_Y1 },
+		{ x1bw, y0bw, _uvrect.m_X0, _uvrect.m_Y0 },
+		{ x1bw, y0, _uvrect.m_X0, _uvrect.m_Y1 },
+		{ x1bw, y0, _uvrect.m_X0, _uvrect.m_Y1 },
+		{ x1, y0, _uvrect.m_X1, _uvrect.m_Y1 },
+		{ x1bw, y0bw, _uvrect.m_X0, _uvrect.m_Y0 },
+		{ x1, y0bw, _uvrect.m_X1, _uvrect.m_Y0 },
+		{ x1bw, y1bw, _uvrect.m_X0, _uvrect.m_Y0 },
+		{ x1, y1bw, _uvrect.m_X1, _uvrect.m_Y0 },
+		{ x1, y1bw, _uvrect.m_X1, _uvrect.m_Y0 },
+		{ x1, y1, _uvrect.m_X1, _uvrect.m_Y1 },
+		{ x1bw, y1bw, _uvrect.m_X0, _uvrect.m_Y0 },
+		{ x1bw, y1, _uvrect.m_X0, _uvrect.m_Y1 },
+		{ x0bw, y1bw, _uvrect.m_X0, _uvrect.m_Y0 },
+		{ x0bw, y1, _uvrect.m_X0, _uvrect.m_Y1 },
+		{ x0bw, y1, _uvrect.m_X0, _uvrect.m_Y1 },
+		{ x0, y1, _uvrect.m_X1, _uvrect.m_Y1 },
+		{ x0bw, y1bw, _uvrect.m_X0, _uvrect.m_Y0 },
+		{ x0, y1bw, _uvrect.m_X1, _uvrect.m_Y0 },
+		{ x0bw, y0bw, _uvrect.m_X0, _uvrect.m_Y0 },
+		{ x0, y0bw, _uvrect.m_X1, _uvrect.m_Y0 }
+	};
+
+	uint8 color[4];
+	PackColor( _color, color );
+
+	sVertexGL *pVertices = m_spState->Vertices( 22 * 3 );
+	for( uint32 i=0; i<22; i++ )
+		for( uint32 j=0; j<3; j++ )
+		{
+			const fp4 *pCorner = strip[ i + j ];
+			Vertex( *pVertices++, pCorner[0], pCorner[1], pCorner[2], pCorner[3], color );
+		}
 	
 	// Center
 	SetTexture( NULL, 0 );
@@ -647,6 +671,13 @@ void 	CRendererGL::SetCurrentGLContext()
 	if (currContext != NULL)
 		CGLSetCurrentContext(currContext);
 #endif	
+#if !defined(WIN32) && !defined(MAC)
+	m_spDisplay->MakeCurrent();
+#endif
+
+	//	Textures and shaders shared with other displays bind through this one from now on.
+	if( m_spState != NULL )
+		m_spState->MakeCurrent();
 }
 
 
@@ -8,6 +8,7 @@
 #include "TextureFlat.h"
 #include "Image.h"
 #include "FontGL.h"
+#include "GLStateCache.h"
 #ifdef MAC
 #undef Random
 #include <OpenGL/CGLMacro.h>
@@ -33,6 +34,9 @@ class CRendererGL : public CRenderer
 #endif
 #endif
 	
+	//	Shadowed state and the quad batch, one per context.
+	spCGLStateCache		m_spState;
+
 	spCTextureFlat		m_spSoftCorner;
 	
 	spCImage			m_spTextImage;
@@ -67,6 +71,7 @@ class CRendererGL : public CRenderer
 			//
 			spCTextureFlat	NewTextureFlat( const uint32 flags = 0 );
 			spCTextureFlat	NewTextureFlat( spCImage _spImage, const uint32 flags = 0 );
+			spCTextureArray	NewTextureArray( const uint32 _numLayers, const uint32 flags = 0 );
 
 			eTextureTargetType	GetTextureTargetType( void );
 
@@ -74,6 +79,7 @@ class CRendererGL : public CRenderer
 			spCBaseFont		NewFont( CFontDescription &_desc );
 			void			Text( spCBaseFont _spFont, const std::string &_text, const Base::Math::CVector4 &_color, const Base::Math::CRect &_rect, uint32 _flags );
 			Base::Math::CVector2	GetTextExtent( spCBaseFont _spFont, const std::string &_text );
+			spCImage		TextImage( spCBaseFont _spFont, const std::string &_text );
 
 			//
 			spCShader		NewShader( const char *_pVertexShader, const char *_pFragmentShader );
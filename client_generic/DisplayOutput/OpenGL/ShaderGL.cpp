@@ -20,9 +20,9 @@ namespace DisplayOutput
 /*
 */
 #ifdef MAC
-CShaderGL::CShaderGL(CGLContextObj glCtx)
+CShaderGL::CShaderGL( CGLContextObj glCtx, spCGLStateCache _spState ) : m_spState( _spState )
 #else
-CShaderGL::CShaderGL()
+CShaderGL::CShaderGL( spCGLStateCache _spState ) : m_spState( _spState )
 #endif
 {
 	m_VertexShader = 0;
@@ -44,7 +44,7 @@ CShaderGL::~CShaderGL()
 		glDeleteObjectARB( m_FragmentShader );
 
 	if( m_Program )
-		glDeleteObjectARB( m_Program );
+		State()->DeleteProgram( m_Program );
 }
 
 
@@ -52,7 +52,7 @@ CShaderGL::~CShaderGL()
 */
 bool	CShaderGL::Bind()
 {
-	glUseProgramObjectARB( m_Program );
+	State()->UseProgram( m_Program );
 	VERIFYGL;
 	
 	return true;
@@ -79,7 +79,7 @@ bool	CShaderGL::Apply()
 */
 bool	CShaderGL::Unbind()
 {
-	glUseProgramObjectARB( 0 );
+	State()->UseProgram( 0 );
 	
 	return true;
 }
@@ -181,7 +181,7 @@ bool	CShaderGL::Build( const char *_pVertexShader, const char *_pFragmentShader
 
 		if( linkResult )
 		{
-			glUseProgramObjectARB( m_Program );
+			State()->UseProgram( m_Program );
 
 			GLint uniformCount, maxLength;
 			glGetObjectParameterivARB( m_Program, GL_OBJECT_ACTIVE_UNIFORMS_ARB, &uniformCount );
@@ -197,7 +197,7 @@ bool	CShaderGL::Build( const char *_pVertexShader, const char *_pFragmentShader
 				GLint length, size;
 				glGetActiveUniformARB( m_Program, i, maxLength, &length, &size, &type, name );
 
-				if( type >= GL_SAMPLER_1D && type <= GL_SAMPLER_2D_RECT_SHADOW_ARB )
+				if( ( type >= GL_SAMPLER_1D && type <= GL_SAMPLER_2D_RECT_SHADOW_ARB ) || type == GL_SAMPLER_2D_ARRAY_EXT )
 				{
 					//	Assign samplers to image units.
 					GLint location = glGetUniformLocationARB( m_Program, name );
@@ -288,7 +288,7 @@ bool	CShaderGL::Build( const char *_pVertexShader, const char *_pFragmentShader
 
 			return shaders.add(shader);*/
 
-			glUseProgram( GL_NONE );
+			State()->UseProgram( 0 );
 
 			VERIFYGL;
 
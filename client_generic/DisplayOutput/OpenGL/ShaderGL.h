@@ -3,6 +3,7 @@
 
 #include "Log.h"
 #include "Shader.h"
+#include "GLStateCache.h"
 
 namespace	DisplayOutput
 {
@@ -85,11 +86,16 @@ class CShaderGL : public CShader
 	CGLContextObj cgl_ctx;
 #endif
 
+	spCGLStateCache	m_spState;
+
+	//	Shared with other displays, it is bound through the cache of the one drawing.
+	CGLStateCache	*State( void )	{	return CGLStateCache::For( m_spState );	};
+
 	public:
 #ifdef MAC
-			CShaderGL(CGLContextObj glCtx);
+			CShaderGL( CGLContextObj glCtx, spCGLStateCache _spState );
 #else
-			CShaderGL();
+			CShaderGL( spCGLStateCache _spState );
 #endif
 			virtual ~CShaderGL();
 
@@ -0,0 +1,170 @@
+#include <assert.h>
+#include <inttypes.h>
+#include <string.h>
+#ifndef LINUX_GNU
+#include "GLee.h"
+#else
+#include <GLee.h>
+#endif
+#include <GL/gl.h>
+#include <GL/glut.h>
+
+#include "base.h"
+#include "Log.h"
+#include "DisplayOutput.h"
+#include "RendererGL.h"
+#include "TextureArrayGL.h"
+
+namespace	DisplayOutput
+{
+
+/*
+*/
+CTextureArrayGL::CTextureArrayGL( const uint32 _numLayers, const uint32 _flags, spCGLStateCache _spState ) : CTextureArray( _numLayers, _flags ), m_spState( _spState )
+{
+	glGenTextures( (GLsizei)1, &m_TexID );
+	VERIFYGL;
+}
+
+/*
+*/
+CTextureArrayGL::~CTextureArrayGL()
+{
+	m_Stream.Release();
+
+	State()->DeleteTexture( GL_TEXTURE_2D_ARRAY_EXT, m_TexID );
+	VERIFYGL;
+}
+
+/*
+	Respecify().
+	New storage for all layers, sized and formatted after _spImage. Same texture object, so nothing that refers to it changes.
+	Expects the texture to be bound.
+*/
+bool	CTextureArrayGL::Respecify( spCImage _spImage, const GLenum _srcFormat, const GLenum _srcType, const GLint _internalFormat )
+{
+	const CImageFormat &format = _spImage->GetFormat();
+	uint32 width = _spImage->GetWidth();
+	uint32 height = _spImage->GetHeight();
+
+	//	Sampling parameters belong to the texture object, they survive new storage.
+	if( m_Allocations == 0 )
+	{
+		glTexParameteri( GL_TEXTURE_2D_ARRAY_EXT, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+		glTexParameteri( GL_TEXTURE_2D_ARRAY_EXT, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+		glTexParameteri( GL_TEXTURE_2D_ARRAY_EXT, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+		glTexParameteri( GL_TEXTURE_2D_ARRAY_EXT, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+	}
+
+	//	All layers at once is a big allocation, so it is checked, without tripping over errors left by someone else.
+	while( glGetError() != GL_NO_ERROR )
+		;
+
+	if( format.isCompressed() )
+	{
+		uint32 layerSize = ( ( width + 3 ) / 4 ) * ( ( height + 3 ) / 4 ) * format.getBPBlock();
+		glCompressedTexImage3DARB( GL_TEXTURE_2D_ARRAY_EXT, 0, _internalFormat, width, height, m_NumLayers, 0, layerSize * m_NumLayers, NULL );
+	}
+	else
+		glTexImage3D( GL_TEXTURE_2D_ARRAY_EXT, 0, _internalFormat, width, height, m_NumLayers, 0, _srcFormat, _srcType, NULL );
+
+	if( glGetError() != GL_NO_ERROR )
+	{
+		g_Log->Warning( "Texture array of %u %ux%u layers failed", m_NumLayers, width, height );
+		m_Width = m_Height = 0;
+		m_Format = eImage_None;
+		return false;
+	}
+
+	m_Width = width;
+	m_Height = height;
+	m_Format = format.getFormatEnum();
+	m_Allocations++;
+	return true;
+}
+
+/*
+	Upload().
+	Same streaming as CTextureFlatGL::StreamUpload(), into one layer.
+*/
+bool	CTextureArrayGL::Upload( spCImage _spImage, const uint32 _layer, const bool _bRespecify )
+{
+	if( _spImage == NULL || _layer >= m_NumLayers )
+		return false;
+
+	uint8	*pSrc = _spImage->GetData( 0 );
+	if( pSrc == NULL )
+		return false;
+
+	GLenum srcFormat = GL_RGBA;
+	GLenum srcType = GL_UNSIGNED_BYTE;
+	GLint internalFormat;
+
+	const CImageFormat &format = _spImage->GetFormat();
+	switch( format.getFormatEnum() )
+	{
+		case eImage_I8:		internalFormat = GL_INTENSITY8;		srcFormat = GL_LUMINANCE;	break;
+		case eImage_RGBA8:	internalFormat = GL_RGBA8;			break;
+		case eImage_DXT1:	internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;	break;
+		default:			return false;
+	}
+
+	if( !Fits( _spImage ) && !_bRespecify )
+		return false;
+
+	State()->BeginUpload( GL_TEXTURE_2D_ARRAY_EXT, m_TexID );
+
+	if( !Fits( _spImage ) && !Respecify( _spImage, srcFormat, srcType, internalFormat ) )
+	{
+		State()->EndUpload( GL_TEXTURE_2D_ARRAY_EXT, 0 );
+		return false;
+	}
+
+	const bool bCompressed = format.isCompressed();
+	uint32 size = _spImage->getMipMappedSize( 0, 1 );
+	uint8 *pPixels = pSrc;
+
+	//	Source is offset 0 into the bound PBO.
+	if( m_Stream.Write( pSrc, size ) )
+		pPixels = NULL;
+
+	if( bCompressed )
+		glCompressedTexSubImage3DARB( GL_TEXTURE_2D_ARRAY_EXT, 0, 0, 0, _layer, m_Width, m_Height, 1, internalFormat, size, pPixels );
+	else
+		glTexSubImage3D( GL_TEXTURE_2D_ARRAY_EXT, 0, 0, 0, _layer, m_Width, m_Height, 1, srcFormat, srcType, pPixels );
+
+	if( pPixels == NULL )
+		m_Stream.Done();
+
+	VERIFYGL;
+
+	State()->EndUpload( GL_TEXTURE_2D_ARRAY_EXT, size );
+
+	m_bDirty = true;
+	return true;
+}
+
+/*
+	Bind().
+	Array textures are only sampled by shaders, there is no fixed function enable for them.
+*/
+bool	CTextureArrayGL::Bind( const uint32 _index )
+{
+	State()->BindTexture( _index, GL_TEXTURE_2D_ARRAY_EXT, m_TexID, false );
+
+	m_bDirty = false;
+
+	VERIFYGL;
+	return true;
+}
+
+/*
+	Unbind().
+	Nothing to turn off, and leaving it bound makes binding it again next frame free.
+*/
+bool	CTextureArrayGL::Unbind( const uint32 /*_index*/ )
+{
+	return true;
+}
+
+}
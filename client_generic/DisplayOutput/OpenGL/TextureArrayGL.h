@@ -0,0 +1,41 @@
+#ifndef _TEXTUREARRAYGL_H
+#define _TEXTUREARRAYGL_H
+
+#include "TextureArray.h"
+#include "TextureFlatGL.h"
+
+namespace	DisplayOutput
+{
+
+/*
+	CTextureArrayGL.
+	GL_TEXTURE_2D_ARRAY_EXT, for 8 bit intensity, RGBA and DXT1 images.
+	Layers are streamed through pixel buffer objects like CTextureFlatGL does, and the texture object lives as long as this does.
+*/
+class CTextureArrayGL : public CTextureArray
+{
+	GLuint	m_TexID;
+
+	spCGLStateCache	m_spState;
+
+	//	Shared with other displays, it is bound through the cache of the one drawing.
+	CGLStateCache	*State( void )	{	return CGLStateCache::For( m_spState );	};
+
+	CPixelStreamGL	m_Stream;
+
+	bool	Respecify( spCImage _spImage, const GLenum _srcFormat, const GLenum _srcType, const GLint _internalFormat );
+
+	public:
+			CTextureArrayGL( const uint32 _numLayers, const uint32 _flags, spCGLStateCache _spState );
+			virtual ~CTextureArrayGL();
+
+			bool	Upload( spCImage _spImage, const uint32 _layer, const bool _bRespecify );
+			bool	Bind( const uint32 _index );
+			bool	Unbind( const uint32 _index );
+};
+
+MakeSmartPointers( CTextureArrayGL );
+
+}
+
+#endif
@@ -110,12 +110,16 @@ static const GLenum srcTypes[] =
 /*
 */
 #ifdef MAC
-CTextureFlatGL::CTextureFlatGL( const uint32 _flags, CGLContextObj glCtx ) : CTextureFlat( _flags )
+CTextureFlatGL::CTextureFlatGL( const uint32 _flags, CGLContextObj glCtx, spCGLStateCache _spState ) : CTextureFlat( _flags ), m_spState( _spState ), m_Stream( glCtx )
 #else
-CTextureFlatGL::CTextureFlatGL( const uint32 _flags ) : CTextureFlat( _flags )
+CTextureFlatGL::CTextureFlatGL( const uint32 _flags, spCGLStateCache _spState ) : CTextureFlat( _flags ), m_spState( _spState )
 #endif
 {
 	m_TexTarget = GL_TEXTURE_2D;
+	m_bParameters = false;
+	m_StorageWidth = 0;
+	m_StorageHeight = 0;
+	m_StorageFormat = 0;
 	
 #ifdef MAC
 	cgl_ctx = glCtx;//CGLGetCurrentContext();
@@ -132,10 +136,138 @@ CTextureFlatGL::CTextureFlatGL( const uint32 _flags ) : CTextureFlat( _flags )
 */
 CTextureFlatGL::~CTextureFlatGL()
 {
-	glDeleteTextures( 1, &m_TexID );
+	m_Stream.Release();
+
+	State()->DeleteTexture( m_TexTarget, m_TexID );
 	VERIFYGL;
 }
 
+/*
+	Reupload().
+	The texture may have lost its contents, so streaming storage has to be respecified too.
+*/
+bool	CTextureFlatGL::Reupload( void )
+{
+	m_StorageWidth = m_StorageHeight = 0;
+	m_bParameters = false;
+	return CTextureFlat::Reupload();
+}
+
+/*
+	TextureSize().
+	Size of the texture needed to hold the image, rounded up to a power of two if the hardware wants that.
+*/
+void	CTextureFlatGL::TextureSize( spCImage _spImage, const uint32 _mipMapLevel, uint32 &_texWidth, uint32 &_texHeight )
+{
+#ifndef LINUX_GNU
+	if( GLEE_ARB_texture_non_power_of_two || m_TexTarget == GL_TEXTURE_RECTANGLE_EXT )
+#else
+	if( GLEE_ARB_texture_non_power_of_two || m_TexTarget == GL_TEXTURE_RECTANGLE_ARB )
+
+#endif
+	{
+		_texWidth = _spImage->GetWidth( _mipMapLevel );
+		_texHeight = _spImage->GetHeight( _mipMapLevel );
+	}
+	else
+	{
+		_texWidth = Base::Math::UpperPowerOfTwo( _spImage->GetWidth( _mipMapLevel ) );
+		_texHeight = Base::Math::UpperPowerOfTwo( _spImage->GetHeight( _mipMapLevel ) );
+	}
+}
+
+/*
+	UpdateRect().
+	Texture coordinates covering the image part of the texture.
+*/
+void	CTextureFlatGL::UpdateRect( const uint32 _imgWidth, const uint32 _imgHeight, const uint32 _texWidth, const uint32 _texHeight )
+{
+#ifndef LINUX_GNU
+	if ( m_TexTarget == GL_TEXTURE_RECTANGLE_EXT )
+#else 
+	if ( m_TexTarget == GL_TEXTURE_RECTANGLE_ARB )
+#endif
+		SetRect( Base::Math::CRect( (fp4)_imgWidth,  (fp4)_imgHeight ) );
+	else
+		SetRect( Base::Math::CRect( (fp4)_imgWidth / (fp4)_texWidth,  (fp4)_imgHeight / (fp4)_texHeight ) );
+}
+
+/*
+	SetParameters().
+	Expects the texture to be bound.
+*/
+void	CTextureFlatGL::SetParameters( void )
+{
+	if( m_bParameters )
+		return;
+
+	glTexParameteri( m_TexTarget, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+	glTexParameteri( m_TexTarget, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+	glTexParameteri( m_TexTarget, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+	glTexParameteri( m_TexTarget, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+	m_bParameters = true;
+}
+
+/*
+	StreamUpload().
+	Texture storage is allocated once, after that only the pixels are replaced with glTexSubImage2D.
+	With pixel buffer objects the pixels go through m_Stream, so the transfer to the gpu runs asynchronously instead of stalling here.
+	Compressed images (BC1 video frames) take the same route with the glCompressed* calls, their size has to be whole blocks.
+	Expects the texture to be bound.
+*/
+bool	CTextureFlatGL::StreamUpload( spCImage _spImage, const GLenum _srcFormat, const GLenum _srcType, const GLint _internalFormat )
+{
+	uint8	*pSrc = _spImage->GetData( 0 );
+	if( pSrc == NULL )
+		return false;
+
+	uint32 imgWidth = _spImage->GetWidth();
+	uint32 imgHeight = _spImage->GetHeight();
+
+	uint32 texWidth, texHeight;
+	TextureSize( _spImage, 0, texWidth, texHeight );
+
+	const CImageFormat &format = _spImage->GetFormat();
+	const bool bCompressed = format.isCompressed();
+	uint32 size = _spImage->getMipMappedSize( 0, 1 );
+
+	if( texWidth != m_StorageWidth || texHeight != m_StorageHeight || _internalFormat != m_StorageFormat )
+	{
+		SetParameters();
+
+		if( bCompressed )
+		{
+			uint32 texSize = ( ( texWidth + 3 ) / 4 ) * ( ( texHeight + 3 ) / 4 ) * format.getBPBlock();
+			glCompressedTexImage2DARB( m_TexTarget, 0, _internalFormat, texWidth, texHeight, 0, texSize, NULL );
+		}
+		else
+			glTexImage2D( m_TexTarget, 0, _internalFormat, texWidth, texHeight, 0, _srcFormat, _srcType, NULL );
+
+		m_StorageWidth = texWidth;
+		m_StorageHeight = texHeight;
+		m_StorageFormat = _internalFormat;
+
+		UpdateRect( imgWidth, imgHeight, texWidth, texHeight );
+	}
+
+	if( m_Stream.Write( pSrc, size ) )
+	{
+		//	Source is offset 0 into the bound PBO.
+		if( bCompressed )
+			glCompressedTexSubImage2DARB( m_TexTarget, 0, 0, 0, imgWidth, imgHeight, _internalFormat, size, NULL );
+		else
+			glTexSubImage2D( m_TexTarget, 0, 0, 0, imgWidth, imgHeight, _srcFormat, _srcType, NULL );
+		m_Stream.Done();
+		return true;
+	}
+
+	if( bCompressed )
+		glCompressedTexSubImage2DARB( m_TexTarget, 0, 0, 0, imgWidth, imgHeight, _internalFormat, size, pSrc );
+	else
+		glTexSubImage2D( m_TexTarget, 0, 0, 0, imgWidth, imgHeight, _srcFormat, _srcType, pSrc );
+	return true;
+}
+
 /*
 */
 bool	CTextureFlatGL::Upload( spCImage _spImage )
@@ -144,6 +276,11 @@ bool	CTextureFlatGL::Upload( spCImage _spImage )
 
 	if (m_spImage==NULL) return false;
 
+	//	Same pixels as last time, nothing to do.
+	uint64 generation = _spImage->GetGeneration();
+	if( generation != 0 && generation == m_UploadedGeneration )
+		return true;
+
 	CImageFormat	format = _spImage->GetFormat();
 
 	static const GLenum srcFormats[] =
@@ -166,18 +303,40 @@ bool	CTextureFlatGL::Upload( spCImage _spImage )
 	if( format.isFloat() )
 		internalFormat = internalFormats[ format.getFormatEnum() - (eImage_RGBA32F - eImage_I16F)];
 
-	glBindTexture( m_TexTarget, m_TexID );
+	State()->BeginUpload( m_TexTarget, m_TexID );
 
-	glTexParameteri( m_TexTarget, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
-	glTexParameteri( m_TexTarget, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+#ifndef MAC
+	//	Single level images (video frames) are streamed into persistent storage, of the compressed formats only DXT1 ones.
+	//	Not on mac, where client storage already avoids the copy.
+	if( ( !format.isCompressed() || format.getFormatEnum() == eImage_DXT1 ) && _spImage->GetNumMipMaps() <= 1 )
+	{
+		uint32 bytes = 0;
+		if( StreamUpload( _spImage, srcFormat, srcType, internalFormat ) )
+		{
+			bytes = _spImage->getMipMappedSize( 0, 1 );
+			//	The pixels were copied, no need to keep the buffer (and its frame pool slot) alive.
+			m_bufferCache = NULL;
+			m_bDirty = true;
+			m_UploadedGeneration = generation;
+		}
 
-	// Set filter modes.
-	glTexParameteri( m_TexTarget, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-	glTexParameteri( m_TexTarget, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+		VERIFYGL;
+
+		State()->EndUpload( m_TexTarget, bytes );
+
+		return true;
+	}
+#endif
+
+	//	Everything below respecifies the texture.
+	m_StorageWidth = m_StorageHeight = 0;
+
+	SetParameters();
 
 	// Upload it all
 	uint8	*pSrc;
 	uint32 mipMapLevel = 0;
+	uint32 bytes = 0;
 	while( (pSrc = _spImage->GetData( mipMapLevel ) ) != NULL )
 	{
 		if( format.isCompressed() )
@@ -209,21 +368,7 @@ bool	CTextureFlatGL::Upload( spCImage _spImage )
 			glGetIntegerv(GL_TEXTURE_STORAGE_HINT_APPLE, &save5);
 #endif
 			
-#ifndef LINUX_GNU
-			if( GLEE_ARB_texture_non_power_of_two || m_TexTarget == GL_TEXTURE_RECTANGLE_EXT )
-#else
-			if( GLEE_ARB_texture_non_power_of_two || m_TexTarget == GL_TEXTURE_RECTANGLE_ARB )
-
-#endif
-			{
-				texWidth = imgWidth;
-				texHeight = imgHeight;
-			}
-			else
-			{
-				texWidth = Base::Math::UpperPowerOfTwo( _spImage->GetWidth( mipMapLevel ) );
-				texHeight = Base::Math::UpperPowerOfTwo( _spImage->GetHeight( mipMapLevel ) );
-			}
+			TextureSize( _spImage, mipMapLevel, texWidth, texHeight );
 			
 			if ( texWidth == imgWidth && texHeight == imgHeight )
 			{
@@ -251,16 +396,7 @@ bool	CTextureFlatGL::Upload( spCImage _spImage )
 				glTexSubImage2D( m_TexTarget, mipMapLevel, 0, 0, _spImage->GetWidth( mipMapLevel ), _spImage->GetHeight( mipMapLevel ), srcFormat, srcType, pSrc );
 			
 				if (mipMapLevel == 0)
-				{
-#ifndef LINUX_GNU
-					if ( m_TexTarget == GL_TEXTURE_RECTANGLE_EXT )
-#else 
-					if ( m_TexTarget == GL_TEXTURE_RECTANGLE_ARB )
-#endif
-						SetRect( Base::Math::CRect( (fp4)imgWidth,  (fp4)imgHeight ) );
-					else
-						SetRect( Base::Math::CRect( (fp4)imgWidth / (fp4)texWidth,  (fp4)imgHeight / (fp4)texHeight ) );
-				}
+					UpdateRect( imgWidth, imgHeight, texWidth, texHeight );
 			}
 			
 #ifdef MAC
@@ -272,15 +408,17 @@ bool	CTextureFlatGL::Upload( spCImage _spImage )
 		}
 				
 		m_bufferCache = _spImage->GetStorageBuffer();
+		bytes += _spImage->getMipMappedSize( mipMapLevel, 1 );
 					
 		mipMapLevel++;
 	}
 
 	m_bDirty = true;
+	m_UploadedGeneration = generation;
 
 	VERIFYGL;
 
-	glBindTexture( m_TexTarget, 0 );
+	State()->EndUpload( m_TexTarget, bytes );
 	
 	return true;
 }
@@ -289,9 +427,7 @@ bool	CTextureFlatGL::Upload( spCImage _spImage )
 */
 bool	CTextureFlatGL::Bind( const uint32 _index )
 {
-	glActiveTextureARB( GL_TEXTURE0 + _index );
-	glEnable( m_TexTarget );
-	glBindTexture( m_TexTarget, m_TexID );
+	State()->BindTexture( _index, m_TexTarget, m_TexID, true );
 	
 	m_bDirty = false;
 	
@@ -300,12 +436,12 @@ bool	CTextureFlatGL::Bind( const uint32 _index )
 }
 
 /*
+	Unbind().
+	Only turns texturing off on the unit, the binding stays so binding the same texture again is free.
 */
 bool	CTextureFlatGL::Unbind( const uint32 _index )
 {
-	glActiveTextureARB( GL_TEXTURE0 + _index );
-	glBindTexture( m_TexTarget, 0 );
-	glDisable( m_TexTarget );
+	State()->EnableTexture( _index, 0 );
 	VERIFYGL;
 	return true;
 }
@@ -2,6 +2,8 @@
 #define _TEXTUREFLATGL_H
 
 #include "TextureFlat.h"
+#include "GLStateCache.h"
+#include "PixelStreamGL.h"
 
 namespace	DisplayOutput
 {
@@ -21,16 +23,37 @@ class CTextureFlatGL : public CTextureFlat
 #ifdef MAC
 	CGLContextObj cgl_ctx;
 #endif
+
+	spCGLStateCache	m_spState;
+
+	//	Shared with other displays, it is bound through the cache of the one drawing.
+	CGLStateCache	*State( void )	{	return CGLStateCache::For( m_spState );	};
+
+	//	Sampling parameters are per texture object and never change, so they are set once.
+	bool	m_bParameters;
+
+	//	Storage allocated for streaming, reallocated only when any of these change.
+	uint32	m_StorageWidth;
+	uint32	m_StorageHeight;
+	GLint	m_StorageFormat;
+
+	CPixelStreamGL	m_Stream;
+
+	bool	StreamUpload( spCImage _spImage, const GLenum _srcFormat, const GLenum _srcType, const GLint _internalFormat );
+	void	TextureSize( spCImage _spImage, const uint32 _mipMapLevel, uint32 &_texWidth, uint32 &_texHeight );
+	void	UpdateRect( const uint32 _imgWidth, const uint32 _imgHeight, const uint32 _texWidth, const uint32 _texHeight );
+	void	SetParameters( void );
 	
 
 	public:
 #ifdef MAC
-			CTextureFlatGL( const uint32 _flags = 0, CGLContextObj glctx = NULL  );
+			CTextureFlatGL( const uint32 _flags, CGLContextObj glctx, spCGLStateCache _spState );
 #else
-			CTextureFlatGL( const uint32 _flags = 0  );
+			CTextureFlatGL( const uint32 _flags, spCGLStateCache _spState );
 #endif
 			virtual ~CTextureFlatGL();
 
+			bool	Reupload( void );
 			bool	Upload( spCImage _spImage );
 			bool	Bind( const uint32 _index );
 			bool	Unbind( const uint32 _index );
@@ -9,6 +9,7 @@
 #include "glx.h"
 #include "Log.h"
 #include "Exception.h"
+#include "LatencyStats.h"
 
 namespace	DisplayOutput
 {
@@ -38,14 +39,20 @@ static Atom XA_NET_WM_STATE_FULLSCREEN;
 
 static bool bScreensaverMode = false;
 
+//	Context of the first display, the ones opened after it share its objects.
+static GLXContext s_RootContext = NULL;
+
 /*
 */
-CUnixGL::CUnixGL() : CDisplayOutput()
+CUnixGL::CUnixGL() : CDisplayOutput(), m_GlxContext( NULL ), m_ShareGroup( NULL )
 {
 }
 
 CUnixGL::~CUnixGL()
 {
+  if ( s_RootContext == m_GlxContext )
+    s_RootContext = NULL;
+
 #ifdef LINUX_GNU
   if (!bScreensaverMode) {
 #endif
@@ -74,11 +81,78 @@ static Bool WaitForNotify( Display *dpy, XEvent *event, XPointer arg ) {
 #endif
 
 
+static bool bContextError = false;
+
+static int ContextErrorHandler( Display */*dpy*/, XErrorEvent */*event*/ )
+{
+  bContextError = true;
+  return 0;
+}
+
+/*
+	createContext().
+	A context sharing objects with the first display's, or one of its own if the server won't have that (another screen, indirect
+	rendering...), textures are then uploaded for every display separately.
+	With _pVisual an old style context for that visual is created, otherwise one for _config.
+*/
+GLXContext CUnixGL::createContext( GLXFBConfig _config, XVisualInfo *_pVisual )
+{
+    GLXContext context = NULL;
+
+    if ( s_RootContext != NULL )
+    {
+        //	A share list that doesn't fit is an X error, which would end the program.
+        bContextError = false;
+        int (*oldHandler)( Display *, XErrorEvent * ) = XSetErrorHandler( ContextErrorHandler );
+
+        if ( _pVisual != NULL )
+            context = glXCreateContext( m_pDisplay, _pVisual, s_RootContext, GL_TRUE );
+        else
+            context = glXCreateNewContext( m_pDisplay, _config, GLX_RGBA_TYPE, s_RootContext, GL_TRUE );
+
+        XSync( m_pDisplay, False );
+        XSetErrorHandler( oldHandler );
+
+        if ( context != NULL && !bContextError )
+        {
+            g_Log->Info( "Sharing GL objects with the first display..." );
+            m_ShareGroup = s_RootContext;
+            return context;
+        }
+
+        if ( context != NULL )
+            glXDestroyContext( m_pDisplay, context );
+
+        g_Log->Warning( "Can't share GL objects with the first display, uploading frames for this one separately" );
+    }
+
+    if ( _pVisual != NULL )
+        context = glXCreateContext( m_pDisplay, _pVisual, 0, GL_TRUE );
+    else
+        context = glXCreateNewContext( m_pDisplay, _config, GLX_RGBA_TYPE, 0, GL_TRUE );
+
+    if ( s_RootContext == NULL )
+    {
+        s_RootContext = context;
+        m_ShareGroup = context;
+    }
+
+    return context;
+}
+
 bool	CUnixGL::Initialize( const uint32 _width, const uint32 _height, const bool _bFullscreen )
 {
     m_Width = _width;
     m_Height = _height;
 
+    //	With more than one display each is drawn from its own thread, Xlib has to know before the first connection.
+    static bool bThreadsInitialized = false;
+    if ( !bThreadsInitialized )
+    {
+        XInitThreads();
+        bThreadsInitialized = true;
+    }
+
     m_pDisplay = XOpenDisplay(0);
     assert(m_pDisplay);
 
@@ -171,7 +245,7 @@ bool	CUnixGL::Initialize( const uint32 _width, const uint32 _height, const bool
        
        assert (numReturned>0);
        
-       m_GlxContext = glXCreateContext ( m_pDisplay, &xvis[0], 0, GL_TRUE);
+       m_GlxContext = createContext( renderFBConfig, &xvis[0] );
        
        glXMakeCurrent ( m_pDisplay, m_Window, m_GlxContext);
 
@@ -195,7 +269,7 @@ bool	CUnixGL::Initialize( const uint32 _width, const uint32 _height, const bool
        // need to call this twice !!
        setFullScreen( _bFullscreen );
 
-       m_GlxContext = glXCreateNewContext(m_pDisplay, renderFBConfig, GLX_RGBA_TYPE, 0, GL_TRUE);
+       m_GlxContext = createContext( renderFBConfig, NULL );
        m_GlxWindow = glXCreateWindow(m_pDisplay, renderFBConfig, m_Window, 0);
        glXMakeContextCurrent(m_pDisplay, m_GlxWindow, m_GlxWindow, m_GlxContext);
 
@@ -226,7 +300,7 @@ bool	CUnixGL::Initialize( const uint32 _width, const uint32 _height, const bool
     XMapRaised( m_pDisplay, m_Window );
     if (!bScreensaverMode && _bFullscreen) XIfEvent( m_pDisplay, &event, WaitForNotify, (XPointer) m_Window );
 
-    m_GlxContext = glXCreateNewContext(m_pDisplay, renderFBConfig, GLX_RGBA_TYPE, 0, GL_TRUE);
+    m_GlxContext = createContext( renderFBConfig, NULL );
     m_GlxWindow = glXCreateWindow(m_pDisplay, renderFBConfig, m_Window, 0);
     XMapWindow (m_pDisplay, m_Window);
     glXMakeContextCurrent(m_pDisplay, m_GlxWindow, m_GlxWindow, m_GlxContext);
@@ -482,10 +556,34 @@ void CUnixGL::Update()
     checkClientMessages();
 }
 
+/*
+	MakeCurrent().
+	Only needed with more than one display, the context of a single one stays current from Initialize() on.
+*/
+void CUnixGL::MakeCurrent()
+{
+    if ( m_GlxContext == NULL || glXGetCurrentContext() == m_GlxContext )
+        return;
+
+    if ( bScreensaverMode )
+        glXMakeCurrent( m_pDisplay, m_Window, m_GlxContext );
+    else
+        glXMakeContextCurrent( m_pDisplay, m_GlxWindow, m_GlxWindow, m_GlxContext );
+}
+
+/*
+*/
+void CUnixGL::DoneCurrent()
+{
+    if ( m_GlxContext != NULL && glXGetCurrentContext() == m_GlxContext )
+        glXMakeCurrent( m_pDisplay, None, NULL );
+}
+
 /*
 */
 void CUnixGL::SwapBuffers()
 {
+    Base::CLatencyScope swapScope( Base::eLatencySwap );
     glXSwapBuffers( m_pDisplay, m_GlxWindow );
 }
 
@@ -32,6 +32,11 @@ class CUnixGL : public CDisplayOutput
     uint32	m_WidthFS;
     uint32	m_HeightFS;
 
+    //	Context of the first display, if ours shares objects with it.
+    GLXContext	m_ShareGroup;
+
+    GLXContext	createContext( GLXFBConfig _config, XVisualInfo *_pVisual );
+
     void    setFullScreen( bool enabled );
     void    setWindowDecorations( bool enabled );
     void    toggleVSync();
@@ -52,6 +57,10 @@ class CUnixGL : public CDisplayOutput
 			virtual void Update();
 
 			void SwapBuffers();
+
+			virtual const void	*ShareGroup()	{	return m_ShareGroup;	};
+			virtual void	MakeCurrent();
+			virtual void	DoneCurrent();
 };
 
 typedef	CUnixGL	CDisplayGL;
@@ -16,6 +16,7 @@ CRenderer::CRenderer()
 	m_aspSelectedTextures = new spCTexture[ MAX_TEXUNIT ];
 
 	m_bDirtyMatrices = 0;
+	memset( &m_FrameStats, 0, sizeof(m_FrameStats) );
 }
 
 /*
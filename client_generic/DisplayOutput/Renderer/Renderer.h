@@ -6,6 +6,7 @@
 #include "SmartPtr.h"
 #include "Font.h"
 #include "TextureFlat.h"
+#include "TextureArray.h"
 #include "Shader.h"
 #include "Image.h"
 #include "DisplayOutput.h"
@@ -99,6 +100,24 @@ class CBlend
 
 MakeSmartPointers( CBlend );
 
+/*
+	sRenderStats.
+	What the renderer asked of the driver over a frame. A texture upload counts as one call.
+*/
+struct	sRenderStats
+{
+	uint32	m_GLCalls;
+	uint32	m_DrawCalls;
+	uint32	m_Vertices;
+
+	//	State changes that went to the driver, and the ones dropped because the state was already set.
+	uint32	m_StateChanges;
+	uint32	m_StateElided;
+
+	//	Texture data sent to the gpu.
+	uint32	m_UploadBytes;
+};
+
 /*
 	CRenderer().
 
@@ -118,6 +137,9 @@ class CRenderer
 		Base::Math::CMatrix4x4	m_WorldMat, m_ViewMat, m_ProjMat;
 		uint32	m_bDirtyMatrices;
 
+		//	Last finished frame, renderers that don't count leave it zeroed.
+		sRenderStats	m_FrameStats;
+
 	public:
 			CRenderer();
 			virtual ~CRenderer();
@@ -132,16 +154,23 @@ class CRenderer
 			//
 			virtual	bool	BeginFrame( void )	{	return( true );	};
 			virtual	bool	EndFrame( bool /*drawn*/ = true )	{	return( true );	};
+			const sRenderStats	&FrameStats( void ) const	{	return m_FrameStats;	};
 
 			//	Textures.
 			virtual spCTextureFlat	NewTextureFlat( const uint32 flags = 0 ) = PureVirtual;
 			virtual spCTextureFlat	NewTextureFlat( spCImage _spImage, const uint32 flags = 0 ) = PureVirtual;
 
+			//	Texture arrays, NULL where the renderer can't do them.
+			virtual spCTextureArray	NewTextureArray( const uint32 /*_numLayers*/, const uint32 /*flags*/ = 0 )	{	return NULL;	};
+
 			//	Font.
 			virtual	spCBaseFont		NewFont( CFontDescription &_desc ) = PureVirtual;
 			virtual void			Text( spCBaseFont /*_spFont*/, const std::string &/*_text*/, const Base::Math::CVector4 &/*_color*/, const Base::Math::CRect &/*_rect*/, uint32 /*_flags*/ ) {};
 			virtual Base::Math::CVector2	GetTextExtent( spCBaseFont /*_spFont*/, const std::string &/*_text*/ )	{	return Base::Math::CVector2( 0, 0 );	};
 
+			//	_text drawn into an image, to stand in for Text() as long as the text doesn't change. NULL where the renderer can't.
+			virtual spCImage		TextImage( spCBaseFont /*_spFont*/, const std::string &/*_text*/ )	{	return NULL;	};
+
 			virtual bool HasShaders() { return false; }
 			//	Shaders.
 			virtual	spCShader		NewShader( const char *_pVertexShader, const char *_pFragmentShader ) = PureVirtual;
@@ -0,0 +1,66 @@
+#ifndef _TEXTUREARRAY_H
+#define _TEXTUREARRAY_H
+
+#include "Texture.h"
+#include "Image.h"
+#include "Rect.h"
+
+namespace	DisplayOutput
+{
+
+/*
+	CTextureArray.
+	A stack of equally sized single level textures in one texture object, addressed by layer in the shader.
+	Storage follows the images uploaded into it: a picture of another size or format respecifies it, and that loses the other layers.
+*/
+class CTextureArray : public CTexture
+{
+	protected:
+		uint32				m_NumLayers;
+		bool				m_bDirty;
+
+		//	Current storage, 0 until the first upload.
+		uint32				m_Width;
+		uint32				m_Height;
+		eImageFormat		m_Format;
+
+		//	Bumped every time the storage is respecified.
+		uint32				m_Allocations;
+
+		Base::Math::CRect	m_texRect;
+
+	public:
+			CTextureArray( const uint32 _numLayers, const uint32 _flags = 0 ) : CTexture( _flags ), m_NumLayers( _numLayers ), m_bDirty( false ),
+																				m_Width( 0 ), m_Height( 0 ), m_Format( eImage_None ), m_Allocations( 0 ),
+																				m_texRect( 1, 1 )	{}
+			virtual ~CTextureArray()	{}
+
+			/*
+				Upload().
+				Replaces layer _layer with _spImage. If the image doesn't match the storage it is respecified when _bRespecify is set,
+				otherwise nothing happens and false is returned.
+			*/
+			virtual	bool	Upload( spCImage _spImage, const uint32 _layer, const bool _bRespecify ) = PureVirtual;
+			virtual	bool	Bind( const uint32 _index ) = PureVirtual;
+			virtual	bool	Unbind( const uint32 _index ) = PureVirtual;
+
+			virtual bool	Dirty( void )	{	return m_bDirty;	};
+
+			//	True if _spImage can go into a layer without respecifying the storage.
+			bool	Fits( spCImage _spImage ) const
+			{
+				return _spImage->GetWidth() == m_Width && _spImage->GetHeight() == m_Height && _spImage->GetFormat().getFormatEnum() == m_Format;
+			}
+
+			uint32	NumLayers( void ) const		{	return m_NumLayers;		};
+			uint32	Allocations( void ) const	{	return m_Allocations;	};
+
+			//	Layers are always exactly the size of the images, so they are sampled over the whole range.
+			Base::Math::CRect&	GetRect( void )	{	return m_texRect;	};
+};
+
+MakeSmartPointers( CTextureArray );
+
+}
+
+#endif
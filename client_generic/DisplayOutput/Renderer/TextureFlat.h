@@ -19,12 +19,13 @@ class CTextureFlat : public CTexture
 		bool				m_bDirty;
 		Base::Math::CRect	m_texRect;
 		Base::spCAlignedBuffer		m_bufferCache;
+		uint64				m_UploadedGeneration;
 
 	public:
 			CTextureFlat( const uint32 _flags = 0 );
 			virtual ~CTextureFlat();
 
-			virtual bool	Reupload( void ) { return Upload(m_spImage); };
+			virtual bool	Reupload( void ) { m_UploadedGeneration = 0; return Upload(m_spImage); };
 			virtual	bool	Upload( spCImage _spImage ) = PureVirtual;
 			virtual	bool	Bind( const uint32 _index ) = PureVirtual;
 			virtual	bool	Unbind( const uint32 _index ) = PureVirtual;
@@ -1,8 +1,11 @@
 #include <stdio.h>
+#include <string.h>
 #include <string>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include "Log.h"
 #include "Networking.h"
 
@@ -24,6 +27,8 @@ CFileDownloader::CFileDownloader( const std::string &_name ) : CCurlTransfer( _n
 */
 CFileDownloader::~CFileDownloader()
 {
+	//	The loop thread writes to m_Data until it lets go, which has to happen before it goes away.
+	g_NetworkManager->Cancel( this );
 }
 
 /*
@@ -45,17 +50,17 @@ int32 CFileDownloader::customWrite( void *_pBuffer, size_t _size, size_t _nmemb,
 
 
 /*
-	Perform().
-	Download specific Perform function.
+	Start().
+	Download specific Start function.
 */
-bool	CFileDownloader::Perform( const std::string &_url )
+bool	CFileDownloader::Start( const std::string &_url )
 {
 	m_Data = "";
 
 	if( !Verify( curl_easy_setopt( m_pCurl, CURLOPT_WRITEDATA, this ) ) )	return false;
 	if( !Verify( curl_easy_setopt( m_pCurl, CURLOPT_WRITEFUNCTION, &CFileDownloader::customWrite ) ) )	return false;
 
-	return CCurlTransfer::Perform( _url );
+	return CCurlTransfer::Start( _url );
 }
 
 /*
@@ -106,4 +111,296 @@ bool CFileDownloader_TimeCondition::PerformDownloadWithTC( const std::string &_u
 	return CFileDownloader::Perform( _url );
 }
 
+
+/*
+	CFileStreamer().
+	Constructor.
+*/
+CFileStreamer::CFileStreamer( const std::string &_name ) : CCurlTransfer( _name ), m_pFile( NULL ), m_Offset( 0 ), m_Written( 0 ), m_ExpectedSize( 0 ),
+															m_bChecked( false ), m_bDiscard( false ), m_bMismatch( false ), m_bAlreadyComplete( false )
+{
+	//	Partial content, what a resumed download gets.
+	Allow( 206 );
+}
+
+/*
+	~CFileStreamer().
+	Destructor.
+*/
+CFileStreamer::~CFileStreamer()
+{
+	//	The loop thread writes to the file until it lets go.
+	g_NetworkManager->Cancel( this );
+	Close();
+}
+
+/*
+	Close().
+*/
+void	CFileStreamer::Close()
+{
+	if( m_pFile != NULL )
+	{
+		fclose( m_pFile );
+		m_pFile = NULL;
+	}
+}
+
+/*
+	Open().
+	Picks up where an earlier download into _output stopped, unless it holds more than _expectedSize.
+*/
+bool	CFileStreamer::Open( const std::string &_output, const uint64 _expectedSize )
+{
+	Close();
+
+	m_Output = _output;
+	m_ExpectedSize = _expectedSize;
+	m_Offset = 0;
+
+	struct stat sbuf;
+	if( stat( _output.c_str(), &sbuf ) == 0 )
+		m_Offset = static_cast<uint64>(sbuf.st_size);
+
+	if( m_ExpectedSize != 0 && m_Offset > m_ExpectedSize )
+		m_Offset = 0;
+
+	m_pFile = fopen( _output.c_str(), m_Offset ? "ab" : "wb" );
+	if( m_pFile == NULL )
+	{
+		g_Log->Warning( "Failed to open %s.", _output.c_str() );
+		return false;
+	}
+
+	setvbuf( m_pFile, NULL, _IOFBF, kBufferSize );
+	m_Written = m_Offset;
+
+	if( m_Offset != 0 )
+		g_Log->Info( "Resuming %s at %llu bytes.", _output.c_str(), (unsigned long long)m_Offset );
+
+	return true;
+}
+
+/*
+	customWrite().
+	Appends incoming data to the file, fails the transfer as soon as it can't add up to the expected size.
+*/
+int32 CFileStreamer::customWrite( void *_pBuffer, size_t _size, size_t _nmemb, void *_pUserData )
+{
+	CFileStreamer *pOut = (CFileStreamer *)_pUserData;
+	if( !pOut )
+	{
+		g_Log->Info( "Error, no _pUserData." );
+		return -1;
+	}
+
+	const size_t numBytes = _size * _nmemb;
+
+	if( !pOut->m_bChecked )
+	{
+		pOut->m_bChecked = true;
+
+		//	The body of an error page doesn't belong in the file, CCurlTransfer::Finish() reports the code.
+		long code = 0;
+		curl_easy_getinfo( pOut->m_pCurl, CURLINFO_RESPONSE_CODE, &code );
+		pOut->m_bDiscard = ( code != 200 && code != 206 );
+
+		curl_off_t length = -1;
+		curl_easy_getinfo( pOut->m_pCurl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length );
+		if( !pOut->m_bDiscard && pOut->m_ExpectedSize != 0 && length >= 0 && pOut->m_Offset + static_cast<uint64>(length) != pOut->m_ExpectedSize )
+		{
+			g_Log->Warning( "%s: server sends %llu bytes, expected %llu.", pOut->m_Output.c_str(), (unsigned long long)( pOut->m_Offset + length ), (unsigned long long)pOut->m_ExpectedSize );
+			pOut->m_bMismatch = true;
+			return 0;
+		}
+	}
+
+	if( pOut->m_bDiscard )
+		return (int32)numBytes;
+
+	if( pOut->m_ExpectedSize != 0 && pOut->m_Written + numBytes > pOut->m_ExpectedSize )
+	{
+		g_Log->Warning( "%s: more than the expected %llu bytes.", pOut->m_Output.c_str(), (unsigned long long)pOut->m_ExpectedSize );
+		pOut->m_bMismatch = true;
+		return 0;
+	}
+
+	if( fwrite( _pBuffer, 1, numBytes, pOut->m_pFile ) != numBytes )
+		return 0;
+
+	pOut->m_Written += numBytes;
+	return (int32)numBytes;
+}
+
+/*
+	Start().
+	Streamer specific Start function, asks for the part of the file that is missing.
+*/
+bool	CFileStreamer::Start( const std::string &_url )
+{
+	if( m_pFile == NULL )
+		return false;
+
+	if( m_ExpectedSize != 0 && m_Offset == m_ExpectedSize )
+	{
+		//	Came down completely last time, but wasn't renamed.
+		m_bAlreadyComplete = true;
+		Status( "Completed" );
+		return true;
+	}
+
+	if( !Verify( curl_easy_setopt( m_pCurl, CURLOPT_WRITEDATA, this ) ) )	return false;
+	if( !Verify( curl_easy_setopt( m_pCurl, CURLOPT_WRITEFUNCTION, &CFileStreamer::customWrite ) ) )	return false;
+	if( !Verify( curl_easy_setopt( m_pCurl, CURLOPT_RESUME_FROM_LARGE, (curl_off_t)m_Offset ) ) )	return false;
+
+	return CCurlTransfer::Start( _url );
+}
+
+/*
+	Finish().
+	Closes the file once the transfer ended. A file that can't be resumed is removed, so the next try starts over.
+*/
+bool	CFileStreamer::Finish()
+{
+	bool bOk = m_bAlreadyComplete || CCurlTransfer::Finish();
+
+	Close();
+
+	if( bOk && m_ExpectedSize != 0 && m_Written != m_ExpectedSize )
+	{
+		g_Log->Warning( "%s: %llu bytes, expected %llu.", m_Output.c_str(), (unsigned long long)m_Written, (unsigned long long)m_ExpectedSize );
+		m_bMismatch = true;
+		bOk = false;
+	}
+
+	//	Wrong size, or the server doesn't do ranges.
+	if( m_bMismatch || Result() == CURLE_RANGE_ERROR )
+		remove( m_Output.c_str() );
+
+	return bOk;
+}
+
+/*
+	CInflateStreamer().
+	Constructor.
+*/
+CInflateStreamer::CInflateStreamer( const std::string &_name ) : CCurlTransfer( _name ), m_bChecked( false ), m_bDiscard( false ), m_bInflate( false ), m_bEnded( false ), m_bFailed( false )
+{
+	memset( &m_Stream, 0, sizeof(m_Stream) );
+
+	//	Gzip wrapper only, that's what gzopen() read before.
+	if( inflateInit2( &m_Stream, 16 + MAX_WBITS ) != Z_OK )
+	{
+		g_Log->Error( "inflateInit2 failed" );
+		m_bFailed = true;
+	}
+}
+
+/*
+	~CInflateStreamer().
+	Destructor.
+*/
+CInflateStreamer::~CInflateStreamer()
+{
+	g_NetworkManager->Cancel( this );
+	inflateEnd( &m_Stream );
+}
+
+/*
+	customWrite().
+	Inflates what came in and passes it on, data that isn't gzipped is passed on as it is, like gzread() did.
+*/
+int32 CInflateStreamer::customWrite( void *_pBuffer, size_t _size, size_t _nmemb, void *_pUserData )
+{
+	CInflateStreamer *pOut = (CInflateStreamer *)_pUserData;
+	if( !pOut )
+	{
+		g_Log->Info( "Error, no _pUserData." );
+		return -1;
+	}
+
+	const size_t numBytes = _size * _nmemb;
+	const uint8 *pData = (const uint8 *)_pBuffer;
+
+	if( !pOut->m_bChecked && numBytes > 0 )
+	{
+		pOut->m_bChecked = true;
+
+		long code = 0;
+		curl_easy_getinfo( pOut->m_pCurl, CURLINFO_RESPONSE_CODE, &code );
+		pOut->m_bDiscard = ( code != 200 );
+		pOut->m_bInflate = ( pData[0] == 0x1f );
+	}
+
+	if( pOut->m_bDiscard || pOut->m_bEnded )
+		return (int32)numBytes;
+
+	if( pOut->m_bFailed )
+		return 0;
+
+	if( !pOut->m_bInflate )
+		return pOut->Consume( pData, numBytes ) ? (int32)numBytes : 0;
+
+	z_stream &stream = pOut->m_Stream;
+	stream.next_in = (Bytef *)pData;
+	stream.avail_in = (uInt)numBytes;
+
+	do
+	{
+		stream.next_out = pOut->m_Buffer;
+		stream.avail_out = kBufferSize;
+
+		int ret = inflate( &stream, Z_NO_FLUSH );
+		if( ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR )
+		{
+			g_Log->Warning( "%s: inflate failed (%d).", pOut->Name().c_str(), ret );
+			pOut->m_bFailed = true;
+			return 0;
+		}
+
+		const size_t have = kBufferSize - stream.avail_out;
+		if( have > 0 && !pOut->Consume( pOut->m_Buffer, have ) )
+			return 0;
+
+		if( ret == Z_STREAM_END )
+			pOut->m_bEnded = true;
+		else if( ret == Z_BUF_ERROR )
+			break;
+
+	//	A full buffer means there may be more output without more input.
+	} while( !pOut->m_bEnded && ( stream.avail_in > 0 || stream.avail_out == 0 ) );
+
+	return (int32)numBytes;
+}
+
+/*
+	Start().
+*/
+bool	CInflateStreamer::Start( const std::string &_url )
+{
+	if( !Verify( curl_easy_setopt( m_pCurl, CURLOPT_WRITEDATA, this ) ) )	return false;
+	if( !Verify( curl_easy_setopt( m_pCurl, CURLOPT_WRITEFUNCTION, &CInflateStreamer::customWrite ) ) )	return false;
+
+	return CCurlTransfer::Start( _url );
+}
+
+/*
+	Finish().
+	Also fails when the gzip data stopped short.
+*/
+bool	CInflateStreamer::Finish()
+{
+	if( !CCurlTransfer::Finish() )
+		return false;
+
+	if( m_bFailed || ( m_bInflate && !m_bEnded ) )
+	{
+		g_Log->Warning( "%s: incomplete gzip data.", Name().c_str() );
+		Status( "Failed" );
+		return false;
+	}
+
+	return true;
+}
+
 };
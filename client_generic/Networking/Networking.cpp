@@ -5,6 +5,14 @@
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#ifdef LINUX_GNU
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#endif
+#include <boost/bind/bind.hpp>
 #include "Log.h"
 #include "Networking.h"
 
@@ -15,20 +23,14 @@ namespace	Network
 	CCurlTransfer().
 	Constructor.
 */
-CCurlTransfer::CCurlTransfer( const std::string &_name ) : m_Name( _name ), m_Status( "Idle" ), m_AverageSpeed("0 kb/s")
+CCurlTransfer::CCurlTransfer( const std::string &_name ) : m_Name( _name ), m_Status( "Idle" ), m_AverageSpeed("0 kb/s"), m_HttpCode( 0 ), m_NumConnects( 0 ),
+															m_bQueued( false ), m_bDone( false ), m_Result( CURLE_OK )
 {
 	g_Log->Info( "CCurlTransfer(%s)", _name.c_str() );
 	memset(errorBuffer, 0, CURL_ERROR_SIZE);
 	m_pCurl = curl_easy_init();
 	if( !m_pCurl )
 		g_Log->Info( "Failed to init curl instance." );
-		
-	m_pCurlM = curl_multi_init();
-	if( !m_pCurlM )
-		g_Log->Info( "Failed to init curl multi instance." );
-		
-	if ( m_pCurl != NULL && m_pCurlM != NULL )
-		curl_multi_add_handle( m_pCurlM, m_pCurl );
 }
 
 /*
@@ -39,21 +41,15 @@ CCurlTransfer::~CCurlTransfer()
 {
 	//g_NetworkManager->Remove( this );
 	g_Log->Info( "~CCurlTransfer()" );
-	
-	if ( m_pCurlM != NULL && m_pCurl != NULL )
-		curl_multi_remove_handle(m_pCurlM, m_pCurl);
+
+	//	Abandoned while running, the loop thread has to let go of the handle first.
+	g_NetworkManager->Cancel( this );
 
 	if( m_pCurl != NULL )
 	{
 		curl_easy_cleanup( m_pCurl );
 		m_pCurl = NULL;
 	}
-	
-	if ( m_pCurlM != NULL )
-	{
-		curl_multi_cleanup( m_pCurlM );
-		m_pCurlM = NULL;
-	}
 }
 
 /*
@@ -73,23 +69,6 @@ bool CCurlTransfer::Verify( CURLcode _code )
 	return true;
 }
 
-/*
-	VerifyM.
-	User throughout these classes to verify curl multi integrity.
-*/
-bool CCurlTransfer::VerifyM( CURLMcode _code )
-{
-	g_Log->Info( "VerifyM(%d)", _code );
-
-	if( _code != CURLM_OK && _code != CURLM_CALL_MULTI_PERFORM)
-	{
-		Status( curl_multi_strerror( _code ) );
-		return false;
-	}
-
-	return true;
-}
-
 
 /*
 */
@@ -165,106 +144,11 @@ void	CManager::Logout()
 	m_UserPass = "";
 }
 
-bool	CCurlTransfer::InterruptiblePerform()
-{
-	CURLMcode _code;
-	int running_handles, running_handles_last;
-	fd_set fd_read, fd_write, fd_except;
-	int max_fd;
-	long timeout;
-	struct timeval tval, orig_tval;
-
-	_code = curl_multi_perform( m_pCurlM, &running_handles );
-	
-	if ( !VerifyM(_code) )
-		return false;
-	
-	if ( running_handles == 0 )
-		return true;
-
-	running_handles_last = running_handles;
-	_code = CURLM_CALL_MULTI_PERFORM;
-	
-	while( 1 )
-	{
-		while ( _code == CURLM_CALL_MULTI_PERFORM )
-		{
-			if (!g_NetworkManager->SingletonActive() || g_NetworkManager->IsAborted())
-				return false;
-			
-			_code = curl_multi_perform (m_pCurlM, &running_handles );
-		}
-
-		if ( !VerifyM( _code ) )
-			return false;
-
-		if ( running_handles < running_handles_last )
-			break;
-
-		FD_ZERO( &fd_read );
-		FD_ZERO( &fd_write );
-		FD_ZERO( &fd_except );
-
-		_code = curl_multi_fdset( m_pCurlM, &fd_read, &fd_write, &fd_except, &max_fd );
-		
-		if ( !VerifyM( _code ) )
-			return false;
-			
-		if (-1 == max_fd)
-		{
-			_code = CURLM_CALL_MULTI_PERFORM;
-			continue;
-		}
-			
-		timeout = -1;
-		
-#ifdef CURL_MULTI_TIMEOUT
-		_code = curl_multi_timeout( m_pCurlM, &timeout );
-
-		if ( !VerifyM( _code ) )
-			return false;
-#endif
-
-		if (timeout == -1)
-			timeout = 100;
-
-		tval.tv_sec = timeout / 1000;
-		tval.tv_usec = timeout % 1000 * 1000;
-        
-        orig_tval = tval;
-
-		int err;
-		
-		if (!g_NetworkManager->SingletonActive() || g_NetworkManager->IsAborted())
-			return false;
-
-		while ( ( err = select( max_fd + 1, &fd_read, &fd_write, &fd_except, &tval ) ) < 0 )
-		{
-#ifndef WIN32
-			if ( errno != EINTR )
-			{
-				return false;
-			}
-#endif
-			if (!g_NetworkManager->SingletonActive() || g_NetworkManager->IsAborted())
-				return false;
-            
-            //tval should be considered invalid after "select" returns
-            tval = orig_tval;
-		}
-
-		_code = CURLM_CALL_MULTI_PERFORM;
-    }
-
-	return true;
-}
-
-
 /*
-	Perform().
-	Do the actual transfer.
+	Start().
+	Sets the transfer up and queues it on the network manager.
 */
-bool	CCurlTransfer::Perform( const std::string &_url )
+bool	CCurlTransfer::Start( const std::string &_url )
 {
 	if (!g_NetworkManager->SingletonActive() || g_NetworkManager->IsAborted())
 		return false;
@@ -301,8 +185,23 @@ bool	CCurlTransfer::Perform( const std::string &_url )
 
 	Status( "Active" );
 
+	if( !g_NetworkManager->Add( this ) )
+	{
+		Status( "Failed" );
+		return false;
+	}
+
+	return true;
+}
+
+/*
+	Finish().
+	Waits for a Start()ed transfer to end and checks how it went.
+*/
+bool	CCurlTransfer::Finish()
+{
 	//if( !Verify( curl_easy_perform( m_pCurl ) ) )
-	if ( !InterruptiblePerform() )
+	if ( g_NetworkManager->Wait( this ) != CURLE_OK )
 	{
 		g_Log->Warning( errorBuffer );
 		Status( "Failed" );
@@ -314,6 +213,9 @@ bool	CCurlTransfer::Perform( const std::string &_url )
 	//	Need to do this to trigger the strings to propagate.
 	g_NetworkManager->UpdateProgress( this, 100, 0 );
 
+	//	Zero when it went over a connection an earlier transfer left open.
+	curl_easy_getinfo( m_pCurl, CURLINFO_NUM_CONNECTS, &m_NumConnects );
+
 	if( !Verify( curl_easy_getinfo( m_pCurl, CURLINFO_RESPONSE_CODE, &m_HttpCode ) ) ) return false;
 	if( m_HttpCode != 200 )
 	{
@@ -363,11 +265,23 @@ bool	CCurlTransfer::Perform( const std::string &_url )
 	return true;
 }
 
+/*
+	Perform().
+	Do the actual transfer.
+*/
+bool	CCurlTransfer::Perform( const std::string &_url )
+{
+	return Start( _url ) && Finish();
+}
+
 /*
 	CManager().
 	Constructor.
 */
-CManager::CManager()
+CManager::CManager() : m_Aborted( false ), m_pMulti( NULL ), m_pShare( NULL ), m_pLoopThread( NULL ), m_bStopLoop( false )
+#ifdef LINUX_GNU
+						, m_Epoll( -1 ), m_WakeFd( -1 ), m_DeadlineMs( -1 )
+#endif
 {
 }
 
@@ -384,7 +298,53 @@ bool	CManager::Startup()
 	m_ProxyUserPass = "";
 	
 	m_Aborted = false;
-	
+
+	m_pShare = curl_share_init();
+	if( m_pShare != NULL )
+	{
+		curl_share_setopt( m_pShare, CURLSHOPT_LOCKFUNC, &CManager::ShareLock );
+		curl_share_setopt( m_pShare, CURLSHOPT_UNLOCKFUNC, &CManager::ShareUnlock );
+		curl_share_setopt( m_pShare, CURLSHOPT_USERDATA, this );
+		curl_share_setopt( m_pShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS );
+		curl_share_setopt( m_pShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION );
+	}
+	else
+		g_Log->Warning( "Failed to init curl share instance." );
+
+	//	The multi handle keeps the connections of finished transfers open for the next ones to the same server.
+	m_pMulti = curl_multi_init();
+	if( m_pMulti == NULL )
+	{
+		g_Log->Error( "Failed to init curl multi instance." );
+		return false;
+	}
+
+#ifdef LINUX_GNU
+	m_Epoll = epoll_create( 16 );
+	m_WakeFd = eventfd( 0, EFD_NONBLOCK );
+	if( m_Epoll < 0 || m_WakeFd < 0 )
+	{
+		g_Log->Error( "Failed to create the network event loop." );
+		Shutdown();
+		return false;
+	}
+
+	struct epoll_event ev;
+	memset( &ev, 0, sizeof(ev) );
+	ev.events = EPOLLIN;
+	ev.data.fd = m_WakeFd;
+	epoll_ctl( m_Epoll, EPOLL_CTL_ADD, m_WakeFd, &ev );
+
+	m_DeadlineMs = -1;
+	curl_multi_setopt( m_pMulti, CURLMOPT_SOCKETFUNCTION, &CManager::SocketCallback );
+	curl_multi_setopt( m_pMulti, CURLMOPT_SOCKETDATA, this );
+	curl_multi_setopt( m_pMulti, CURLMOPT_TIMERFUNCTION, &CManager::TimerCallback );
+	curl_multi_setopt( m_pMulti, CURLMOPT_TIMERDATA, this );
+#endif
+
+	m_bStopLoop = false;
+	m_pLoopThread = new boost::thread( boost::bind( &CManager::Loop, this ) );
+
 	return true;
 }
 
@@ -394,10 +354,399 @@ bool	CManager::Startup()
 */
 bool	CManager::Shutdown()
 {
+	//	The loop fails whatever is still running on its way out.
+	if( m_pLoopThread != NULL )
+	{
+		{
+			boost::mutex::scoped_lock lock( m_LoopLock );
+			m_bStopLoop = true;
+		}
+
+		Wake();
+		m_pLoopThread->join();
+		SAFE_DELETE( m_pLoopThread );
+	}
+
+	if( m_pMulti != NULL )
+	{
+		curl_multi_cleanup( m_pMulti );
+		m_pMulti = NULL;
+	}
+
+	if( m_pShare != NULL )
+	{
+		if( curl_share_cleanup( m_pShare ) != CURLSHE_OK )
+			g_Log->Warning( "Curl share instance still in use." );
+		m_pShare = NULL;
+	}
+
+#ifdef LINUX_GNU
+	if( m_WakeFd >= 0 )
+		close( m_WakeFd );
+	if( m_Epoll >= 0 )
+		close( m_Epoll );
+	m_WakeFd = m_Epoll = -1;
+#endif
+
 	curl_global_cleanup();
 	return true;
 }
 
+/*
+	ShareLock(), ShareUnlock().
+	Curl locks the dns cache and tls sessions through these.
+*/
+void	CManager::ShareLock( CURL * /*_pCurl*/, curl_lock_data _data, curl_lock_access /*_access*/, void *_pUserData )
+{
+	((CManager *)_pUserData)->m_ShareLocks[ _data ].lock();
+}
+
+void	CManager::ShareUnlock( CURL * /*_pCurl*/, curl_lock_data _data, void *_pUserData )
+{
+	((CManager *)_pUserData)->m_ShareLocks[ _data ].unlock();
+}
+
+#ifdef LINUX_GNU
+/*
+	SocketCallback().
+	Curl tells which of its sockets to watch for what, they go in the epoll set.
+*/
+int	CManager::SocketCallback( CURL * /*_pCurl*/, curl_socket_t _socket, int _what, void *_pUserData, void * /*_pSocketData*/ )
+{
+	CManager *pManager = (CManager *)_pUserData;
+
+	if( _what == CURL_POLL_REMOVE )
+	{
+		epoll_ctl( pManager->m_Epoll, EPOLL_CTL_DEL, _socket, NULL );
+		return 0;
+	}
+
+	struct epoll_event ev;
+	memset( &ev, 0, sizeof(ev) );
+	ev.events = ( ( _what & CURL_POLL_IN ) ? (uint32_t)EPOLLIN : (uint32_t)0 ) | ( ( _what & CURL_POLL_OUT ) ? (uint32_t)EPOLLOUT : (uint32_t)0 );
+	ev.data.fd = _socket;
+
+	if( epoll_ctl( pManager->m_Epoll, EPOLL_CTL_ADD, _socket, &ev ) != 0 && errno == EEXIST )
+		epoll_ctl( pManager->m_Epoll, EPOLL_CTL_MOD, _socket, &ev );
+
+	return 0;
+}
+
+/*
+	NowMs().
+*/
+int64	CManager::NowMs()
+{
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (int64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+	TimerCallback().
+	When curl wants to be called next whatever the sockets do, -1 is never. Kept as a deadline, the loop waits for what is left of it.
+*/
+int	CManager::TimerCallback( CURLM * /*_pMulti*/, long _timeoutMs, void *_pUserData )
+{
+	((CManager *)_pUserData)->m_DeadlineMs = ( _timeoutMs < 0 ) ? -1 : NowMs() + _timeoutMs;
+	return 0;
+}
+#endif
+
+/*
+	Wake().
+	Gets the loop out of its wait, to pick up new transfers, cancels and aborts.
+*/
+void	CManager::Wake()
+{
+#ifdef LINUX_GNU
+	if( m_WakeFd >= 0 )
+	{
+		uint64_t one = 1;
+		//	Can only fail if the counter is about to overflow, a wake is pending then anyway.
+		const ssize_t written = write( m_WakeFd, &one, sizeof(one) );
+		(void)written;
+	}
+#elif LIBCURL_VERSION_NUM >= 0x074400
+	if( m_pMulti != NULL )
+		curl_multi_wakeup( m_pMulti );
+#endif
+}
+
+/*
+	Loop().
+	The network thread, drives every transfer on the multi handle.
+*/
+void	CManager::Loop()
+{
+	int running = 0;
+
+	while( 1 )
+	{
+		{
+			boost::mutex::scoped_lock lock( m_LoopLock );
+			if( m_bStopLoop )
+				break;
+		}
+
+		TakeAdded();
+
+#ifdef LINUX_GNU
+		int waitMs = -1;
+		if( m_DeadlineMs >= 0 )
+			waitMs = (int)std::max( m_DeadlineMs - NowMs(), (int64)0 );
+
+		struct epoll_event events[ 32 ];
+		int numEvents = epoll_wait( m_Epoll, events, 32, waitMs );
+
+		for( int i=0; i<numEvents; i++ )
+		{
+			if( events[i].data.fd == m_WakeFd )
+			{
+				uint64_t count;
+				//	Nothing to read means the wakes were taken already, either way it is empty now.
+				const ssize_t taken = read( m_WakeFd, &count, sizeof(count) );
+				(void)taken;
+				continue;
+			}
+
+			int flags = 0;
+			if( events[i].events & EPOLLIN )
+				flags |= CURL_CSELECT_IN;
+			if( events[i].events & EPOLLOUT )
+				flags |= CURL_CSELECT_OUT;
+			if( events[i].events & ( EPOLLERR | EPOLLHUP ) )
+				flags |= CURL_CSELECT_ERR;
+
+			curl_multi_socket_action( m_pMulti, events[i].data.fd, flags, &running );
+		}
+
+		//	Busy sockets don't hold up curl's timers, connect timeouts and stall checks run off those.
+		if( m_DeadlineMs >= 0 && NowMs() >= m_DeadlineMs )
+		{
+			m_DeadlineMs = -1;
+			curl_multi_socket_action( m_pMulti, CURL_SOCKET_TIMEOUT, 0, &running );
+		}
+#else
+		curl_multi_perform( m_pMulti, &running );
+
+#if LIBCURL_VERSION_NUM >= 0x074400
+		curl_multi_poll( m_pMulti, NULL, 0, 1000, NULL );
+#else
+		curl_multi_wait( m_pMulti, NULL, 0, 100, NULL );
+#endif
+#endif
+
+		TakeDone();
+	}
+
+	//	Shutting down, nothing gets to finish.
+	for( size_t i=0; i<m_Running.size(); i++ )
+	{
+		curl_multi_remove_handle( m_pMulti, m_Running[i]->m_pCurl );
+		Complete( m_Running[i], CURLE_ABORTED_BY_CALLBACK );
+	}
+	m_Running.clear();
+
+	boost::mutex::scoped_lock lock( m_LoopLock );
+	for( size_t i=0; i<m_Added.size(); i++ )
+	{
+		m_Added[i]->m_Result = CURLE_ABORTED_BY_CALLBACK;
+		m_Added[i]->m_bDone = true;
+	}
+	m_Added.clear();
+	m_TransferDone.notify_all();
+}
+
+/*
+	TakeAdded().
+	Loop thread. Puts new transfers on the multi handle and takes cancelled ones off, all of them once aborted.
+*/
+void	CManager::TakeAdded()
+{
+	std::vector<CCurlTransfer *> added, cancelled;
+	{
+		boost::mutex::scoped_lock lock( m_LoopLock );
+		added.swap( m_Added );
+		cancelled.swap( m_Cancelled );
+	}
+
+	const bool bAborted = IsAborted();
+
+	for( size_t i=0; i<added.size(); i++ )
+	{
+		if( bAborted )
+		{
+			Complete( added[i], CURLE_ABORTED_BY_CALLBACK );
+			continue;
+		}
+
+		CURLMcode code = curl_multi_add_handle( m_pMulti, added[i]->m_pCurl );
+		if( code != CURLM_OK )
+		{
+			g_Log->Warning( "Failed to start %s: %s", added[i]->Name().c_str(), curl_multi_strerror( code ) );
+			Complete( added[i], CURLE_FAILED_INIT );
+			continue;
+		}
+
+		m_Running.push_back( added[i] );
+	}
+
+	if( bAborted )
+		cancelled = m_Running;
+
+	for( size_t i=0; i<cancelled.size(); i++ )
+	{
+		//	Not running anymore if it finished meanwhile.
+		std::vector<CCurlTransfer *>::iterator it = std::find( m_Running.begin(), m_Running.end(), cancelled[i] );
+		if( it == m_Running.end() )
+			continue;
+
+		m_Running.erase( it );
+		curl_multi_remove_handle( m_pMulti, cancelled[i]->m_pCurl );
+		Complete( cancelled[i], CURLE_ABORTED_BY_CALLBACK );
+	}
+}
+
+/*
+	TakeDone().
+	Loop thread. Takes finished transfers off the multi handle and wakes whoever waits for them.
+*/
+void	CManager::TakeDone()
+{
+	CURLMsg *pMsg;
+	int msgsLeft;
+	while( ( pMsg = curl_multi_info_read( m_pMulti, &msgsLeft ) ) != NULL )
+	{
+		if( pMsg->msg != CURLMSG_DONE )
+			continue;
+
+		//	The message is gone once the handle is removed.
+		CURL *pCurl = pMsg->easy_handle;
+		CURLcode result = pMsg->data.result;
+
+		char *pPrivate = NULL;
+		curl_easy_getinfo( pCurl, CURLINFO_PRIVATE, &pPrivate );
+		CCurlTransfer *pTransfer = (CCurlTransfer *)pPrivate;
+
+		curl_multi_remove_handle( m_pMulti, pCurl );
+
+		std::vector<CCurlTransfer *>::iterator it = std::find( m_Running.begin(), m_Running.end(), pTransfer );
+		if( it != m_Running.end() )
+			m_Running.erase( it );
+
+		if( pTransfer != NULL )
+			Complete( pTransfer, result );
+	}
+}
+
+/*
+	Complete().
+	Loop thread. Hands the result to Wait().
+*/
+void	CManager::Complete( CCurlTransfer *_pTransfer, const CURLcode _result )
+{
+	boost::mutex::scoped_lock lock( m_LoopLock );
+	_pTransfer->m_Result = _result;
+	_pTransfer->m_bDone = true;
+	m_TransferDone.notify_all();
+}
+
+/*
+	Add().
+	Queues a prepared transfer for the loop thread, false if the manager isn't running.
+*/
+bool	CManager::Add( CCurlTransfer *_pTransfer )
+{
+	if( _pTransfer->m_pCurl == NULL )
+		return false;
+
+	curl_easy_setopt( _pTransfer->m_pCurl, CURLOPT_PRIVATE, _pTransfer );
+
+	{
+		boost::mutex::scoped_lock lock( m_LoopLock );
+		if( m_pLoopThread == NULL || m_bStopLoop || _pTransfer->m_bQueued )
+			return false;
+
+		_pTransfer->m_bQueued = true;
+		_pTransfer->m_bDone = false;
+		m_Added.push_back( _pTransfer );
+	}
+
+	Wake();
+	return true;
+}
+
+/*
+	Wait().
+	Blocks until an Add()ed transfer is over, and returns how it ended.
+	Not an interruption point, aborts come through the progress callbacks as they always did.
+*/
+CURLcode	CManager::Wait( CCurlTransfer *_pTransfer )
+{
+	boost::this_thread::disable_interruption noInterruption;
+	boost::mutex::scoped_lock lock( m_LoopLock );
+
+	if( !_pTransfer->m_bQueued )
+		return CURLE_FAILED_INIT;
+
+	while( !_pTransfer->m_bDone )
+		m_TransferDone.wait( lock );
+
+	_pTransfer->m_bQueued = false;
+	return _pTransfer->m_Result;
+}
+
+/*
+	WaitAny().
+	Blocks until one of _transfers is over, and returns its index, Wait() (or Finish()) for it then returns right away.
+	NULL entries and transfers that never made it onto the loop count as over.
+*/
+size_t	CManager::WaitAny( const std::vector<CCurlTransfer *> &_transfers )
+{
+	boost::this_thread::disable_interruption noInterruption;
+	boost::mutex::scoped_lock lock( m_LoopLock );
+
+	while( true )
+	{
+		for( size_t i=0; i<_transfers.size(); i++ )
+			if( _transfers[i] == NULL || !_transfers[i]->m_bQueued || _transfers[i]->m_bDone )
+				return i;
+
+		m_TransferDone.wait( lock );
+	}
+}
+
+/*
+	Cancel().
+	Takes a transfer off the loop before it is destroyed, and waits until the loop let go of it.
+*/
+void	CManager::Cancel( CCurlTransfer *_pTransfer )
+{
+	boost::this_thread::disable_interruption noInterruption;
+	boost::mutex::scoped_lock lock( m_LoopLock );
+
+	if( !_pTransfer->m_bQueued )
+		return;
+
+	if( !_pTransfer->m_bDone )
+	{
+		std::vector<CCurlTransfer *>::iterator it = std::find( m_Added.begin(), m_Added.end(), _pTransfer );
+		if( it != m_Added.end() )
+			m_Added.erase( it );
+		else
+		{
+			m_Cancelled.push_back( _pTransfer );
+			Wake();
+
+			while( !_pTransfer->m_bDone )
+				m_TransferDone.wait( lock );
+		}
+	}
+
+	_pTransfer->m_bQueued = false;
+}
+
 /*
 	Prepare()-
 	Called from CCurlTransfer::Perform().
@@ -430,8 +779,13 @@ CURLcode	CManager::Prepare( CURL *_pCurl )
 
 		if( m_ProxyUserPass != "" )
 			code = curl_easy_setopt( _pCurl, CURLOPT_PROXYUSERPWD, m_ProxyUserPass.c_str() );
+		if( code != CURLE_OK )	return code;
 	}
 
+	//	Dns cache and tls sessions of all transfers.
+	if( m_pShare != NULL )
+		code = curl_easy_setopt( _pCurl, CURLOPT_SHARE, m_pShare );
+
 	return code;
 }
 
@@ -441,9 +795,14 @@ CURLcode	CManager::Prepare( CURL *_pCurl )
 */
 void	CManager::Abort( void )
 {
-	boost::mutex::scoped_lock locker( m_Lock );
-	
-	m_Aborted = true;
+	{
+		boost::mutex::scoped_lock locker( m_Lock );
+
+		m_Aborted = true;
+	}
+
+	//	So running transfers stop now rather than at their next progress callback.
+	Wake();
 }
 
 /*
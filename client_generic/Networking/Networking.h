@@ -7,6 +7,7 @@
 #include	<curl/easy.h>
 #include	<curl/multi.h>
 #include	<boost/thread.hpp>
+#include	<zlib.h>
 
 #include	"base.h"
 #include	"SmartPtr.h"
@@ -33,17 +34,21 @@ class	CCurlTransfer
 	std::string m_Status;
 	std::string m_AverageSpeed;
 	long		m_HttpCode;
+	long		m_NumConnects;
     char errorBuffer[ CURL_ERROR_SIZE ];
 
 	//	Map of respons codes allowed. This is checkd on failed perform's.
 	std::vector< uint32 > m_AllowedResponses;
 
+	//	Set by CManager, under its loop lock.
+	bool		m_bQueued;
+	bool		m_bDone;
+	CURLcode	m_Result;
+
 	protected:
 		CURL		*m_pCurl;
-		CURLM		*m_pCurlM;
 
 		bool	Verify( CURLcode _code );
-		bool	VerifyM( CURLMcode _code );
 		void	Status( const std::string &_status )	{	m_Status = _status; };
 
 	public:
@@ -52,8 +57,11 @@ class	CCurlTransfer
 
 		static int32 customProgressCallback( void *_pUserData, curl_off_t _downTotal, curl_off_t _downNow, curl_off_t _upTotal, curl_off_t _upNow );
 
-		virtual bool	InterruptiblePerform();
-		
+		//	Start() hands the transfer to the network manager and returns right away, Finish() waits for it and checks the outcome.
+		virtual bool	Start( const std::string &_url );
+		virtual bool	Finish();
+
+		//	Both of the above.
 		virtual bool	Perform( const std::string &_url );
 
 		//	Add a response code to the list of allowed ones.
@@ -62,6 +70,8 @@ class	CCurlTransfer
 		const std::string	&Name() const				{	return m_Name;			};
 		const std::string	&Status() const				{	return m_Status;		};
 		long 			ResponseCode() const		{	return m_HttpCode;		};
+		long			NumConnects() const			{	return m_NumConnects;	};
+		CURLcode		Result() const				{	return m_Result;		};
 		const std::string	SpeedString() const			{	return m_AverageSpeed;	};
 };
 
@@ -76,7 +86,7 @@ class	CFileDownloader : public CCurlTransfer
 		CFileDownloader( const std::string &_name );
 		virtual ~CFileDownloader();
 
-		virtual bool	Perform( const std::string &_url );
+		virtual bool	Start( const std::string &_url );
 		bool	Save( const std::string &_output );
 
 		const std::string &Data()								{ return m_Data;			};
@@ -92,6 +102,77 @@ class	CFileDownloader_TimeCondition : public CFileDownloader
 		bool	PerformDownloadWithTC( const std::string &_url, const time_t _lastTime );
 };
 
+/*
+	CFileStreamer.
+	Downloads straight into a file through a small buffer, so memory use doesn't grow with the file.
+	A file that is already there gets resumed with a range request, and the size is checked as the data comes in.
+*/
+class	CFileStreamer : public CCurlTransfer
+{
+	enum { kBufferSize = 256 * 1024 };
+
+	std::string	m_Output;
+	FILE		*m_pFile;
+
+	//	Bytes that were there before, bytes there now, and the size the file should end up with, 0 if unknown.
+	uint64		m_Offset;
+	uint64		m_Written;
+	uint64		m_ExpectedSize;
+
+	bool		m_bChecked;
+	bool		m_bDiscard;
+	bool		m_bMismatch;
+	bool		m_bAlreadyComplete;
+
+	void	Close();
+
+	public:
+		static int32 customWrite( void *_pBuffer, size_t _size, size_t _nmemb, void *_pUserData );
+
+		CFileStreamer( const std::string &_name );
+		virtual ~CFileStreamer();
+
+		//	Opens _output to append to, call before Start().
+		bool	Open( const std::string &_output, const uint64 _expectedSize );
+
+		virtual bool	Start( const std::string &_url );
+		virtual bool	Finish();
+
+		uint64	Size() const	{	return m_Written;	};
+};
+
+/*
+	CInflateStreamer.
+	Hands the response body to Consume() piece by piece as it comes in, gunzipped on the fly when it is gzip data.
+	Consume() runs on the network thread, derived classes have to Cancel() themselves in their destructor like the others here.
+*/
+class	CInflateStreamer : public CCurlTransfer
+{
+	enum { kBufferSize = 16 * 1024 };
+
+	z_stream	m_Stream;
+	uint8		m_Buffer[ kBufferSize ];
+
+	bool		m_bChecked;
+	bool		m_bDiscard;
+	bool		m_bInflate;
+	bool		m_bEnded;
+	bool		m_bFailed;
+
+	protected:
+		//	The next piece of the body, false stops the transfer.
+		virtual bool	Consume( const uint8 *_pData, const size_t _len ) = 0;
+
+	public:
+		static int32 customWrite( void *_pBuffer, size_t _size, size_t _nmemb, void *_pUserData );
+
+		CInflateStreamer( const std::string &_name );
+		virtual ~CInflateStreamer();
+
+		virtual bool	Start( const std::string &_url );
+		virtual bool	Finish();
+};
+
 //
 class	CFileUploader : public CCurlTransfer
 {
@@ -106,12 +187,16 @@ class	CFileUploader : public CCurlTransfer
 MakeSmartPointers( CCurlTransfer );
 MakeSmartPointers( CFileDownloader );
 MakeSmartPointers( CFileDownloader_TimeCondition );
+MakeSmartPointers( CFileStreamer );
+MakeSmartPointers( CInflateStreamer );
 MakeSmartPointers( CFileUploader );
 
 
 /*
 	CManager().
 	The main manager.
+	Runs every transfer on one curl multi handle from its own thread, so they go on in parallel and reuse connections,
+	dns lookups and tls sessions of earlier ones.
 */
 MakeSmartPointers( CManager );
 class	CManager : public Base::CSingleton<CManager>
@@ -137,6 +222,42 @@ class	CManager : public Base::CSingleton<CManager>
 
 	bool			m_Aborted;
 
+	//	Everything below belongs to the loop thread, but for what is guarded by m_LoopLock.
+	CURLM			*m_pMulti;
+	CURLSH			*m_pShare;
+	boost::mutex	m_ShareLocks[ CURL_LOCK_DATA_LAST ];
+
+	boost::thread	*m_pLoopThread;
+	bool			m_bStopLoop;
+
+	boost::mutex				m_LoopLock;
+	boost::condition_variable	m_TransferDone;
+	std::vector<CCurlTransfer *>	m_Added;
+	std::vector<CCurlTransfer *>	m_Cancelled;
+	std::vector<CCurlTransfer *>	m_Running;
+
+#ifdef LINUX_GNU
+	//	epoll set of curl's sockets and the eventfd that wakes the loop, and when curl wants to be called next.
+	int				m_Epoll;
+	int				m_WakeFd;
+	int64			m_DeadlineMs;
+
+	//	Monotonic milliseconds, what m_DeadlineMs is in.
+	static int64	NowMs();
+
+	static int	SocketCallback( CURL *_pCurl, curl_socket_t _socket, int _what, void *_pUserData, void *_pSocketData );
+	static int	TimerCallback( CURLM *_pMulti, long _timeoutMs, void *_pUserData );
+#endif
+
+	static void	ShareLock( CURL *_pCurl, curl_lock_data _data, curl_lock_access _access, void *_pUserData );
+	static void	ShareUnlock( CURL *_pCurl, curl_lock_data _data, void *_pUserData );
+
+	void	Loop();
+	void	Wake();
+	void	TakeAdded();
+	void	TakeDone();
+	void	Complete( CCurlTransfer *_pTransfer, const CURLcode _result );
+
 	public:
 			bool	Startup();
 			bool	Shutdown();
@@ -155,6 +276,12 @@ class	CManager : public Base::CSingleton<CManager>
 			//	Called by CCurlTransfer prior to each Perform() call to handle proxy & authentication.
 			CURLcode Prepare( CURL *_pCurl );
 
+			//	Called by CCurlTransfer to run, wait for and cancel transfers on the loop thread.
+			bool	Add( CCurlTransfer *_pTransfer );
+			CURLcode	Wait( CCurlTransfer *_pTransfer );
+			size_t	WaitAny( const std::vector<CCurlTransfer *> &_transfers );
+			void	Cancel( CCurlTransfer *_pTransfer );
+
 			//	Used by the transfers to update progress.
 			void	UpdateProgress( CCurlTransfer *_pTransfer, const fp8 _percentComplete, const fp8 _bytesTransferred );
 
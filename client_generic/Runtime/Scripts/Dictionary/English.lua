@@ -20,6 +20,12 @@ LoopIterations	= "The number of times to display a looping sheep",
 PieceWiseLinear	= "Piecewise linear display. Produces smoother playback by interpolating across frames.",
 player_fps		= "The number of times per second at which to decode a fresh frame from the sheep.\nLower this value if your machine isn't fast enough to keep up",
 BufferLength	= "How many complete frames to buffer in advance.\nLower this value if ram is an issue.",
+DecoderThreads	= "How many threads the video decoder may use, shared by both sheep during a transition.\n0 uses one thread per processor core.",
+CPUInterpolation	= "Interpolate between frames on the processor when the graphics card has no shaders.\nTurn this off on slow machines.",
+LoopCacheMB	= "Memory in megabytes for keeping the pictures of a looping sheep, so repeats don't decode it again.\nSheep that don't fit are decoded every time, 0 turns this off.",
+AdaptiveDecode	= "Lower the decoding quality for a while when the machine can't keep up, instead of stuttering.",
+DXTFrames	= "Transcode sheep to compressed texture frames in the background and play those, nearly no cpu needed for playback. Takes about 15 times the disk space of the sheep.",
+TextureArray	= "Keep the frames being blended in one texture array, fewer texture switches per frame. Turn this off if the picture comes out wrong.",
 
 
 --	Content tab.
@@ -29,6 +35,7 @@ server = "The sheep server",
 sheepdir = "Location of your sheep cache",
 cache_size = "The amount of disk space the sheep may consume",
 download_mode = "Enables the downloading of new sheep",
+parallel_downloads = "How many sheep to download at the same time",
 use_bittorrent = "Use BitTorrent peer-to-peer downloading (disabled in beta)",
 registered = "Are you a registered user?",
 password = "Your password",
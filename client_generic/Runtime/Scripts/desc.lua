@@ -7,11 +7,18 @@ LoopIterations	= { type="int", min=0, max=8 },
 PieceWiseLinear	= { type="bool" },
 player_fps		= { type="int", min=5, max=60 },
 BufferLength	= { type="int", min=1, max=200 },
+DecoderThreads	= { type="int", min=0, max=16 },
+CPUInterpolation	= { type="bool" },
+LoopCacheMB	= { type="int", min=0, max=2048 },
+AdaptiveDecode	= { type="bool" },
+DXTFrames	= { type="bool" },
+TextureArray	= { type="bool" },
 
 --	content
 server = { type="string" },
 sheepdir = { type="string" },
 download_mode = { type="bool" },
+parallel_downloads = { type="int", min=1, max=8 },
 --use_bittorrent = { type="bool" },
 registered = { type="bool" },
 password = { type="pass" },